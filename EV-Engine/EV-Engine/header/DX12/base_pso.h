@@ -25,6 +25,20 @@ namespace EV
 
         virtual void Apply(CommandList& commandList) = 0;
 
+        /**
+         * Instanced draws, for PSOs whose vertex shader fetches its matrices per instance.
+         * SetInstances replaces the world matrix with one per instance, which the next
+         * Apply uploads together. SetFirstInstance picks where the instances of the next
+         * draw start (SV_InstanceID starts at 0 for every draw). SetWorldMatrix goes
+         * back to a single instance.
+         */
+        virtual bool SupportsInstancing() const
+        {
+            return false;
+        }
+        virtual void SetInstances(const DirectX::XMMATRIX* /*worldMatrices*/, uint32_t /*count*/) {}
+        virtual void SetFirstInstance(uint32_t /*firstInstance*/) {}
+
         std::wstring GetModulePath();
 
 
@@ -39,7 +53,9 @@ namespace EV
             DF_Material = (1 << 3),
             DF_Matrices = (1 << 4),
             DF_Camera = (1 << 5),
-            DF_All = DF_PointLights | DF_SpotLights | DF_DirectionalLights | DF_Material | DF_Matrices
+            DF_IBL = (1 << 6),
+            DF_FirstInstance = (1 << 7),
+            DF_All = DF_PointLights | DF_SpotLights | DF_DirectionalLights | DF_Material | DF_Matrices | DF_Camera | DF_IBL | DF_FirstInstance
         };
 
     	// Transformation matrices for the vertex shader.
@@ -0,0 +1,113 @@
+#pragma once
+
+/**
+ *  @file bounding_volume_hierarchy.h
+ *
+ *  @brief A binary BVH over world space boxes, built with the binned surface
+ *  area heuristic. Scene keeps one over the meshes of its nodes (see
+ *  Scene::UpdateBVH), so visibility, picking and overlap queries only touch the
+ *  part of the scene they hit instead of every node.
+ */
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace EV
+{
+    struct BVHBox
+    {
+        DirectX::XMFLOAT3 min;
+        DirectX::XMFLOAT3 max;
+    };
+
+    class BoundingVolumeHierarchy
+    {
+    public:
+        struct Node
+        {
+            BVHBox   bounds;
+            uint32_t left;   // Index of the left child, the right one follows it. 0 for leaves.
+            uint32_t first;  // The items below the node are GetItems()[first, first + count).
+            uint32_t count;
+        };
+
+        /**
+         * Build the tree over count boxes, item i is boxes[i].
+         */
+        void Build(const BVHBox* boxes, uint32_t count);
+
+        /**
+         * Move the boxes of the items (the same items the tree was built over) and
+         * grow or shrink every node around them, without changing the tree.
+         */
+        void Refit(const BVHBox* boxes);
+
+        /**
+         * Expected cost of a query, the surface area heuristic summed over the tree.
+         * Refits make it grow when items move apart, compare against GetBuildCost
+         * to decide when to build again.
+         */
+        float GetCost() const;
+        float GetBuildCost() const
+        {
+            return m_buildCost;
+        }
+
+        /**
+         * Items whose box is inside or intersects the six planes (a, b, c, d),
+         * ax + by + cz + d >= 0 inside. Subtrees completely inside are added without
+         * testing their boxes.
+         */
+        void QueryFrustum(const float planes[6][4], std::vector<uint32_t>& outItems) const;
+
+        /**
+         * Items whose box overlaps the sphere.
+         */
+        void QuerySphere(const DirectX::XMFLOAT3& center, float radius, std::vector<uint32_t>& outItems) const;
+
+        /**
+         * Nearest item along the ray within maxDistance, boxes are visited front
+         * to back. hitItem gets an item whose box the ray enters at boxDistance
+         * and returns the distance of the actual hit (e.g. against its triangles),
+         * or a negative value for a miss. Without it the box is the hit.
+         * @returns false if nothing was hit.
+         */
+        bool RayCast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance,
+                     uint32_t& outItem, float& outDistance,
+                     const std::function<float(uint32_t item, float boxDistance)>& hitItem = nullptr) const;
+
+        bool IsEmpty() const
+        {
+            return m_nodes.empty();
+        }
+        const BVHBox& GetBounds() const
+        {
+            return m_nodes[0].bounds;
+        }
+        const std::vector<Node>& GetNodes() const
+        {
+            return m_nodes;
+        }
+        const std::vector<uint32_t>& GetItems() const
+        {
+            return m_items;
+        }
+        uint32_t GetDepth() const
+        {
+            return m_depth;
+        }
+
+    private:
+        void BuildNode(uint32_t node, uint32_t first, uint32_t count, uint32_t depth);
+
+        std::vector<Node>              m_nodes;
+        std::vector<uint32_t>          m_items;      // Item indices, every node's items are contiguous.
+        std::vector<BVHBox>            m_boxes;      // Per item.
+        std::vector<DirectX::XMFLOAT3> m_centroids;  // Per item, only while building.
+        float                          m_buildCost = 0.0f;
+        uint32_t                       m_depth = 0;
+    };
+}  // namespace EV
@@ -55,6 +55,7 @@ namespace EV
 {
     struct VertexPositionNormalTangentBitangentTexture;
     class Scene;
+    class MeshGenerator;
     class PipelineStateObject;
     // class PipelineStateObject;
     class Buffer;
@@ -459,6 +460,64 @@ namespace EV
                                            uint32_t subdivisionDepth,
                                            bool reverseWinding = false);
 
+        /**
+         * Create a scene that contains a single node with a single mesh.
+         *
+         * The generator writes straight into one mapped upload resource, rows
+         * split over the thread pool, which is then copied into the vertex and
+         * index buffers. Indices are 16 bit when the vertices fit.
+         */
+        std::shared_ptr<Scene> CreateScene(const MeshGenerator& generator);
+
+        struct MeshStats
+        {
+            uint32_t    numVertices = 0;
+            uint32_t    numIndices = 0;
+            DXGI_FORMAT indexFormat = DXGI_FORMAT_UNKNOWN;
+            // Bytes written to the upload resource and copied to the GPU.
+            size_t      uploadBytes = 0;
+            // Wall time of the generation in milliseconds.
+            double      generateTime = 0.0;
+        };
+
+        /**
+         * Statistics of the last mesh created with CreateScene.
+         */
+        const MeshStats& GetLastMeshStats() const
+        {
+            return m_lastMeshStats;
+        }
+
+        /**
+         * Pipeline state set on the command list since the last Reset. Only what
+         * actually reaches the D3D12 command list counts, setting the bound PSO, root
+         * signature or buffers again is skipped.
+         */
+        struct StateStats
+        {
+            uint32_t pipelineStates = 0;
+            uint32_t rootSignatures = 0;
+            uint32_t rootBuffers = 0;          // Dynamic constant and structured buffers.
+            uint32_t shaderResourceViews = 0;  // Descriptors staged for descriptor tables.
+            uint32_t vertexBuffers = 0;
+            uint32_t indexBuffers = 0;
+            uint32_t draws = 0;
+        };
+
+        const StateStats& GetStateStats() const
+        {
+            return m_stateStats;
+        }
+
+        /**
+         * The root signature bound last, nullptr after Reset. Root arguments set for
+         * another root signature are gone.
+         */
+        ID3D12RootSignature* GetBoundRootSignature() const
+        {
+            return m_rootSignature;
+        }
+
 
     protected:
         // friend class CommandQueue;
@@ -466,15 +525,6 @@ namespace EV
         // friend class std::default_delete<CommandList>;
 
     private:
-        // Used for procedural mesh generation.
-        using VertexCollection = std::vector<VertexPositionNormalTangentBitangentTexture>;
-        using IndexCollection = std::vector<uint32_t>;
-
-
-        // Create a scene that contains a single node with a single mesh.
-        std::shared_ptr<Scene> CreateScene(const VertexCollection& vertices, const IndexCollection& indices);
-
-
         // void TrackObject(Microsoft::WRL::ComPtr<ID3D12Object> object);
         void TrackResource(const std::shared_ptr<Resource>& res);
 
@@ -510,6 +560,11 @@ namespace EV
         ID3D12RootSignature* m_rootSignature;
         // Keep track of the currently bond pipeline state object to minimize PSO changes.
         ID3D12PipelineState* m_pipelineState;
+        // And of the bound vertex and index buffers, meshes drawn in a row bind them once.
+        D3D12_VERTEX_BUFFER_VIEW m_vertexBufferViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+        D3D12_INDEX_BUFFER_VIEW  m_indexBufferView = {};
+
+        StateStats m_stateStats;
 
         // Resource created in an upload heap. Useful for drawing of dynamic geometry
         // or for uploading constant buffer data that changes every draw call.
@@ -545,20 +600,7 @@ namespace EV
         static std::map<std::wstring, ID3D12Resource* > m_textureCache;
         static std::mutex m_textureCacheMutex;
 
-        // Inlined helper functions
-
-        inline void ReverseWinding(IndexCollection& indices, VertexCollection& vertices)
-        {
-            assert((indices.size() % 3) == 0);
-            for (auto it = indices.begin(); it != indices.end(); it += 3)
-            {
-                std::swap(*it, *(it + 2));
-            }
-
-            for (auto it = vertices.begin(); it != vertices.end(); ++it)
-            {
-                it->texCoord.x = (1.f - it->texCoord.x);
-            }
-        }
+        // Statistics of the last mesh created with CreateScene.
+        MeshStats m_lastMeshStats;
     };
 }
\ No newline at end of file
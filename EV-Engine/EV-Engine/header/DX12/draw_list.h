@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ *  @file draw_list.h
+ *
+ *  @brief Draws collected for a pass and sorted by a 64-bit key, so that draws
+ *  sharing a PSO, material and mesh end up next to each other and the state
+ *  only has to change where the key does. See SceneVisitor::Submit.
+ */
+
+#include <cstdint>
+#include <vector>
+
+namespace EV
+{
+    /**
+     * A draw as it is sorted, payload is an index into whatever describes the
+     * draw (the caller keeps that, the list only moves the 12 bytes around).
+     */
+    struct DrawItem
+    {
+        uint64_t key;
+        uint32_t payload;
+    };
+
+    /**
+     * Sorted items [firstItem, firstItem + count) that draw the same thing, drawn as
+     * one instanced draw. With the instance data in sorted order firstItem is also
+     * the first instance of the draw.
+     */
+    struct DrawBatch
+    {
+        uint32_t firstItem;
+        uint32_t count;
+    };
+
+    class DrawList
+    {
+    public:
+        /**
+         * Bits of the key from the most significant down. Fields that change the
+         * most expensive state come first, depth last orders the draws of a mesh
+         * front to back.
+         */
+        static constexpr uint32_t PassBits = 4;
+        static constexpr uint32_t PSOBits = 8;
+        static constexpr uint32_t MaterialBits = 16;
+        static constexpr uint32_t MeshBits = 16;
+        static constexpr uint32_t DepthBits = 20;
+
+        /**
+         * Build a key. Ids wider than their field wrap around, which only makes
+         * the sort group less well, draws still compare their actual state.
+         * @param depth View space depth, negative depths sort as 0.
+         */
+        static uint64_t MakeKey(uint32_t pass, uint32_t pso, uint32_t material, uint32_t mesh, float depth);
+
+        static uint32_t GetMaterial(uint64_t key)
+        {
+            return static_cast<uint32_t>(key >> (MeshBits + DepthBits)) & ((1u << MaterialBits) - 1);
+        }
+        static uint32_t GetMesh(uint64_t key)
+        {
+            return static_cast<uint32_t>(key >> DepthBits) & ((1u << MeshBits) - 1);
+        }
+
+        void Add(uint64_t key, uint32_t payload)
+        {
+            m_items.push_back({ key, payload });
+        }
+
+        /**
+         * Sort by key with a least significant digit radix sort, 8 bits per pass.
+         * Passes over bytes every key has in common are skipped. Stable, draws with
+         * equal keys keep the order they were added in.
+         */
+        void Sort();
+
+        /**
+         * Split the sorted items into runs of neighbours for which same(payloadA, payloadB)
+         * holds. Keys only hold wrapped ids, same compares the actual state.
+         */
+        template<typename Same>
+        void GetBatches(Same&& same, std::vector<DrawBatch>& outBatches) const
+        {
+            outBatches.clear();
+            const uint32_t size = static_cast<uint32_t>(m_items.size());
+            for (uint32_t first = 0; first < size;)
+            {
+                uint32_t count = 1;
+                while (first + count < size && same(m_items[first].payload, m_items[first + count].payload))
+                {
+                    ++count;
+                }
+                outBatches.push_back({ first, count });
+                first += count;
+            }
+        }
+
+        void Clear()
+        {
+            m_items.clear();
+        }
+
+        const std::vector<DrawItem>& GetItems() const
+        {
+            return m_items;
+        }
+
+    private:
+        std::vector<DrawItem> m_items;
+        std::vector<DrawItem> m_scratch;  // The other buffer of every radix pass.
+    };
+}  // namespace EV
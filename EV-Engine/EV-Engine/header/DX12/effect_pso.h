@@ -74,8 +74,9 @@ namespace EV
         // to use these as root indices in the root signature.
         enum RootParameters
         {
-            // Vertex shader parameter
-            MatricesCB,  // ConstantBuffer<Matrices> MatCB : register(b0);
+            // Vertex shader parameters
+            Instances,      // StructuredBuffer<Matrices> Instances : register( t0, space1 );
+            FirstInstance,  // uint FirstInstance : register( b1, space1 );
 
             // Pixel shader parameters
             MaterialCB,         // ConstantBuffer<Material> MaterialCB : register( b0, space1 );
@@ -94,6 +95,7 @@ namespace EV
             // Texture2D BumpTexture : register( t9 );
             // Texture2D OpacityTexture : register( t10 );
             Camera, // just its position
+            IrradianceCB,  // ConstantBuffer<IrradianceSH> IrradianceCB : register( b2 );
             NumRootParameters
         };
 
@@ -134,16 +136,16 @@ namespace EV
         {
             return m_material;
         }
-        void SetMaterial(const std::shared_ptr<Material>& material) override
-        {
-            m_material = material;
-            m_dirtyFlags |= DF_Material;
-        }
+        // The textures and properties are bound again when the material changes, or
+        // when the bound one was edited since (see Material::GetVersion).
+        void SetMaterial(const std::shared_ptr<Material>& material) override;
 
         // Set matrices.
         void XM_CALLCONV SetWorldMatrix(DirectX::FXMMATRIX worldMatrix) override
         {
             m_pAlignedMVP->world = worldMatrix;
+            m_instanceWorldMatrices.clear();
+            SetFirstInstance(0);
             m_dirtyFlags |= DF_Matrices;
         }
         DirectX::XMMATRIX GetWorldMatrix() const
@@ -154,7 +156,7 @@ namespace EV
         void XM_CALLCONV SetViewMatrix(DirectX::FXMMATRIX viewMatrix) override
         {
             m_pAlignedMVP->view = viewMatrix;
-            m_dirtyFlags |= DF_Matrices;
+            m_dirtyFlags |= DF_Matrices | DF_Camera;
         }
         DirectX::XMMATRIX GetViewMatrix() const
         {
@@ -171,10 +173,36 @@ namespace EV
             return m_pAlignedMVP->projection;
         }
 
-        // Apply this effect to the rendering pipeline.
+        // The vertex shader reads the matrices of SV_InstanceID from a structured buffer,
+        // a plain draw is a single instance.
+        bool SupportsInstancing() const override
+        {
+            return true;
+        }
+        void SetInstances(const DirectX::XMMATRIX* worldMatrices, uint32_t count) override
+        {
+            m_instanceWorldMatrices.assign(worldMatrices, worldMatrices + count);
+            m_dirtyFlags |= DF_Matrices;
+        }
+        void SetFirstInstance(uint32_t firstInstance) override
+        {
+            if (firstInstance != m_firstInstance)
+            {
+                m_firstInstance = firstInstance;
+                m_dirtyFlags |= DF_FirstInstance;
+            }
+        }
+
+        // Apply this effect to the rendering pipeline. Binds everything when the command
+        // list has another root signature bound, otherwise only what changed since the last Apply.
         void Apply(CommandList& commandList) override;
-        void SetIBLTextures(std::shared_ptr<ShaderResourceView> diffuse, std::shared_ptr<ShaderResourceView> specular,
-                            std::shared_ptr<ShaderResourceView> lut);
+        void SetIBLTextures(std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut);
+        // Diffuse IBL, replaces the irradiance cubemap.
+        void SetIrradiance(const IrradianceSH& irradiance)
+        {
+            m_irradiance = irradiance;
+            m_dirtyFlags |= DF_IBL;
+        }
 
 
     private:
@@ -192,8 +220,17 @@ namespace EV
         std::shared_ptr<ShaderResourceView> m_defaultSRV;
         std::shared_ptr<ShaderResourceView> m_defaultCubeSRV;
 
-        // IBL textures
-        std::shared_ptr<ShaderResourceView> m_diffuseIBL;
+        // Version of m_material when it was set.
+        uint64_t m_materialVersion = 0;
+
+        // World matrices of the instances, empty for a single one, and the matrices
+        // Apply uploads for them.
+        std::vector<DirectX::XMMATRIX> m_instanceWorldMatrices;
+        std::vector<Matrices>          m_instanceMatrices;
+        uint32_t                       m_firstInstance = 0;
+
+        // IBL
+        IrradianceSH                        m_irradiance;
         std::shared_ptr<ShaderResourceView> m_specularIBL;
         std::shared_ptr<ShaderResourceView> m_lutIBL;
 
@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ *  @file frustum_culling.h
+ *
+ *  @brief Tests world space boxes against the six planes of a view frustum in
+ *  batches, four boxes per instruction with SSE and eight when the engine is
+ *  compiled for AVX. The planes come from Camera::GetFrustumPlanes.
+ */
+
+#include <DX12/bounding_volume_hierarchy.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace EV
+{
+    /**
+     * Boxes as a structure of arrays, the layout the culling kernel loads whole
+     * registers from. The arrays are padded to a multiple of eight boxes.
+     */
+    struct CullingBoxes
+    {
+        std::vector<float> minX, minY, minZ;
+        std::vector<float> maxX, maxY, maxZ;
+        uint32_t           count = 0;
+
+        void Assign(const BVHBox* boxes, uint32_t boxCount);
+    };
+
+    /**
+     * Test every box against the planes (a, b, c, d), ax + by + cz + d >= 0 inside.
+     * outVisible[i] becomes 1 if box i is inside or intersects the frustum, 0 if it
+     * is completely outside one of the planes.
+     * @returns The number of visible boxes.
+     */
+    uint32_t CullBoxes(const float planes[6][4], const CullingBoxes& boxes, uint8_t* outVisible);
+
+    /**
+     * The same test for a single box, with the same result as CullBoxes.
+     */
+    bool IsBoxVisible(const float planes[6][4], const BVHBox& box);
+}  // namespace EV
@@ -121,4 +121,19 @@ namespace EV
         //----------------------------------- (16 byte boundary)
         // Total:                              16 * 4 = 64 bytes
     };
+
+    // Diffuse irradiance of the environment as 9 L2 spherical harmonics with
+    // the basis constants folded in, evaluated per pixel instead of sampling
+    // a convolved cubemap.
+    struct IrradianceSH
+    {
+        IrradianceSH()
+            : coefficients{}
+        {
+        }
+
+        DirectX::XMFLOAT4 coefficients[9];  // rgb, w unused. Order: 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2.
+        //----------------------------------- (16 byte boundary)
+        // Total:                              16 * 9 = 144 bytes
+    };
 }
\ No newline at end of file
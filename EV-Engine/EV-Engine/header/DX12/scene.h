@@ -32,11 +32,16 @@
 
 #include <DirectXCollision.h> // For DirectX::BoundingBox
 
+#include <DX12/bounding_volume_hierarchy.h>
+#include <DX12/frustum_culling.h>
+
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 	class aiMaterial;
     class aiMesh;
@@ -48,6 +53,7 @@ namespace EV
 	class Material;
 	class Visitor;
 	class SceneNode;
+	struct VertexPositionNormalTangentBitangentTexture;
 }
     namespace EV
     {
@@ -65,6 +71,7 @@ namespace EV
         void SetRootNode(std::shared_ptr<SceneNode> node)
         {
             m_rootNode = node;
+            InvalidateBVH();
         }
 
         std::shared_ptr<SceneNode> GetRootNode() const
@@ -78,6 +85,100 @@ namespace EV
          */
         DirectX::BoundingBox GetAABB() const;
 
+        /**
+         * World space bounds of every mesh, as of the last UpdateBVH (so with the
+         * transforms of the last Accept for scenes drawn more than once a frame).
+         * Empty before the first UpdateBVH.
+         */
+        DirectX::BoundingBox GetWorldBounds() const;
+
+        /**
+         * A mesh of a node, what the items of the BVH stand for.
+         */
+        struct BVHItem
+        {
+            SceneNode* node;
+            Mesh*      mesh;
+        };
+
+        /**
+         * A scene node with the BVH items of its meshes and its children's meshes,
+         * items [firstItem, firstItem + itemCount). Ranges are in the order Accept
+         * visits the nodes, a node is followed by the nodeCount - 1 ranges below it.
+         */
+        struct BVHNodeRange
+        {
+            SceneNode* node;
+            uint32_t   firstItem;
+            uint32_t   itemCount;
+            uint32_t   nodeCount;
+        };
+
+        struct BVHStats
+        {
+            uint32_t builds = 0;
+            uint32_t refits = 0;
+            double   buildTime = 0.0;  // Milliseconds of the last build, gathering the boxes included.
+            double   refitTime = 0.0;  // Milliseconds of the last refit.
+        };
+
+        /**
+         * Bring the BVH over the world space AABBs of the meshes up to date. It is
+         * built on first use, refit when the transform hierarchy changed and built
+         * again when the refits made it a lot worse than a new build, or when the
+         * meshes changed. Adding or removing meshes without moving a transform
+         * needs InvalidateBVH.
+         */
+        void UpdateBVH();
+        void InvalidateBVH()
+        {
+            m_bvhDirty = true;
+        }
+
+        /**
+         * Item i of the BVH is GetBVHItems()[i].
+         */
+        const BoundingVolumeHierarchy& GetBVH() const
+        {
+            return m_bvh;
+        }
+        const std::vector<BVHItem>& GetBVHItems() const
+        {
+            return m_bvhItems;
+        }
+        const std::vector<BVHNodeRange>& GetBVHNodeRanges() const
+        {
+            return m_bvhNodeRanges;
+        }
+
+        /**
+         * The boxes of the BVH items laid out for CullBoxes, up to date after UpdateBVH.
+         */
+        const CullingBoxes& GetCullingBoxes() const
+        {
+            return m_cullingBoxes;
+        }
+
+        const BVHStats& GetBVHStats() const
+        {
+            return m_bvhStats;
+        }
+
+        /**
+         * Size of the vertex and index buffer the meshes of an imported scene share.
+         */
+        struct GeometryStats
+        {
+            uint32_t meshes = 0;
+            uint64_t vertexBytes = 0;
+            uint64_t indexBytes = 0;
+            uint64_t paddingBytes = 0;  // Between the sections of the meshes, to align them.
+        };
+        const GeometryStats& GetGeometryStats() const
+        {
+            return m_geometryStats;
+        }
+
         /**
          * Accept a visitor.
          * This will first visit the scene, then it will visit the root node of the scene.
@@ -106,7 +207,13 @@ namespace EV
     private:
         void ImportScene(CommandList& commandList, const aiScene& scene, std::filesystem::path parentPath);
         void ImportMaterial(CommandList& commandList, const aiMaterial& material, std::filesystem::path parentPath);
-        void ImportMesh(CommandList& commandList, const aiMesh& mesh);
+        /**
+         * Append the vertices and indices of the mesh to the buffers of the scene, in
+         * sections that start on 256 byte boundaries. ImportScene uploads them once
+         * all meshes are in.
+         */
+        void ImportMesh(const aiMesh& mesh, std::vector<VertexPositionNormalTangentBitangentTexture>& vertices,
+            std::vector<uint32_t>& indices);
         std::shared_ptr<SceneNode> ImportSceneNode(CommandList& commandList, std::shared_ptr<SceneNode> parent,
             const aiNode* aiNode);
 
@@ -121,5 +228,16 @@ namespace EV
         std::shared_ptr<SceneNode> m_rootNode;
 
         std::wstring m_sceneFile;
+
+        BoundingVolumeHierarchy   m_bvh;
+        std::vector<BVHItem>      m_bvhItems;
+        std::vector<BVHBox>       m_bvhBoxes;
+        std::vector<BVHNodeRange> m_bvhNodeRanges;
+        CullingBoxes              m_cullingBoxes;
+        uint64_t                  m_bvhVersion = 0;
+        bool                      m_bvhDirty = true;
+        BVHStats                  m_bvhStats;
+
+        GeometryStats m_geometryStats;
     };
 }
\ No newline at end of file
@@ -38,6 +38,8 @@
 
 #include <DirectXMath.h>
 
+#include <DX12/transform_hierarchy.h>
+
 namespace EV
 {
 
@@ -49,6 +51,13 @@ namespace EV
     {
     public:
         explicit SceneNode(const DirectX::XMMATRIX& localTransform = DirectX::XMMatrixIdentity());
+
+        /**
+         * Create the node's transform in the hierarchy of parent, under the parent's
+         * transform. Linking it into the parent's children is left to the caller,
+         * the importer uses this to build a scene in one hierarchy.
+         */
+        SceneNode(const DirectX::XMMATRIX& localTransform, const SceneNode& parent);
         virtual ~SceneNode();
 
         /**
@@ -64,7 +73,7 @@ namespace EV
         void              SetLocalTransform(const DirectX::XMMATRIX& localTransform);
 
         /**
-         * Get the inverse of the local transform.
+         * Get the inverse of the local transform. Computed on every call.
          */
         DirectX::XMMATRIX GetInverseLocalTransform() const;
 
@@ -76,7 +85,7 @@ namespace EV
 
         /**
          * Get the inverse of the world transform (concatenated with its parent's
-         * world transform).
+         * world transform). Cached until the world transform changes.
          */
         DirectX::XMMATRIX GetInverseWorldTransform() const;
 
@@ -109,6 +118,20 @@ namespace EV
          */
         const DirectX::BoundingBox& GetAABB() const;
 
+        /**
+         * The flattened transforms this node's tree lives in, see TransformHierarchy.
+         * Updating it once per frame brings every world transform of the tree up to
+         * date in one pass, otherwise the first GetWorldTransform does.
+         */
+        TransformHierarchy& GetTransformHierarchy() const
+        {
+            return *m_transformHierarchy;
+        }
+        TransformHierarchy::Handle GetTransformHandle() const
+        {
+            return m_transformHandle;
+        }
+
         /**
          * Accept a visitor.
          */
@@ -117,6 +140,12 @@ namespace EV
     protected:
         DirectX::XMMATRIX GetParentWorldTransform() const;
 
+        /**
+         * Move the transforms of this node and its subtree into another hierarchy,
+         * under parentHandle.
+         */
+        void MoveToHierarchy(const std::shared_ptr<TransformHierarchy>& hierarchy, TransformHierarchy::Handle parentHandle);
+
     private:
         using NodePtr = std::shared_ptr<SceneNode>;
         using NodeList = std::vector<NodePtr>;
@@ -125,14 +154,9 @@ namespace EV
 
         std::string m_Name;
 
-        // This data must be aligned to a 16-byte boundary.
-        // The only way to guarantee this, is to allocate this
-        // structure in aligned memory.
-        struct alignas(16) AlignedData
-        {
-            DirectX::XMMATRIX m_localTransform;
-            DirectX::XMMATRIX m_inverseTransform;
-        } *m_alignedData;
+        // Shared by every node of the tree, nodes without a parent start their own.
+        std::shared_ptr<TransformHierarchy> m_transformHierarchy;
+        TransformHierarchy::Handle          m_transformHandle;
 
         MeshList                 m_meshes;
 
@@ -31,38 +31,145 @@
   * nodes of a scene.
   */
 
+#include <DX12/command_list.h>
+#include <DX12/draw_list.h>
 #include <DX12/visitor.h>
 
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace EV
 {
 	class BasePSO;
 	// class EffectPSO;
 	class Camera;
-	// namespace dx12lib
-	// {
-	    class CommandList;
-	// }
+	class Material;
+	class Scene;
 
 	class SceneVisitor : public Visitor
 	{
 	public:
+	    /**
+	     * Counts of the meshes of every scene the visitor rendered, so for a frame
+	     * when one visitor is used for the frame.
+	     */
+	    struct CullingStats
+	    {
+	        uint32_t tested = 0;        // Meshes tested against the frustum.
+	        uint32_t culled = 0;        // Meshes completely outside it.
+	        uint32_t drawn = 0;
+	        uint32_t skippedNodes = 0;  // Scene nodes not visited because nothing below them is visible.
+	    };
+
+	    /**
+	     * Draws of Submit that drew several meshes as instances, and how many meshes
+	     * they drew.
+	     */
+	    struct InstancingStats
+	    {
+	        uint32_t draws = 0;
+	        uint32_t instances = 0;
+	    };
+
 	    /**
 	     * Constructor for the SceneVisitor.
 	     * @param commandList The CommandList that is used to render the meshes in the scene.
+	     * @param frustumCulling Skip meshes outside the view frustum of the camera. Off for
+	     * geometry that follows the camera, like the skybox.
 	     */
-	    SceneVisitor(CommandList& commandList, const Camera& camera, BasePSO& pso, bool transparent);
+	    SceneVisitor(CommandList& commandList, const Camera& camera, BasePSO& pso, bool transparent, bool frustumCulling = true);
+	    virtual ~SceneVisitor() override;
 
-	    // For this sample, we don't need to do anything when visiting the Scene.
+	    // Tests the world space boxes of all meshes in the scene against the frustum at once.
 	    virtual void Visit(Scene& scene) override;
-		// For this sample, we don't need to do anything when visiting the SceneNode.
-		virtual void Visit(SceneNode& sceneNode) override;
-	    // When visiting a mesh, the mesh must be rendered.
+		// Skips the node and everything below it if none of their meshes is visible.
+		virtual bool Visit(SceneNode& sceneNode) override;
+	    // Records a draw of the mesh, or draws it right away when sorting is off.
 	    virtual void Visit(Mesh& mesh) override;
 
+	    /**
+	     * Draw everything recorded since the last Submit, sorted by material and mesh,
+	     * setting the material and the buffers only where they change. Draws of the
+	     * same mesh and material become one instanced draw when the PSO supports it.
+	     */
+	    void Submit();
+
+	    /**
+	     * Draw meshes in scene graph order while visiting instead, to compare against.
+	     */
+	    void SetSortDraws(bool sortDraws)
+	    {
+	        m_sortDraws = sortDraws;
+	    }
+
+	    /**
+	     * Draw every recorded mesh on its own instead of instancing repeated ones.
+	     */
+	    void SetInstancing(bool instancing)
+	    {
+	        m_instancing = instancing;
+	    }
+
+	    const CullingStats& GetCullingStats() const
+	    {
+	        return m_cullingStats;
+	    }
+
+	    /**
+	     * State the draws of the visitor set on the command list.
+	     */
+	    const CommandList::StateStats& GetStateStats() const
+	    {
+	        return m_stateStats;
+	    }
+
+	    const InstancingStats& GetInstancingStats() const
+	    {
+	        return m_instancingStats;
+	    }
+
 	private:
 	    CommandList& m_commandList;
 	    const Camera& m_camera;
 	    BasePSO& m_lightingPSO;
 	    bool m_transparentPass;
+	    bool m_frustumCulling;
+	    float m_frustumPlanes[6][4];
+
+	    // Culling results of the scene being visited, per BVH item of the scene.
+	    Scene* m_scene = nullptr;
+	    std::vector<uint8_t> m_visible;
+	    std::vector<uint32_t> m_visibleBefore;  // Visible items before item i, for the ranges of nodes.
+	    uint32_t m_nodeRange = 0;               // Next of Scene::GetBVHNodeRanges.
+	    uint32_t m_item = 0;                    // Item of the next mesh.
+	    CullingStats m_cullingStats;
+
+	    DirectX::XMMATRIX m_viewMatrix;
+	    DirectX::XMMATRIX m_worldMatrix;  // Of the node whose meshes are visited.
+
+	    // What a recorded draw needs, DrawList payloads index it.
+	    struct Draw
+	    {
+	        DirectX::XMMATRIX         worldMatrix;
+	        Mesh*                     mesh;
+	        std::shared_ptr<Material> material;
+	    };
+
+	    bool m_sortDraws = true;
+	    DrawList m_drawList;
+	    std::vector<Draw> m_draws;
+	    // Small ids of the materials and meshes for the keys, in the order they were first drawn.
+	    std::unordered_map<const void*, uint32_t> m_materialIds;
+	    std::unordered_map<const void*, uint32_t> m_meshIds;
+	    CommandList::StateStats m_stateStats;
+
+	    bool m_instancing = true;
+	    std::vector<DirectX::XMMATRIX> m_instanceWorldMatrices;  // In sorted order.
+	    std::vector<DrawBatch> m_batches;
+	    InstancingStats m_instancingStats;
 	};
 }
\ No newline at end of file
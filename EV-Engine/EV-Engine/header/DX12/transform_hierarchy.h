@@ -0,0 +1,143 @@
+#pragma once
+
+/**
+ *  @file transform_hierarchy.h
+ *
+ *  @brief Local and world matrices of a scene graph in flat arrays, ordered so
+ *  that every parent comes before its children. The world matrices are brought
+ *  up to date in one linear pass over the dirty part of the arrays, instead of
+ *  every query walking up to the root.
+ */
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace EV
+{
+    class TransformHierarchy
+    {
+    public:
+        /**
+         * Stable name of a transform. The transform moves around in the arrays
+         * when it is reparented or the arrays are compacted, the handle doesn't.
+         */
+        using Handle = uint32_t;
+        static constexpr Handle InvalidHandle = UINT32_MAX;
+
+        /**
+         * Append a transform. It goes after everything that already exists, so
+         * after its parent too.
+         */
+        Handle Create(const DirectX::XMMATRIX& localTransform, Handle parent = InvalidHandle);
+
+        /**
+         * Release a transform. Children that are still alive become roots. The
+         * arrays are compacted once more than half of them is free.
+         */
+        void Destroy(Handle handle);
+
+        /**
+         * Move a transform (and everything below it) under another parent, or make
+         * it a root with InvalidHandle. The local transform is kept. A parent that
+         * comes after it moves the subtree to the end of the arrays.
+         * NOTE: Circular references are not checked.
+         */
+        void SetParent(Handle handle, Handle parent);
+        Handle GetParent(Handle handle) const;
+
+        DirectX::XMMATRIX GetLocalTransform(Handle handle) const;
+        void              SetLocalTransform(Handle handle, const DirectX::XMMATRIX& localTransform);
+
+        /**
+         * World transform, brought up to date with Update first if anything changed
+         * since the last one.
+         */
+        DirectX::XMMATRIX GetWorldTransform(Handle handle);
+
+        /**
+         * Inverse of the world transform. Only computed when asked for, and kept
+         * until the world transform changes.
+         */
+        DirectX::XMMATRIX GetInverseWorldTransform(Handle handle);
+
+        /**
+         * Recompute the world transforms of every changed transform and everything
+         * below it, in one pass from the first change to the end of the arrays.
+         */
+        void Update();
+        bool IsDirty() const
+        {
+            return m_firstDirty != InvalidIndex;
+        }
+
+        /**
+         * Counts the updates that changed something, for caches of world space data
+         * (like the BVH of a scene) to tell whether they are stale.
+         */
+        uint64_t GetVersion() const
+        {
+            return m_version;
+        }
+
+        /**
+         * Position of a transform in the arrays, changes when it moves. Together with
+         * GetWorldTransforms this lets a pass read all world matrices in order.
+         */
+        uint32_t GetIndex(Handle handle) const
+        {
+            return m_indices[handle];
+        }
+
+        /**
+         * Number of array slots, the released ones included.
+         */
+        uint32_t GetSize() const
+        {
+            return static_cast<uint32_t>(m_parents.size());
+        }
+        uint32_t GetLiveCount() const
+        {
+            return GetSize() - m_freeCount;
+        }
+
+        /**
+         * World matrices in array order, up to date after Update.
+         */
+        const DirectX::XMMATRIX* GetWorldTransforms() const
+        {
+            return m_worldTransforms.data();
+        }
+
+    private:
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+        enum Flags : uint8_t
+        {
+            Dirty = 1 << 0,         // The world transform has to be recomputed.
+            InverseValid = 1 << 1,  // m_inverseWorldTransforms matches the world transform.
+            Free = 1 << 2,          // Released, skipped until the next compaction.
+        };
+
+        uint32_t Append(Handle handle, const DirectX::XMMATRIX& localTransform, uint32_t parentIndex);
+        void     MarkDirty(uint32_t index);
+        void     Compact();
+
+        // Structure of arrays, indexed by position.
+        std::vector<DirectX::XMMATRIX> m_localTransforms;
+        std::vector<DirectX::XMMATRIX> m_worldTransforms;
+        std::vector<DirectX::XMMATRIX> m_inverseWorldTransforms;
+        std::vector<uint32_t>          m_parents;  // Position of the parent, always smaller.
+        std::vector<uint8_t>           m_flags;
+        std::vector<Handle>            m_handles;
+
+        // Position of every handle, and the handles that can be given out again.
+        std::vector<uint32_t> m_indices;
+        std::vector<Handle>   m_freeHandles;
+
+        uint32_t m_freeCount = 0;
+        uint32_t m_firstDirty = InvalidIndex;
+        uint64_t m_version = 0;
+    };
+}  // namespace EV
@@ -43,7 +43,8 @@ namespace EV
         virtual ~Visitor() = default;
 
         virtual void Visit(Scene& scene) = 0;
-        virtual void Visit(SceneNode& sceneNode) = 0;
+        // Returning false skips the meshes and the children of the node.
+        virtual bool Visit(SceneNode& sceneNode) = 0;
         virtual void Visit(Mesh& mesh) = 0;
     };
 
@@ -39,6 +39,10 @@ namespace EV
 		DirectX::XMMATRIX GetProjectionMatrix() const;
 		DirectX::XMMATRIX GetInverseProjectionMatrix() const;
 
+		// World space planes of the view frustum, (a, b, c, d) with ax + by + cz + d >= 0
+		// inside, in the order left, right, bottom, top, near, far.
+		void GetFrustumPlanes(float outPlanes[6][4]) const;
+
 		// Values in Degrees.
 		void SetFov(float fov);
 		float GetFov() const;
@@ -32,8 +32,9 @@
 
 #include <DirectXMath.h>  // For vector types.
 
-#include <map>     // For std::map
-#include <memory>  // For std::unique_ptr and std::shared_ptr
+#include <cstdint>  // For uint64_t
+#include <map>      // For std::map
+#include <memory>   // For std::unique_ptr and std::shared_ptr
 
 namespace EV
 {
@@ -180,6 +181,13 @@ namespace EV
         const MaterialProperties& GetMaterialProperties() const;
         void                      SetMaterialProperties(const MaterialProperties& materialProperties);
 
+        // Bumped by every setter, so users that cache what they uploaded of the
+        // material can tell when it was edited in place.
+        uint64_t GetVersion() const
+        {
+            return m_version;
+        }
+
         // Define some interesting materials.
         static const MaterialProperties Zero;
         static const MaterialProperties Red;
@@ -224,5 +232,6 @@ namespace EV
 
         MaterialPropertiesPtr m_materialProperties;
         TextureMap            m_textures;
+        uint64_t              m_version = 0;
     };
 }  // namespace EV
\ No newline at end of file
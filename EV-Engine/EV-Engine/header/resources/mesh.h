@@ -36,6 +36,7 @@
 
 #include <map>     // For std::map
 #include <memory>  // For std::shared_ptr
+#include <vector>  // For std::vector
 
 namespace EV
 {
@@ -68,13 +69,28 @@ namespace EV
         std::shared_ptr<IndexBuffer> GetIndexBuffer();
 
         /**
-         * Get the number if indices in the index buffer.
+         * Draw only a part of the vertex and index buffers, for meshes that share
+         * the buffers of their scene. The indices are relative to baseVertex.
+         * Without a section the mesh draws the whole buffers.
+         */
+        void SetSection(uint32_t baseVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount);
+        uint32_t GetBaseVertex() const
+        {
+            return m_baseVertex;
+        }
+        uint32_t GetFirstIndex() const
+        {
+            return m_firstIndex;
+        }
+
+        /**
+         * Get the number if indices in the index buffer, or in the section of it.
          * If no index buffer is bound to the mesh, this function returns 0.
          */
         size_t GetIndexCount() const;
 
         /**
-         * Get the number of vertices in the mesh.
+         * Get the number of vertices in the mesh, or in its section.
          * If this mesh does not have a vertex buffer, the function returns 0.
          */
         size_t GetVertexCount() const;
@@ -88,6 +104,15 @@ namespace EV
         void                        SetAABB(const DirectX::BoundingBox& aabb);
         const DirectX::BoundingBox& GetAABB() const;
 
+        /**
+         * A copy of the vertex positions and triangle indices that stays on the CPU,
+         * for code that needs the shape of the mesh (e.g. buoyancy probes).
+         * Empty unless the mesh was imported from a file.
+         */
+        void                                  SetGeometry(std::vector<DirectX::XMFLOAT3> positions, std::vector<uint32_t> indices);
+        const std::vector<DirectX::XMFLOAT3>& GetPositions() const;
+        const std::vector<uint32_t>&          GetIndices() const;
+
         /**
          * Draw the mesh to a CommandList.
          *
@@ -108,5 +133,15 @@ namespace EV
         std::shared_ptr<Material>    m_material;
         D3D12_PRIMITIVE_TOPOLOGY     m_primitiveTopology;
         DirectX::BoundingBox         m_AABB;
+
+        // Section of the buffers, see SetSection.
+        bool     m_hasSection = false;
+        uint32_t m_baseVertex = 0;
+        uint32_t m_vertexCount = 0;
+        uint32_t m_firstIndex = 0;
+        uint32_t m_indexCount = 0;
+
+        std::vector<DirectX::XMFLOAT3> m_positions;
+        std::vector<uint32_t>          m_indices;
     };
 }  // namespace EV
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+/**
+ *  @file mesh_generator.h
+ *
+ *  @brief Procedural meshes that know their size up front. CommandList::CreateScene
+ *  lets them write their vertices and indices straight into mapped upload
+ *  memory, split over the thread pool, instead of growing vectors that are
+ *  copied into an intermediate buffer afterwards.
+ */
+
+#include <resources/vertex_types.h>
+
+#include <cstdint>
+
+namespace EV
+{
+    class MeshGenerator
+    {
+    public:
+        using Vertex = VertexPositionNormalTangentBitangentTexture;
+
+        explicit MeshGenerator(bool reverseWinding)
+            : m_reverseWinding(reverseWinding)
+        {
+        }
+        virtual ~MeshGenerator() = default;
+
+        virtual uint32_t GetVertexCount() const = 0;
+        virtual uint32_t GetIndexCount() const = 0;
+
+        /**
+         * The mesh is written in rows that don't depend on each other, every row
+         * knows where its vertices and indices go.
+         */
+        virtual uint32_t GetRowCount() const = 0;
+
+        /**
+         * Write the vertices and indices of the rows [beginRow, endRow). vertices and
+         * indices point at the start of the whole mesh. The memory may be write
+         * combined, so nothing is read back.
+         */
+        virtual void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const = 0;
+        virtual void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const = 0;
+
+    protected:
+        // Writes a triangle, flipped when the winding is reversed (useful for skyboxes).
+        template<typename Index>
+        void WriteTriangle(Index* indices, uint32_t a, uint32_t b, uint32_t c) const
+        {
+            indices[0] = static_cast<Index>(m_reverseWinding ? c : a);
+            indices[1] = static_cast<Index>(b);
+            indices[2] = static_cast<Index>(m_reverseWinding ? a : c);
+        }
+
+        // Reversed meshes are seen from the inside, which mirrors the texture coordinates.
+        float U(float u) const
+        {
+            return m_reverseWinding ? 1.0f - u : u;
+        }
+
+    private:
+        bool m_reverseWinding;
+    };
+
+    /**
+     * A plane in the XZ plane facing +Y, one row per row of vertices.
+     */
+    class PlaneGenerator : public MeshGenerator
+    {
+    public:
+        PlaneGenerator(float width, float depth, uint32_t subdivisionWidth, uint32_t subdivisionDepth, bool reverseWinding = false);
+
+        uint32_t GetVertexCount() const override;
+        uint32_t GetIndexCount() const override;
+        uint32_t GetRowCount() const override;
+
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const override;
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const override;
+
+    private:
+        template<typename Index>
+        void GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const;
+
+        float    m_width;
+        float    m_depth;
+        uint32_t m_subdivisionWidth;
+        uint32_t m_subdivisionDepth;
+    };
+
+    /**
+     * A UV sphere, one row per ring of latitude.
+     */
+    class SphereGenerator : public MeshGenerator
+    {
+    public:
+        SphereGenerator(float radius, uint32_t tessellation, bool reverseWinding = false);
+
+        uint32_t GetVertexCount() const override;
+        uint32_t GetIndexCount() const override;
+        uint32_t GetRowCount() const override;
+
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const override;
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const override;
+
+    private:
+        template<typename Index>
+        void GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const;
+
+        float    m_radius;
+        uint32_t m_verticalSegments;
+        uint32_t m_horizontalSegments;
+    };
+
+    /**
+     * A cube centred on the origin, one row per face.
+     */
+    class CubeGenerator : public MeshGenerator
+    {
+    public:
+        explicit CubeGenerator(float size, bool reverseWinding = false);
+
+        uint32_t GetVertexCount() const override;
+        uint32_t GetIndexCount() const override;
+        uint32_t GetRowCount() const override;
+
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const override;
+        void Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const override;
+
+    private:
+        template<typename Index>
+        void GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const;
+
+        float m_size;
+    };
+}  // namespace EV
@@ -0,0 +1,185 @@
+#pragma once
+
+/**
+ *  @file thread_pool.h
+ *
+ *  @brief A minimal fixed-size worker pool used to split CPU heavy loops
+ *  (spectrum generation, CPU FFT, ...) across the available cores.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace EV
+{
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(uint32_t numThreads = 0)
+        {
+            if (numThreads == 0)
+            {
+                // Leave one core for the thread that issues the work, it joins in anyway.
+                numThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+            }
+
+            m_workers.reserve(numThreads);
+            for (uint32_t i = 0; i < numThreads; ++i)
+            {
+                m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+            }
+            m_cv.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Process wide pool shared by all systems.
+         */
+        static ThreadPool& Get()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        /**
+         * Number of threads that participate in a ParallelFor (workers + caller).
+         */
+        uint32_t GetThreadCount() const
+        {
+            return static_cast<uint32_t>(m_workers.size()) + 1;
+        }
+
+        /**
+         * Push a single job to the queue. The job runs on one of the workers.
+         */
+        void Submit(std::function<void()> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push(std::move(job));
+            }
+            m_cv.notify_one();
+        }
+
+        /**
+         * Split [begin, end) in chunks of at most grainSize and call
+         * func(chunkBegin, chunkEnd) for every chunk. The calling thread helps
+         * processing chunks and only returns once all chunks are done.
+         */
+        template<typename Func>
+        void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const Func& func)
+        {
+            if (end <= begin)
+                return;
+
+            grainSize = std::max(1u, grainSize);
+            const uint32_t numChunks = (end - begin + grainSize - 1) / grainSize;
+
+            if (numChunks == 1 || m_workers.empty())
+            {
+                func(begin, end);
+                return;
+            }
+
+            // The state is shared with the helper jobs so a helper that only gets
+            // scheduled after all chunks are done (or from within another
+            // ParallelFor on a busy pool) never touches a dead stack frame.
+            struct SharedState
+            {
+                const Func* func = nullptr;
+                uint32_t begin = 0;
+                uint32_t end = 0;
+                uint32_t grainSize = 0;
+                uint32_t numChunks = 0;
+                std::atomic_uint32_t nextChunk{ 0 };
+                std::atomic_uint32_t finishedChunks{ 0 };
+                std::mutex mutex;
+                std::condition_variable cv;
+
+                void RunChunks()
+                {
+                    uint32_t chunk;
+                    while ((chunk = nextChunk.fetch_add(1)) < numChunks)
+                    {
+                        uint32_t chunkBegin = begin + chunk * grainSize;
+                        uint32_t chunkEnd = std::min(end, chunkBegin + grainSize);
+                        (*func)(chunkBegin, chunkEnd);
+
+                        if (finishedChunks.fetch_add(1) + 1 == numChunks)
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            cv.notify_all();
+                        }
+                    }
+                }
+            };
+
+            auto state = std::make_shared<SharedState>();
+            state->func = &func;
+            state->begin = begin;
+            state->end = end;
+            state->grainSize = grainSize;
+            state->numChunks = numChunks;
+
+            const uint32_t numHelpers = std::min(static_cast<uint32_t>(m_workers.size()), numChunks - 1);
+            for (uint32_t i = 0; i < numHelpers; ++i)
+            {
+                Submit([state]() { state->RunChunks(); });
+            }
+
+            state->RunChunks();
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cv.wait(lock, [&]() { return state->finishedChunks.load() == numChunks; });
+        }
+
+    private:
+        void WorkerLoop()
+        {
+            while (true)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cv.wait(lock, [this]() { return !m_running || !m_jobs.empty(); });
+
+                    if (!m_running && m_jobs.empty())
+                        return;
+
+                    job = std::move(m_jobs.front());
+                    m_jobs.pop();
+                }
+                job();
+            }
+        }
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_running = true;
+    };
+}
@@ -0,0 +1,458 @@
+#include <DX12/bounding_volume_hierarchy.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+using namespace EV;
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t BinCount = 16;
+    // Leaves hold at most this many items, and never split below two.
+    constexpr uint32_t MaxLeafSize = 8;
+    constexpr uint32_t MinLeafSize = 2;
+    // Past this depth nodes are split at the median, which bounds the recursion
+    // and keeps the traversal stacks below StackSize.
+    constexpr uint32_t MaxSAHDepth = 48;
+    constexpr uint32_t StackSize = 128;
+    // Cost of visiting a node relative to testing an item.
+    constexpr float TraversalCost = 1.0f;
+    constexpr float IntersectionCost = 1.0f;
+
+    const float* Min(const BVHBox& box)
+    {
+        return &box.min.x;
+    }
+
+    const float* Max(const BVHBox& box)
+    {
+        return &box.max.x;
+    }
+
+    BVHBox EmptyBox()
+    {
+        return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    }
+
+    void Grow(BVHBox& box, const BVHBox& other)
+    {
+        box.min = { std::min(box.min.x, other.min.x), std::min(box.min.y, other.min.y), std::min(box.min.z, other.min.z) };
+        box.max = { std::max(box.max.x, other.max.x), std::max(box.max.y, other.max.y), std::max(box.max.z, other.max.z) };
+    }
+
+    void Grow(BVHBox& box, const XMFLOAT3& point)
+    {
+        Grow(box, BVHBox{ point, point });
+    }
+
+    float SurfaceArea(const BVHBox& box)
+    {
+        const float x = box.max.x - box.min.x, y = box.max.y - box.min.y, z = box.max.z - box.min.z;
+        return x < 0.0f ? 0.0f : 2.0f * (x * y + y * z + z * x);
+    }
+
+    enum class Containment
+    {
+        Outside,
+        Intersects,
+        Inside,
+    };
+
+    // Tests the planes in mask and clears the ones the box is completely inside of.
+    Containment Classify(const BVHBox& box, const float planes[6][4], uint32_t& mask)
+    {
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            if (!(mask & (1u << i)))
+            {
+                continue;
+            }
+
+            // The corner furthest along the normal decides outside, the nearest one inside.
+            const float* plane = planes[i];
+            const float farDistance = plane[0] * (plane[0] >= 0.0f ? box.max.x : box.min.x) +
+                                      plane[1] * (plane[1] >= 0.0f ? box.max.y : box.min.y) +
+                                      plane[2] * (plane[2] >= 0.0f ? box.max.z : box.min.z) + plane[3];
+            if (farDistance < 0.0f)
+            {
+                return Containment::Outside;
+            }
+
+            const float nearDistance = plane[0] * (plane[0] >= 0.0f ? box.min.x : box.max.x) +
+                                       plane[1] * (plane[1] >= 0.0f ? box.min.y : box.max.y) +
+                                       plane[2] * (plane[2] >= 0.0f ? box.min.z : box.max.z) + plane[3];
+            if (nearDistance >= 0.0f)
+            {
+                mask &= ~(1u << i);
+            }
+        }
+        return mask == 0 ? Containment::Inside : Containment::Intersects;
+    }
+
+    float DistanceSquared(const BVHBox& box, const XMFLOAT3& point)
+    {
+        const float x = std::max({ box.min.x - point.x, 0.0f, point.x - box.max.x });
+        const float y = std::max({ box.min.y - point.y, 0.0f, point.y - box.max.y });
+        const float z = std::max({ box.min.z - point.z, 0.0f, point.z - box.max.z });
+        return x * x + y * y + z * z;
+    }
+
+    // Distance at which the ray enters the box (0 if it starts inside), FLT_MAX on a miss.
+    float RayEnter(const BVHBox& box, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance)
+    {
+        const float x0 = (box.min.x - origin.x) * inverseDirection.x, x1 = (box.max.x - origin.x) * inverseDirection.x;
+        const float y0 = (box.min.y - origin.y) * inverseDirection.y, y1 = (box.max.y - origin.y) * inverseDirection.y;
+        const float z0 = (box.min.z - origin.z) * inverseDirection.z, z1 = (box.max.z - origin.z) * inverseDirection.z;
+        const float enter = std::max({ std::min(x0, x1), std::min(y0, y1), std::min(z0, z1), 0.0f });
+        const float exit = std::min({ std::max(x0, x1), std::max(y0, y1), std::max(z0, z1), maxDistance });
+        return enter <= exit ? enter : FLT_MAX;
+    }
+}
+
+void BoundingVolumeHierarchy::Build(const BVHBox* boxes, uint32_t count)
+{
+    m_boxes.assign(boxes, boxes + count);
+    m_items.resize(count);
+    std::iota(m_items.begin(), m_items.end(), 0u);
+    m_centroids.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        m_centroids[i] = { 0.5f * (boxes[i].min.x + boxes[i].max.x), 0.5f * (boxes[i].min.y + boxes[i].max.y),
+                           0.5f * (boxes[i].min.z + boxes[i].max.z) };
+    }
+
+    m_nodes.clear();
+    m_depth = 0;
+    if (count > 0)
+    {
+        m_nodes.reserve(2 * count);
+        m_nodes.emplace_back();
+        BuildNode(0, 0, count, 1);
+    }
+
+    m_centroids.clear();
+    m_centroids.shrink_to_fit();
+    m_buildCost = GetCost();
+}
+
+void BoundingVolumeHierarchy::BuildNode(uint32_t node, uint32_t first, uint32_t count, uint32_t depth)
+{
+    m_depth = std::max(m_depth, depth);
+
+    BVHBox bounds = EmptyBox(), centroidBounds = EmptyBox();
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        Grow(bounds, m_boxes[m_items[i]]);
+        Grow(centroidBounds, m_centroids[m_items[i]]);
+    }
+    m_nodes[node] = { bounds, 0, first, count };
+    if (count <= MinLeafSize)
+    {
+        return;
+    }
+
+    // Bin the centroids along every axis and sweep for the cheapest split plane.
+    float bestCost = FLT_MAX;
+    uint32_t bestAxis = 0, bestSplit = 0;
+    for (uint32_t axis = 0; axis < 3 && depth < MaxSAHDepth; ++axis)
+    {
+        const float low = Min(centroidBounds)[axis], extent = Max(centroidBounds)[axis] - low;
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        uint32_t binCounts[BinCount] = {};
+        BVHBox binBounds[BinCount];
+        std::fill(std::begin(binBounds), std::end(binBounds), EmptyBox());
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const uint32_t item = m_items[i];
+            const uint32_t bin = std::min(BinCount - 1, static_cast<uint32_t>(((&m_centroids[item].x)[axis] - low) / extent * BinCount));
+            ++binCounts[bin];
+            Grow(binBounds[bin], m_boxes[item]);
+        }
+
+        float rightAreas[BinCount];
+        uint32_t rightCounts[BinCount];
+        BVHBox right = EmptyBox();
+        uint32_t rightCount = 0;
+        for (uint32_t bin = BinCount - 1; bin > 0; --bin)
+        {
+            Grow(right, binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightAreas[bin] = SurfaceArea(right);
+            rightCounts[bin] = rightCount;
+        }
+
+        BVHBox left = EmptyBox();
+        uint32_t leftCount = 0;
+        for (uint32_t split = 1; split < BinCount; ++split)
+        {
+            Grow(left, binBounds[split - 1]);
+            leftCount += binCounts[split - 1];
+            if (leftCount == 0 || rightCounts[split] == 0)
+            {
+                continue;
+            }
+
+            const float cost = SurfaceArea(left) * leftCount + rightAreas[split] * rightCounts[split];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    const float area = SurfaceArea(bounds);
+    const float splitCost = TraversalCost + IntersectionCost * bestCost / std::max(area, FLT_MIN);
+    if (count <= MaxLeafSize && (bestCost == FLT_MAX || splitCost >= IntersectionCost * count))
+    {
+        return;
+    }
+
+    uint32_t* begin = m_items.data() + first;
+    uint32_t* end = begin + count;
+    uint32_t* middle = begin;
+    if (bestCost < FLT_MAX)
+    {
+        const float low = Min(centroidBounds)[bestAxis], extent = Max(centroidBounds)[bestAxis] - low;
+        middle = std::partition(begin, end, [&](uint32_t item)
+        {
+            return std::min(BinCount - 1, static_cast<uint32_t>(((&m_centroids[item].x)[bestAxis] - low) / extent * BinCount)) < bestSplit;
+        });
+    }
+
+    // Too deep, or every centroid in the same place: halve along the longest axis.
+    if (middle == begin || middle == end)
+    {
+        uint32_t axis = 0;
+        for (uint32_t i = 1; i < 3; ++i)
+        {
+            if (Max(centroidBounds)[i] - Min(centroidBounds)[i] > Max(centroidBounds)[axis] - Min(centroidBounds)[axis])
+            {
+                axis = i;
+            }
+        }
+        middle = begin + count / 2;
+        std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b)
+        {
+            return (&m_centroids[a].x)[axis] < (&m_centroids[b].x)[axis];
+        });
+    }
+
+    const uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+    const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    m_nodes[node].left = left;
+    BuildNode(left, first, leftCount, depth + 1);
+    BuildNode(left + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+void BoundingVolumeHierarchy::Refit(const BVHBox* boxes)
+{
+    m_boxes.assign(boxes, boxes + m_boxes.size());
+
+    // Children always come after their parent.
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        Node& node = m_nodes[i];
+        if (node.left != 0)
+        {
+            node.bounds = m_nodes[node.left].bounds;
+            Grow(node.bounds, m_nodes[node.left + 1].bounds);
+            continue;
+        }
+
+        node.bounds = EmptyBox();
+        for (uint32_t j = node.first; j < node.first + node.count; ++j)
+        {
+            Grow(node.bounds, m_boxes[m_items[j]]);
+        }
+    }
+}
+
+float BoundingVolumeHierarchy::GetCost() const
+{
+    if (m_nodes.empty())
+    {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+    for (const Node& node : m_nodes)
+    {
+        cost += SurfaceArea(node.bounds) * (node.left != 0 ? TraversalCost : IntersectionCost * node.count);
+    }
+    return cost / std::max(SurfaceArea(m_nodes[0].bounds), FLT_MIN);
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const float planes[6][4], std::vector<uint32_t>& outItems) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    struct Entry
+    {
+        uint32_t node;
+        uint32_t mask;  // Planes the node isn't known to be inside of.
+    };
+    Entry stack[StackSize];
+    uint32_t size = 0;
+    stack[size++] = { 0, 0x3f };
+    while (size > 0)
+    {
+        const Entry entry = stack[--size];
+        const Node& node = m_nodes[entry.node];
+        uint32_t mask = entry.mask;
+        const Containment containment = Classify(node.bounds, planes, mask);
+        if (containment == Containment::Outside)
+        {
+            continue;
+        }
+
+        if (containment == Containment::Inside)
+        {
+            outItems.insert(outItems.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+        }
+        else if (node.left == 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                uint32_t itemMask = mask;
+                if (Classify(m_boxes[m_items[i]], planes, itemMask) != Containment::Outside)
+                {
+                    outItems.push_back(m_items[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[size++] = { node.left + 1, mask };
+            stack[size++] = { node.left, mask };
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QuerySphere(const XMFLOAT3& center, float radius, std::vector<uint32_t>& outItems) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    const float radiusSquared = radius * radius;
+    uint32_t stack[StackSize];
+    uint32_t size = 0;
+    stack[size++] = 0;
+    while (size > 0)
+    {
+        const Node& node = m_nodes[stack[--size]];
+        if (DistanceSquared(node.bounds, center) > radiusSquared)
+        {
+            continue;
+        }
+
+        if (node.left == 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (DistanceSquared(m_boxes[m_items[i]], center) <= radiusSquared)
+                {
+                    outItems.push_back(m_items[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[size++] = node.left + 1;
+            stack[size++] = node.left;
+        }
+    }
+}
+
+bool BoundingVolumeHierarchy::RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, uint32_t& outItem,
+                                      float& outDistance, const std::function<float(uint32_t, float)>& hitItem) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    const XMFLOAT3 inverseDirection = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+    float nearest = maxDistance;
+    bool hit = false;
+
+    struct Entry
+    {
+        uint32_t node;
+        float    distance;
+    };
+    Entry stack[StackSize];
+    uint32_t size = 0;
+    const float rootDistance = RayEnter(m_nodes[0].bounds, origin, inverseDirection, nearest);
+    if (rootDistance != FLT_MAX)
+    {
+        stack[size++] = { 0, rootDistance };
+    }
+
+    while (size > 0)
+    {
+        const Entry entry = stack[--size];
+        if (entry.distance > nearest)
+        {
+            continue;
+        }
+
+        const Node& node = m_nodes[entry.node];
+        if (node.left == 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const uint32_t item = m_items[i];
+                const float boxDistance = RayEnter(m_boxes[item], origin, inverseDirection, nearest);
+                if (boxDistance == FLT_MAX)
+                {
+                    continue;
+                }
+
+                const float distance = hitItem ? hitItem(item, boxDistance) : boxDistance;
+                if (distance >= 0.0f && distance <= nearest)
+                {
+                    nearest = distance;
+                    outItem = item;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // The nearer child goes on top of the stack.
+        float leftDistance = RayEnter(m_nodes[node.left].bounds, origin, inverseDirection, nearest);
+        float rightDistance = RayEnter(m_nodes[node.left + 1].bounds, origin, inverseDirection, nearest);
+        uint32_t nearChild = node.left, farChild = node.left + 1;
+        if (rightDistance < leftDistance)
+        {
+            std::swap(leftDistance, rightDistance);
+            std::swap(nearChild, farChild);
+        }
+        if (rightDistance != FLT_MAX)
+        {
+            stack[size++] = { farChild, rightDistance };
+        }
+        if (leftDistance != FLT_MAX)
+        {
+            stack[size++] = { nearChild, leftDistance };
+        }
+    }
+
+    outDistance = nearest;
+    return hit;
+}
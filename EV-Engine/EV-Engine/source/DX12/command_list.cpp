@@ -23,6 +23,7 @@
 #include "DX12/pano_cubemap_pso.h"
 #include "resources/material.h"
 #include "resources/mesh.h"
+#include "resources/mesh_generator.h"
 #include "DX12/pipeline_state_object.h"
 #include "DX12/scene.h"
 #include "DX12/scene_node.h"
@@ -31,6 +32,7 @@
 #include "resources/vertex_buffer.h"
 #include "resources/vertex_types.h"
 #include "utility/helpers.h"
+#include "utility/thread_pool.h"
 
 using namespace EV;
 
@@ -890,145 +892,12 @@ void CommandList::PanoToCubemap(const std::shared_ptr<Texture>& cubemapTexture,
 
 std::shared_ptr<Scene> CommandList::CreateSphere(float radius, uint32_t tessellation, bool reversWinding)
 {
-
-	if (tessellation < 3)
-		throw std::out_of_range("tessellation parameter out of range");
-
-	VertexCollection vertices;
-	IndexCollection  indices;
-
-	size_t verticalSegments = tessellation;
-	size_t horizontalSegments = tessellation * 2;
-
-	// Create rings of vertices at progressively higher latitudes.
-	for (size_t i = 0; i <= verticalSegments; i++)
-	{
-		float v = 1 - (float)i / verticalSegments;
-
-		float latitude = (i * XM_PI / verticalSegments) - XM_PIDIV2;
-		float dy, dxz;
-
-		XMScalarSinCos(&dy, &dxz, latitude);
-
-		// Create a single ring of vertices at this latitude.
-		for (size_t j = 0; j <= horizontalSegments; j++)
-		{
-			float u = (float)j / horizontalSegments;
-
-			float longitude = j * XM_2PI / horizontalSegments;
-			float dx, dz;
-
-			XMScalarSinCos(&dx, &dz, longitude);
-
-			dx *= dxz;
-			dz *= dxz;
-
-			auto normal = XMVectorSet(dx, dy, dz, 0);
-			auto textureCoordinate = XMVectorSet(u, v, 0, 0);
-			auto position = normal * radius;
-
-			vertices.emplace_back(position, normal, textureCoordinate);
-		}
-	}
-
-	// Fill the index buffer with triangles joining each pair of latitude rings.
-	size_t stride = horizontalSegments + 1;
-
-	for (size_t i = 0; i < verticalSegments; i++)
-	{
-		for (size_t j = 0; j <= horizontalSegments; j++)
-		{
-			size_t nextI = i + 1;
-			size_t nextJ = (j + 1) % stride;
-
-			indices.push_back(i * stride + nextJ);
-			indices.push_back(nextI * stride + j);
-			indices.push_back(i * stride + j);
-
-			indices.push_back(nextI * stride + nextJ);
-			indices.push_back(nextI * stride + j);
-			indices.push_back(i * stride + nextJ);
-		}
-	}
-
-	if (reversWinding)
-	{
-		ReverseWinding(indices, vertices);
-	}
-
-	return CreateScene(vertices, indices);
+	return CreateScene(SphereGenerator(radius, tessellation, reversWinding));
 }
 
 std::shared_ptr<Scene> CommandList::CreatePlane(float width, float depth, uint32_t subdivisionWidth, uint32_t subdivisionDepth, bool reverseWinding)
 {
-	if (subdivisionWidth < 1 || subdivisionDepth < 1)
-		throw std::out_of_range("subdivision parameters must be at least 1");
-
-	VertexCollection vertices;
-	IndexCollection  indices;
-
-	float halfWidth = width * 0.5f;
-	float halfDepth = depth * 0.5f;
-
-	float dx = width / subdivisionWidth;
-	float dz = depth / subdivisionDepth;
-
-	float du = 1.0f / subdivisionWidth;
-	float dv = 1.0f / subdivisionDepth;
-
-	// Plane lies in XZ plane, Y-up
-	XMFLOAT3 normal = { 0.0f, 1.0f, 0.0f };
-	XMFLOAT3 tangent = { 1.0f, 0.0f, 0.0f };    // Along X-axis
-	XMFLOAT3 bitangent = { 0.0f, 0.0f, 1.0f };  // Along Z-axis
-
-	// Generate vertices
-	for (uint32_t i = 0; i <= subdivisionDepth; ++i)
-	{
-		float z = halfDepth - i * dz;
-		float v = (float)i * dv;
-
-		for (uint32_t j = 0; j <= subdivisionWidth; ++j)
-		{
-			float x = -halfWidth + j * dx;
-			float u = (float)j * du;
-
-			XMFLOAT3 position = { x, 0.0f, z };
-			XMFLOAT3 texCoord = { u, v, 0.0f };
-
-			vertices.emplace_back(position, normal, texCoord, tangent, bitangent);
-		}
-	}
-
-	// Generate indices
-	uint32_t stride = subdivisionWidth + 1;
-
-	for (uint32_t i = 0; i < subdivisionDepth; ++i)
-	{
-		for (uint32_t j = 0; j < subdivisionWidth; ++j)
-		{
-			uint32_t bottomLeft = i * stride + j;
-			uint32_t bottomRight = bottomLeft + 1;
-			uint32_t topLeft = (i + 1) * stride + j;
-			uint32_t topRight = topLeft + 1;
-
-			// First triangle
-			indices.emplace_back(bottomLeft);
-			indices.emplace_back(topLeft);
-			indices.emplace_back(bottomRight);
-
-			// Second triangle
-			indices.emplace_back(bottomRight);
-			indices.emplace_back(topLeft);
-			indices.emplace_back(topRight);
-		}
-	}
-
-	if (reverseWinding)
-	{
-		ReverseWinding(indices, vertices);
-	}
-
-	return CreateScene(vertices, indices);
+	return CreateScene(PlaneGenerator(width, depth, subdivisionWidth, subdivisionDepth, reverseWinding));
 }
 
 void CommandList::ClearTexture(const std::shared_ptr<Texture>& texture, float clearColor[])
@@ -1110,6 +979,7 @@ void CommandList::SetGraphicsDynamicConstantBuffer(uint32_t rootParameterIndex,
 	memcpy(heapAllococation.CPU, bufferData, sizeInBytes);
 
 	m_commandList->SetGraphicsRootConstantBufferView(rootParameterIndex, heapAllococation.GPU);
+	++m_stateStats.rootBuffers;
 }
 
 void CommandList::SetGraphics32BitConstants(uint32_t rootParameterIndex, uint32_t numConstants, const void* constants)
@@ -1139,6 +1009,7 @@ void CommandList::SetVertexBuffers(uint32_t
 	std::vector<D3D12_VERTEX_BUFFER_VIEW> views;
 	views.reserve(vertexBuffers.size());
 
+	bool bound = true;
 	for (auto vertexBuffer : vertexBuffers)
 	{
 		if (vertexBuffer)
@@ -1146,11 +1017,20 @@ void CommandList::SetVertexBuffers(uint32_t
 			TransitionBarrier(vertexBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
 			TrackResource(vertexBuffer);
 
-			views.push_back(vertexBuffer->GetVertexBufferView());
+			const D3D12_VERTEX_BUFFER_VIEW view = vertexBuffer->GetVertexBufferView();
+			D3D12_VERTEX_BUFFER_VIEW& boundView = m_vertexBufferViews[startSlot + views.size()];
+			bound &= boundView.BufferLocation == view.BufferLocation && boundView.SizeInBytes == view.SizeInBytes &&
+			         boundView.StrideInBytes == view.StrideInBytes;
+			boundView = view;
+			views.push_back(view);
 		}
 	}
 
-	m_commandList->IASetVertexBuffers(startSlot, static_cast<UINT>(views.size()), views.data());
+	if (!bound)
+	{
+		m_commandList->IASetVertexBuffers(startSlot, static_cast<UINT>(views.size()), views.data());
+		++m_stateStats.vertexBuffers;
+	}
 }
 
 void CommandList::SetVertexBuffer(uint32_t slot, const std::shared_ptr<VertexBuffer>& vertexBuffer)
@@ -1171,6 +1051,8 @@ void CommandList::SetDynamicVertexBuffer(uint32_t slot, size_t numVertices, size
 	vertexBufferView.StrideInBytes = static_cast<UINT>(vertexSize);
 
 	m_commandList->IASetVertexBuffers(slot, 1, &vertexBufferView);
+	m_vertexBufferViews[slot] = vertexBufferView;
+	++m_stateStats.vertexBuffers;
 }
 
 void CommandList::SetIndexBuffer(const std::shared_ptr<IndexBuffer>& indexBuffer)
@@ -1180,7 +1062,13 @@ void CommandList::SetIndexBuffer(const std::shared_ptr<IndexBuffer>& indexBuffer
 		TransitionBarrier(indexBuffer, D3D12_RESOURCE_STATE_INDEX_BUFFER);
 		TrackResource(indexBuffer);
 		auto indexBufferView = indexBuffer->GetIndexBufferView();
-		m_commandList->IASetIndexBuffer(&indexBufferView);
+		if (indexBufferView.BufferLocation != m_indexBufferView.BufferLocation || indexBufferView.SizeInBytes != m_indexBufferView.SizeInBytes ||
+		    indexBufferView.Format != m_indexBufferView.Format)
+		{
+			m_commandList->IASetIndexBuffer(&indexBufferView);
+			m_indexBufferView = indexBufferView;
+			++m_stateStats.indexBuffers;
+		}
 
 		// m_commandList->IASetIndexBuffer(&(indexBuffer->GetIndexBufferView()));
 	}
@@ -1200,6 +1088,8 @@ void CommandList::SetDynamicIndexBuffer(size_t numIndicies, DXGI_FORMAT indexFor
 	indexBufferView.Format = indexFormat;
 
 	m_commandList->IASetIndexBuffer(&indexBufferView);
+	m_indexBufferView = indexBufferView;
+	++m_stateStats.indexBuffers;
 }
 
 void CommandList::SetGraphicsDynamicStructuredBuffer(uint32_t slot, size_t numElements, size_t elementSize, const void* bufferData)
@@ -1211,6 +1101,7 @@ void CommandList::SetGraphicsDynamicStructuredBuffer(uint32_t slot, size_t numEl
 	memcpy(heapAllocation.CPU, bufferData, bufferSize);
 
 	m_commandList->SetGraphicsRootShaderResourceView(slot, heapAllocation.GPU);
+	++m_stateStats.rootBuffers;
 }
 void CommandList::SetViewport(const D3D12_VIEWPORT& viewport)
 {
@@ -1246,6 +1137,7 @@ void CommandList::SetPipelineState(const std::shared_ptr<PipelineStateObject>& p
 		m_pipelineState = d3d12PipelineStateObject;
 
 		m_commandList->SetPipelineState(d3d12PipelineStateObject);
+		++m_stateStats.pipelineStates;
 
 		TrackResource(d3d12PipelineStateObject);
 	}
@@ -1264,6 +1156,7 @@ void CommandList::SetGraphicsRootSignature(const std::shared_ptr<RootSignature>&
 		}
 
 		m_commandList->SetGraphicsRootSignature(m_rootSignature);
+		++m_stateStats.rootSignatures;
 
 		TrackResource(m_rootSignature);
 	}
@@ -1284,6 +1177,7 @@ void CommandList::SetComputeRootSignature(const std::shared_ptr<RootSignature>&
 		}
 
 		m_commandList->SetComputeRootSignature(m_rootSignature);
+		++m_stateStats.rootSignatures;
 
 		TrackResource(m_rootSignature);
 	}
@@ -1315,6 +1209,7 @@ void CommandList::SetShaderResourceView(uint32_t rootParameterIndex, uint32_t de
 
 	m_dynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
 		rootParameterIndex, descriptorOffset, 1, srv->GetDescriptorHandle());
+	++m_stateStats.shaderResourceViews;
 }
 
 void CommandList::SetShaderResourceView(uint32_t rootParameterIndex, const std::shared_ptr<Buffer>& buffer,
@@ -1354,6 +1249,7 @@ void CommandList::SetShaderResourceView(int32_t rootParameterIndex, uint32_t des
 
 		m_dynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
 			rootParameterIndex, descriptorOffset, 1, texture->GetShaderResourceView());
+		++m_stateStats.shaderResourceViews;
 	}
 }
 
@@ -1494,6 +1390,7 @@ void CommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t st
 	}
 
 	m_commandList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+	++m_stateStats.draws;
 }
 
 void CommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
@@ -1506,6 +1403,7 @@ void CommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint3
 	}
 
 	m_commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	++m_stateStats.draws;
 }
 
 void CommandList::Dispatch(uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ)
@@ -1561,6 +1459,9 @@ void CommandList::Reset()
 	m_rootSignature = nullptr;
 	m_pipelineState = nullptr;
 	m_computeCommandList = nullptr;
+	std::fill(std::begin(m_vertexBufferViews), std::end(m_vertexBufferViews), D3D12_VERTEX_BUFFER_VIEW{});
+	m_indexBufferView = {};
+	m_stateStats = {};
 }
 
 void CommandList::TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object)
@@ -1607,55 +1508,7 @@ void CommandList::BindDescriptorHeaps()
 
 std::shared_ptr<Scene> CommandList::CreateCube(float size, bool reverseWinding)
 {
-	// Cube is centered at 0,0,0.
-	float s = size * 0.5f;
-
-	// 8 edges of cube.
-	XMFLOAT3 p[8] = { { s, s, -s }, { s, s, s },   { s, -s, s },   { s, -s, -s },
-					  { -s, s, s }, { -s, s, -s }, { -s, -s, -s }, { -s, -s, s } };
-	// 6 face normals
-	XMFLOAT3 n[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
-	// 4 unique texture coordinates
-	XMFLOAT3 t[4] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 } };
-
-	// Indices for the vertex positions.
-	uint16_t i[24] = {
-		0, 1, 2, 3,  // +X
-		4, 5, 6, 7,  // -X
-		4, 1, 0, 5,  // +Y
-		2, 7, 6, 3,  // -Y
-		1, 4, 7, 2,  // +Z
-		5, 0, 3, 6   // -Z
-	};
-
-	VertexCollection vertices;
-	IndexCollection  indices;
-
-	for (uint16_t f = 0; f < 6; ++f)  // For each face of the cube.
-	{
-		// Four vertices per face.
-		vertices.emplace_back(p[i[f * 4 + 0]], n[f], t[0]);
-		vertices.emplace_back(p[i[f * 4 + 1]], n[f], t[1]);
-		vertices.emplace_back(p[i[f * 4 + 2]], n[f], t[2]);
-		vertices.emplace_back(p[i[f * 4 + 3]], n[f], t[3]);
-
-		// First triangle.
-		indices.emplace_back(f * 4 + 0);
-		indices.emplace_back(f * 4 + 1);
-		indices.emplace_back(f * 4 + 2);
-
-		// Second triangle
-		indices.emplace_back(f * 4 + 2);
-		indices.emplace_back(f * 4 + 3);
-		indices.emplace_back(f * 4 + 0);
-	}
-
-	if (reverseWinding)
-	{
-		ReverseWinding(indices, vertices);
-	}
-
-	return CreateScene(vertices, indices);
+	return CreateScene(CubeGenerator(size, reverseWinding));
 }
 
 std::shared_ptr<Scene> CommandList::LoadSceneFromFile(const std::wstring& fileName,
@@ -1671,15 +1524,98 @@ std::shared_ptr<Scene> CommandList::LoadSceneFromFile(const std::wstring& fileNa
 	return nullptr;
 }
 
-std::shared_ptr<Scene> CommandList::CreateScene(const VertexCollection& vertices, const IndexCollection& indices)
+std::shared_ptr<Scene> CommandList::CreateScene(const MeshGenerator& generator)
 {
-	if (vertices.empty())
+	const uint32_t numVertices = generator.GetVertexCount();
+	const uint32_t numIndices = generator.GetIndexCount();
+	if (numVertices == 0)
 	{
 		return nullptr;
 	}
 
-	auto vertexBuffer = CopyVertexBuffer(vertices);
-	auto indexBuffer = CopyIndexBuffer(indices);
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t      vertexStride = sizeof(MeshGenerator::Vertex);
+	const DXGI_FORMAT indexFormat = numVertices <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	const size_t      indexStride = indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+
+	const size_t vertexBytes = numVertices * vertexStride;
+	const size_t indexBytes = numIndices * indexStride;
+	// Buffer copies have no alignment requirement, this only keeps the indices aligned for the CPU.
+	const size_t indexOffset = Math::AlignUp(vertexBytes, 16);
+	const size_t uploadBytes = indexOffset + indexBytes;
+
+	// One upload resource for both buffers, the generator writes into it directly.
+	auto device = Application::Get().GetDevice();
+
+	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC   desc = CD3DX12_RESOURCE_DESC::Buffer(uploadBytes);
+
+	ComPtr<ID3D12Resource> uploadResource;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadResource)));
+
+	// The CPU doesn't read from the resource.
+	CD3DX12_RANGE readRange(0, 0);
+	uint8_t*      mapped = nullptr;
+	ThrowIfFailed(uploadResource->Map(0, &readRange, reinterpret_cast<void**>(&mapped)));
+
+	auto* vertices = reinterpret_cast<MeshGenerator::Vertex*>(mapped);
+	void* indices = mapped + indexOffset;
+
+	// Rows are small for the cube and the sphere, keep enough of them per job to pay for the dispatch.
+	constexpr uint32_t VERTICES_PER_JOB = 4096;
+	const uint32_t     numRows = generator.GetRowCount();
+	const uint32_t     rowsPerJob = std::max(1u, VERTICES_PER_JOB / std::max(1u, numVertices / numRows));
+
+	ThreadPool::Get().ParallelFor(0, numRows, rowsPerJob, [&](uint32_t begin, uint32_t end)
+	{
+		if (indexFormat == DXGI_FORMAT_R16_UINT)
+		{
+			generator.Generate(begin, end, vertices, static_cast<uint16_t*>(indices));
+		}
+		else
+		{
+			generator.Generate(begin, end, vertices, static_cast<uint32_t*>(indices));
+		}
+	});
+
+	uploadResource->Unmap(0, nullptr);
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	auto vertexResource = CopyBuffer(vertexBytes, nullptr);
+	auto indexResource = CopyBuffer(indexBytes, nullptr);
+
+	m_resourceStateTracker->TransitionResource(vertexResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	if (indexResource)
+	{
+		m_resourceStateTracker->TransitionResource(indexResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	}
+	FlushResourceBarriers();
+
+	m_commandList->CopyBufferRegion(vertexResource.Get(), 0, uploadResource.Get(), 0, vertexBytes);
+	if (indexResource)
+	{
+		m_commandList->CopyBufferRegion(indexResource.Get(), 0, uploadResource.Get(), indexOffset, indexBytes);
+	}
+
+	// Add references to resources so they stay in scope until the command list is reset.
+	TrackResource(uploadResource);
+
+	auto vertexBuffer = Application::Get().CreateVertexBuffer(vertexResource, numVertices, vertexStride);
+	auto indexBuffer = Application::Get().CreateIndexBuffer(indexResource, numIndices, indexFormat);
+
+	m_lastMeshStats.numVertices = numVertices;
+	m_lastMeshStats.numIndices = numIndices;
+	m_lastMeshStats.indexFormat = indexFormat;
+	m_lastMeshStats.uploadBytes = vertexBytes + indexBytes;
+	m_lastMeshStats.generateTime = std::chrono::duration<double, std::milli>(end - start).count();
 
 	auto mesh = std::make_shared<Mesh>();
 	// Create a default white material for new meshes.
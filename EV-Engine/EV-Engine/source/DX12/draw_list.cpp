@@ -0,0 +1,71 @@
+#include <DX12/draw_list.h>
+
+#include <cstring>
+
+using namespace EV;
+
+static_assert(DrawList::PassBits + DrawList::PSOBits + DrawList::MaterialBits + DrawList::MeshBits + DrawList::DepthBits == 64,
+              "The fields fill the key.");
+
+uint64_t DrawList::MakeKey(uint32_t pass, uint32_t pso, uint32_t material, uint32_t mesh, float depth)
+{
+    // Positive floats sort like their bits, the top DepthBits of them keep the
+    // exponent and the leading bits of the mantissa.
+    uint32_t depthBits = 0;
+    if (depth > 0.0f)
+    {
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits >>= 32 - DepthBits;
+    }
+
+    uint64_t key = pass & ((1u << PassBits) - 1);
+    key = (key << PSOBits) | (pso & ((1u << PSOBits) - 1));
+    key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+    key = (key << MeshBits) | (mesh & ((1u << MeshBits) - 1));
+    key = (key << DepthBits) | depthBits;
+    return key;
+}
+
+void DrawList::Sort()
+{
+    const size_t count = m_items.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    // All eight histograms in one read of the keys.
+    uint32_t histograms[8][256] = {};
+    for (const DrawItem& item : m_items)
+    {
+        for (uint32_t digit = 0; digit < 8; ++digit)
+        {
+            ++histograms[digit][(item.key >> (digit * 8)) & 0xFF];
+        }
+    }
+
+    m_scratch.resize(count);
+    for (uint32_t digit = 0; digit < 8; ++digit)
+    {
+        // A byte all keys share doesn't reorder anything.
+        uint32_t* histogram = histograms[digit];
+        if (histogram[(m_items[0].key >> (digit * 8)) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket)
+        {
+            const uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (const DrawItem& item : m_items)
+        {
+            m_scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
@@ -46,14 +46,16 @@ EffectPSO::EffectPSO(EV::Camera& cam, const std::wstring& vertexpath, const std:
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
     // Descriptor range for the textures.
-    CD3DX12_DESCRIPTOR_RANGE1 descriptorRage(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 12, 3 );
+    CD3DX12_DESCRIPTOR_RANGE1 descriptorRage(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 11, 3 );
 
 
     // clang-format off
     CD3DX12_ROOT_PARAMETER1 rootParameters[RootParameters::NumRootParameters];
-    rootParameters[RootParameters::MatricesCB].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParameters[RootParameters::Instances].InitAsShaderResourceView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParameters[RootParameters::FirstInstance].InitAsConstants(1, 1, 1, D3D12_SHADER_VISIBILITY_VERTEX);
     rootParameters[RootParameters::MaterialCB].InitAsConstantBufferView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParameters[RootParameters::Camera].InitAsConstantBufferView(1,0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[RootParameters::IrradianceCB].InitAsConstantBufferView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
     // rootParameters[RootParameters::LightPropertiesCB].InitAsConstants(sizeof(LightProperties) / 4, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParameters[RootParameters::PointLights].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
     // rootParameters[RootParameters::SpotLights].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
@@ -146,6 +148,17 @@ EffectPSO::~EffectPSO()
     _aligned_free(m_pAlignedMVP);
 }
 
+void EffectPSO::SetMaterial(const std::shared_ptr<Material>& material)
+{
+    const uint64_t version = material ? material->GetVersion() : 0;
+    if (material != m_material || version != m_materialVersion)
+    {
+        m_material = material;
+        m_materialVersion = version;
+        m_dirtyFlags |= DF_Material;
+    }
+}
+
 inline void EffectPSO::BindTexture(CommandList& commandList, uint32_t offset, const std::shared_ptr<Texture>& texture)
 {
     if (texture)
@@ -162,18 +175,38 @@ inline void EffectPSO::BindTexture(CommandList& commandList, uint32_t offset, co
 
 void EffectPSO::Apply(CommandList& commandList)
 {
+    // Root arguments are lost when another root signature is bound, and a new
+    // command list starts without any.
+    if (commandList.GetBoundRootSignature() != m_rootSignature->GetRootSignature().Get())
+    {
+        m_dirtyFlags = DF_All;
+    }
+
     commandList.SetPipelineState(m_pipelineStateObject);
     commandList.SetGraphicsRootSignature(m_rootSignature);
 
     if (m_dirtyFlags & DF_Matrices)
     {
-        Matrices m;
-        m.modelMatrix = m_pAlignedMVP->world;
-        m.modelViewMatrix = m_pAlignedMVP->world * m_pAlignedMVP->view;
-        m.modelViewProjectionMatrix = m.modelViewMatrix * m_pAlignedMVP->projection;
-        m.inverseTransposeModelViewMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, m.modelViewMatrix));
+        // The matrices of every instance go into one buffer, the draws pick theirs
+        // with FirstInstance.
+        const DirectX::XMMATRIX* worldMatrices = m_instanceWorldMatrices.empty() ? &m_pAlignedMVP->world : m_instanceWorldMatrices.data();
+        const size_t count = m_instanceWorldMatrices.empty() ? 1 : m_instanceWorldMatrices.size();
+        m_instanceMatrices.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Matrices& m = m_instanceMatrices[i];
+            m.modelMatrix = worldMatrices[i];
+            m.modelViewMatrix = worldMatrices[i] * m_pAlignedMVP->view;
+            m.modelViewProjectionMatrix = m.modelViewMatrix * m_pAlignedMVP->projection;
+            m.inverseTransposeModelViewMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, m.modelViewMatrix));
+        }
 
-        commandList.SetGraphicsDynamicConstantBuffer(RootParameters::MatricesCB, m);
+        commandList.SetGraphicsDynamicStructuredBuffer(RootParameters::Instances, m_instanceMatrices);
+    }
+
+    if (m_dirtyFlags & DF_FirstInstance)
+    {
+        commandList.SetGraphics32BitConstants(RootParameters::FirstInstance, m_firstInstance);
     }
 
     if (m_dirtyFlags & DF_Material)
@@ -201,18 +234,19 @@ void EffectPSO::Apply(CommandList& commandList)
        
     }
 
-    // bind IBL textures
-    commandList.SetShaderResourceView(RootParameters::Textures, 9,
-        m_diffuseIBL ? m_diffuseIBL : m_defaultCubeSRV,
-        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    commandList.SetShaderResourceView(RootParameters::Textures, 10,
-        m_specularIBL ? m_specularIBL : m_defaultCubeSRV,
-        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    commandList.SetShaderResourceView(RootParameters::Textures, 11,
-        m_lutIBL,
-        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-
-    // if (m_dirtyFlags & DF_Camera)
+    // bind IBL
+    if (m_dirtyFlags & DF_IBL)
+    {
+        commandList.SetGraphicsDynamicConstantBuffer(RootParameters::IrradianceCB, m_irradiance);
+        commandList.SetShaderResourceView(RootParameters::Textures, 9,
+            m_specularIBL ? m_specularIBL : m_defaultCubeSRV,
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandList.SetShaderResourceView(RootParameters::Textures, 10,
+            m_lutIBL,
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    }
+
+    if (m_dirtyFlags & DF_Camera)
     {
         // // TODO: Move camera data in its own class so we can retrieve it here and get rid of Demo.
         auto position = m_camera.GetTranslation();
@@ -250,9 +284,9 @@ void EffectPSO::Apply(CommandList& commandList)
     m_dirtyFlags = DF_None;
 }
 
-void EffectPSO::SetIBLTextures(std::shared_ptr<ShaderResourceView> diffuse, std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut)
+void EffectPSO::SetIBLTextures(std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut)
 {
-    m_diffuseIBL = diffuse;
     m_specularIBL = specular;
     m_lutIBL = lut;
+    m_dirtyFlags |= DF_IBL;
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <DX12/frustum_culling.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+using namespace EV;
+
+namespace
+{
+    // Every array holds whole registers of the widest kernel.
+    constexpr uint32_t BoxAlignment = 8;
+}
+
+void CullingBoxes::Assign(const BVHBox* boxes, uint32_t boxCount)
+{
+    // The padding boxes are empty and sit at the origin, their results are never written.
+    const uint32_t padded = (boxCount + BoxAlignment - 1) / BoxAlignment * BoxAlignment;
+    for (std::vector<float>* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+    {
+        values->assign(padded, 0.0f);
+    }
+
+    for (uint32_t i = 0; i < boxCount; ++i)
+    {
+        minX[i] = boxes[i].min.x;
+        minY[i] = boxes[i].min.y;
+        minZ[i] = boxes[i].min.z;
+        maxX[i] = boxes[i].max.x;
+        maxY[i] = boxes[i].max.y;
+        maxZ[i] = boxes[i].max.z;
+    }
+    count = boxCount;
+}
+
+uint32_t EV::CullBoxes(const float planes[6][4], const CullingBoxes& boxes, uint8_t* outVisible)
+{
+    // A box is outside a plane if the corner furthest along its normal is. Which
+    // corner that is only depends on the signs of the normal, so per plane the
+    // kernel reads either the min or the max array of every axis.
+    const float* corners[6][3];
+    for (int i = 0; i < 6; ++i)
+    {
+        const float* plane = planes[i];
+        corners[i][0] = plane[0] >= 0.0f ? boxes.maxX.data() : boxes.minX.data();
+        corners[i][1] = plane[1] >= 0.0f ? boxes.maxY.data() : boxes.minY.data();
+        corners[i][2] = plane[2] >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+    }
+
+#if defined(__AVX__)
+    constexpr uint32_t Width = 8;
+    __m256 a[6], b[6], c[6], d[6];
+    for (int i = 0; i < 6; ++i)
+    {
+        a[i] = _mm256_set1_ps(planes[i][0]);
+        b[i] = _mm256_set1_ps(planes[i][1]);
+        c[i] = _mm256_set1_ps(planes[i][2]);
+        d[i] = _mm256_set1_ps(planes[i][3]);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+#else
+    constexpr uint32_t Width = 4;
+    __m128 a[6], b[6], c[6], d[6];
+    for (int i = 0; i < 6; ++i)
+    {
+        a[i] = _mm_set1_ps(planes[i][0]);
+        b[i] = _mm_set1_ps(planes[i][1]);
+        c[i] = _mm_set1_ps(planes[i][2]);
+        d[i] = _mm_set1_ps(planes[i][3]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+#endif
+
+    uint32_t visibleCount = 0;
+    for (uint32_t first = 0; first < boxes.count; first += Width)
+    {
+        // Same order of operations as IsBoxVisible, so both agree on boxes that touch a plane.
+#if defined(__AVX__)
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int i = 0; i < 6; ++i)
+        {
+            __m256 distance = _mm256_mul_ps(a[i], _mm256_loadu_ps(corners[i][0] + first));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(b[i], _mm256_loadu_ps(corners[i][1] + first)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(c[i], _mm256_loadu_ps(corners[i][2] + first)));
+            distance = _mm256_add_ps(distance, d[i]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+#else
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int i = 0; i < 6; ++i)
+        {
+            __m128 distance = _mm_mul_ps(a[i], _mm_loadu_ps(corners[i][0] + first));
+            distance = _mm_add_ps(distance, _mm_mul_ps(b[i], _mm_loadu_ps(corners[i][1] + first)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(c[i], _mm_loadu_ps(corners[i][2] + first)));
+            distance = _mm_add_ps(distance, d[i]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+        }
+        const int mask = _mm_movemask_ps(inside);
+#endif
+
+        const uint32_t lanes = boxes.count - first < Width ? boxes.count - first : Width;
+        for (uint32_t lane = 0; lane < lanes; ++lane)
+        {
+            const uint8_t visible = static_cast<uint8_t>((mask >> lane) & 1);
+            outVisible[first + lane] = visible;
+            visibleCount += visible;
+        }
+    }
+
+    return visibleCount;
+}
+
+bool EV::IsBoxVisible(const float planes[6][4], const BVHBox& box)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        const float* plane = planes[i];
+        const float distance = plane[0] * (plane[0] >= 0.0f ? box.max.x : box.min.x) +
+                               plane[1] * (plane[1] >= 0.0f ? box.max.y : box.min.y) +
+                               plane[2] * (plane[2] >= 0.0f ? box.max.z : box.min.z) + plane[3];
+        if (!(distance >= 0.0f))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -12,9 +12,63 @@
 
 #include "resources/material.h"
 
+#include <chrono>
+#include <cmath>
+#include <numeric>
 
 using namespace EV;
 
+namespace
+{
+    // Refits only grow the boxes, past this cost over a fresh build it is built again.
+    constexpr float BVHRebuildCostRatio = 1.5f;
+
+    // Every mesh's vertices and indices start on this many bytes into the buffers of
+    // the scene, so a section can still be given a view of its own.
+    constexpr size_t SectionAlignment = 256;
+
+    // World space AABB of every mesh below node, and the items below every node, in scene graph order.
+    void GatherBVHItems(SceneNode& node, std::vector<Scene::BVHItem>& items, std::vector<BVHBox>& boxes, std::vector<Scene::BVHNodeRange>& ranges)
+    {
+        const size_t range = ranges.size();
+        ranges.push_back({ &node, static_cast<uint32_t>(items.size()), 0, 0 });
+
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, node.GetWorldTransform());
+        for (size_t i = 0; std::shared_ptr<Mesh> mesh = node.GetMesh(i); ++i)
+        {
+            // The center moves with the matrix, the extents along every world axis
+            // add up the absolute rows it is built from.
+            const BoundingBox& aabb = mesh->GetAABB();
+            const float center[3] = { aabb.Center.x, aabb.Center.y, aabb.Center.z };
+            const float extents[3] = { aabb.Extents.x, aabb.Extents.y, aabb.Extents.z };
+            float worldCenter[3], worldExtents[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                worldCenter[axis] = world.m[3][axis];
+                worldExtents[axis] = 0.0f;
+                for (int row = 0; row < 3; ++row)
+                {
+                    worldCenter[axis] += center[row] * world.m[row][axis];
+                    worldExtents[axis] += extents[row] * std::abs(world.m[row][axis]);
+                }
+            }
+
+            items.push_back({ &node, mesh.get() });
+            boxes.push_back({ { worldCenter[0] - worldExtents[0], worldCenter[1] - worldExtents[1], worldCenter[2] - worldExtents[2] },
+                              { worldCenter[0] + worldExtents[0], worldCenter[1] + worldExtents[1], worldCenter[2] + worldExtents[2] } });
+        }
+
+        for (auto& child : node.m_children)
+        {
+            GatherBVHItems(*child, items, boxes, ranges);
+        }
+
+        ranges[range].itemCount = static_cast<uint32_t>(items.size()) - ranges[range].firstItem;
+        ranges[range].nodeCount = static_cast<uint32_t>(ranges.size() - range);
+    }
+}
+
 // A progress handler for Assimp
 class ProgressHandler : public Assimp::ProgressHandler
 {
@@ -142,18 +196,40 @@ void Scene::ImportScene(CommandList& commandList, const aiScene& scene, std::fil
     m_materialMap.clear();
     m_materials.clear();
     m_meshes.clear();
+    m_geometryStats = {};
 
     // Import scene materials.
     for (unsigned int i = 0; i < scene.mNumMaterials; ++i)
     {
         ImportMaterial(commandList, *(scene.mMaterials[i]), parentPath);
     }
-    // Import meshes
+    // Import meshes into one vertex and one index buffer, uploaded with a copy each
+    // instead of two resources per mesh. The meshes draw their sections of them.
+    std::vector<VertexPositionNormalTangentBitangentTexture> vertices;
+    std::vector<uint32_t> indices;
     for (unsigned int i = 0; i < scene.mNumMeshes; ++i)
     {
-        ImportMesh(commandList, *(scene.mMeshes[i]));
+        ImportMesh(*(scene.mMeshes[i]), vertices, indices);
     }
 
+    std::shared_ptr<VertexBuffer> vertexBuffer = vertices.empty() ? nullptr : commandList.CopyVertexBuffer(vertices);
+    std::shared_ptr<IndexBuffer> indexBuffer = indices.empty() ? nullptr : commandList.CopyIndexBuffer(indices);
+    for (const std::shared_ptr<Mesh>& mesh : m_meshes)
+    {
+        if (vertexBuffer)
+        {
+            mesh->SetVertexBuffer(0, vertexBuffer);
+        }
+        if (indexBuffer && !mesh->GetIndices().empty())
+        {
+            mesh->SetIndexBuffer(indexBuffer);
+        }
+    }
+
+    m_geometryStats.meshes = static_cast<uint32_t>(m_meshes.size());
+    m_geometryStats.vertexBytes = vertices.size() * sizeof(VertexPositionNormalTangentBitangentTexture);
+    m_geometryStats.indexBytes = indices.size() * sizeof(uint32_t);
+
     // Import the root node.
     m_rootNode = ImportSceneNode(commandList, nullptr, scene.mRootNode);
 }
@@ -325,7 +401,8 @@ void Scene::ImportMaterial(CommandList& commandList, const aiMaterial& material,
     m_materials.push_back(pMaterial);
 }
 
-void Scene::ImportMesh(EV::CommandList& commandList, const aiMesh& aiMesh)
+void Scene::ImportMesh(const aiMesh& aiMesh, std::vector<VertexPositionNormalTangentBitangentTexture>& vertices,
+    std::vector<uint32_t>& indices)
 {
     auto mesh = std::make_shared<EV::Mesh>();
 
@@ -369,13 +446,10 @@ void Scene::ImportMesh(EV::CommandList& commandList, const aiMesh& aiMesh)
         }
     }
 
-    auto vertexBuffer = commandList.CopyVertexBuffer(vertexData);
-    mesh->SetVertexBuffer(0, vertexBuffer);
-
     // Extract the index buffer.
+    std::vector<uint32_t> meshIndices;
     if (aiMesh.HasFaces())
     {
-        std::vector<unsigned int> indices;
         for (i = 0; i < aiMesh.mNumFaces; ++i)
         {
             const aiFace& face = aiMesh.mFaces[i];
@@ -383,22 +457,40 @@ void Scene::ImportMesh(EV::CommandList& commandList, const aiMesh& aiMesh)
             // Only extract triangular faces
             if (face.mNumIndices == 3)
             {
-                indices.push_back(face.mIndices[0]);
-                indices.push_back(face.mIndices[1]);
-                indices.push_back(face.mIndices[2]);
+                meshIndices.push_back(face.mIndices[0]);
+                meshIndices.push_back(face.mIndices[1]);
+                meshIndices.push_back(face.mIndices[2]);
             }
         }
-
-        if (indices.size() > 0)
-        {
-            auto indexBuffer = commandList.CopyIndexBuffer(indices);
-            mesh->SetIndexBuffer(indexBuffer);
-        }
     }
 
+    // The section starts on an element that is also on an aligned byte, the padding
+    // before it is never drawn. Indices stay relative to the base vertex.
+    constexpr size_t vertexStride = sizeof(VertexPositionNormalTangentBitangentTexture);
+    constexpr size_t vertexAlignment = std::lcm(vertexStride, SectionAlignment) / vertexStride;
+    constexpr size_t indexAlignment = SectionAlignment / sizeof(uint32_t);
+    const size_t baseVertex = (vertices.size() + vertexAlignment - 1) / vertexAlignment * vertexAlignment;
+    const size_t firstIndex = (indices.size() + indexAlignment - 1) / indexAlignment * indexAlignment;
+    m_geometryStats.paddingBytes += (baseVertex - vertices.size()) * vertexStride + (firstIndex - indices.size()) * sizeof(uint32_t);
+
+    vertices.resize(baseVertex);
+    vertices.insert(vertices.end(), vertexData.begin(), vertexData.end());
+    indices.resize(firstIndex);
+    indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+    mesh->SetSection(static_cast<uint32_t>(baseVertex), static_cast<uint32_t>(vertexData.size()),
+        static_cast<uint32_t>(firstIndex), static_cast<uint32_t>(meshIndices.size()));
+
     // Set the AABB from the AI Mesh's AABB.
     mesh->SetAABB(CreateBoundingBox(aiMesh.mAABB));
 
+    // Keep the triangles on the CPU as well.
+    std::vector<XMFLOAT3> positions(vertexData.size());
+    for (i = 0; i < vertexData.size(); ++i)
+    {
+        positions[i] = vertexData[i].position;
+    }
+    mesh->SetGeometry(std::move(positions), std::move(meshIndices));
+
     m_meshes.push_back(mesh);
 }
 
@@ -418,9 +510,8 @@ std::shared_ptr<SceneNode> Scene::ImportSceneNode(CommandList& commandList, std:
         aiNode->mTransformation.a4, aiNode->mTransformation.b4, aiNode->mTransformation.c4, aiNode->mTransformation.d4
     );
 
-    auto node = std::make_shared<SceneNode>(localTransform);
-
-    // Set parent directly without recalculating transform
+    // Set parent directly without recalculating transform, the whole scene shares one transform hierarchy.
+    auto node = parent ? std::make_shared<SceneNode>(localTransform, *parent) : std::make_shared<SceneNode>(localTransform);
     if (parent)
     {
         node->m_parentNode = parent;
@@ -472,3 +563,66 @@ DirectX::BoundingBox Scene::GetAABB() const
 
     return aabb;
 }
+
+DirectX::BoundingBox Scene::GetWorldBounds() const
+{
+    DirectX::BoundingBox aabb{ { 0, 0, 0 }, { 0, 0, 0 } };
+
+    if (!m_bvh.IsEmpty())
+    {
+        const BVHBox& bounds = m_bvh.GetBounds();
+        BoundingBox::CreateFromPoints(aabb, XMLoadFloat3(&bounds.min), XMLoadFloat3(&bounds.max));
+    }
+
+    return aabb;
+}
+
+void Scene::UpdateBVH()
+{
+    if (!m_rootNode)
+    {
+        m_bvhItems.clear();
+        m_bvhBoxes.clear();
+        m_bvhNodeRanges.clear();
+        m_cullingBoxes.Assign(nullptr, 0);
+        m_bvh.Build(nullptr, 0);
+        return;
+    }
+
+    // Every world transform of the scene in one pass, then nothing to do if none moved.
+    TransformHierarchy& transforms = m_rootNode->GetTransformHierarchy();
+    transforms.Update();
+    if (!m_bvhDirty && transforms.GetVersion() == m_bvhVersion)
+    {
+        return;
+    }
+    m_bvhVersion = transforms.GetVersion();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<BVHItem> items;
+    items.reserve(m_bvhItems.size());
+    m_bvhBoxes.clear();
+    m_bvhNodeRanges.clear();
+    GatherBVHItems(*m_rootNode, items, m_bvhBoxes, m_bvhNodeRanges);
+    m_cullingBoxes.Assign(m_bvhBoxes.data(), static_cast<uint32_t>(m_bvhBoxes.size()));
+
+    bool build = m_bvhDirty || !std::equal(items.begin(), items.end(), m_bvhItems.begin(), m_bvhItems.end(),
+        [](const BVHItem& a, const BVHItem& b) { return a.node == b.node && a.mesh == b.mesh; });
+    m_bvhItems = std::move(items);
+    m_bvhDirty = false;
+
+    if (!build)
+    {
+        m_bvh.Refit(m_bvhBoxes.data());
+        m_bvhStats.refitTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        ++m_bvhStats.refits;
+        build = m_bvh.GetCost() > BVHRebuildCostRatio * m_bvh.GetBuildCost();
+    }
+
+    if (build)
+    {
+        m_bvh.Build(m_bvhBoxes.data(), static_cast<uint32_t>(m_bvhBoxes.size()));
+        m_bvhStats.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        ++m_bvhStats.builds;
+    }
+}
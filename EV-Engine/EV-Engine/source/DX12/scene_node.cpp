@@ -4,23 +4,28 @@
 #include <DX12/scene_node.h>
 #include <DX12/visitor.h>
 
-#include <cstdlib>
-
 using namespace EV;
 using namespace DirectX;
 
 SceneNode::SceneNode(const DirectX::XMMATRIX& localTransform)
     : m_Name("SceneNode")
+    , m_transformHierarchy(std::make_shared<TransformHierarchy>())
+    , m_AABB({ 0, 0, 0 }, { 0, 0, 0 })
+{
+    m_transformHandle = m_transformHierarchy->Create(localTransform);
+}
+
+SceneNode::SceneNode(const DirectX::XMMATRIX& localTransform, const SceneNode& parent)
+    : m_Name("SceneNode")
+    , m_transformHierarchy(parent.m_transformHierarchy)
     , m_AABB({ 0, 0, 0 }, { 0, 0, 0 })
 {
-    m_alignedData = (AlignedData*)_aligned_malloc(sizeof(AlignedData), 16);
-    m_alignedData->m_localTransform = localTransform;
-    m_alignedData->m_inverseTransform = XMMatrixInverse(nullptr, localTransform);
+    m_transformHandle = m_transformHierarchy->Create(localTransform, parent.m_transformHandle);
 }
 
 SceneNode::~SceneNode()
 {
-    _aligned_free(m_alignedData);
+    m_transformHierarchy->Destroy(m_transformHandle);
 }
 
 const std::string& SceneNode::GetName() const
@@ -35,28 +40,27 @@ void SceneNode::SetName(const std::string& name)
 
 DirectX::XMMATRIX SceneNode::GetLocalTransform() const
 {
-    return m_alignedData->m_localTransform;
+    return m_transformHierarchy->GetLocalTransform(m_transformHandle);
 }
 
 void SceneNode::SetLocalTransform(const DirectX::XMMATRIX& localTransform)
 {
-    m_alignedData->m_localTransform = localTransform;
-    m_alignedData->m_inverseTransform = XMMatrixInverse(nullptr, localTransform);
+    m_transformHierarchy->SetLocalTransform(m_transformHandle, localTransform);
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseLocalTransform() const
 {
-    return m_alignedData->m_inverseTransform;
+    return XMMatrixInverse(nullptr, GetLocalTransform());
 }
 
 DirectX::XMMATRIX SceneNode::GetWorldTransform() const
 {
-    return m_alignedData->m_localTransform * GetParentWorldTransform();
+    return m_transformHierarchy->GetWorldTransform(m_transformHandle);
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseWorldTransform() const
 {
-    return XMMatrixInverse(nullptr, GetWorldTransform());
+    return m_transformHierarchy->GetInverseWorldTransform(m_transformHandle);
 }
 
 DirectX::XMMATRIX SceneNode::GetParentWorldTransform() const
@@ -79,6 +83,14 @@ void SceneNode::AddChild(std::shared_ptr<SceneNode> childNode)
         {
             XMMATRIX worldTransform = childNode->GetWorldTransform();
             childNode->m_parentNode = shared_from_this();
+            if (childNode->m_transformHierarchy == m_transformHierarchy)
+            {
+                m_transformHierarchy->SetParent(childNode->m_transformHandle, m_transformHandle);
+            }
+            else
+            {
+                childNode->MoveToHierarchy(m_transformHierarchy, m_transformHandle);
+            }
             XMMATRIX localTransform = worldTransform * GetInverseWorldTransform();
             childNode->SetLocalTransform(localTransform);
             m_children.push_back(childNode);
@@ -137,10 +149,25 @@ void SceneNode::SetParent(std::shared_ptr<SceneNode> parentNode)
         auto worldTransform = GetWorldTransform();
         parent->RemoveChild(me);
         m_parentNode.reset();
+        m_transformHierarchy->SetParent(m_transformHandle, TransformHierarchy::InvalidHandle);
         SetLocalTransform(worldTransform);
     }
 }
 
+void SceneNode::MoveToHierarchy(const std::shared_ptr<TransformHierarchy>& hierarchy, TransformHierarchy::Handle parentHandle)
+{
+    const XMMATRIX localTransform = GetLocalTransform();
+    m_transformHierarchy->Destroy(m_transformHandle);
+    m_transformHierarchy = hierarchy;
+    m_transformHandle = m_transformHierarchy->Create(localTransform, parentHandle);
+
+    // Parents go first, so the subtree keeps its order in the new hierarchy.
+    for (auto& child : m_children)
+    {
+        child->MoveToHierarchy(hierarchy, m_transformHandle);
+    }
+}
+
 size_t SceneNode::AddMesh(std::shared_ptr<Mesh> mesh)
 {
     size_t index = (size_t)-1;
@@ -194,7 +221,10 @@ const DirectX::BoundingBox& SceneNode::GetAABB() const
 
 void SceneNode::Accept(Visitor& visitor)
 {
-    visitor.Visit(*this);
+    if (!visitor.Visit(*this))
+    {
+        return;
+    }
 
     // Visit meshes
     for (auto& mesh : m_meshes)
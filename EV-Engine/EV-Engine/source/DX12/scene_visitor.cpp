@@ -7,40 +7,193 @@
 #include "core/camera.h"
 #include "DX12/effect_pso.h"
 #include "resources/material.h"
+#include "DX12/scene.h"
 #include "DX12/scene_node.h"
 
+#include <cassert>
+
 
 using namespace EV;
 using namespace DirectX;
 
-SceneVisitor::SceneVisitor(CommandList& commandList, const Camera& camera, BasePSO& pso, bool transparent)
+namespace
+{
+    // Adds the state set between two snapshots of the command list.
+    void AddStateStats(CommandList::StateStats& stats, const CommandList::StateStats& before, const CommandList::StateStats& after)
+    {
+        stats.pipelineStates += after.pipelineStates - before.pipelineStates;
+        stats.rootSignatures += after.rootSignatures - before.rootSignatures;
+        stats.rootBuffers += after.rootBuffers - before.rootBuffers;
+        stats.shaderResourceViews += after.shaderResourceViews - before.shaderResourceViews;
+        stats.vertexBuffers += after.vertexBuffers - before.vertexBuffers;
+        stats.indexBuffers += after.indexBuffers - before.indexBuffers;
+        stats.draws += after.draws - before.draws;
+    }
+}
+
+SceneVisitor::SceneVisitor(CommandList& commandList, const Camera& camera, BasePSO& pso, bool transparent, bool frustumCulling)
     : m_commandList(commandList)
     , m_camera(camera)
     , m_lightingPSO(pso)
     , m_transparentPass(transparent)
+    , m_frustumCulling(frustumCulling)
 {
+    if (m_frustumCulling)
+    {
+        m_camera.GetFrustumPlanes(m_frustumPlanes);
+    }
+}
+
+SceneVisitor::~SceneVisitor()
+{
+    assert(m_draws.empty() && "Submit the recorded draws before the visitor goes away.");
 }
 
 void SceneVisitor::Visit(Scene& scene)
 {
-    m_lightingPSO.SetViewMatrix(m_camera.GetViewMatrix());
+    m_viewMatrix = m_camera.GetViewMatrix();
+    m_lightingPSO.SetViewMatrix(m_viewMatrix);
     m_lightingPSO.SetProjectionMatrix(m_camera.GetProjectionMatrix());
+
+    if (!m_frustumCulling)
+    {
+        return;
+    }
+
+    // The world space boxes follow the transforms, one batch tests all of them and
+    // the nodes only look up their results.
+    scene.UpdateBVH();
+    const CullingBoxes& boxes = scene.GetCullingBoxes();
+    m_visible.resize(boxes.count);
+    const uint32_t visibleCount = CullBoxes(m_frustumPlanes, boxes, m_visible.data());
+
+    m_visibleBefore.resize(boxes.count + 1);
+    m_visibleBefore[0] = 0;
+    for (uint32_t i = 0; i < boxes.count; ++i)
+    {
+        m_visibleBefore[i + 1] = m_visibleBefore[i] + m_visible[i];
+    }
+
+    m_scene = &scene;
+    m_nodeRange = 0;
+    m_cullingStats.tested += boxes.count;
+    m_cullingStats.culled += boxes.count - visibleCount;
 }
 
-void SceneVisitor::Visit(SceneNode& sceneNode)
+bool SceneVisitor::Visit(SceneNode& sceneNode)
 {
-    auto world = sceneNode.GetWorldTransform();
-    m_lightingPSO.SetWorldMatrix(world);
+    if (m_scene)
+    {
+        const std::vector<Scene::BVHNodeRange>& ranges = m_scene->GetBVHNodeRanges();
+        assert(m_nodeRange < ranges.size() && ranges[m_nodeRange].node == &sceneNode && "Nodes are visited in the order of the BVH ranges.");
+
+        const Scene::BVHNodeRange& range = ranges[m_nodeRange];
+        if (m_visibleBefore[range.firstItem + range.itemCount] == m_visibleBefore[range.firstItem])
+        {
+            m_nodeRange += range.nodeCount;
+            m_cullingStats.skippedNodes += range.nodeCount;
+            return false;
+        }
+
+        ++m_nodeRange;
+        m_item = range.firstItem;
+    }
+
+    m_worldMatrix = sceneNode.GetWorldTransform();
+    if (!m_sortDraws)
+    {
+        m_lightingPSO.SetWorldMatrix(m_worldMatrix);
+    }
+    return true;
 }
 
 void SceneVisitor::Visit(Mesh& mesh)
 {
+    if (m_scene && !m_visible[m_item++])
+    {
+        return;
+    }
+
     auto material = mesh.GetMaterial();
     // if (material->IsTransparent() == m_transparentPass) // TODO: need to account for transparant objects.
     {
-        m_lightingPSO.SetMaterial(material);
+        ++m_cullingStats.drawn;
+        if (!m_sortDraws)
+        {
+            const CommandList::StateStats before = m_commandList.GetStateStats();
+            m_lightingPSO.SetMaterial(material);
+
+            m_lightingPSO.Apply(m_commandList);
+            mesh.Draw(m_commandList);
+            AddStateStats(m_stateStats, before, m_commandList.GetStateStats());
+            return;
+        }
+
+        // Depth of the center of the mesh, for front to back within a material and mesh.
+        const BoundingBox& aabb = mesh.GetAABB();
+        const XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&aabb.Center), m_worldMatrix);
+        const float depth = XMVectorGetZ(XMVector3TransformCoord(center, m_viewMatrix));
+
+        const uint32_t materialId = m_materialIds.try_emplace(material.get(), static_cast<uint32_t>(m_materialIds.size())).first->second;
+        const uint32_t meshId = m_meshIds.try_emplace(&mesh, static_cast<uint32_t>(m_meshIds.size())).first->second;
+        m_drawList.Add(DrawList::MakeKey(m_transparentPass ? 1 : 0, 0, materialId, meshId, depth), static_cast<uint32_t>(m_draws.size()));
+        m_draws.push_back({ m_worldMatrix, &mesh, material });
+    }
+}
+
+void SceneVisitor::Submit()
+{
+    const CommandList::StateStats before = m_commandList.GetStateStats();
+
+    // The PSO only binds what changed since the last draw, so the material is only
+    // bound at material boundaries, and the command list skips buffers already bound.
+    m_drawList.Sort();
+    const std::vector<DrawItem>& items = m_drawList.GetItems();
+
+    // Sorting puts the draws of a mesh and material next to each other, so with the
+    // world matrices in sorted order every group's instances are contiguous and the
+    // whole Submit uploads them once.
+    const bool instancing = m_instancing && m_lightingPSO.SupportsInstancing();
+    if (instancing && !items.empty())
+    {
+        m_instanceWorldMatrices.clear();
+        for (const DrawItem& item : items)
+        {
+            m_instanceWorldMatrices.push_back(m_draws[item.payload].worldMatrix);
+        }
+        m_lightingPSO.SetInstances(m_instanceWorldMatrices.data(), static_cast<uint32_t>(m_instanceWorldMatrices.size()));
+    }
 
+    m_drawList.GetBatches([this, instancing](uint32_t a, uint32_t b)
+    {
+        return instancing && m_draws[a].mesh == m_draws[b].mesh && m_draws[a].material == m_draws[b].material;
+    }, m_batches);
+
+    for (const DrawBatch& batch : m_batches)
+    {
+        const Draw& draw = m_draws[items[batch.firstItem].payload];
+        m_lightingPSO.SetMaterial(draw.material);
+        if (instancing)
+        {
+            m_lightingPSO.SetFirstInstance(batch.firstItem);
+        }
+        else
+        {
+            m_lightingPSO.SetWorldMatrix(draw.worldMatrix);
+        }
         m_lightingPSO.Apply(m_commandList);
-        mesh.Draw(m_commandList);
+        draw.mesh->Draw(m_commandList, batch.count);
+
+        if (batch.count > 1)
+        {
+            ++m_instancingStats.draws;
+            m_instancingStats.instances += batch.count;
+        }
     }
+    AddStateStats(m_stateStats, before, m_commandList.GetStateStats());
+
+    m_drawList.Clear();
+    m_draws.clear();
+    m_materialIds.clear();
+    m_meshIds.clear();
 }
\ No newline at end of file
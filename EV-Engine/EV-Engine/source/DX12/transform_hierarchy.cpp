@@ -0,0 +1,240 @@
+#include <DX12/transform_hierarchy.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace EV;
+using namespace DirectX;
+
+namespace
+{
+    // Compacting is a copy of every live transform, only worth it once enough slots are free.
+    constexpr uint32_t MinFreeToCompact = 64;
+}
+
+TransformHierarchy::Handle TransformHierarchy::Create(const XMMATRIX& localTransform, Handle parent)
+{
+    Handle handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(m_indices.size());
+        m_indices.push_back(InvalidIndex);
+    }
+
+    Append(handle, localTransform, parent == InvalidHandle ? InvalidIndex : m_indices[parent]);
+    return handle;
+}
+
+void TransformHierarchy::Destroy(Handle handle)
+{
+    const uint32_t index = m_indices[handle];
+    assert(index != InvalidIndex && "Transform was already destroyed.");
+
+    // The children find out in the next Update, they all come after it.
+    m_flags[index] |= Free;
+    MarkDirty(index);
+    m_indices[handle] = InvalidIndex;
+    m_freeHandles.push_back(handle);
+    ++m_freeCount;
+
+    if (m_freeCount >= MinFreeToCompact && m_freeCount * 2 > GetSize())
+    {
+        Compact();
+    }
+}
+
+void TransformHierarchy::SetParent(Handle handle, Handle parent)
+{
+    const uint32_t index = m_indices[handle];
+    const uint32_t parentIndex = parent == InvalidHandle ? InvalidIndex : m_indices[parent];
+    if (parentIndex == InvalidIndex || parentIndex < index)
+    {
+        m_parents[index] = parentIndex;
+        MarkDirty(index);
+        return;
+    }
+
+    // The new parent comes later, so the subtree moves behind it. Everything below
+    // the transform comes after it, one pass finds the subtree and keeps its order.
+    const uint32_t size = GetSize();
+    std::vector<uint32_t> newIndices(size - index, InvalidIndex);
+    for (uint32_t i = index; i < size; ++i)
+    {
+        const uint32_t oldParent = m_parents[i];
+        const bool inSubtree = i == index || (oldParent != InvalidIndex && oldParent >= index && newIndices[oldParent - index] != InvalidIndex);
+        if (!inSubtree || (m_flags[i] & Free))
+        {
+            continue;
+        }
+
+        assert(i != parentIndex && "A transform can't be parented to its own subtree.");
+        const uint32_t newParent = i == index ? parentIndex : newIndices[oldParent - index];
+        const XMMATRIX localTransform = m_localTransforms[i];
+        newIndices[i - index] = Append(m_handles[i], localTransform, newParent);
+
+        m_flags[i] |= Free;
+        ++m_freeCount;
+    }
+
+    if (m_freeCount >= MinFreeToCompact && m_freeCount * 2 > GetSize())
+    {
+        Compact();
+    }
+}
+
+TransformHierarchy::Handle TransformHierarchy::GetParent(Handle handle) const
+{
+    const uint32_t parentIndex = m_parents[m_indices[handle]];
+    return parentIndex == InvalidIndex || (m_flags[parentIndex] & Free) ? InvalidHandle : m_handles[parentIndex];
+}
+
+XMMATRIX TransformHierarchy::GetLocalTransform(Handle handle) const
+{
+    return m_localTransforms[m_indices[handle]];
+}
+
+void TransformHierarchy::SetLocalTransform(Handle handle, const XMMATRIX& localTransform)
+{
+    const uint32_t index = m_indices[handle];
+    m_localTransforms[index] = localTransform;
+    MarkDirty(index);
+}
+
+XMMATRIX TransformHierarchy::GetWorldTransform(Handle handle)
+{
+    Update();
+    return m_worldTransforms[m_indices[handle]];
+}
+
+XMMATRIX TransformHierarchy::GetInverseWorldTransform(Handle handle)
+{
+    Update();
+
+    const uint32_t index = m_indices[handle];
+    if (!(m_flags[index] & InverseValid))
+    {
+        m_inverseWorldTransforms[index] = XMMatrixInverse(nullptr, m_worldTransforms[index]);
+        m_flags[index] |= InverseValid;
+    }
+    return m_inverseWorldTransforms[index];
+}
+
+void TransformHierarchy::Update()
+{
+    if (m_firstDirty == InvalidIndex)
+    {
+        return;
+    }
+
+    // A transform is recomputed when it changed itself or its parent was recomputed,
+    // which happened earlier in this same pass. The dirty flags are cleared afterwards.
+    const uint32_t size = GetSize();
+    for (uint32_t i = m_firstDirty; i < size; ++i)
+    {
+        uint8_t flags = m_flags[i];
+        if (flags & Free)
+        {
+            continue;
+        }
+
+        uint32_t parent = m_parents[i];
+        if (parent != InvalidIndex && (m_flags[parent] & Free))
+        {
+            m_parents[i] = parent = InvalidIndex;
+            flags |= Dirty;
+        }
+
+        if (!(flags & Dirty) && (parent == InvalidIndex || !(m_flags[parent] & Dirty)))
+        {
+            continue;
+        }
+
+        m_worldTransforms[i] = parent == InvalidIndex ? m_localTransforms[i] : XMMatrixMultiply(m_localTransforms[i], m_worldTransforms[parent]);
+        m_flags[i] = static_cast<uint8_t>((flags | Dirty) & ~InverseValid);
+    }
+
+    for (uint32_t i = m_firstDirty; i < size; ++i)
+    {
+        m_flags[i] &= ~Dirty;
+    }
+    m_firstDirty = InvalidIndex;
+    ++m_version;
+}
+
+uint32_t TransformHierarchy::Append(Handle handle, const XMMATRIX& localTransform, uint32_t parentIndex)
+{
+    const uint32_t index = GetSize();
+    m_localTransforms.push_back(localTransform);
+    m_worldTransforms.push_back(localTransform);
+    m_inverseWorldTransforms.push_back(XMMatrixIdentity());
+    m_parents.push_back(parentIndex);
+    m_flags.push_back(0);
+    m_handles.push_back(handle);
+    m_indices[handle] = index;
+
+    MarkDirty(index);
+    return index;
+}
+
+void TransformHierarchy::MarkDirty(uint32_t index)
+{
+    m_flags[index] |= Dirty;
+    m_firstDirty = std::min(m_firstDirty, index);
+}
+
+void TransformHierarchy::Compact()
+{
+    // Keeps the order, so parents still come first. Children of released
+    // transforms become dirty roots.
+    const uint32_t size = GetSize();
+    std::vector<uint32_t> newIndices(size, InvalidIndex);
+    uint32_t count = 0;
+    m_firstDirty = InvalidIndex;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        if (m_flags[i] & Free)
+        {
+            continue;
+        }
+
+        const uint32_t parent = m_parents[i];
+        uint8_t flags = m_flags[i];
+        uint32_t newParent = InvalidIndex;
+        if (parent != InvalidIndex)
+        {
+            newParent = newIndices[parent];
+            if (newParent == InvalidIndex)
+            {
+                flags |= Dirty;
+            }
+        }
+
+        m_localTransforms[count] = m_localTransforms[i];
+        m_worldTransforms[count] = m_worldTransforms[i];
+        m_inverseWorldTransforms[count] = m_inverseWorldTransforms[i];
+        m_parents[count] = newParent;
+        m_flags[count] = flags;
+        m_handles[count] = m_handles[i];
+        m_indices[m_handles[i]] = count;
+        newIndices[i] = count;
+
+        if ((flags & Dirty) && m_firstDirty == InvalidIndex)
+        {
+            m_firstDirty = count;
+        }
+        ++count;
+    }
+
+    m_localTransforms.resize(count);
+    m_worldTransforms.resize(count);
+    m_inverseWorldTransforms.resize(count);
+    m_parents.resize(count);
+    m_flags.resize(count);
+    m_handles.resize(count);
+    m_freeCount = 0;
+}
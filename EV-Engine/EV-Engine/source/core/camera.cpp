@@ -86,6 +86,25 @@ DirectX::XMMATRIX Camera::GetInverseProjectionMatrix() const
 	return pData->m_inverseProjectionMatrix;
 }
 
+void Camera::GetFrustumPlanes(float outPlanes[6][4]) const
+{
+	// The planes of clip space, taken from the columns of the view projection
+	// matrix (row vectors and a [0, 1] depth range).
+	DirectX::XMMATRIX columns = DirectX::XMMatrixTranspose(GetViewMatrix() * GetProjectionMatrix());
+	DirectX::XMVECTOR planes[6] = {
+		DirectX::XMVectorAdd(columns.r[3], columns.r[0]),      // Left
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[0]), // Right
+		DirectX::XMVectorAdd(columns.r[3], columns.r[1]),      // Bottom
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[1]), // Top
+		columns.r[2],                                          // Near
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[2]), // Far
+	};
+	for (int i = 0; i < 6; ++i)
+	{
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(outPlanes[i]), DirectX::XMPlaneNormalize(planes[i]));
+	}
+}
+
 void Camera::SetFov(float fov)
 {
 	// TODO: Should be if the fov passed is not the same as what is set
@@ -497,6 +497,7 @@ void Demo:: OnRender()
             m_sphere->GetRootNode()->SetLocalTransform(worldMatrix);
             m_sphere->Accept(visitor);
         }
+        visitor.Submit();
 
 
 
@@ -39,6 +39,7 @@ const DirectX::XMFLOAT4& Material::GetAmbientColor() const
 
 void Material::SetAmbientColor(const DirectX::XMFLOAT4& ambient)
 {
+    ++m_version;
     m_materialProperties->ambient = ambient;
 }
 
@@ -49,6 +50,7 @@ const DirectX::XMFLOAT4& Material::GetDiffuseColor() const
 
 void Material::SetDiffuseColor(const DirectX::XMFLOAT4& diffuse)
 {
+    ++m_version;
     m_materialProperties->diffuse = diffuse;
 }
 
@@ -59,6 +61,7 @@ const DirectX::XMFLOAT4& Material::GetEmissiveColor() const
 
 void Material::SetEmissiveColor(const DirectX::XMFLOAT4& emissive)
 {
+    ++m_version;
     m_materialProperties->emissive = emissive;
 }
 
@@ -69,6 +72,7 @@ const DirectX::XMFLOAT4& Material::GetSpecularColor() const
 
 void Material::SetSpecularColor(const DirectX::XMFLOAT4& specular)
 {
+    ++m_version;
     m_materialProperties->specular = specular;
 }
 
@@ -79,6 +83,7 @@ float Material::GetSpecularPower() const
 
 void Material::SetSpecularPower(float specularPower)
 {
+    ++m_version;
     m_materialProperties->specularPower = specularPower;
 }
 
@@ -89,6 +94,7 @@ const DirectX::XMFLOAT4& Material::GetReflectance() const
 
 void Material::SetReflectance(const DirectX::XMFLOAT4& reflectance)
 {
+    ++m_version;
     m_materialProperties->reflectance = reflectance;
 }
 
@@ -99,16 +105,19 @@ const float Material::GetOpacity() const
 
 const void Material::SetMetallic(float metallic)
 {
+    ++m_version;
     m_materialProperties->metallic = metallic;
 }
 
 const void Material::SetRoughness(float roughness)
 {
+    ++m_version;
     m_materialProperties->roughness = roughness;
 }
 
 void Material::SetOpacity(float opacity)
 {
+    ++m_version;
     m_materialProperties->opacity = opacity;
 }
 
@@ -119,6 +128,7 @@ float Material::GetIndexOfRefraction() const
 
 void Material::SetIndexOfRefraction(float indexOfRefraction)
 {
+    ++m_version;
     m_materialProperties->indexOfRefraction = indexOfRefraction;
 }
 
@@ -129,6 +139,7 @@ float Material::GetBumpIntensity() const
 
 void Material::SetBumpIntensity(float bumpIntensity)
 {
+    ++m_version;
     m_materialProperties->bumpIntensity = bumpIntensity;
 }
 
@@ -145,6 +156,7 @@ std::shared_ptr<Texture> Material::GetTexture(TextureType ID) const
 
 void Material::SetTexture(TextureType type, std::shared_ptr<Texture> texture)
 {
+    ++m_version;
     m_textures[type] = texture;
 
     switch (type)
@@ -209,6 +221,7 @@ const MaterialProperties& Material::GetMaterialProperties() const
 
 void Material::SetMaterialProperties(const MaterialProperties& materialProperties)
 {
+    ++m_version;
     *m_materialProperties = materialProperties;
 }
 
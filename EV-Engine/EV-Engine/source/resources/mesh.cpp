@@ -46,10 +46,23 @@ std::shared_ptr<IndexBuffer> Mesh::GetIndexBuffer()
     return m_indexBuffer;
 }
 
+void Mesh::SetSection(uint32_t baseVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount)
+{
+    m_hasSection = true;
+    m_baseVertex = baseVertex;
+    m_vertexCount = vertexCount;
+    m_firstIndex = firstIndex;
+    m_indexCount = indexCount;
+}
+
 size_t Mesh::GetIndexCount() const
 {
     size_t indexCount = 0;
-    if (m_indexBuffer)
+    if (m_hasSection)
+    {
+        indexCount = m_indexBuffer ? m_indexCount : 0;
+    }
+    else if (m_indexBuffer)
     {
         indexCount = m_indexBuffer->GetNumIndices();
     }
@@ -60,6 +73,10 @@ size_t Mesh::GetIndexCount() const
 size_t Mesh::GetVertexCount() const
 {
     size_t vertexCount = 0;
+    if (m_hasSection)
+    {
+        return m_vertexBuffers.empty() ? 0 : m_vertexCount;
+    }
 
     // To count the number of vertices in the mesh, just take the number of vertices in the first vertex buffer.
     BufferMap::const_iterator iter = m_vertexBuffers.cbegin();
@@ -95,12 +112,13 @@ void Mesh::Draw(CommandList& commandList, uint32_t instanceCount, uint32_t start
 
     if (indexCount > 0)
     {
+        // Meshes of a scene share the buffers, the command list only binds them for the first.
         commandList.SetIndexBuffer(m_indexBuffer);
-        commandList.DrawIndexed(indexCount, instanceCount, 0u, 0u, startInstance);
+        commandList.DrawIndexed(indexCount, instanceCount, m_firstIndex, static_cast<int32_t>(m_baseVertex), startInstance);
     }
     else if (vertexCount > 0)
     {
-        commandList.Draw(vertexCount, instanceCount, 0u, startInstance);
+        commandList.Draw(vertexCount, instanceCount, m_baseVertex, startInstance);
     }
 }
 
@@ -117,3 +135,16 @@ const DirectX::BoundingBox& Mesh::GetAABB() const {
     return m_AABB;
 }
 
+void Mesh::SetGeometry(std::vector<DirectX::XMFLOAT3> positions, std::vector<uint32_t> indices) {
+    m_positions = std::move(positions);
+    m_indices = std::move(indices);
+}
+
+const std::vector<DirectX::XMFLOAT3>& Mesh::GetPositions() const {
+    return m_positions;
+}
+
+const std::vector<uint32_t>& Mesh::GetIndices() const {
+    return m_indices;
+}
+
@@ -0,0 +1,245 @@
+#include "DX12/dx12_includes.h"
+
+#include <resources/mesh_generator.h>
+
+#include <stdexcept>
+
+using namespace EV;
+using namespace DirectX;
+
+PlaneGenerator::PlaneGenerator(float width, float depth, uint32_t subdivisionWidth, uint32_t subdivisionDepth, bool reverseWinding)
+    : MeshGenerator(reverseWinding)
+    , m_width(width)
+    , m_depth(depth)
+    , m_subdivisionWidth(subdivisionWidth)
+    , m_subdivisionDepth(subdivisionDepth)
+{
+    if (subdivisionWidth < 1 || subdivisionDepth < 1)
+        throw std::out_of_range("subdivision parameters must be at least 1");
+}
+
+uint32_t PlaneGenerator::GetVertexCount() const
+{
+    return (m_subdivisionWidth + 1) * (m_subdivisionDepth + 1);
+}
+
+uint32_t PlaneGenerator::GetIndexCount() const
+{
+    return m_subdivisionWidth * m_subdivisionDepth * 6;
+}
+
+uint32_t PlaneGenerator::GetRowCount() const
+{
+    return m_subdivisionDepth + 1;
+}
+
+void PlaneGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+void PlaneGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+template<typename Index>
+void PlaneGenerator::GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const
+{
+    const float halfWidth = m_width * 0.5f;
+    const float halfDepth = m_depth * 0.5f;
+
+    const float dx = m_width / m_subdivisionWidth;
+    const float dz = m_depth / m_subdivisionDepth;
+
+    const float du = 1.0f / m_subdivisionWidth;
+    const float dv = 1.0f / m_subdivisionDepth;
+
+    // Plane lies in XZ plane, Y-up
+    const XMFLOAT3 normal = { 0.0f, 1.0f, 0.0f };
+    const XMFLOAT3 tangent = { 1.0f, 0.0f, 0.0f };    // Along X-axis
+    const XMFLOAT3 bitangent = { 0.0f, 0.0f, 1.0f };  // Along Z-axis
+
+    const uint32_t stride = m_subdivisionWidth + 1;
+
+    for (uint32_t i = beginRow; i < endRow; ++i)
+    {
+        const float z = halfDepth - i * dz;
+        const float v = i * dv;
+
+        Vertex* row = vertices + i * stride;
+        for (uint32_t j = 0; j <= m_subdivisionWidth; ++j)
+        {
+            const XMFLOAT3 position = { -halfWidth + j * dx, 0.0f, z };
+            const XMFLOAT3 texCoord = { U(j * du), v, 0.0f };
+            row[j] = Vertex(position, normal, texCoord, tangent, bitangent);
+        }
+
+        // The quads between this row and the next.
+        if (i == m_subdivisionDepth)
+            continue;
+
+        Index* quads = indices + i * m_subdivisionWidth * 6;
+        for (uint32_t j = 0; j < m_subdivisionWidth; ++j)
+        {
+            const uint32_t bottomLeft = i * stride + j;
+            const uint32_t bottomRight = bottomLeft + 1;
+            const uint32_t topLeft = (i + 1) * stride + j;
+            const uint32_t topRight = topLeft + 1;
+
+            WriteTriangle(quads + j * 6, bottomLeft, topLeft, bottomRight);
+            WriteTriangle(quads + j * 6 + 3, bottomRight, topLeft, topRight);
+        }
+    }
+}
+
+SphereGenerator::SphereGenerator(float radius, uint32_t tessellation, bool reverseWinding)
+    : MeshGenerator(reverseWinding)
+    , m_radius(radius)
+    , m_verticalSegments(tessellation)
+    , m_horizontalSegments(tessellation * 2)
+{
+    if (tessellation < 3)
+        throw std::out_of_range("tessellation parameter out of range");
+}
+
+uint32_t SphereGenerator::GetVertexCount() const
+{
+    return (m_verticalSegments + 1) * (m_horizontalSegments + 1);
+}
+
+uint32_t SphereGenerator::GetIndexCount() const
+{
+    return m_verticalSegments * (m_horizontalSegments + 1) * 6;
+}
+
+uint32_t SphereGenerator::GetRowCount() const
+{
+    return m_verticalSegments + 1;
+}
+
+void SphereGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+void SphereGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+template<typename Index>
+void SphereGenerator::GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const
+{
+    const uint32_t stride = m_horizontalSegments + 1;
+
+    // Rings of vertices at progressively higher latitudes.
+    for (uint32_t i = beginRow; i < endRow; ++i)
+    {
+        const float v = 1 - (float)i / m_verticalSegments;
+
+        const float latitude = (i * XM_PI / m_verticalSegments) - XM_PIDIV2;
+        float dy, dxz;
+
+        XMScalarSinCos(&dy, &dxz, latitude);
+
+        Vertex* ring = vertices + i * stride;
+        for (uint32_t j = 0; j <= m_horizontalSegments; j++)
+        {
+            const float u = (float)j / m_horizontalSegments;
+
+            const float longitude = j * XM_2PI / m_horizontalSegments;
+            float dx, dz;
+
+            XMScalarSinCos(&dx, &dz, longitude);
+
+            dx *= dxz;
+            dz *= dxz;
+
+            const XMFLOAT3 normal = { dx, dy, dz };
+            const XMFLOAT3 position = { dx * m_radius, dy * m_radius, dz * m_radius };
+            const XMFLOAT3 texCoord = { U(u), v, 0.0f };
+            ring[j] = Vertex(position, normal, texCoord);
+        }
+
+        // The triangles joining this ring with the next.
+        if (i == m_verticalSegments)
+            continue;
+
+        Index* band = indices + i * stride * 6;
+        for (uint32_t j = 0; j <= m_horizontalSegments; j++)
+        {
+            const uint32_t nextI = i + 1;
+            const uint32_t nextJ = (j + 1) % stride;
+
+            WriteTriangle(band + j * 6, i * stride + nextJ, nextI * stride + j, i * stride + j);
+            WriteTriangle(band + j * 6 + 3, nextI * stride + nextJ, nextI * stride + j, i * stride + nextJ);
+        }
+    }
+}
+
+CubeGenerator::CubeGenerator(float size, bool reverseWinding)
+    : MeshGenerator(reverseWinding)
+    , m_size(size)
+{
+}
+
+uint32_t CubeGenerator::GetVertexCount() const
+{
+    return 24;
+}
+
+uint32_t CubeGenerator::GetIndexCount() const
+{
+    return 36;
+}
+
+uint32_t CubeGenerator::GetRowCount() const
+{
+    return 6;
+}
+
+void CubeGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint16_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+void CubeGenerator::Generate(uint32_t beginRow, uint32_t endRow, Vertex* vertices, uint32_t* indices) const
+{
+    GenerateRows(beginRow, endRow, vertices, indices);
+}
+
+template<typename Index>
+void CubeGenerator::GenerateRows(uint32_t beginRow, uint32_t endRow, Vertex* vertices, Index* indices) const
+{
+    // Cube is centered at 0,0,0.
+    const float s = m_size * 0.5f;
+
+    // 8 edges of cube.
+    const XMFLOAT3 p[8] = { { s, s, -s }, { s, s, s },   { s, -s, s },   { s, -s, -s },
+                            { -s, s, s }, { -s, s, -s }, { -s, -s, -s }, { -s, -s, s } };
+    // 6 face normals
+    const XMFLOAT3 n[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    // 4 unique texture coordinates
+    const XMFLOAT3 t[4] = { { U(0), 0, 0 }, { U(1), 0, 0 }, { U(1), 1, 0 }, { U(0), 1, 0 } };
+
+    // Indices for the vertex positions.
+    const uint16_t i[24] = {
+        0, 1, 2, 3,  // +X
+        4, 5, 6, 7,  // -X
+        4, 1, 0, 5,  // +Y
+        2, 7, 6, 3,  // -Y
+        1, 4, 7, 2,  // +Z
+        5, 0, 3, 6   // -Z
+    };
+
+    for (uint32_t f = beginRow; f < endRow; ++f)  // For each face of the cube.
+    {
+        // Four vertices per face.
+        for (uint32_t corner = 0; corner < 4; ++corner)
+            vertices[f * 4 + corner] = Vertex(p[i[f * 4 + corner]], n[f], t[corner]);
+
+        WriteTriangle(indices + f * 6, f * 4 + 0, f * 4 + 1, f * 4 + 2);
+        WriteTriangle(indices + f * 6 + 3, f * 4 + 2, f * 4 + 3, f * 4 + 0);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+/**
+ *  @file ocean_benchmark.h
+ *
+ *  @brief Headless benchmarks and accuracy checks for the CPU side of the
+ *  ocean. They don't need a device or a window, main.cpp runs them when the
+ *  executable is started with --benchmark.
+ */
+
+namespace EV
+{
+	namespace OceanBenchmark
+	{
+		// Times the vectorized multithreaded H0 builder against the scalar
+		// reference and compares their output. Returns false if the error is
+		// outside of the tolerance.
+		bool RunSpectrum();
+
+		// Times OceanCascadeSpectrum::Update for single parameter edits against a
+		// full build and checks that both give the same H0.
+		bool RunSpectrumRebuild();
+
+		// Checks the disk cache round trip, key sensitivity, rejection of
+		// broken files and LRU eviction, and times a cached load against a build.
+		bool RunH0Cache();
+
+		// Checks the Philox generator against known answers, compares the SSE
+		// gaussian field with the scalar path and checks its statistics.
+		bool RunNoise();
+
+		// Runs OceanCpuSimulator against a scalar translation of the compute
+		// shaders and times a simulation step of all cascades.
+		bool RunCpuSimulator();
+
+		// Compares the SSE surface queries with the scalar path, checks how far
+		// the displacement inversion is from convergence and times a batch.
+		bool RunSurfaceQuery();
+
+		// Checks the F16C half conversion against the scalar one and times the
+		// H0 packing, then runs the CPU simulation with H0 and with every
+		// texture store rounded to half and reports the error per cascade and
+		// of the summed surface against the error budget.
+		bool RunHalfPrecision();
+
+		// Plans the cascades for calm to strong wind and a strong short wave fade, checks
+		// that they tile k-space, that the integrated energies match the H0
+		// BuildH0 generates and that only cascades below the threshold are skipped.
+		bool RunCascadePlanner();
+
+		// Checks that the displacement bounds of the default cascades hold over
+		// a spread of simulated frames and times the estimate.
+		bool RunDisplacementBounds();
+
+		// Selects the CDLOD nodes for cameras near and far above the water,
+		// checks that they cover the root once, that neighbours differ by one
+		// level at most and meet without cracks or steps in the cascade weights
+		// after the morph, that the SSE frustum culling agrees with a scalar
+		// test and keeps every visible point, and times the selection.
+		bool RunQuadtree();
+
+		// Checks how many cascades every quadtree level samples against the
+		// vertex spacing and pixel size rule and counts the displacement
+		// fetches the masking saves per frame.
+		bool RunCascadeMasking();
+
+		// Round trips simulated frames through a baked clip in both formats,
+		// checks the decoded error against the quantization, the loop and a
+		// complete bake, and times encoding and decoding.
+		bool RunClip();
+
+		// Voxelizes a box and checks its volume and inertia, lets it settle on
+		// still water at the analytic draft, checks that the bodies move the
+		// same at different frame rates and stay afloat on the waves, and
+		// times a step of hundreds of bodies.
+		bool RunBuoyancy();
+
+		// Checks the spherical harmonic irradiance of panoramas and cubemaps
+		// against the exact irradiance of a linear environment, the SSE
+		// projection against a scalar one and the irradiance of a sunny sky
+		// against brute force integration, and times the projection.
+		bool RunIrradiance();
+
+		// Checks the cubemap resampled from a panorama against the environment,
+		// that prefiltering keeps a constant environment, the GGX prefilter with
+		// its source mips against the integral over every environment texel,
+		// and times a complete bake.
+		bool RunIBLBake();
+
+		// Checks what a bilinear sampler reads from the BRDF LUT at every
+		// resolution and precision option against the integral with many more
+		// samples, times the generation and round trips a LUT through a file.
+		bool RunBrdfLut();
+
+		// Checks the world transforms of the flattened hierarchy against walking
+		// up to the root on a wide and a deep tree of 100k nodes, after
+		// reparenting and releasing, and times the update pass against the walk.
+		bool RunTransformHierarchy();
+
+		// Checks frustum, ray and sphere queries of the scene BVH against testing
+		// every box on an atrium, a chess set and a city of 100k boxes, checks
+		// that refits after scattering the boxes ask for a rebuild, and times
+		// the build, refit and queries against the brute force tests.
+		bool RunSceneBVH();
+
+		// Checks that the SIMD frustum culling kernel keeps the same boxes as the
+		// scalar test and the BVH, and times it against the scalar test for the
+		// mesh count of Sponza and for 100k boxes.
+		bool RunFrustumCulling();
+
+		// Checks the radix sort of the draw list against a stable sort and times
+		// both, and counts the material and mesh changes of draws in scene order
+		// and sorted for layouts like Sponza, the chess set and the ocean scene.
+		bool RunDrawList();
+
+		// Checks that sorted draws of the same mesh and material collapse into one
+		// instanced draw with the right instance count and first instance, and that
+		// a mixed list keeps the sorted draw order.
+		bool RunDrawInstancing();
+
+		// Runs every benchmark, returns the process exit code.
+		int RunAll();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "ocean_h0_cache.h"
+
+namespace EV
+{
+	// Texel format of the stored LUT.
+	enum OceanBrdfLutFormat : uint32_t
+	{
+		OBF_Half = 0,   // R16G16_FLOAT
+		OBF_Unorm8 = 1, // R8G8_UNORM, the scale and bias both stay in [0, 1]
+	};
+
+	struct OceanBrdfLutDesc
+	{
+		uint32_t size = 512;
+		OceanBrdfLutFormat format = OBF_Half;
+		uint32_t sampleCount = 1024;
+
+		uint32_t GetTexelSize() const { return format == OBF_Half ? 4 : 2; }
+		uint64_t GetPayloadSize() const { return static_cast<uint64_t>(size) * size * GetTexelSize(); }
+		bool operator==(const OceanBrdfLutDesc& other) const
+		{
+			return size == other.size && format == other.format && sampleCount == other.sampleCount;
+		}
+	};
+
+	// A LUT file mapped for the upload, the texels go straight into CopyTextureSubresource.
+	struct OceanBrdfLutBlob
+	{
+		OceanMappedFile file;
+		OceanBrdfLutDesc desc;
+		const uint8_t* texels = nullptr;
+	};
+
+	// The split sum BRDF LUT only depends on the BRDF, not on the environment,
+	// so it is generated once by the build (the post build step runs the
+	// executable with --bake-brdf-lut) and stored next to the shaders as a
+	// small header and the packed rows, uploaded with one copy at startup.
+	//
+	// 512^2 half floats (1 MB) are the reference, 128^2 unorm8 (32 KB) stays
+	// within a few thousandths of it after filtering, see
+	// OceanBenchmark::RunBrdfLut.
+	class OceanBrdfLut
+	{
+	public:
+		// Integrates the LUT over the thread pool, see OceanIBLBaker::IntegrateBrdf,
+		// and packs it into rows of desc.size texels.
+		static std::vector<uint8_t> Generate(const OceanBrdfLutDesc& desc);
+		static std::vector<uint8_t> Encode(const float* scaleBias, const OceanBrdfLutDesc& desc);
+		static void Decode(const uint8_t* texels, const OceanBrdfLutDesc& desc, float* outScaleBias);
+
+		// Writes a temporary file and renames it over path.
+		static bool Store(const std::filesystem::path& path, const OceanBrdfLutDesc& desc, const uint8_t* texels);
+		// Maps path, returns false if it is missing or doesn't look like what Store writes.
+		static bool Load(const std::filesystem::path& path, OceanBrdfLutBlob& outBlob);
+	};
+}
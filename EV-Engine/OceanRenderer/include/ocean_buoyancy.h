@@ -0,0 +1,155 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "ocean_cpu_simulator.h"
+
+// Most probes VoxelizeHull gives a hull, it grows the voxels until the hull fits.
+#define OCEAN_BUOYANCY_MAX_PROBES 256
+
+namespace EV
+{
+	// Volume of a hull sampled with one probe per voxel. The probes are relative
+	// to the centroid, everything else is in the space of the triangles.
+	struct OceanBuoyancyHull
+	{
+		std::vector<float> probeX;
+		std::vector<float> probeY;
+		std::vector<float> probeZ;
+		float probeSize = 0.0f; // Edge length of the voxels
+		float volume = 0.0f;
+		float centroid[3] = {};
+		// Inertia tensor of the solid hull per kilogram about the centroid, row major.
+		float inertia[9] = {};
+	};
+
+	struct OceanBuoyancySettings
+	{
+		float timeStep = 1.0f / 60.0f;
+		// Steps one Update may take. Longer frames slow the bodies down instead
+		// of making the next frame longer still.
+		uint32_t maxSteps = 8;
+		float waterDensity = 1025.0f;
+		float gravity = 9.81f;
+		// Drag on a probe per second, as a fraction of the water it displaces
+		// times its velocity. Damps both the heave and the roll.
+		float drag = 1.0f;
+		// Fixed-point iterations of the water height queries. Fewer than the
+		// OCEAN_QUERY_ITERATIONS of the camera, the probes only need the height.
+		uint32_t queryIterations = 2;
+	};
+
+	struct OceanBuoyancyBodyDesc
+	{
+		const OceanBuoyancyHull* hull = nullptr;
+		float mass = 0.0f;
+		// Centre of mass relative to the centroid of the hull, ballast pulls it down.
+		float centerOfMassOffset[3] = {};
+		// World position of the centre of mass and orientation, a quaternion (x, y, z, w).
+		float position[3] = {};
+		float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	};
+
+	struct OceanBuoyancyPose
+	{
+		float position[3];
+		float rotation[4];
+	};
+
+	// Rigid bodies floating on the surface of an OceanCpuSimulator.
+	//
+	// Every body is a hull of voxel probes (VoxelizeHull). A step moves the
+	// probes of all bodies to world space, queries the water height above all
+	// of them with one OceanSurface::Query batch and pushes every probe up with
+	// the weight of the water its submerged part displaces, with a drag against
+	// its velocity. The forces and torques per body are summed with SSE and
+	// integrated with semi-implicit Euler, bodies split over the thread pool.
+	//
+	// Steps have a fixed length, Update runs as many as the frame time covers
+	// and GetPose interpolates between the last two, so the motion doesn't
+	// depend on the frame rate. All steps of a frame see the surface of the
+	// last Simulate, the water itself doesn't move with the bodies.
+	class OceanBuoyancy
+	{
+	public:
+		OceanBuoyancy() = default;
+		~OceanBuoyancy();
+
+		OceanBuoyancy(const OceanBuoyancy&) = delete;
+		OceanBuoyancy& operator=(const OceanBuoyancy&) = delete;
+
+		// Fills the triangles with voxels. A voxel is inside when the vertical line
+		// through its centre has crossed the surface an odd number of times
+		// below it. Where a hole or an open deck leaves an odd number of
+		// crossings, everything above the lowest one is inside, so open hulls
+		// don't leak. positions are xyz.
+		static OceanBuoyancyHull VoxelizeHull(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+		                                      uint32_t maxProbes = OCEAN_BUOYANCY_MAX_PROBES);
+
+		void SetSettings(const OceanBuoyancySettings& settings);
+		const OceanBuoyancySettings& GetSettings() const { return m_settings; }
+
+		// Returns the index of the body. The hull is copied.
+		uint32_t AddBody(const OceanBuoyancyBodyDesc& desc);
+		void Clear();
+
+		uint32_t GetBodyCount() const { return static_cast<uint32_t>(m_bodies.size()); }
+		uint32_t GetProbeCount() const { return static_cast<uint32_t>(m_probeVolume.size()); }
+
+		// Advances the bodies by frameTime in fixed steps against the current surface of the simulator.
+		void Update(const OceanCpuSimulator& simulator, float frameTime);
+		// Update on a worker thread. Neither the simulator nor the bodies may be
+		// touched until Wait returns.
+		void UpdateAsync(const OceanCpuSimulator& simulator, float frameTime);
+		void Wait();
+
+		// Pose of the centre of mass, interpolated to the time Update advanced to.
+		OceanBuoyancyPose GetPose(uint32_t body) const;
+		void GetVelocity(uint32_t body, float outLinear[3], float outAngular[3]) const;
+		float GetSubmergedVolume(uint32_t body) const { return m_bodies[body].submergedVolume; }
+
+		uint64_t GetStepCount() const { return m_stepCount; }
+		// Where the time Update advanced to lies between the last two steps, 0 to 1.
+		float GetInterpolation() const { return static_cast<float>(m_accumulator / m_settings.timeStep); }
+		// Wall time of the last Update in milliseconds and the steps it took.
+		double GetUpdateTime() const { return m_updateTime; }
+		uint32_t GetLastSteps() const { return m_lastSteps; }
+
+	private:
+		struct Body
+		{
+			uint32_t probeBegin, probeEnd;
+			float probeSize;
+			float inverseMass;
+			float inverseInertia[9]; // Body space, row major
+			float position[3], rotation[4];
+			float linearVelocity[3], angularVelocity[3];
+			float previousPosition[3], previousRotation[4];
+			float submergedVolume;
+		};
+
+		void Step(const OceanCpuSimulator& simulator);
+		void TransformProbes(uint32_t body);
+		void Integrate(uint32_t body);
+
+		OceanBuoyancySettings m_settings;
+		std::vector<Body> m_bodies;
+
+		// Probes of all bodies, structure of arrays. Every body starts on a multiple
+		// of 4, the padding has no volume. local is relative to the centre of mass
+		// in body space, offset the same rotated to world space.
+		std::vector<float> m_localX, m_localY, m_localZ;
+		std::vector<float> m_offsetX, m_offsetY, m_offsetZ;
+		std::vector<float> m_worldX, m_worldZ;
+		std::vector<float> m_waterHeight;
+		std::vector<float> m_probeVolume;
+
+		double m_accumulator = 0.0;
+		uint64_t m_stepCount = 0;
+		uint32_t m_lastSteps = 0;
+		double m_updateTime = 0.0;
+
+		std::future<void> m_task;
+	};
+}
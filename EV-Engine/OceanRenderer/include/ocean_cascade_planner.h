@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ocean_spectrum.h"
+
+namespace EV
+{
+	struct OceanCascadePlannerSettings
+	{
+		// Patch size of the first cascade, the period the whole ocean tiles with.
+		float largestPatchSize = 500.0f;
+		// Patch size of the last cascade, its Nyquist limit is the shortest wave simulated.
+		float smallestPatchSize = 5.0f;
+		// A cascade never starts closer than this many k-space texels to its origin,
+		// its longest waves would only be sampled by a handful of texels otherwise.
+		float minLowCutoffTexels = 4.0f;
+		// Cascades below this fraction of both the total height and slope energy are skipped.
+		float minEnergyFraction = 1e-3f;
+		float depth = OCEAN_DEPTH;
+	};
+
+	struct OceanCascadePlan
+	{
+		std::vector<OceanCascadeDesc> cascades;
+		// Energy each cascade captures, the expected sum of the squared H0
+		// amplitudes BuildH0 produces: plain for the heights, weighted with k^2 for the slopes.
+		std::vector<float> heightEnergy;
+		std::vector<float> slopeEnergy;
+		// Bit i is set when cascade i carries enough energy to be simulated and rendered.
+		uint32_t activeMask = 0;
+
+		bool IsActive(uint32_t cascade) const { return (activeMask >> cascade) & 1; }
+	};
+
+	// Lays the cascades out over the spectrum. Patch sizes are spaced
+	// geometrically from the largest to the smallest, the first cascade starts
+	// at k = 0 and every following one starts at the Nyquist limit of the
+	// previous one, so the cascades tile k-space without gaps or overlap.
+	//
+	// The energy every cascade captures is integrated from the same spectrum
+	// BuildH0 samples (JONSWAP, TMA, spreading, short wave fade). A cascade that
+	// adds next to nothing to either the heights or the slopes is marked
+	// inactive; the first cascade always stays active.
+	class OceanCascadePlanner
+	{
+	public:
+		static OceanCascadePlan Plan(const JonswapParameters& params, const std::vector<uint32_t>& resolutions,
+		                             const OceanCascadePlannerSettings& settings = {});
+
+		// Height and slope energy of the waves with lowK <= |k| <= highK.
+		static void IntegrateEnergy(const JonswapParameters& params, float lowK, float highK, float depth,
+		                            float& outHeight, float& outSlope);
+
+		// The same energies measured on a packed H0, see OceanSpectrum::BuildH0.
+		static void MeasureEnergy(const OceanCascadeDesc& cascade, const float* packedH0, float& outHeight, float& outSlope);
+	};
+}
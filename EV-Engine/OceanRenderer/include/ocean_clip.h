@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "ocean_cpu_simulator.h"
+#include "ocean_h0_cache.h"
+#include "ocean_spectrum.h"
+
+namespace EV
+{
+	// Quantization of the baked fields.
+	enum OceanClipFormat : uint32_t
+	{
+		OCF_Half = 0,    // IEEE half floats
+		OCF_Unorm16 = 1, // 16 bit normalized over the range of the channel in that frame
+	};
+
+	// Channels of a baked cascade, in the order of OceanCpuSimulator::Cascade.
+	enum OceanClipChannel
+	{
+		OCC_DisplacementX = 0,
+		OCC_DisplacementY,
+		OCC_DisplacementZ,
+		OCC_Foam,
+		OCC_SlopeX,
+		OCC_SlopeZ,
+		OCC_Count
+	};
+
+	struct OceanClipCascade
+	{
+		uint32_t resolution = 0;
+		float patchSize = 0.0f;
+	};
+
+	struct OceanClipDesc
+	{
+		OceanClipFormat format = OCF_Half;
+		float frameRate = 0.0f;
+		uint32_t frameCount = 0;
+		std::vector<OceanClipCascade> cascades;
+
+		// Length of the loop in seconds.
+		float GetDuration() const { return frameCount / frameRate; }
+	};
+
+	// Where the chunk of (frame, cascade) sits in the file, see OceanClipWriter.
+	struct OceanClipIndexEntry
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// One decoded cascade of a frame, one plane of 16 bit codes per channel,
+	// indexed [m * resolution + n] like the simulator output.
+	struct OceanClipFrame
+	{
+		OceanClipFormat format = OCF_Half;
+		uint32_t resolution = 0;
+		std::vector<uint16_t> planes[OCC_Count];
+		// OCF_Unorm16 only: value = code * scale + bias.
+		float scale[OCC_Count] = {};
+		float bias[OCC_Count] = {};
+
+		void ToFloat(uint32_t channel, float* outValues) const;
+		// Largest displacement of the frame, exact for the stored values.
+		OceanDisplacementBounds GetDisplacementBounds() const;
+		// Fills the playback textures: RGBA16F displacement (x, y, z, foam),
+		// RG16F slope (x, z) and R16F foam, resolution^2 texels each.
+		void ToHalfTexels(uint16_t* outDisplacement, uint16_t* outSlope, uint16_t* outFoam) const;
+	};
+
+	// Writes a baked clip. Layout:
+	// - OceanClipFileHeader, one OceanClipCascade per cascade,
+	// - the index, one OceanClipIndexEntry per (frame, cascade), frame major,
+	// - the chunks, one per (frame, cascade) in the order of the index.
+	// The index comes first so a player can seek to any frame as soon as the
+	// head of the file is in, and frames only depend on themselves, so every
+	// frame can be decoded on its own.
+	//
+	// A chunk holds the scale and bias of every channel followed by the six
+	// planes. A plane is predicted texel by texel from its left, upper and
+	// upper left neighbours (the LOCO-I median predictor), and the residuals are
+	// Rice coded with one parameter per row. Half floats are mapped to
+	// integers that sort like the floats first, so neighbouring values stay
+	// close. The file is written under a temporary name and renamed by Close.
+	class OceanClipWriter
+	{
+	public:
+		OceanClipWriter() = default;
+		~OceanClipWriter();
+		OceanClipWriter(const OceanClipWriter&) = delete;
+		OceanClipWriter& operator=(const OceanClipWriter&) = delete;
+
+		bool Open(const std::filesystem::path& path, const OceanClipDesc& desc);
+		// Encodes the current output of every cascade as the next frame.
+		bool WriteFrame(const OceanCpuSimulator& simulator);
+		// Writes the index and moves the file in place, fails unless every frame was written.
+		bool Close();
+
+		// Bytes written so far.
+		uint64_t GetSize() const { return m_offset; }
+
+	private:
+		void Abandon();
+
+		std::filesystem::path m_path;
+		std::filesystem::path m_temporaryPath;
+		std::ofstream m_file;
+		OceanClipDesc m_desc;
+		std::vector<OceanClipIndexEntry> m_index;
+		uint32_t m_frame = 0;
+		uint64_t m_offset = 0;
+	};
+
+	// Streams frames out of a clip. The file is memory mapped, so only the
+	// chunks that are actually decoded get paged in.
+	class OceanClipReader
+	{
+	public:
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		bool IsOpen() const { return m_file.IsOpen(); }
+		const OceanClipDesc& GetDesc() const { return m_desc; }
+		uint64_t GetSize() const { return m_file.GetSize(); }
+
+		// Frame shown at the given time, the clip loops.
+		uint32_t GetFrame(double time) const;
+
+		// Decodes every cascade of a frame, the planes are split over the thread pool.
+		bool Decode(uint32_t frame, std::vector<OceanClipFrame>& outCascades) const;
+
+	private:
+		OceanMappedFile m_file;
+		OceanClipDesc m_desc;
+		const OceanClipIndexEntry* m_index = nullptr;
+	};
+
+	// Everything a bake depends on.
+	struct OceanClipBakeSettings
+	{
+		JonswapParameters params;
+		uint64_t seed = 0;
+		std::vector<OceanCascadeDesc> cascades;
+		OceanFoamParameters foamParameters;
+
+		OceanClipFormat format = OCF_Half;
+		float frameRate = 30.0f;
+		// Rounded to a whole number of frames. OCEAN_REPEAT_TIME reproduces the
+		// live simulation exactly, shorter loops quantize the slow waves.
+		float repeatTime = 30.0f;
+	};
+
+	// Offline baker. Builds the H0 of every cascade, runs OceanCpuSimulator over
+	// one period of the animation and writes every frame to a clip.
+	class OceanClipBaker
+	{
+	public:
+		// The cascade setup and parameters of the ocean scene at the given FFT resolution.
+		static OceanClipBakeSettings DefaultSettings(uint32_t resolution);
+
+		// progress(frame, frameCount) is called after every frame, returning false cancels the bake.
+		static bool Bake(const OceanClipBakeSettings& settings, const std::filesystem::path& path,
+		                 const std::function<bool(uint32_t, uint32_t)>& progress = {});
+	};
+}
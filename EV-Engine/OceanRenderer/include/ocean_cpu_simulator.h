@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ocean_spectrum.h"
+
+// Period of the animation in animate_waves.hlsl.
+#define OCEAN_REPEAT_TIME 500.0f
+
+namespace EV
+{
+	// Foam constants of permute.hlsl, same order as Ocean::m_foamParameters.
+	struct OceanFoamParameters
+	{
+		float decay = 0.0f;
+		float bias = 0.0f;
+		float add = 0.0f;
+		float threshold = 0.0f;
+	};
+
+	// CPU implementation of the ocean compute passes (animate_waves.hlsl,
+	// fft.hlsl and permute.hlsl). Takes the packed H0 GenerateH0 uploads and
+	// produces the same displacement, slope and foam fields, so the simulation
+	// can be validated and profiled without a GPU and queried by gameplay code.
+	//
+	// The two FFT passes run a Stockham radix-4 (radix-2 for the last stage
+	// of odd powers) inverse FFT on 4 lines at a time, one line per SSE lane.
+	// Rows are gathered in 4x4 transposed blocks, columns in cache line wide
+	// strips. Work is split over the thread pool across rows, columns and cascades.
+	class OceanCpuSimulator
+	{
+	public:
+		// Output of one cascade, one plane per channel, indexed [m * resolution + n]
+		// like the textures (n is x, m is y).
+		struct Cascade
+		{
+			OceanCascadeDesc desc;
+			std::vector<float> H0; // Packed RGBA, see OceanSpectrum::BuildH0
+			// What H0 is multiplied with before it's rounded to half precision, see OceanHalf::RangeScale.
+			float H0Scale = 1.0f;
+
+			std::vector<float> displacementX; // displacementTexture.r
+			std::vector<float> displacementY; // displacementTexture.g
+			std::vector<float> displacementZ; // displacementTexture.b
+			std::vector<float> foam;          // displacementTexture.a and foamTexture
+			std::vector<float> slopeX;        // slopeTexture.r
+			std::vector<float> slopeZ;        // slopeTexture.g
+
+			// The same fields interleaved per texel for random access, SURFACE_STRIDE floats:
+			// (displacementX, displacementY, displacementZ, foam, slopeX, slopeZ, 0, 0).
+			std::vector<float> surface;
+
+			// Spectra of Dx + iDz, Dy + iDzx, Dyx + iDyz and Dxx + iDzz, split in real and imaginary planes.
+			std::vector<float> spectrum[8];
+		};
+
+		// Copies the H0 of a cascade, resolution has to be a power of two >= 4.
+		void SetCascade(uint32_t cascade, const OceanCascadeDesc& desc, const float* packedH0);
+		void SetCascadeCount(uint32_t count);
+
+		// Runs animate, FFT and permute for all cascades at the given time.
+		void Simulate(float time, const OceanFoamParameters& foamParameters);
+
+		// Clears the foam that accumulates between Simulate calls.
+		void ResetFoam();
+
+		// The wave frequencies are quantized to multiples of 2 pi / repeatTime, which
+		// makes the animation loop. OCEAN_REPEAT_TIME matches the compute passes,
+		// shorter periods make loops short enough to bake but quantize the slow
+		// waves more coarsely.
+		void SetRepeatTime(float repeatTime);
+		float GetRepeatTime() const { return m_repeatTime; }
+
+		// Rounds every value the compute passes store to a texture to half
+		// precision, like the R16G16B16A16_FLOAT H0 and targets of the half
+		// precision mode: H0 (kept in full precision here and rounded with its
+		// H0Scale as it's read), the animated spectrum, both FFT passes and the outputs.
+		void SetHalfPrecision(bool halfPrecision);
+		bool GetHalfPrecision() const { return m_halfPrecision; }
+
+		uint32_t GetCascadeCount() const { return static_cast<uint32_t>(m_cascades.size()); }
+		const Cascade& GetCascade(uint32_t cascade) const { return m_cascades[cascade]; }
+
+		static constexpr uint32_t SURFACE_STRIDE = 8;
+
+		// Choppiness of the horizontal displacement, Lambda in permute.hlsl.
+		static constexpr float LAMBDA = 1.3f;
+
+		// In place unnormalized inverse FFT, sum_j x[j] * e^(2 pi i j k / N), of
+		// 4 interleaved lines: re[j * 4 + lane], im[j * 4 + lane]. scratch needs 8 * N floats.
+		static void InverseFFT4(uint32_t N, float* re, float* im, float* scratch);
+
+	private:
+		void AnimateAndTransformRows(Cascade& cascade, float time, uint32_t rowBegin, uint32_t rowEnd);
+		void TransformColumnsAndPermute(Cascade& cascade, const OceanFoamParameters& foamParameters, uint32_t columnBegin, uint32_t columnEnd);
+
+		std::vector<Cascade> m_cascades;
+		float m_repeatTime = OCEAN_REPEAT_TIME;
+		bool m_halfPrecision = false;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+#include "ocean_spectrum.h"
+
+// Upper bound of the cache directory, the least recently used files go first.
+#define OCEAN_H0_CACHE_SIZE (256ull * 1024 * 1024)
+
+namespace EV
+{
+	// Read only memory mapping of a cache file, unmapped on destruction.
+	class OceanMappedFile
+	{
+	public:
+		OceanMappedFile() = default;
+		~OceanMappedFile();
+
+		OceanMappedFile(OceanMappedFile&& other) noexcept;
+		OceanMappedFile& operator=(OceanMappedFile&& other) noexcept;
+		OceanMappedFile(const OceanMappedFile&) = delete;
+		OceanMappedFile& operator=(const OceanMappedFile&) = delete;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		bool IsOpen() const { return m_data != nullptr; }
+		const uint8_t* GetData() const { return m_data; }
+		uint64_t GetSize() const { return m_size; }
+
+	private:
+		const uint8_t* m_data = nullptr;
+		uint64_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+
+	// Packed H0 of a cascade as it sits in the cache file, see OceanSpectrum::BuildH0.
+	// Keeps the file mapped for as long as it lives, so the texels can go straight
+	// into CopyTextureSubresource.
+	struct OceanCachedH0
+	{
+		OceanMappedFile file;
+		const float* packedH0 = nullptr;
+		uint32_t resolution = 0;
+	};
+
+	// Disk cache of generated H0 spectra. Every cascade is stored in its own file,
+	// named after a hash of everything the spectrum depends on: the JONSWAP
+	// parameters, the cascade geometry and resolution, the noise seed and cascade
+	// index, and OCEAN_H0_CACHE_VERSION (bumped whenever the generator changes).
+	//
+	// File layout: OceanH0FileHeader followed by resolution^2 RGBA32F texels.
+	// Files are written to a temporary name and renamed, so a crash never leaves
+	// a half written entry behind. A hit refreshes the file's write time, Store
+	// evicts the oldest files once the directory grows past its size budget.
+	class OceanH0Cache
+	{
+	public:
+		explicit OceanH0Cache(const std::filesystem::path& directory, uint64_t maxSize = OCEAN_H0_CACHE_SIZE);
+
+		static uint64_t MakeKey(const JonswapParameters& params, const OceanCascadeDesc& cascade, uint64_t seed, uint32_t cascadeIndex);
+
+		// Maps the cached H0 of key, returns false on a miss or an invalid file.
+		bool Load(uint64_t key, uint32_t resolution, OceanCachedH0& outH0);
+		// Writes an entry and trims the directory back into budget.
+		bool Store(uint64_t key, uint32_t resolution, const float* packedH0);
+
+		// Evicts least recently used entries until the directory fits in maxSize.
+		void Trim();
+		void Clear();
+
+		// Total size of the entries in the directory.
+		uint64_t GetSize() const;
+		uint32_t GetHits() const { return m_hits; }
+		uint32_t GetMisses() const { return m_misses; }
+
+	private:
+		std::filesystem::path GetPath(uint64_t key) const;
+		void TrimLocked();
+
+		std::filesystem::path m_directory;
+		uint64_t m_maxSize;
+		std::atomic_uint32_t m_hits{ 0 };
+		std::atomic_uint32_t m_misses{ 0 };
+
+		// Serializes the directory updates, the cache may be used from loader threads.
+		mutable std::mutex m_mutex;
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace EV
+{
+	// IEEE half float conversion for the R16 float textures of the ocean (the
+	// H0 and simulation targets in half precision, the baked clips). Rounds
+	// to nearest even and overflows to infinity, like the GPU does when it
+	// stores to a half float target.
+	//
+	// The array versions use F16C (vcvtps2ph / vcvtph2ps, 8 values per
+	// iteration) when the CPU and OS support it and fall back to the scalar
+	// path otherwise. Both give the same bits, except for NaN payloads.
+	class OceanHalf
+	{
+	public:
+		static uint16_t FromFloat(float value);
+		static float ToFloat(uint16_t half);
+
+		// Converts values * scale.
+		static void FromFloat(const float* values, uint16_t* outHalves, size_t count, float scale = 1.0f);
+		static void ToFloat(const uint16_t* halves, float* outValues, size_t count);
+
+		// Power of two that brings the largest magnitude of values into [2^13, 2^14),
+		// 1 if they are all 0. Small fields like the H0 of short wave cascades
+		// would otherwise lose their precision to the subnormal halves; a power
+		// of two scale is exact and leaves room below the maximum of 65504.
+		static float RangeScale(const float* values, size_t count);
+
+		// Whether the array versions take the F16C path, checked once.
+		static bool HasF16C();
+	};
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace EV
+{
+	// 64 bit FNV-1a, the key of the disk caches. Add fields one by one, so
+	// padding never ends up in the hash.
+	class OceanHasher
+	{
+	public:
+		void Add(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				m_hash ^= bytes[i];
+				m_hash *= 0x100000001b3ull;
+			}
+		}
+
+		template<typename T>
+		void Add(const T& value) { Add(&value, sizeof(T)); }
+
+		uint64_t Get() const { return m_hash; }
+
+	private:
+		uint64_t m_hash = 0xcbf29ce484222325ull;
+	};
+}
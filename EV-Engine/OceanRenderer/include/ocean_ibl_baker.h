@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "ocean_irradiance.h"
+
+namespace EV
+{
+	// A cubemap with its mip chain, RGBA float texels in the order of the D3D
+	// subresources: face by face, every face from mip 0 down. Faces are in the
+	// order and orientation of FACE_ROTATION in ocean_irradiance.cpp.
+	struct OceanCubemap
+	{
+		uint32_t size = 0;
+		uint32_t mipLevels = 0;
+		std::vector<float> texels;
+
+		uint32_t GetMipSize(uint32_t mip) const { return std::max(size >> mip, 1u); }
+		// Offset of the first texel of a face and mip, in floats.
+		size_t GetOffset(uint32_t face, uint32_t mip) const;
+		float* GetFace(uint32_t face, uint32_t mip) { return texels.data() + GetOffset(face, mip); }
+		const float* GetFace(uint32_t face, uint32_t mip) const { return texels.data() + GetOffset(face, mip); }
+	};
+
+	struct OceanIBLBakeSettings
+	{
+		// Faces of the environment cubemap, with a full mip chain.
+		uint32_t cubemapSize = 1024;
+		// Faces of the prefiltered specular cubemap, mip m holds roughness m / (mipLevels - 1).
+		uint32_t specularSize = 512;
+		uint32_t specularMipLevels = 5;
+		// GGX samples per texel. Every sample reads the mip of the environment that
+		// matches its solid angle, so far fewer are needed than without filtering.
+		uint32_t specularSampleCount = 256;
+	};
+
+	// Wall time of the stages of a bake in milliseconds.
+	struct OceanIBLBakeTimes
+	{
+		double cubemap = 0.0;
+		double irradiance = 0.0;
+		double specular = 0.0;
+	};
+
+	struct OceanIBLBake
+	{
+		OceanCubemap environment;
+		OceanCubemap specular;
+		// Radiance of the panorama, see OceanIrradiance::ToShaderConstants.
+		OceanSH9 irradiance;
+		OceanIBLBakeTimes times;
+	};
+
+	// Offline image based lighting on the CPU: the panorama to cubemap pass,
+	// the specular prefilter and the BRDF LUT the GPU used to redo at every
+	// start. All stages split their rows over the thread pool and give the same
+	// result for any thread count.
+	//
+	// The specular prefilter importance samples GGX with the view along the
+	// normal. With V = N the sample directions only depend on the roughness, so
+	// every mip builds its lobe once in tangent space, with the weight and the
+	// source mip of every sample: the mip whose texels span the solid angle
+	// 1 / (N pdf) the sample stands for (GPU Gems 3, chapter 20.4). The
+	// texels then only rotate the lobe onto their normal.
+	class OceanIBLBaker
+	{
+	public:
+		// Resamples an equirectangular RGBA float panorama, mapped like
+		// OceanIrradiance::ProjectPanorama, and box filters the mip chain.
+		// rowPitch in floats, 0 for tightly packed rows.
+		static OceanCubemap PanoramaToCubemap(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t size);
+		// Box filters mip 0 down the rest of the chain, face by face.
+		static void GenerateMips(OceanCubemap& cubemap);
+
+		static OceanCubemap PrefilterSpecular(const OceanCubemap& environment, uint32_t size, uint32_t mipLevels, uint32_t sampleCount);
+		// Scale (r) and bias (g) of F0 in the split sum approximation, NdotV
+		// along x and roughness along y, at the texel centres. Doesn't depend on
+		// the environment, see OceanBrdfLut.
+		static std::vector<float> IntegrateBrdf(uint32_t size, uint32_t sampleCount);
+
+		// Everything the renderer needs from a panorama.
+		static OceanIBLBake Bake(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, const OceanIBLBakeSettings& settings);
+
+		// Trilinear lookup of the unit direction (x, y, z), bilinear within the
+		// face and clamped at its edges.
+		static void Sample(const OceanCubemap& cubemap, float x, float y, float z, float mip, float outRgb[3]);
+		// Split sum of one NdotV and roughness, what IntegrateBrdf stores per texel.
+		static void IntegrateBrdf(float NdotV, float roughness, uint32_t sampleCount, float outScaleBias[2]);
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+#include <DirectXTex.h>
+
+#include "ocean_ibl_baker.h"
+
+namespace EV
+{
+	// What the renderer uploads of a baked environment, R16G16B16A16_FLOAT
+	// cubemaps with their mips.
+	struct OceanIBLCacheEntry
+	{
+		DirectX::ScratchImage environment;
+		DirectX::ScratchImage specular;
+		// Radiance of the panorama, see OceanIrradiance::ToShaderConstants.
+		OceanSH9 irradiance;
+	};
+
+	// Baked image based lighting of a panorama, stored as DDS files next to it:
+	// <name>.<key>.environment.dds, .specular.dds and .irradiance.dds (the 9
+	// coefficients as a 9 x 1 R32G32B32A32_FLOAT image). The key hashes the
+	// bytes of the panorama, the bake settings and OCEAN_IBL_CACHE_VERSION
+	// (bumped whenever the baker changes its output), so an edited panorama or
+	// other settings never load a stale bake. The BRDF LUT doesn't depend on
+	// the panorama and is built with the executable, see OceanBrdfLut.
+	//
+	// Files are written to temporary names and renamed, a new bake removes
+	// the files of older keys. Files that don't match the settings count as a
+	// miss and are baked again.
+	class OceanIBLCache
+	{
+	public:
+		explicit OceanIBLCache(const std::filesystem::path& panorama, const OceanIBLBakeSettings& settings = {});
+
+		// 0 if the panorama can't be read.
+		uint64_t GetKey() const { return m_key; }
+		const OceanIBLBakeSettings& GetSettings() const { return m_settings; }
+
+		// Loads the files of the key, returns false on a miss or an invalid file.
+		bool Load(OceanIBLCacheEntry& outEntry) const;
+		// Bakes the panorama and stores the result, outTimes gets the time of every stage.
+		bool Bake(OceanIBLCacheEntry& outEntry, OceanIBLBakeTimes* outTimes = nullptr) const;
+		// Load and Bake on a miss, returns false only if both fail.
+		bool LoadOrBake(OceanIBLCacheEntry& outEntry, bool* outHit = nullptr, OceanIBLBakeTimes* outTimes = nullptr) const;
+
+		std::filesystem::path GetPath(const char* name) const;
+
+	private:
+		void RemoveStaleFiles() const;
+
+		std::filesystem::path m_panorama;
+		OceanIBLBakeSettings m_settings;
+		uint64_t m_key = 0;
+	};
+}
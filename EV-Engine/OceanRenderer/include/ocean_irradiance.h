@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+namespace EV
+{
+	// Radiance of an environment projected onto the 9 real L2 spherical
+	// harmonics, per channel. Order and signs of the basis: 1, y, z, x, xy,
+	// yz, 3z^2 - 1, xz, x^2 - y^2.
+	struct OceanSH9
+	{
+		double rgb[9][3] = {};
+	};
+
+	// Diffuse image based lighting from spherical harmonics.
+	//
+	// The irradiance of a Lambertian surface is the environment convolved
+	// with the clamped cosine, which is smooth enough that the first 9
+	// harmonics keep it to a few percent (Ramamoorthi and Hanrahan, "An
+	// Efficient Representation for Irradiance Environment Maps"). The
+	// projection is an integral over the texels of the environment weighted
+	// with their solid angle, split over the thread pool in rows and summed
+	// per row in a fixed order, so it doesn't depend on the thread count.
+	//
+	// The shaders evaluate ToShaderConstants with a second order polynomial
+	// of the normal, it replaces the convolved irradiance cubemap.
+	class OceanIrradiance
+	{
+	public:
+		// Equirectangular RGBA float image, laid out like the panorama
+		// pano_to_cubemap_CS samples: u = atan2(-x, -z) / 2pi, v = acos(y) / pi.
+		// rowPitch in floats, 0 for tightly packed rows. The rows are separable,
+		// every row only needs 5 weighted sums per channel, 4 texels per SSE
+		// iteration.
+		static OceanSH9 ProjectPanorama(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch = 0);
+
+		// Six square RGBA float faces in the order and orientation of a D3D
+		// cubemap, tightly packed. Every texel is weighted with the exact solid
+		// angle it spans on the sphere. Like the panorama the rows reduce to 6
+		// weighted sums per channel, rotated to the face afterwards.
+		static OceanSH9 ProjectCubemap(const float* const faces[6], uint32_t size);
+
+		// Convolves the radiance with the clamped cosine and folds the basis
+		// constants in, 9 float4 (rgb, 0) in the layout of IrradianceSH. Divided by
+		// pi like the irradiance cubemap was, so the shaders only multiply with
+		// the albedo.
+		static void ToShaderConstants(const OceanSH9& radiance, float outConstants[9][4]);
+
+		// What the shaders compute for the unit normal (x, y, z), clamped at 0.
+		static void Evaluate(const float constants[9][4], float x, float y, float z, float outRgb[3]);
+
+		// The basis functions at the unit direction (x, y, z).
+		static void EvaluateBasis(double x, double y, double z, double outBasis[9]);
+	};
+}
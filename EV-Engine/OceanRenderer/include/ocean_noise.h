@@ -0,0 +1,29 @@
+#pragma once
+#include <complex>
+#include <cstdint>
+
+namespace EV
+{
+	// Stateless gaussian noise for the ocean spectrum.
+	// Every texel draws from a Philox4x32-10 counter based generator, with
+	// (n, m, cascade) as counter and the seed as key. A texel therefore
+	// always gets the same pair of numbers for a given seed, no matter in
+	// which order or on which thread it is generated, and changing the
+	// spectrum parameters keeps the phase field of the ocean intact.
+	class OceanNoise
+	{
+	public:
+		static void Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+		// Pair of independent standard normal numbers (Box-Muller) for texel (m, n).
+		static std::complex<float> GaussianPair(uint64_t seed, uint32_t cascade, uint32_t m, uint32_t n);
+
+		// Fills the rows [rowBegin, rowEnd) of a resolution x resolution field,
+		// indexed as field[m * resolution + n]. Four texels are generated per SSE batch.
+		static void GenerateRows(uint64_t seed, uint32_t cascade, uint32_t resolution,
+		                         uint32_t rowBegin, uint32_t rowEnd, std::complex<float>* outField);
+
+		// Fills the whole field, the rows are split over the thread pool.
+		static void Generate(uint64_t seed, uint32_t cascade, uint32_t resolution, std::complex<float>* outField);
+	};
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include "DX12/base_pso.h"
+#include "DX12/light.h"
+
+#include "ocean_quadtree.h"
 
 namespace EV
 {
@@ -12,7 +15,9 @@ namespace EV
 	class OceanPSO : public BasePSO
 	{
 	public:
-		OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, const std::wstring& pixelPath, const UINT cascadeCount, const std::vector<float>& patchSizes);
+		// vertexPaths holds the vertex shader permutations, the first one samples
+		// cascadeCount cascades and every following one a cascade less.
+		OceanPSO(const EV::Camera& cam, const std::vector<std::wstring>& vertexPaths, const std::wstring& pixelPath, const UINT cascadeCount, const std::vector<float>& patchSizes);
         const std::vector<PointLight>& GetPointLights() const
         {
             return m_pointLights;
@@ -84,11 +89,21 @@ namespace EV
             return m_pAlignedMVP->projection;
         }
 		void Apply(CommandList& commandList) override;
-		void SetIBLTextures(std::shared_ptr<ShaderResourceView> diffuse, std::shared_ptr<ShaderResourceView> specular,
-		                    std::shared_ptr<ShaderResourceView> lut);
+		void SetIBLTextures(std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut);
+		// Diffuse IBL as spherical harmonics, see OceanIrradiance.
+		void SetIrradiance(const IrradianceSH& irradiance)
+		{
+			m_irradiance = irradiance;
+		}
 
 
 		void SetOceanTextures(std::shared_ptr<Texture> displacement, std::shared_ptr<Texture> slope, std::shared_ptr<Texture> foam, const UINT cascade);
+        // Patch size of every cascade and the mask of the cascades the shaders sample, see OceanCascadePlan.
+        void SetCascades(const std::vector<float>& patchSizes, uint32_t activeMask);
+        // Quadtree nodes drawn as instances of the patch mesh, see OceanQuadtree.
+        void SetNodes(const std::vector<OceanQuadtreeNode>& nodes, uint32_t gridResolution);
+        // Picks the vertex shader permutation that samples the first count cascades.
+        void SetSampledCascades(uint32_t count);
         // Helper function to bind a texture to the rendering pipeline.
         inline void BindTexture(CommandList& commandList, uint32_t offset,
             const std::shared_ptr<Texture>& texture);
@@ -110,6 +125,7 @@ namespace EV
         {
             // Vertex shader parameter
             MatricesCB,  // ConstantBuffer<Matrices> MatCB : register(b0);
+            Nodes,       // StructuredBuffer<OceanNode> Nodes : register(t1);
 
             // Pixel shader parameters
             MaterialCB,         // ConstantBuffer<Material> MaterialCB : register( b0, space1 );
@@ -130,6 +146,7 @@ namespace EV
             Camera, // just its position
             RenderParams,
             Constants,
+            IrradianceCB, // ConstantBuffer<IrradianceSH> IrradianceCB : register( b4 );
             NumRootParameters
         };
         struct alignas(16) CameraData
@@ -138,6 +155,15 @@ namespace EV
             float pad;
         };
 
+        // Matches cbuffer Constants in ocean_vertex.hlsl and ocean_pixel.hlsl.
+        struct alignas(16) CascadeConstants
+        {
+            float patchSizes[4];
+            uint32_t activeMask;
+            float gridResolution;
+            uint32_t pad[2];
+        };
+
         struct FFTTextures
         {
             std::shared_ptr<Texture> displacementTexture;
@@ -149,8 +175,8 @@ namespace EV
         std::shared_ptr<ShaderResourceView> m_defaultSRV;
         std::shared_ptr<ShaderResourceView> m_defaultCubeSRV;
 
-        // IBL textures
-        std::shared_ptr<ShaderResourceView> m_diffuseIBL;
+        // IBL
+        IrradianceSH m_irradiance;
         std::shared_ptr<ShaderResourceView> m_specularIBL;
         std::shared_ptr<ShaderResourceView> m_lutIBL;
 
@@ -166,6 +192,9 @@ namespace EV
 
         const UINT m_cascadeCount;
         std::vector<FFTTextures> m_textures;
-        std::vector<float> m_cascadeSizes;
+        CascadeConstants m_cascadeConstants = {};
+        // One pipeline per vertex shader permutation, m_pipelineStateObject is the one in use.
+        std::vector<std::shared_ptr<PipelineStateObject>> m_permutations;
+        std::vector<OceanQuadtreeNode> m_nodes;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ocean_spectrum.h"
+
+namespace EV
+{
+	struct OceanQuadtreeSettings
+	{
+		// Edge length of the finest nodes in metres.
+		float leafSize = 32.0f;
+		// Number of detail levels, the root is leafSize * 2^(lodCount - 1) wide.
+		uint32_t lodCount = 10;
+		// Quads along an edge of the shared patch mesh, a power of two.
+		uint32_t gridResolution = 16;
+		// Level i is drawn up to rangeFactor * leafSize * 2^i from the camera. Below
+		// ~4.1 a level can't finish morphing before its coarser neighbour starts and cracks appear.
+		float rangeFactor = 5.0f;
+		// Fraction of its range after which a level starts morphing into the next coarser one.
+		float morphStartRatio = 0.7f;
+		// A level samples a cascade while the cascade's patch spans at least this
+		// many samples, the larger of the vertex spacing and a pixel being one sample.
+		float minSamplesPerPatch = 2.0f;
+		// Fewest cascades a level samples, 2 to 4 (the ocean_vertex permutations).
+		uint32_t minCascades = 2;
+	};
+
+	// A selected node, the per instance data of ocean_vertex.hlsl (OceanNode).
+	struct OceanQuadtreeNode
+	{
+		float x, z;       // Corner with the smallest coordinates
+		float size;
+		float lod;        // 0 is the finest level
+		float morphStart; // Camera distance where the vertices start moving onto the grid of lod + 1
+		float morphEnd;   // and where they have arrived
+		float cascadeCount; // Cascades sampled, the first ones; selects the shader permutation
+		float fadeCascade;  // Cascades from this one on fade out with the morph, the next level doesn't sample them
+	};
+	static_assert(sizeof(OceanQuadtreeNode) == 32, "Must match OceanNode in ocean_vertex.hlsl");
+
+	// CDLOD selection for the ocean surface. A quadtree centred on the camera
+	// picks nodes of the level each distance needs; every node is drawn as an
+	// instance of the same gridResolution^2 patch. Within the outer part of
+	// its range a node moves its odd vertices onto the grid of the next level,
+	// so neighbours of different levels meet without cracks or T-junctions
+	// and levels change without popping.
+	//
+	// Far levels skip the cascades whose waves are too short for their vertex
+	// spacing or for the pixels they cover, see ClassifyCascades. A level fades
+	// the cascades the next level skips out along with the morph, so the
+	// displacement matches at the seams as well.
+	//
+	// Nodes are frustum culled with their bounds grown by the displacement
+	// bounds of the spectrum, so a crest can't pop in at the edge of the
+	// screen. The planes are tested four at a time with SSE, and the subtree
+	// of a node that lies completely inside the frustum isn't tested at all.
+	class OceanQuadtree
+	{
+	public:
+		explicit OceanQuadtree(const OceanQuadtreeSettings& settings = {});
+
+		void SetSettings(const OceanQuadtreeSettings& settings);
+		const OceanQuadtreeSettings& GetSettings() const { return m_settings; }
+
+		float GetRootSize() const;
+		float GetRange(uint32_t lod) const { return m_ranges[lod]; }
+
+		// Works out how many cascades every level samples. patchSizes are in
+		// decreasing order; focalLength is the height of the viewport in pixels
+		// over 2 tan(fov / 2), so a metre at distance d covers focalLength / d pixels.
+		void ClassifyCascades(const float* patchSizes, uint32_t cascadeCount, float focalLength);
+		uint32_t GetCascadeCount(uint32_t lod) const { return m_cascadeCounts[lod]; }
+
+		// How far the waves can move the surface, the sum over the cascades drawn.
+		void SetDisplacementBounds(const OceanDisplacementBounds& bounds) { m_displacementBounds = bounds; }
+		const OceanDisplacementBounds& GetDisplacementBounds() const { return m_displacementBounds; }
+
+		// Selects the nodes to draw around the camera. frustumPlanes holds six
+		// planes (a, b, c, d) with ax + by + cz + d >= 0 inside, nullptr disables culling.
+		void Select(const float cameraPosition[3], const float (*frustumPlanes)[4], std::vector<OceanQuadtreeNode>& outNodes) const;
+
+		// World position of grid vertex (gridX, gridZ) of a node after the morph, what the vertex shader computes.
+		void MorphVertex(const OceanQuadtreeNode& node, uint32_t gridX, uint32_t gridZ, const float cameraPosition[3],
+		                 float& outX, float& outZ, float& outMorph) const;
+
+		// Weight the vertex shader gives a cascade at the given morph.
+		static float CascadeWeight(const OceanQuadtreeNode& node, uint32_t cascade, float morph);
+
+	private:
+		struct Frustum;
+
+		bool SelectNode(float x, float z, uint32_t lod, const float cameraPosition[3], const Frustum& frustum,
+		                uint32_t activePlanes, std::vector<OceanQuadtreeNode>& outNodes) const;
+		OceanQuadtreeNode MakeNode(float x, float z, uint32_t lod) const;
+
+		OceanQuadtreeSettings m_settings;
+		OceanDisplacementBounds m_displacementBounds;
+		std::vector<float> m_ranges;
+		std::vector<uint32_t> m_cascadeCounts;
+	};
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <future>
 
 
@@ -6,14 +7,29 @@
 #include "core/camera.h"
 #include "core/game.h"
 #include "core/window.h"
+#include "DX12/command_list.h"
+#include "DX12/light.h"
 #include "DX12/render_target.h"
+#include "DX12/scene_visitor.h"
 #include <complex>
 
-#define OCEAN_SUBRES 512
-#define OCEAN_PLANE_SIZE 4096.0f
-#define OCEAN_DEPTH 20.0f
+#include "ocean_brdf_lut.h"
+#include "ocean_buoyancy.h"
+#include "ocean_cascade_planner.h"
+#include "ocean_clip.h"
+#include "ocean_cpu_simulator.h"
+#include "ocean_half.h"
+#include "ocean_h0_cache.h"
+#include "ocean_ibl_baker.h"
+#include "ocean_quadtree.h"
+#include "ocean_spectrum.h"
+#include "ocean_surface_query.h"
+
+#define OCEAN_SUBRES 512 // Default FFT resolution of a cascade
+#define OCEAN_MIN_SUBRES 64
+#define OCEAN_MAX_SUBRES 1024
+#define OCEAN_PATCH_RESOLUTION 16 // Quads along an edge of the patch every quadtree node draws
 
-class ConvolutionCompute;
 class OceanCompute;
 class UpdateEventArgs;
 class KeyEventArgs;
@@ -63,15 +79,13 @@ public:
 	void UnloadContent() override;
 
 	float InitPhillipsSpectrum(DirectX::XMFLOAT2 k, DirectX::XMFLOAT2 windDir, float windSpeed, float A = 0.05f);
-	float DirectionSpectrum(float theta, float omega);
-	float ShortWavesFade(float kLength);
-	void GenerateH0(std::shared_ptr<CommandList> commandList, UINT cascade);
-	float GaussianRandom();
-	float JONSWAP(float omega);
-
-	float JonswapAlpha(float fetch, float windSpeed);
-	float JonswapPeakFequency(float fetch, float windSpeed);
+	std::shared_ptr<OceanCompute> GetFFTPSO(uint32_t resolution) const;
+	// Opens a clip written by OceanClipBaker and creates its playback textures.
+	bool LoadClip(const std::filesystem::path& path);
+
 	void UpdateSpectrumParameters();
+	// Regenerates the spectrum with the current parameters in the background, see UpdateSpectrum.
+	void RequestSpectrum();
 
 protected:
 	void OnUpdate(UpdateEventArgs& e) override;
@@ -91,6 +105,37 @@ private:
 	static std::wstring GetModulePath();
 	bool LoadingProgress(float loadingProgress);
 	bool LoadScene(const std::wstring& sceneFile);
+	// Uploads the clip frame shown at time into the playback textures.
+	void UpdateClipPlayback(std::shared_ptr<CommandList> commandList, double time);
+
+	struct SpectrumBuild;
+	// Lays out the cascades for the spectrum and resolutions, see OceanCascadePlanner.
+	static OceanCascadePlan PlanCascades(const JonswapParameters& params, const std::vector<uint32_t>& resolutions,
+	                                     const OceanCascadePlannerSettings& settings, bool automatic);
+	// Builds the H0 of every cascade, runs on the spectrum worker.
+	std::unique_ptr<SpectrumBuild> BuildSpectrum(JonswapParameters params, uint32_t seed, std::vector<uint32_t> resolutions,
+	                                             OceanCascadePlannerSettings settings, bool automatic, bool halfPrecision);
+	// Copies a build into the back H0 texture of every cascade.
+	void UploadSpectrum(std::shared_ptr<CommandList> commandList, const SpectrumBuild& build);
+	// Makes the uploaded H0 textures current, along with the cascade layout of the build.
+	void SwapSpectrum(const SpectrumBuild& build);
+	// Moves the regeneration along one step per frame: picks up a finished
+	// build and uploads it, swaps it in once the copy is done, and starts the
+	// next build when edits came in since.
+	void UpdateSpectrum();
+	// Voxelizes the ship for the buoyancy solver, see OceanBuoyancy::VoxelizeHull.
+	void BuildBoatHull();
+	// Loads the baked image based lighting of the sky panorama, or bakes it on
+	// the CPU on a cache miss (see OceanIBLCache), and uploads the sky cubemap
+	// and the prefiltered specular. The SH irradiance is kept for the PSOs.
+	void LoadEnvironment(std::shared_ptr<CommandList> commandList, const std::filesystem::path& panoramaFile);
+	// Uploads the BRDF LUT the build stored next to the executable, or
+	// generates and stores it if the file is missing or invalid (see OceanBrdfLut).
+	void LoadBrdfLut(std::shared_ptr<CommandList> commandList);
+	// Replaces the floating bodies with m_boatCount ships on a grid around the origin.
+	void SpawnBoats();
+	// (Re)creates the slope, displacement and foam targets of a cascade.
+	void CreateCascadeOutputs(UINT cascade, uint32_t resolution, DXGI_FORMAT format);
 
 	std::shared_ptr<EV::Scene> m_cubeMesh;
 
@@ -99,7 +144,10 @@ private:
 	std::shared_ptr<EV::Scene> m_chessboard;
 	std::shared_ptr<EV::Scene> m_boat;
 
-	std::shared_ptr<EV::Scene> m_oceanPlane;
+	// Unit grid of OCEAN_PATCH_RESOLUTION^2 quads, instanced for every node the quadtree selects.
+	std::shared_ptr<EV::Scene> m_oceanPatch;
+	// Size and generation time of the patch mesh, for the GUI.
+	EV::CommandList::MeshStats m_oceanPatchStats;
 	std::shared_ptr<EV::Scene> m_skybox;
 
 	// ImGUI
@@ -195,46 +243,87 @@ private:
 	std::shared_ptr<SkyboxPSO> m_skyboxPSO;
 	std::shared_ptr<SDRPSO> m_sdrPSO;
 	std::shared_ptr<OceanCompute> m_oceanPSO;
-	std::shared_ptr<OceanCompute> m_fftPSO;
+	// One FFT permutation per resolution, indexed by log2(resolution / OCEAN_MIN_SUBRES).
+	static const UINT m_fftPermutationsNumber = 5;
+	std::shared_ptr<OceanCompute> m_fftPSOs[m_fftPermutationsNumber];
 	std::shared_ptr<OceanCompute> m_permutePSO;
-	std::shared_ptr<ConvolutionCompute> m_convolutionPSO;
-	std::shared_ptr<ConvolutionCompute> m_specularConvolutionPSO;
-	std::shared_ptr<ConvolutionCompute> m_brdfLutPSO;
 
 	std::future<bool> m_loadingTask;
 
 	// Ocean
-
-	// FFT and JONSWAP Implementation largely referenced from https://github.com/gasgiant/FFT-Ocean/
-	struct JonswapParameters
-	{
-		float scale = 0.0f; // Used to scale the Spectrum [1.0f, 5.0f] --> Value Range
-		float spreadBlend = 0.0f; // Used to blend between agitated water motion, and windDirection [0.0f, 1.0f]
-		float swell = 0.0f; // Influences wave choppines, the bigger the swell, the longer the wave length [0.0f, 1.0f]
-		float gamma = 0.0f; // Defines the Spectrum Peak [0.0f, 7.0f]
-		float shortWavesFade = 0.0f; // [0.0f, 1.0f]
-
-		float windDirection = 0.0f; // [0.0f, 360.0f]
-		float fetch = 0.0f; // Distance over which Wind impacts Wave Formation [0.0f, 10000.0f]
-		float windSpeed = 0.0f; // [0.0f, 100.0f]
-
-		float angle = 0.0f;
-		float alpha = 0.0f;
-		float peakOmega = 0.0f;
-	}m_jonswapParams;
+	JonswapParameters m_jonswapParams;
+	// Key of the counter based noise the wave phases are drawn from.
+	uint32_t m_noiseSeed = 0;
+	// Time spent building the H0 spectra of all cascades on the last regeneration.
+	double m_h0BuildTime = 0.0;
+	// SpectrumDirtyFlags of the work done by the last regeneration.
+	uint32_t m_h0RebuildFlags = SDF_None;
+	// Disk cache of the generated H0 spectra, skips the build for known parameter sets.
+	std::unique_ptr<OceanH0Cache> m_h0Cache;
+	// Runs the simulation on the CPU next to the compute passes, for validation and queries.
+	OceanCpuSimulator m_cpuSimulator;
+	bool m_cpuSimulation = false;
+	double m_cpuSimulationTime = 0.0;
+	float m_cameraWaterHeight = 0.0f;
+	// Copies of the ship floating on the CPU simulation, which runs while they
+	// do. The solver steps on a worker during the frame and is waited for at
+	// the start of the next one, before anything touches the simulator.
+	OceanBuoyancy m_buoyancy;
+	OceanBuoyancyHull m_boatHull;
+	std::vector<DirectX::XMMATRIX> m_boatTransforms;
+	bool m_floatBoats = false;
+	int m_boatCount = 16;
+	float m_boatScale = 4.0f;
+	// Mass of a ship as a fraction of the water its hull can displace.
+	float m_boatDensity = 0.3f;
+	// Cost of the last finished buoyancy update, the solver itself is busy while the GUI draws.
+	double m_buoyancyTime = 0.0;
+	uint32_t m_buoyancySteps = 0;
+	// Cascade layout. Automatic plans the patch sizes and skips cascades without
+	// energy, otherwise the fixed 500/250/17/5 m setup runs with every cascade.
+	// The plan is the one in use, OceanData::resolution holds the requested
+	// resolution until the next regeneration swaps it in.
+	OceanCascadePlan m_cascadePlan;
+	OceanCascadePlannerSettings m_plannerSettings;
+	bool m_autoCascades = true;
+	// Stores H0 and the slope and displacement targets in R16G16B16A16_FLOAT,
+	// half the memory and bandwidth of the 32 bit floats. The benchmark
+	// (RunHalfPrecision) measures the height error this adds.
+	bool m_halfPrecision = true;
+	// CDLOD surface. The nodes are selected from the camera every frame.
+	OceanQuadtree m_oceanQuadtree;
+	std::vector<OceanQuadtreeNode> m_oceanNodes;
+	// The nodes by the cascades they sample, [i] holds the ones drawn with m_oceanCascadesNumber - i.
+	std::vector<OceanQuadtreeNode> m_oceanNodeGroups[3];
+	double m_oceanSelectTime = 0.0;
+	// Displacement fetches of the last frame, and what sampling every cascade everywhere would take.
+	uint64_t m_oceanFetches = 0;
+	uint64_t m_oceanFullFetches = 0;
+	// Frustum culling of the scenes drawn last frame, and the state their draws set.
+	EV::SceneVisitor::CullingStats m_sceneCulling;
+	EV::CommandList::StateStats m_sceneStateStats;
+	EV::SceneVisitor::InstancingStats m_sceneInstancing;
+	bool m_sortDraws = true;
+	bool m_instanceDraws = true;
+	// Streams a baked clip into the playback textures instead of running the compute passes.
+	OceanClipReader m_clip;
+	bool m_clipPlayback = false;
+	char m_clipPath[260] = "ocean.clip";
+	uint32_t m_clipFrame = UINT32_MAX;
+	double m_clipUploadTime = 0.0;
+	std::vector<OceanClipFrame> m_clipFrames;
+	std::vector<uint16_t> m_clipTexels[3];
+	std::vector<float> m_clipPatchSizes;
 
 	
 	// skybox
 
-	std::shared_ptr<Texture> m_skyboxTexture; 
 	std::shared_ptr<Texture> m_skyboxCubemap; 
 	std::shared_ptr<Texture> m_HDRTexture; 
-	std::shared_ptr<Texture> m_diffuseIrradianceMap; 
 	std::shared_ptr<Texture> m_specularIrradianceMap; 
 	std::shared_ptr<Texture> m_brdfLUT; 
 
 	std::shared_ptr<EV::ShaderResourceView> m_skyboxCubemapSRV; 
-	std::shared_ptr<EV::ShaderResourceView> m_diffuseCubemapSRV; 
 	std::shared_ptr<EV::ShaderResourceView> m_specularCubemapSRV; 
 	std::shared_ptr<EV::ShaderResourceView> m_brdfLUTSRV;
 	std::shared_ptr<ShaderResourceView> m_skyboxTextureMip1; 
@@ -250,9 +339,15 @@ private:
 	// HDR -> SDR tone mapping PSO.
 	std::shared_ptr<PipelineStateObject> m_SDRPipelineState;
 
-	// IBL convolution
-	uint32_t m_convolutionPlaneSize = 32;
-	uint32_t m_convolutionSampleCount = 64;
+	// Image based lighting of the sky, baked once per panorama and settings.
+	OceanIBLBakeSettings m_iblSettings;
+	IrradianceSH m_irradiance = {};
+	bool m_iblCacheHit = false;
+	OceanIBLBakeTimes m_iblBakeTimes;
+	double m_iblLoadTime = 0.0;
+	OceanBrdfLutDesc m_brdfLutDesc;
+	bool m_brdfLutGenerated = false;
+	double m_brdfLutLoadTime = 0.0;
 
 	struct OceanH0Values
 	{
@@ -262,10 +357,29 @@ private:
 	};
 	struct OceanData
 	{
-		std::shared_ptr<Texture> H0Texture;
+		// Double buffered: the simulation reads H0Textures[front] while a
+		// regenerated spectrum is uploaded into the other one.
+		std::shared_ptr<Texture> H0Textures[2];
+		uint32_t H0Resolutions[2] = {};
+		DXGI_FORMAT H0Formats[2] = {};
+		// What the H0 in the texture was multiplied with, animate_waves.hlsl divides it out again.
+		float H0Scales[2] = { 1.0f, 1.0f };
+		uint32_t front = 0;
+		uint32_t outputResolution = 0;
+		DXGI_FORMAT outputFormat = DXGI_FORMAT_UNKNOWN;
 		std::shared_ptr<Texture> slopeTexture;
 		std::shared_ptr<Texture> displacementTexture;
 		std::shared_ptr<Texture> foamTexture;
+		// Half float copies of the three outputs, filled from the clip during playback.
+		std::shared_ptr<Texture> clipDisplacementTexture;
+		std::shared_ptr<Texture> clipSlopeTexture;
+		std::shared_ptr<Texture> clipFoamTexture;
+		OceanCascadeSpectrum spectrum;
+		// How far the current H0 (or during playback the current clip frame) can displace the surface.
+		OceanDisplacementBounds displacementBounds;
+		OceanDisplacementBounds clipDisplacementBounds;
+		// FFT resolution, a power of two in [OCEAN_MIN_SUBRES, OCEAN_MAX_SUBRES].
+		uint32_t resolution = OCEAN_SUBRES;
 		// OceanH0Values data;
 	};
 
@@ -274,6 +388,31 @@ private:
 	std::vector<float> m_oceanPatchSizes;
 	std::vector<float> m_foamParameters;
 
+	struct SpectrumBuild
+	{
+		OceanCascadePlan plan;
+		// Points into the OceanCascadeSpectrum of the cascade or into a mapped cache entry.
+		const float* packedH0[m_oceanCascadesNumber] = {};
+		OceanCachedH0 cachedH0[m_oceanCascadesNumber];
+		// In half precision packedH0 times H0Scales is uploaded from halfH0.
+		bool halfPrecision = false;
+		std::vector<uint16_t> halfH0[m_oceanCascadesNumber];
+		float H0Scales[m_oceanCascadesNumber] = {};
+		OceanDisplacementBounds displacementBounds[m_oceanCascadesNumber];
+		uint32_t rebuildFlags = SDF_None;
+		double buildTime = 0.0;
+	};
+
+	// Spectrum regeneration. Edits only mark the spectrum dirty. A worker builds
+	// the H0 of every cascade, the result is uploaded on the compute queue into the
+	// back H0 textures and swapped in on the frame the copy finished. The
+	// simulation targets are kept, so the foam survives. Edits made while a
+	// build is in flight are coalesced into one follow up build.
+	std::future<std::unique_ptr<SpectrumBuild>> m_spectrumTask;
+	std::unique_ptr<SpectrumBuild> m_spectrumUpload;
+	uint64_t m_spectrumUploadFence = 0;
+	std::atomic_bool m_spectrumDirty{ false };
+
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#pragma once
+
+/**
+ *  @file ocean_simd.h
+ *
+ *  @brief 4-wide SSE2 helpers used by the CPU side of the ocean (spectrum
+ *  generation, CPU FFT, surface queries).
+ *
+ *  The transcendental approximations follow the Cephes single precision
+ *  polynomials (the same ones used by sse_mathfun), which are accurate to a
+ *  couple of ULP over the ranges the spectrum uses. SSE2 is the x64 baseline
+ *  (and what DirectXMath builds on), so no runtime dispatch is needed.
+ */
+
+#include <emmintrin.h>
+#include <cstdint>
+
+namespace EV
+{
+namespace simd
+{
+    using Vec4 = __m128;
+
+    inline Vec4 Set(float v) { return _mm_set1_ps(v); }
+    inline Vec4 Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+
+    inline Vec4 Abs(Vec4 v) { return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+    inline Vec4 Min(Vec4 a, Vec4 b) { return _mm_min_ps(a, b); }
+    inline Vec4 Max(Vec4 a, Vec4 b) { return _mm_max_ps(a, b); }
+    inline Vec4 Sqrt(Vec4 v) { return _mm_sqrt_ps(v); }
+
+    // mask ? a : b
+    inline Vec4 Select(Vec4 mask, Vec4 a, Vec4 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // Exact at t = 0 and t = 1 (like std::lerp), a + (b - a) * t is not.
+    inline Vec4 Lerp(Vec4 a, Vec4 b, Vec4 t)
+    {
+        return _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(Set(1.0f), t)), _mm_mul_ps(b, t));
+    }
+
+    // Rounds to the nearest half float (ties to even), what storing to a 16
+    // bit float target does. Adding 2^(e + 13) to |v| in [2^e, 2^(e + 1))
+    // drops all but 10 bits of mantissa, below 2^-14 the step stays at the
+    // 2^-24 of the subnormal halves. Values rounding past 65504 become infinity.
+    inline Vec4 RoundToHalf(Vec4 v)
+    {
+        Vec4 sign = _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000))));
+        Vec4 magnitude = Abs(v);
+
+        Vec4 exponent = _mm_and_ps(magnitude, _mm_castsi128_ps(_mm_set1_epi32(0x7f800000)));
+        exponent = Min(Max(exponent, Set(6.103515625e-5f)), Set(65536.0f)); // [2^-14, 2^16]
+        Vec4 bias = _mm_mul_ps(exponent, Set(8192.0f));
+        Vec4 rounded = _mm_sub_ps(_mm_add_ps(magnitude, bias), bias);
+
+        Vec4 overflow = _mm_cmpgt_ps(rounded, Set(65504.0f));
+        rounded = Select(overflow, _mm_castsi128_ps(_mm_set1_epi32(0x7f800000)), rounded);
+        return _mm_or_ps(rounded, sign);
+    }
+
+    // Floor for |v| < 2^31.
+    inline Vec4 Floor(Vec4 v)
+    {
+        Vec4 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        Vec4 correction = _mm_and_ps(_mm_cmpgt_ps(truncated, v), Set(1.0f));
+        return _mm_sub_ps(truncated, correction);
+    }
+
+    inline Vec4 Exp(Vec4 x)
+    {
+        x = _mm_min_ps(x, Set(88.3762626647949f));
+        x = _mm_max_ps(x, Set(-88.3762626647949f));
+
+        // exp(x) = 2^n * exp(g), n = round(x / ln2)
+        Vec4 fx = Floor(_mm_add_ps(_mm_mul_ps(x, Set(1.44269504088896341f)), Set(0.5f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(fx, Set(0.693359375f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(fx, Set(-2.12194440e-4f)));
+
+        Vec4 z = _mm_mul_ps(x, x);
+        Vec4 y = Set(1.9875691500E-4f);
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(1.3981999507E-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(8.3334519073E-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(4.1665795894E-2f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(1.6666665459E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(5.0000001201E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, z), x);
+        y = _mm_add_ps(y, Set(1.0f));
+
+        __m128i n = _mm_cvttps_epi32(fx);
+        n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(0x7f)), 23);
+        return _mm_mul_ps(y, _mm_castsi128_ps(n));
+    }
+
+    // Natural logarithm. Returns a large negative number for x <= 0 which,
+    // fed into Exp, underflows to 0 (what pow(0, s) with s > 0 expects).
+    inline Vec4 Log(Vec4 x)
+    {
+        Vec4 invalid = _mm_cmple_ps(x, _mm_setzero_ps());
+        x = _mm_max_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x00800000))); // smallest normal
+
+        __m128i exponent = _mm_srli_epi32(_mm_castps_si128(x), 23);
+        x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+        x = _mm_or_ps(x, Set(0.5f));
+
+        exponent = _mm_sub_epi32(exponent, _mm_set1_epi32(0x7f));
+        Vec4 e = _mm_add_ps(_mm_cvtepi32_ps(exponent), Set(1.0f));
+
+        // Keep the mantissa in [sqrt(1/2), sqrt(2)).
+        Vec4 mask = _mm_cmplt_ps(x, Set(0.707106781186547524f));
+        Vec4 tmp = _mm_and_ps(x, mask);
+        x = _mm_sub_ps(x, Set(1.0f));
+        e = _mm_sub_ps(e, _mm_and_ps(Set(1.0f), mask));
+        x = _mm_add_ps(x, tmp);
+
+        Vec4 z = _mm_mul_ps(x, x);
+        Vec4 y = Set(7.0376836292E-2f);
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(-1.1514610310E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(1.1676998740E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(-1.2420140846E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(1.4249322787E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(-1.6668057665E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(2.0000714765E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(-2.4999993993E-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), Set(3.3333331174E-1f));
+        y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+        y = _mm_add_ps(y, _mm_mul_ps(e, Set(-2.12194440e-4f)));
+        y = _mm_sub_ps(y, _mm_mul_ps(z, Set(0.5f)));
+        x = _mm_add_ps(x, y);
+        x = _mm_add_ps(x, _mm_mul_ps(e, Set(0.693359375f)));
+
+        return Select(invalid, Set(-1.0e30f), x);
+    }
+
+    // pow(|base|, exponent), 0^e = 0 for e > 0.
+    inline Vec4 Pow(Vec4 base, Vec4 exponent)
+    {
+        return Exp(_mm_mul_ps(Log(Abs(base)), exponent));
+    }
+
+    // Sine and cosine of x in one go, accurate for |x| < 8192.
+    inline void SinCos(Vec4 x, Vec4* outSin, Vec4* outCos)
+    {
+        const Vec4 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+        Vec4 signSin = _mm_and_ps(x, signMask);
+        x = Abs(x);
+
+        // Octant of x, rounded up to an even value.
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, Set(1.27323954473516f))); // 4 / pi
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        Vec4 y = _mm_cvtepi32_ps(octant);
+
+        Vec4 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+        Vec4 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+        Vec4 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+        signSin = _mm_xor_ps(signSin, swapSignSin);
+
+        // Extended precision modular arithmetic, x - y * pi / 4.
+        x = _mm_add_ps(x, _mm_mul_ps(y, Set(-0.78515625f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, Set(-2.4187564849853515625e-4f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, Set(-3.77489497744594108e-8f)));
+
+        Vec4 z = _mm_mul_ps(x, x);
+
+        Vec4 cosPoly = Set(2.443315711809948E-005f);
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), Set(-1.388731625493765E-003f));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), Set(4.166664568298827E-002f));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+        cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, Set(0.5f)));
+        cosPoly = _mm_add_ps(cosPoly, Set(1.0f));
+
+        Vec4 sinPoly = Set(-1.9515295891E-4f);
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), Set(8.3321608736E-3f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), Set(-1.6666654611E-1f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+        *outSin = _mm_xor_ps(Select(polyMask, sinPoly, cosPoly), signSin);
+        *outCos = _mm_xor_ps(Select(polyMask, cosPoly, sinPoly), signCos);
+    }
+
+    // tanh for x >= 0 (all callers pass magnitudes).
+    inline Vec4 TanhPositive(Vec4 x)
+    {
+        Vec4 e = Exp(_mm_mul_ps(x, Set(-2.0f)));
+        return _mm_div_ps(_mm_sub_ps(Set(1.0f), e), _mm_add_ps(Set(1.0f), e));
+    }
+
+    // 1 / cosh(x)^2 for x >= 0, computed without overflowing cosh.
+    inline Vec4 SechSquaredPositive(Vec4 x)
+    {
+        Vec4 e = Exp(_mm_mul_ps(x, Set(-2.0f)));
+        Vec4 d = _mm_add_ps(Set(1.0f), e);
+        return _mm_div_ps(_mm_mul_ps(Set(4.0f), e), _mm_mul_ps(d, d));
+    }
+}
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#define OCEAN_DEPTH 20.0f
+
+namespace EV
+{
+	// FFT and JONSWAP Implementation largely referenced from https://github.com/gasgiant/FFT-Ocean/
+	struct JonswapParameters
+	{
+		float scale = 0.0f; // Used to scale the Spectrum [1.0f, 5.0f] --> Value Range
+		float spreadBlend = 0.0f; // Used to blend between agitated water motion, and windDirection [0.0f, 1.0f]
+		float swell = 0.0f; // Influences wave choppines, the bigger the swell, the longer the wave length [0.0f, 1.0f]
+		float gamma = 0.0f; // Defines the Spectrum Peak [0.0f, 7.0f]
+		float shortWavesFade = 0.0f; // [0.0f, 1.0f]
+
+		float windDirection = 0.0f; // [0.0f, 360.0f]
+		float fetch = 0.0f; // Distance over which Wind impacts Wave Formation [0.0f, 10000.0f]
+		float windSpeed = 0.0f; // [0.0f, 100.0f]
+
+		float angle = 0.0f;
+		float alpha = 0.0f;
+		float peakOmega = 0.0f;
+	};
+
+	// Describes the k-space window one cascade covers.
+	struct OceanCascadeDesc
+	{
+		float patchSize = 0.0f;
+		float lowCutoff = 0.0f;
+		float highCutoff = 0.0f;
+		float depth = OCEAN_DEPTH;
+		uint32_t resolution = 0;
+
+		bool operator==(const OceanCascadeDesc& other) const = default;
+	};
+
+	// Largest displacement a cascade can produce anywhere at any time, in metres.
+	struct OceanDisplacementBounds
+	{
+		float horizontal = 0.0f; // Along x and along z
+		float vertical = 0.0f;
+	};
+
+	// Per texel terms of a cascade that only depend on its geometry (patch size,
+	// cutoffs, depth), stored as structure of arrays.
+	struct OceanKTable
+	{
+		OceanCascadeDesc desc;
+		std::vector<float> k;         // |k|
+		std::vector<float> dirX;      // k / |k|
+		std::vector<float> dirY;
+		std::vector<float> omega;     // Dispersion relation
+		std::vector<float> tma;       // TMA depth correction of the JONSWAP spectrum
+		std::vector<float> factor;    // sqrt(2 dk^2 |domega/dk| / k), 0 outside of the cutoffs
+	};
+
+	// Which parts of a cascade spectrum have to be recomputed.
+	enum SpectrumDirtyFlags
+	{
+		SDF_None = 0,
+		SDF_Scale = (1 << 0),       // Only the final multiply with sqrt(scale)
+		SDF_Directional = (1 << 1), // Wind direction, spread blend, swell
+		SDF_Radial = (1 << 2),      // JONSWAP shape and short wave fade
+		SDF_Noise = (1 << 3),       // Seed or resolution
+		SDF_KTable = (1 << 4),      // Patch size, cutoffs or depth
+		SDF_All = SDF_Scale | SDF_Directional | SDF_Radial | SDF_Noise | SDF_KTable
+	};
+
+	// Builds the initial H0 spectrum of a cascade.
+	// BuildH0 splits the rows over the thread pool and evaluates 4 texels at a
+	// time with SSE; BuildH0Reference is the original scalar implementation,
+	// kept to validate and benchmark the vectorized path against.
+	class OceanSpectrum
+	{
+	public:
+		// Output is packed as RGBA32F per texel: (H0.re, H0.im, conj(H0(-k)).re, conj(H0(-k)).im).
+		// noise holds one pair of independent standard normal numbers per texel.
+		static void BuildH0(const JonswapParameters& params, const OceanCascadeDesc& cascade,
+		                    const std::complex<float>* noise, float* outRGBA);
+		static void BuildH0Reference(const JonswapParameters& params, const OceanCascadeDesc& cascade,
+		                             const std::complex<float>* noise, float* outRGBA);
+
+		static float JonswapAlpha(float fetch, float windSpeed);
+		static float JonswapPeakFequency(float fetch, float windSpeed);
+
+		// Scalar spectrum terms.
+		static float DispersionRelation(float kMag, float depth = OCEAN_DEPTH);
+		static float DispersionDerivative(float kMag, float depth = OCEAN_DEPTH);
+		static float JONSWAP(const JonswapParameters& params, float omega, float depth = OCEAN_DEPTH);
+		static float DirectionSpectrum(const JonswapParameters& params, float theta, float omega);
+		static float ShortWavesFade(const JonswapParameters& params, float kLength);
+
+		// Bounds the displacement the FFT of a packed H0 can produce. A texel adds
+		// |h(k, t)| <= |H0(k)| + |conj(H0(-k))| to the height and choppiness * |k.x| / |k|
+		// (or |k.y| / |k|) times that to the horizontal displacement; the sum
+		// over all texels is reached when every phase lines up.
+		static OceanDisplacementBounds DisplacementBounds(const OceanCascadeDesc& cascade, const float* packedH0, float choppiness);
+		// Sum of the bounds of the cascades in mask, how far the drawn surface can move.
+		static OceanDisplacementBounds SumDisplacementBounds(const OceanDisplacementBounds* bounds, uint32_t count, uint32_t mask);
+
+		// Works out the SpectrumDirtyFlags between two parameter sets.
+		static uint32_t PlanRebuild(const JonswapParameters& previous, const JonswapParameters& next);
+
+	private:
+		friend class OceanCascadeSpectrum;
+
+		// The stages of BuildH0, each one works on the texels [begin, end).
+		static void BuildKTable(OceanKTable& table, uint32_t begin, uint32_t end);
+		static void BuildRadial(const JonswapParameters& params, const OceanKTable& table, float* outRadial, uint32_t begin, uint32_t end);
+		static void BuildDirectional(const JonswapParameters& params, const OceanKTable& table, float* outDirectional, uint32_t begin, uint32_t end);
+		static void BuildAmplitude(const OceanKTable& table, const float* radial, const float* directional, float* outAmplitude, uint32_t begin, uint32_t end);
+		static void ApplyNoise(float scale, const float* amplitude, const std::complex<float>* noise, std::complex<float>* outH0, uint32_t begin, uint32_t end);
+
+		// Writes the packed RGBA output from the complex H0 field.
+		static void PackH0(const std::vector<std::complex<float>>& H0, uint32_t resolution, float* outRGBA, bool parallel);
+	};
+
+	// Cached spectrum of one cascade. Keeps the k-space table and every
+	// intermediate term, and on Update only recomputes what the changed
+	// parameters actually touch:
+	// - scale only multiplies the cached amplitudes,
+	// - wind direction, spread blend and swell only redo the directional term,
+	// - gamma and short wave fade only redo the JONSWAP (radial) term,
+	// - fetch and wind speed move the JONSWAP peak and redo both,
+	// - patch size, cutoffs and depth rebuild the k-space table and everything after it.
+	class OceanCascadeSpectrum
+	{
+	public:
+		// Brings the spectrum up to date and returns the SpectrumDirtyFlags of the work that was done.
+		uint32_t Update(const JonswapParameters& params, const OceanCascadeDesc& cascade, uint64_t seed, uint32_t cascadeIndex);
+
+		// Forces a full rebuild on the next Update.
+		void Invalidate() { m_valid = false; }
+		bool IsValid() const { return m_valid; }
+
+		// Packed RGBA32F H0, see OceanSpectrum::BuildH0.
+		const std::vector<float>& GetPackedH0() const { return m_packedH0; }
+
+	private:
+		bool m_valid = false;
+		JonswapParameters m_params;
+		uint64_t m_seed = 0;
+		uint32_t m_cascadeIndex = 0;
+
+		OceanKTable m_table;
+		std::vector<float> m_radial;
+		std::vector<float> m_directional;
+		std::vector<float> m_amplitude;
+		std::vector<std::complex<float>> m_noise;
+		std::vector<std::complex<float>> m_H0;
+		std::vector<float> m_packedH0;
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+#include "ocean_cpu_simulator.h"
+
+// Fixed-point iterations used to find the undisplaced point under a query.
+#define OCEAN_QUERY_ITERATIONS 4
+
+namespace EV
+{
+	// One batch of surface queries, structure of arrays. The positions are
+	// world space XZ (the ocean plane has an identity transform). Outputs that
+	// are nullptr are skipped, the others need room for count floats.
+	struct OceanSurfaceQuery
+	{
+		const float* x = nullptr;
+		const float* z = nullptr;
+		uint32_t count = 0;
+
+		float* height = nullptr;
+		float* normalX = nullptr;
+		float* normalY = nullptr;
+		float* normalZ = nullptr;
+		float* foam = nullptr;
+
+		uint32_t iterations = OCEAN_QUERY_ITERATIONS;
+	};
+
+	// Samples the fields of an OceanCpuSimulator the same way the ocean shaders
+	// do: every cascade is sampled bilinearly with wrapping at xz / patchSize and
+	// the cascades are summed.
+	//
+	// The vertex shader moves every grid point horizontally, so the surface above
+	// (x, z) comes from a different grid point p with p + D(p) = (x, z). Query
+	// finds p with a few fixed-point iterations p = (x, z) - D(p), which converge
+	// quickly as long as the waves don't fold over, and then returns the height,
+	// normal (from the slopes, as in ocean_pixel.hlsl) and saturated foam at p.
+	class OceanSurface
+	{
+	public:
+		// SSE, 4 points at a time. Large batches are split over the thread pool.
+		static void Query(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query);
+		// Scalar version of Query, kept to validate the vectorized path against.
+		static void QueryReference(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query);
+
+	private:
+		static void QueryRange(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query, uint32_t begin, uint32_t end);
+	};
+}
@@ -1,5 +1,3 @@
-#define OCEAN_RESOLUTION 512
-
 #define PI 3.14159265359f
 #define GRAVITY 9.81f
 #define REPEAT_TIME 500.0f
@@ -20,6 +18,8 @@ cbuffer Constants : register(b0)
 {
     float time;
     float patchSize;
+    uint resolution;
+    float inverseH0Scale; // H0 is stored scaled by a power of two in half precision, see OceanHalf::RangeScale
 }
 
 Texture2D<float4> H0Texture : register(t0);
@@ -29,12 +29,12 @@ RWTexture2D<float4> displacementTexture : register(u1);
 [numthreads(16, 16, 1)]
 void main( uint3 dispatchThreadID : SV_DispatchThreadID )
 {
-    float4 H0Data = H0Texture.Load(int3(dispatchThreadID.xy, 0));
+    float4 H0Data = H0Texture.Load(int3(dispatchThreadID.xy, 0)) * inverseH0Scale;
     float2 h0 = H0Data.rg;
     float2 h0conj = H0Data.ba;
 
-    float kx = 2.0f * PI * (dispatchThreadID.x - OCEAN_RESOLUTION / 2.0f) / patchSize;
-    float ky = 2.0f * PI * (dispatchThreadID.y - OCEAN_RESOLUTION / 2.0f) / patchSize;
+    float kx = 2.0f * PI * (dispatchThreadID.x - resolution / 2.0f) / patchSize;
+    float ky = 2.0f * PI * (dispatchThreadID.y - resolution / 2.0f) / patchSize;
     float k = length(float2(kx,ky));
     float kRcp = rcp(k);
 
@@ -1,113 +0,0 @@
-#define BLOCK_SIZE 16
-#define PI 3.14159265358979323846f
-
-
-float PBRCalculateGeometryGGX(float NdotV, float roughness)
-{
-    // Roughness here is dependent on IBL or Direct lighting.
-    // This implementation will only take into account Direct Lighting.
-    // float kDirect = ((roughness + 1.0f) * (roughness + 1.0f)) / 8.0f;
-    float kIBL = (roughness * roughness) * 0.5f;
-    float nom = NdotV;
-    float denom = NdotV * (1.0f - kIBL) + kIBL;
-    denom = max(denom, 0.000001f); // prevent / 0
-    return nom / denom;
-}
-
-float PBRCalculateGeometry(const float3 normal, const float3 viewDir, const float3 lightDir, float roughness)
-{
-
-    float NdotV = max(dot(normal, viewDir), 0.0f);
-    float NdotL = max(dot(normal, lightDir), 0.0f);
-
-    float ggx1 = PBRCalculateGeometryGGX(NdotV, roughness);
-    float ggx2 = PBRCalculateGeometryGGX(NdotL, roughness);
-    return ggx1 * ggx2;
-}
-
-
-float RadicalInverse_VdC(uint bits)
-{
-    bits = (bits << 16u) | (bits >> 16u);
-    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-    return float(bits) * 2.3283064365386963e-10;
-}
-
-float2 Hammersley(uint i, uint N)
-{
-    return float2(float(i) / float(N), RadicalInverse_VdC(i));
-}
-
-float3 ImportanceSampleGGX(float2 Xi, float3 N, float roughness)
-{
-    float a = roughness * roughness;
-    float phi = 2.0 * PI * Xi.x;
-    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
-    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
-
-    float3 H;
-    H.x = cos(phi) * sinTheta;
-    H.y = sin(phi) * sinTheta;
-    H.z = cosTheta;
-
-    float3 up = abs(N.z) < 0.999 ? float3(0, 0, 1) : float3(1, 0, 0);
-    float3 tangent = normalize(cross(up, N));
-    float3 bitangent = cross(N, tangent);
-
-    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
-}
-
-
-float2 IntegrateBRDF(float NdotV, float roughness)
-{
-    float3 V;
-    V.x = sqrt(1.0 - NdotV * NdotV);
-    V.y = 0.0;
-    V.z = NdotV;
-
-    float A = 0.0;
-    float B = 0.0;
-
-    float3 N = float3(0.0, 0.0, 1.0);
-
-    const uint SAMPLE_COUNT = 4096u;
-    for (uint i = 0u; i < SAMPLE_COUNT; ++i)
-    {
-        float2 Xi = Hammersley(i, SAMPLE_COUNT);
-        float3 H = ImportanceSampleGGX(Xi, N, roughness);
-        float3 L = normalize(2.0 * dot(V, H) * H - V);
-
-        float NdotL = max(L.z, 0.0);
-        float NdotH = max(H.z, 0.0);
-        float VdotH = max(dot(V, H), 0.0);
-
-        if (NdotL > 0.0)
-        {
-            float G = PBRCalculateGeometry(N, V, L, roughness);
-            float G_Vis = (G * VdotH) / (NdotH * NdotV);
-            float Fc = pow(1.0 - VdotH, 5.0);
-
-            A += (1.0 - Fc) * G_Vis;
-            B += Fc * G_Vis;
-        }
-    }
-    A /= float(SAMPLE_COUNT);
-    B /= float(SAMPLE_COUNT);
-    return float2(A, B);
-}
-
-RWTexture2D<float2> brdfLUT : register(u0); 
-
-[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
-void main(uint3 DTid : SV_DispatchThreadID)
-{
-    uint lutSize = 512;
-    float NdotV = (DTid.x + 0.5f) / float(lutSize);
-    float roughness = (DTid.y + 0.5f) / float(lutSize);
-
-    float2 integratedBRDF = IntegrateBRDF(NdotV, roughness);
-	brdfLUT[DTid.xy] = integratedBRDF;
-}
\ No newline at end of file
@@ -1,4 +1,9 @@
-#define TOTALPOINTS 512
+// Compiled once per cascade resolution, the fft_<N>.hlsl permutations define
+// TOTALPOINTS and include this file (thread group and shared memory size have
+// to be known at compile time). 1024 uses the full 32KB of group shared memory.
+#ifndef TOTALPOINTS
+#error "Compile one of the fft_<N>.hlsl permutations"
+#endif
 #define PI 3.14159265359f
 
 cbuffer Constants : register(b0)
@@ -0,0 +1,2 @@
+#define TOTALPOINTS 1024
+#include "fft.hlsl"
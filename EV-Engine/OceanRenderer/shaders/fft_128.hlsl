@@ -0,0 +1,2 @@
+#define TOTALPOINTS 128
+#include "fft.hlsl"
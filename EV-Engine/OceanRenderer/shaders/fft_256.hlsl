@@ -0,0 +1,2 @@
+#define TOTALPOINTS 256
+#include "fft.hlsl"
@@ -0,0 +1,2 @@
+#define TOTALPOINTS 512
+#include "fft.hlsl"
@@ -0,0 +1,2 @@
+#define TOTALPOINTS 64
+#include "fft.hlsl"
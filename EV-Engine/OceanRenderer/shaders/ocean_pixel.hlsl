@@ -19,7 +19,6 @@ struct DirectionalLight
 
 StructuredBuffer<DirectionalLight> DirectionalLights : register(t2);
 
-TextureCube<float4> diffuseMap : register(t3);
 TextureCube<float4> specularMap : register(t4);
 Texture2D<float2> brdfLUT : register(t5);
 
@@ -64,6 +63,28 @@ cbuffer Constants : register(b3)
     float patchSize1;
     float patchSize2;
     float patchSize3;
+    uint activeCascades; // Bit i is set when cascade i is simulated, see OceanCascadePlanner
+}
+
+// Diffuse irradiance of the environment as L2 spherical harmonics, see OceanIrradiance.
+cbuffer IrradianceCB : register(b4)
+{
+    float4 irradianceSH[9];
+}
+
+// Irradiance / pi around the unit normal n, like the convolved cubemap held.
+float3 EvaluateIrradiance(float3 n)
+{
+    float3 irradiance = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y
+        + irradianceSH[2].rgb * n.z
+        + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y)
+        + irradianceSH[5].rgb * (n.y * n.z)
+        + irradianceSH[6].rgb * (3.0f * n.z * n.z - 1.0f)
+        + irradianceSH[7].rgb * (n.x * n.z)
+        + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, 0.0f);
 }
 
 float PBRCalculateNormalDistribution(float roughness, const float3 normal, const float3 halfvec)
@@ -150,17 +171,24 @@ float4 main(PixelShaderInput IN) : SV_Target
     float2 uv2 = IN.PositionWS.xz / patchSize2;
     float2 uv3 = IN.PositionWS.xz / patchSize3;
 
-    float4 slope0 = SlopeTexture0.Sample(anisotropicSampler, uv0);
-    float4 slope1 = SlopeTexture1.Sample(anisotropicSampler, uv1);
-    float4 slope2 = SlopeTexture2.Sample(anisotropicSampler, uv2);
-    float4 slope3 = SlopeTexture3.Sample(anisotropicSampler, uv3);
-    float4 slope = slope0 + slope1 + slope2 + slope3;
-
-    float foam0 = FoamTexture0.Sample(anisotropicSampler, uv0).r;
-    float foam1 = FoamTexture1.Sample(anisotropicSampler, uv1).r;
-    float foam2 = FoamTexture2.Sample(anisotropicSampler, uv2).r;
-    float foam3 = FoamTexture3.Sample(anisotropicSampler, uv3).r;
-    float foam = saturate(foam0 + foam1 + foam2 + foam3);
+    float4 slope = SlopeTexture0.Sample(anisotropicSampler, uv0);
+    float foam = FoamTexture0.Sample(anisotropicSampler, uv0).r;
+    [branch] if (activeCascades & 2)
+    {
+        slope += SlopeTexture1.Sample(anisotropicSampler, uv1);
+        foam += FoamTexture1.Sample(anisotropicSampler, uv1).r;
+    }
+    [branch] if (activeCascades & 4)
+    {
+        slope += SlopeTexture2.Sample(anisotropicSampler, uv2);
+        foam += FoamTexture2.Sample(anisotropicSampler, uv2).r;
+    }
+    [branch] if (activeCascades & 8)
+    {
+        slope += SlopeTexture3.Sample(anisotropicSampler, uv3);
+        foam += FoamTexture3.Sample(anisotropicSampler, uv3).r;
+    }
+    foam = saturate(foam);
 
     // Reconstruct normal from slopes (object space, Y-up)
     float3 normal = normalize(float3(-slope.x, 1.0f, -slope.y));
@@ -238,7 +266,7 @@ float4 main(PixelShaderInput IN) : SV_Target
     float2 lutUV = float2(NdotV, roughness);
     float2 envBRDF = brdfLUT.Sample(linearClampSampler, lutUV).rg;
 
-    float3 irradiance = diffuseMap.Sample(linearClampSampler, normal).rgb;
+    float3 irradiance = EvaluateIrradiance(normal);
     float3 diffuse = irradiance * oceanColor;
     float3 fresnelIBL = PBRCalculateFresnelIBL(NdotV, F0, roughness);
     float3 kd_ibl = (float3(1.0f, 1.0f, 1.0f) - fresnelIBL) * (1.0f - metallic);
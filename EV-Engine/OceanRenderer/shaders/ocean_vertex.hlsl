@@ -1,3 +1,9 @@
+// Cascades sampled, ocean_vertex_3.hlsl and ocean_vertex_2.hlsl build the
+// permutations far nodes are drawn with, see OceanQuadtree::ClassifyCascades.
+#ifndef CASCADE_COUNT
+#define CASCADE_COUNT 4
+#endif
+
 struct Matrices
 {
     matrix modelMatrix;
@@ -17,8 +23,30 @@ cbuffer Constants : register(b3)
     float patchSize1;
     float patchSize2;
     float patchSize3;
+    uint activeCascades; // Bit i is set when cascade i is simulated, see OceanCascadePlanner
+    float gridResolution; // Quads along an edge of the patch mesh
+}
+
+cbuffer CameraCB : register(b1, space0)
+{
+    float3 cameraPosition;
+    float camPad;
 }
 
+// A quadtree node the patch is drawn for, see OceanQuadtreeNode.
+struct OceanNode
+{
+    float2 position; // Corner with the smallest coordinates
+    float size;
+    float lod;
+    float morphStart;
+    float morphEnd;
+    float cascadeCount;
+    float fadeCascade; // Cascades from this one on fade out with the morph
+};
+
+StructuredBuffer<OceanNode> Nodes : register(t1);
+
 struct VertexPositionNormalTexture
 {
     float3 Position : POSITION;
@@ -44,20 +72,43 @@ Texture2D DisplacementTexture3 : register(t15);
 SamplerState linearWrapSampler : register(s2);
 static const float HEIGHT_SCALE = 1.0f;
 
-VertexShaderOutput main(VertexPositionNormalTexture data)
+VertexShaderOutput main(VertexPositionNormalTexture data, uint instanceID : SV_InstanceID)
 {
-    float2 uv0 = data.Position.xz / patchSize0;
-    float2 uv1 = data.Position.xz / patchSize1;
-    float2 uv2 = data.Position.xz / patchSize2;
-    float2 uv3 = data.Position.xz / patchSize3;
-
-    float3 displacement0 = DisplacementTexture0.SampleLevel(linearWrapSampler, uv0, 0).rgb;
-    float3 displacement1 = DisplacementTexture1.SampleLevel(linearWrapSampler, uv1, 0).rgb;
-    float3 displacement2 = DisplacementTexture2.SampleLevel(linearWrapSampler, uv2, 0).rgb;
-    float3 displacement3 = DisplacementTexture3.SampleLevel(linearWrapSampler, uv3, 0).rgb;
-    float3 displacement = displacement0 + displacement1 + displacement2 + displacement3;
-
-    float3 displacedPosition = data.Position;
+    OceanNode node = Nodes[instanceID];
+
+    // The patch is a unit plane around the origin. Odd vertices slide onto
+    // their even neighbour towards the end of the node's range, so at its
+    // edge the node matches the grid of the next coarser level.
+    float2 gridIndex = round((data.Position.xz + 0.5f) * gridResolution);
+    float2 worldXZ = node.position + gridIndex / gridResolution * node.size;
+    float morph = saturate((distance(cameraPosition, float3(worldXZ.x, 0.0f, worldXZ.y)) - node.morphStart) / (node.morphEnd - node.morphStart));
+    gridIndex -= fmod(gridIndex, 2.0f) * morph;
+
+    worldXZ = node.position + gridIndex / gridResolution * node.size;
+    float3 position = float3(worldXZ.x, 0.0f, worldXZ.y);
+
+    float2 uv0 = position.xz / patchSize0;
+    float2 uv1 = position.xz / patchSize1;
+    float2 uv2 = position.xz / patchSize2;
+    float2 uv3 = position.xz / patchSize3;
+
+    // The mask is uniform, skipped cascades cost neither the fetch nor the bandwidth.
+    // The next coarser level doesn't sample the cascades from fadeCascade on,
+    // they fade out towards it. The first two are always sampled.
+    float fade = 1.0f - morph;
+    float3 displacement = DisplacementTexture0.SampleLevel(linearWrapSampler, uv0, 0).rgb;
+    [branch] if (activeCascades & 2)
+        displacement += DisplacementTexture1.SampleLevel(linearWrapSampler, uv1, 0).rgb;
+#if CASCADE_COUNT > 2
+    [branch] if (activeCascades & 4)
+        displacement += DisplacementTexture2.SampleLevel(linearWrapSampler, uv2, 0).rgb * (node.fadeCascade > 2.0f ? 1.0f : fade);
+#endif
+#if CASCADE_COUNT > 3
+    [branch] if (activeCascades & 8)
+        displacement += DisplacementTexture3.SampleLevel(linearWrapSampler, uv3, 0).rgb * (node.fadeCascade > 3.0f ? 1.0f : fade);
+#endif
+
+    float3 displacedPosition = position;
     displacedPosition += displacement * HEIGHT_SCALE;
 
     VertexShaderOutput OUT;
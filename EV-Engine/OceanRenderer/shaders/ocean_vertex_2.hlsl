@@ -0,0 +1,2 @@
+#define CASCADE_COUNT 2
+#include "ocean_vertex.hlsl"
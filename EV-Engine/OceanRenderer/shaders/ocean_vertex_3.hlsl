@@ -0,0 +1,2 @@
+#define CASCADE_COUNT 3
+#include "ocean_vertex.hlsl"
@@ -138,6 +138,27 @@ cbuffer CameraCB : register(b1, space0)
     Camera camera;
 }
 
+// Diffuse irradiance of the environment as L2 spherical harmonics, see OceanIrradiance.
+cbuffer IrradianceCB : register(b2)
+{
+    float4 irradianceSH[9];
+}
+
+// Irradiance / pi around the unit normal n, like the convolved cubemap held.
+float3 EvaluateIrradiance(float3 n)
+{
+    float3 irradiance = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y
+        + irradianceSH[2].rgb * n.z
+        + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y)
+        + irradianceSH[5].rgb * (n.y * n.z)
+        + irradianceSH[6].rgb * (3.0f * n.z * n.z - 1.0f)
+        + irradianceSH[7].rgb * (n.x * n.z)
+        + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, 0.0f);
+}
+
 float PBRCalculateNormalDistribution(float roughness, const float3 normal, const float3 halfvec)
 {
   
@@ -226,9 +247,8 @@ Texture2D BumpTexture : register(t9);
 Texture2D OpacityTexture : register(t10);
 Texture2D MetallicRoughness : register(t11);
 // IBL
-TextureCube<float4> diffuseMap : register(t12);
-TextureCube<float4> specularMap : register(t13);
-Texture2D<float2> brdfLUT : register(t14);
+TextureCube<float4> specularMap : register(t12);
+Texture2D<float2> brdfLUT : register(t13);
 
 
 SamplerState anisotropicSampler : register(s0); // for material textures
@@ -319,7 +339,7 @@ float4 main(PixelShaderInput IN) : SV_Target
     float2 lutUV = float2(NdotV, roughness);
     float2 envBRDF = brdfLUT.Sample(linearClampSampler, lutUV).rg;
 
-    float3 irradiance = diffuseMap.Sample(linearClampSampler, normalWS).rgb;
+    float3 irradiance = EvaluateIrradiance(normalWS);
     float3 diffuse = irradiance * albedo;
     float3 fresnelIBL = PBRCalculateFresnelIBL(NdotV, F0, roughness);
     float3 kd_ibl = (float3(1.0f, 1.0f, 1.0f) - fresnelIBL) * (1.0f - metallic);
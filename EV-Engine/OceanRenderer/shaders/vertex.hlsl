@@ -6,9 +6,12 @@ struct Matrices
     matrix MVP;
 };
 
-cbuffer matrixCB : register(b0)
+// One entry per instance, a draw's instances start at FirstInstance.
+StructuredBuffer<Matrices> Instances : register(t0, space1);
+
+cbuffer InstanceCB : register(b1, space1)
 {
-    Matrices matrixBuffer;
+    uint FirstInstance;
 }
 
 
@@ -33,9 +36,10 @@ struct VertexShaderOutput
     float4 Position : SV_Position;
 };
 
-VertexShaderOutput main(VertexPositionNormalTexture data)
+VertexShaderOutput main(VertexPositionNormalTexture data, uint instanceID : SV_InstanceID)
 {
     VertexShaderOutput OUT;
+    Matrices matrixBuffer = Instances[FirstInstance + instanceID];
 
     OUT.Position = mul(matrixBuffer.MVP, float4(data.Position, 1.0f));
     OUT.PositionVS = mul(matrixBuffer.modelViewMatrix, float4(data.Position, 1.0f));
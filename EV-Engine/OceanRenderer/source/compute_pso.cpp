@@ -55,7 +55,7 @@ std::wstring OceanCompute::ModulePath()
 }
 
 // TODO: make more clear which dispatch belongs to which pass since they are all different anyway
-void OceanCompute::Dispatch(std::shared_ptr<CommandList> commandList, const std::shared_ptr<Texture>& inputTexture, std::shared_ptr<Texture> slopeTexture, std::shared_ptr<Texture> displacementTexture, float totalTime, float patchSize, DirectX::XMUINT3 dispatchDimension)
+void OceanCompute::Dispatch(std::shared_ptr<CommandList> commandList, const std::shared_ptr<Texture>& inputTexture, std::shared_ptr<Texture> slopeTexture, std::shared_ptr<Texture> displacementTexture, float totalTime, float patchSize, uint32_t resolution, float inverseH0Scale, DirectX::XMUINT3 dispatchDimension)
 {
     commandList->SetPipelineState(m_pipelineStateObject);
     commandList->SetComputeRootSignature(m_rootSignature);
@@ -71,11 +71,15 @@ void OceanCompute::Dispatch(std::shared_ptr<CommandList> commandList, const std:
     {
         float time;
         float patchSize;
+        uint32_t resolution;
+        float inverseH0Scale;
     }cbv;
 
     cbv.time = totalTime;
     cbv.patchSize = patchSize;
-    commandList->SetCompute32BitConstants(RootParameters::Constants, 2, &cbv);
+    cbv.resolution = resolution;
+    cbv.inverseH0Scale = inverseH0Scale;
+    commandList->SetCompute32BitConstants(RootParameters::Constants, 4, &cbv);
 
     commandList->Dispatch(dispatchDimension.x, dispatchDimension.y, dispatchDimension.z);
     
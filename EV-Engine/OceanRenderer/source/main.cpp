@@ -6,9 +6,16 @@
 #include <ocean_scene.h>
 
 #include <dxgidebug.h>
+#include <chrono>
+#include <cstdio>
 #include <memory>
+#include <shellapi.h>
 
 #include "core/application.h"
+#include "ocean_benchmark.h"
+#include "ocean_brdf_lut.h"
+#include "ocean_clip.h"
+#include "ocean_ibl_cache.h"
 
 void ReportLiveObjects()
 {
@@ -19,10 +26,208 @@ void ReportLiveObjects()
 	dxgiDebug->Release();
 }
 
+void AttachConsoleOutput()
+{
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		AllocConsole();
+	FILE* stream = nullptr;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+}
+
+// Headless baker: --bake <path> [--fps N] [--repeat seconds] [--resolution N] [--format half|unorm16]
+int BakeClip()
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+
+	std::wstring path;
+	uint32_t resolution = 256;
+	float frameRate = 30.0f;
+	float repeatTime = 30.0f;
+	EV::OceanClipFormat format = EV::OCF_Half;
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (wcscmp(argv[i], L"--bake") == 0)
+			path = argv[++i];
+		else if (wcscmp(argv[i], L"--fps") == 0)
+			frameRate = static_cast<float>(_wtof(argv[++i]));
+		else if (wcscmp(argv[i], L"--repeat") == 0)
+			repeatTime = static_cast<float>(_wtof(argv[++i]));
+		else if (wcscmp(argv[i], L"--resolution") == 0)
+			resolution = static_cast<uint32_t>(_wtoi(argv[++i]));
+		else if (wcscmp(argv[i], L"--format") == 0)
+			format = wcscmp(argv[++i], L"unorm16") == 0 ? EV::OCF_Unorm16 : EV::OCF_Half;
+	}
+	LocalFree(argv);
+
+	if (path.empty() || frameRate <= 0.0f || repeatTime <= 0.0f ||
+		resolution < OCEAN_MIN_SUBRES || resolution > OCEAN_MAX_SUBRES || (resolution & (resolution - 1)) != 0)
+	{
+		std::printf("Usage: --bake <path> [--fps N] [--repeat seconds] [--resolution %u..%u] [--format half|unorm16]\n", OCEAN_MIN_SUBRES, OCEAN_MAX_SUBRES);
+		return 1;
+	}
+
+	EV::OceanClipBakeSettings settings = EV::OceanClipBaker::DefaultSettings(resolution);
+	settings.frameRate = frameRate;
+	settings.repeatTime = repeatTime;
+	settings.format = format;
+
+	std::printf("Baking %.1f s at %.0f fps, 4 cascades of %ux%u, %s\n", repeatTime, frameRate, resolution, resolution, format == EV::OCF_Half ? "half" : "unorm16");
+	uint32_t reported = 0;
+	bool baked = EV::OceanClipBaker::Bake(settings, path, [&](uint32_t frame, uint32_t frameCount)
+	{
+		const uint32_t percent = frame * 100 / frameCount;
+		if (percent >= reported + 5 || frame == frameCount)
+		{
+			std::printf("  %3u%% (%u / %u frames)\n", percent, frame, frameCount);
+			reported = percent;
+		}
+		return true;
+	});
+
+	EV::OceanClipReader clip;
+	if (!baked || !clip.Open(path))
+	{
+		std::printf("Bake failed\n");
+		return 1;
+	}
+
+	const EV::OceanClipDesc& desc = clip.GetDesc();
+	double rawSize = 0.0;
+	for (const EV::OceanClipCascade& cascade : desc.cascades)
+		rawSize += static_cast<double>(desc.frameCount) * cascade.resolution * cascade.resolution * static_cast<uint32_t>(EV::OCC_Count) * sizeof(uint16_t);
+	std::printf("Wrote %.1f MB, %.2f:1 over the 16 bit frames\n", clip.GetSize() / (1024.0 * 1024.0), rawSize / clip.GetSize());
+	return 0;
+}
+
+// Headless IBL bake for the asset pipeline: --bake-ibl <panorama.hdr> [--cubemap N] [--specular N] [--samples N]
+int BakeIBL()
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+
+	std::wstring path;
+	EV::OceanIBLBakeSettings settings;
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (wcscmp(argv[i], L"--bake-ibl") == 0)
+			path = argv[++i];
+		else if (wcscmp(argv[i], L"--cubemap") == 0)
+			settings.cubemapSize = static_cast<uint32_t>(_wtoi(argv[++i]));
+		else if (wcscmp(argv[i], L"--specular") == 0)
+			settings.specularSize = static_cast<uint32_t>(_wtoi(argv[++i]));
+		else if (wcscmp(argv[i], L"--samples") == 0)
+			settings.specularSampleCount = static_cast<uint32_t>(_wtoi(argv[++i]));
+	}
+	LocalFree(argv);
+
+	if (path.empty() || settings.cubemapSize == 0 || settings.specularSampleCount == 0 ||
+		settings.specularSize < (1u << (settings.specularMipLevels - 1)))
+	{
+		std::printf("Usage: --bake-ibl <panorama.hdr> [--cubemap N] [--specular N (at least %u)] [--samples N]\n", 1u << (settings.specularMipLevels - 1));
+		return 1;
+	}
+
+	EV::OceanIBLCache cache(path, settings);
+	std::printf("Baking a %u^2 cubemap and a %u^2 specular cubemap with %u samples per texel\n", settings.cubemapSize, settings.specularSize, settings.specularSampleCount);
+
+	EV::OceanIBLCacheEntry entry;
+	EV::OceanIBLBakeTimes times;
+	if (!cache.Bake(entry, &times))
+	{
+		std::printf("Bake failed\n");
+		return 1;
+	}
+
+	std::printf("Cubemap %.0f ms, irradiance %.1f ms, specular %.0f ms\n", times.cubemap, times.irradiance, times.specular);
+	std::printf("Wrote %ls\n", cache.GetPath("*").c_str());
+	return 0;
+}
+
+// Post build step: --bake-brdf-lut <path> [--size N] [--format half|unorm8] [--samples N]
+// Leaves a LUT that already matches alone, so incremental builds don't integrate it again.
+int BakeBrdfLut()
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+
+	std::wstring path;
+	EV::OceanBrdfLutDesc desc;
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (wcscmp(argv[i], L"--bake-brdf-lut") == 0)
+			path = argv[++i];
+		else if (wcscmp(argv[i], L"--size") == 0)
+			desc.size = static_cast<uint32_t>(_wtoi(argv[++i]));
+		else if (wcscmp(argv[i], L"--format") == 0)
+			desc.format = wcscmp(argv[++i], L"unorm8") == 0 ? EV::OBF_Unorm8 : EV::OBF_Half;
+		else if (wcscmp(argv[i], L"--samples") == 0)
+			desc.sampleCount = static_cast<uint32_t>(_wtoi(argv[++i]));
+	}
+	LocalFree(argv);
+
+	if (path.empty() || desc.size == 0 || desc.size > 4096 || desc.sampleCount == 0)
+	{
+		std::printf("Usage: --bake-brdf-lut <path> [--size 1..4096] [--format half|unorm8] [--samples N]\n");
+		return 1;
+	}
+
+	{
+		EV::OceanBrdfLutBlob existing;
+		if (EV::OceanBrdfLut::Load(path, existing) && existing.desc == desc)
+		{
+			std::printf("%ls is up to date\n", path.c_str());
+			return 0;
+		}
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const std::vector<uint8_t> texels = EV::OceanBrdfLut::Generate(desc);
+	const double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (!EV::OceanBrdfLut::Store(path, desc, texels.data()))
+	{
+		std::printf("Failed to write %ls\n", path.c_str());
+		return 1;
+	}
+
+	std::printf("Wrote a %u^2 %s BRDF LUT (%.1f KB) with %u samples per texel in %.0f ms\n", desc.size, desc.format == EV::OBF_Half ? "half" : "unorm8",
+	            desc.GetPayloadSize() / 1024.0, desc.sampleCount, time);
+	return 0;
+}
+
 int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
 {
 	int retCode = 0;
 
+	// Headless mode, runs the CPU benchmarks without creating a device or window.
+	if (lpCmdLine && wcsstr(lpCmdLine, L"--benchmark"))
+	{
+		AttachConsoleOutput();
+		return EV::OceanBenchmark::RunAll();
+	}
+
+	// Build step that writes the BRDF LUT next to the executable. This and
+	// --bake-ibl are checked before --bake, which they start with.
+	if (lpCmdLine && wcsstr(lpCmdLine, L"--bake-brdf-lut"))
+	{
+		AttachConsoleOutput();
+		return BakeBrdfLut();
+	}
+
+	// Offline bake of the image based lighting of a sky panorama.
+	if (lpCmdLine && wcsstr(lpCmdLine, L"--bake-ibl"))
+	{
+		AttachConsoleOutput();
+		return BakeIBL();
+	}
+
+	// Offline bake of a looping clip for the playback mode.
+	if (lpCmdLine && wcsstr(lpCmdLine, L"--bake"))
+	{
+		AttachConsoleOutput();
+		return BakeClip();
+	}
+
 	// // Set the working directory to the path of the executable.
 	// WCHAR path[MAX_PATH];
 	// HMODULE hModule = GetModuleHandleW(NULL);
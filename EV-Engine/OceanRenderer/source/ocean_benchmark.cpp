@@ -0,0 +1,2891 @@
+#include "ocean_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "ocean_brdf_lut.h"
+#include "ocean_buoyancy.h"
+#include "ocean_cascade_planner.h"
+#include "ocean_clip.h"
+#include "ocean_cpu_simulator.h"
+#include "ocean_half.h"
+#include "ocean_h0_cache.h"
+#include "ocean_ibl_baker.h"
+#include "ocean_irradiance.h"
+#include "ocean_noise.h"
+#include "ocean_quadtree.h"
+#include "ocean_simd.h"
+#include "ocean_spectrum.h"
+#include "ocean_surface_query.h"
+#include "DX12/bounding_volume_hierarchy.h"
+#include "DX12/draw_list.h"
+#include "DX12/frustum_culling.h"
+#include "DX12/transform_hierarchy.h"
+#include "utility/thread_pool.h"
+
+#define PI 3.14159265359f
+
+using namespace EV;
+
+namespace
+{
+	constexpr uint32_t BENCHMARK_RESOLUTION = 512;
+	constexpr int BENCHMARK_ITERATIONS = 10;
+	constexpr uint64_t BENCHMARK_SEED = 1337;
+	// Subdivisions of the uniform plane the ocean was drawn with before the quadtree.
+	constexpr uint32_t UNIFORM_GRID_RESOLUTION = 512;
+	// Focal length in pixels of a 1080 pixel high viewport with the 45 degree field of view of the ocean scene.
+	const float BENCHMARK_FOCAL_LENGTH = 1080.0f / (2.0f * std::tan(22.5f * PI / 180.0f));
+	// Largest error of the summed surface the half precision targets may add.
+	constexpr float HALF_HEIGHT_ERROR_BUDGET = 1e-3f;
+	constexpr float HALF_NORMAL_ERROR_BUDGET = 1e-3f;
+
+	// Same values as Ocean::UpdateSpectrumParameters and the default cascade setup.
+	JonswapParameters DefaultParameters()
+	{
+		JonswapParameters params;
+		params.scale = 1.0f;
+		params.spreadBlend = 1.0f;
+		params.swell = 0.198f;
+		params.gamma = 3.3f;
+		params.shortWavesFade = 0.01f;
+		params.windDirection = 0.0f;
+		params.fetch = 100000.0f;
+		params.windSpeed = 0.5f;
+		params.angle = params.windDirection / 180.0f * PI;
+		params.alpha = OceanSpectrum::JonswapAlpha(params.fetch, params.windSpeed);
+		params.peakOmega = OceanSpectrum::JonswapPeakFequency(params.fetch, params.windSpeed);
+		return params;
+	}
+
+	const float PATCH_SIZES[] = { 500.0f, 250.0f, 17.0f, 5.0f };
+
+	OceanCascadeDesc CascadeDesc(uint32_t cascade)
+	{
+		OceanCascadeDesc desc;
+		desc.patchSize = PATCH_SIZES[cascade];
+		desc.resolution = BENCHMARK_RESOLUTION;
+		desc.highCutoff = (BENCHMARK_RESOLUTION / 2.0f) * 2.0f * PI / desc.patchSize;
+		desc.lowCutoff = cascade == 0 ? 0.001f : (BENCHMARK_RESOLUTION * PI / PATCH_SIZES[cascade - 1]);
+		return desc;
+	}
+
+	constexpr uint32_t NUM_CASCADES = sizeof(PATCH_SIZES) / sizeof(PATCH_SIZES[0]);
+
+	// Foam settings of the ocean scene.
+	OceanFoamParameters DefaultFoamParameters()
+	{
+		OceanFoamParameters foamParameters;
+		foamParameters.decay = 0.008f;
+		foamParameters.bias = 0.311f;
+		foamParameters.add = 0.023f;
+		foamParameters.threshold = 0.023f;
+		return foamParameters;
+	}
+
+	// Loads the H0 of every default cascade into the simulator.
+	void SetupSimulator(OceanCpuSimulator& simulator)
+	{
+		const uint32_t N = BENCHMARK_RESOLUTION;
+		const JonswapParameters params = DefaultParameters();
+		std::vector<std::complex<float>> noise(N * N);
+		std::vector<float> H0(N * N * 4);
+
+		for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+		{
+			const OceanCascadeDesc desc = CascadeDesc(cascade);
+			OceanNoise::Generate(BENCHMARK_SEED, cascade, N, noise.data());
+			OceanSpectrum::BuildH0(params, desc, noise.data(), H0.data());
+			simulator.SetCascade(cascade, desc, H0.data());
+		}
+	}
+
+	// Literal scalar translation of animate_waves.hlsl, fft.hlsl and permute.hlsl,
+	// the reference the CPU simulator is checked against.
+	struct GpuReference
+	{
+		uint32_t N = 0;
+		float patchSize = 0.0f;
+		std::vector<std::complex<float>> displacementRG, displacementBA, slopeRG, slopeBA;
+		std::vector<float> displacement[4]; // xyz, foam
+		std::vector<float> slope[2];
+		std::vector<float> foam;
+
+		void AnimateWaves(const std::vector<float>& H0, float time)
+		{
+			const float w = 2.0f * PI / 500.0f;
+			for (uint32_t y = 0; y < N; ++y)
+			{
+				for (uint32_t x = 0; x < N; ++x)
+				{
+					const float* texel = &H0[(y * N + x) * 4];
+					std::complex<float> h0(texel[0], texel[1]);
+					std::complex<float> h0conj(texel[2], texel[3]);
+
+					float kx = 2.0f * PI * (x - N / 2.0f) / patchSize;
+					float ky = 2.0f * PI * (y - N / 2.0f) / patchSize;
+					float k = std::sqrt(kx * kx + ky * ky);
+					float kRcp = k < 0.0001f ? 1.0f : 1.0f / k;
+
+					float dispersion = std::floor(std::sqrt(9.81f * k) / w) * w * time;
+					std::complex<float> exponent(std::cos(dispersion), std::sin(dispersion));
+					std::complex<float> htilde = h0 * exponent + h0conj * std::conj(exponent);
+					std::complex<float> ih(-htilde.imag(), htilde.real());
+
+					std::complex<float> dx = ih * kx * kRcp;
+					std::complex<float> dy = htilde;
+					std::complex<float> dz = ih * ky * kRcp;
+					std::complex<float> dxdx = -htilde * kx * kx * kRcp;
+					std::complex<float> dydx = ih * kx;
+					std::complex<float> dzdx = -htilde * kx * ky * kRcp;
+					std::complex<float> dydz = ih * ky;
+					std::complex<float> dzdz = -htilde * ky * ky * kRcp;
+
+					const uint32_t i = y * N + x;
+					displacementRG[i] = { dx.real() - dz.imag(), dx.imag() + dz.real() };
+					displacementBA[i] = { dy.real() - dzdx.imag(), dy.imag() + dzdx.real() };
+					slopeRG[i] = { dydx.real() - dydz.imag(), dydx.imag() + dydz.real() };
+					slopeBA[i] = { dxdx.real() - dzdz.imag(), dxdx.imag() + dzdz.real() };
+				}
+			}
+		}
+
+		void FFT(std::vector<std::complex<float>>& texture, bool columnPass)
+		{
+			std::vector<std::complex<float>> buffer[2] = { std::vector<std::complex<float>>(N), std::vector<std::complex<float>>(N) };
+			for (uint32_t group = 0; group < N; ++group)
+			{
+				for (uint32_t index = 0; index < N; ++index)
+					buffer[0][index] = columnPass ? texture[index * N + group] : texture[group * N + index];
+
+				uint32_t flag = 0;
+				for (uint32_t stage = 0; (1u << stage) < N; ++stage)
+				{
+					for (uint32_t index = 0; index < N; ++index)
+					{
+						uint32_t b = N >> (stage + 1);
+						uint32_t w = b * (index / b);
+						uint32_t i = (w + index) % N;
+						float angle = -2.0f * PI * float(w) / float(N);
+						std::complex<float> twiddle(std::cos(angle), -std::sin(angle));
+						buffer[1 - flag][index] = buffer[flag][i] + twiddle * buffer[flag][i + b];
+					}
+					flag = 1 - flag;
+				}
+
+				for (uint32_t index = 0; index < N; ++index)
+					(columnPass ? texture[index * N + group] : texture[group * N + index]) = buffer[flag][index];
+			}
+		}
+
+		void Permute(const OceanFoamParameters& foamParameters)
+		{
+			const float lambda = OceanCpuSimulator::LAMBDA;
+			for (uint32_t y = 0; y < N; ++y)
+			{
+				for (uint32_t x = 0; x < N; ++x)
+				{
+					const uint32_t i = y * N + x;
+					const float sign = 1.0f - 2.0f * ((x + y) % 2);
+					std::complex<float> dxdz = displacementRG[i] * sign;
+					std::complex<float> dydxz = displacementBA[i] * sign;
+					std::complex<float> dyxdyz = slopeRG[i] * sign;
+					std::complex<float> dxxdzz = slopeBA[i] * sign;
+
+					float jacobian = (1.0f + lambda * dxxdzz.real()) * (1.0f + lambda * dxxdzz.imag()) - lambda * lambda * dydxz.imag() * dydxz.imag();
+					float f = std::clamp(foam[i] * std::exp(-foamParameters.decay), 0.0f, 1.0f);
+					float biasedJacobian = std::max(0.0f, -(jacobian - foamParameters.bias));
+					if (biasedJacobian > foamParameters.threshold)
+						f += foamParameters.add * biasedJacobian;
+
+					slope[0][i] = dyxdyz.real() / (1.0f + std::abs(dxxdzz.real() * lambda));
+					slope[1][i] = dyxdyz.imag() / (1.0f + std::abs(dxxdzz.imag() * lambda));
+					displacement[0][i] = lambda * dxdz.real();
+					displacement[1][i] = dydxz.real();
+					displacement[2][i] = lambda * dxdz.imag();
+					displacement[3][i] = f;
+					foam[i] = f;
+				}
+			}
+		}
+
+		void Simulate(const std::vector<float>& H0, float time, const OceanFoamParameters& foamParameters)
+		{
+			const size_t count = static_cast<size_t>(N) * N;
+			for (auto* texture : { &displacementRG, &displacementBA, &slopeRG, &slopeBA })
+				texture->resize(count);
+			for (auto& plane : displacement)
+				plane.resize(count);
+			for (auto& plane : slope)
+				plane.resize(count);
+			foam.resize(count, 0.0f);
+
+			AnimateWaves(H0, time);
+			for (auto* texture : { &displacementRG, &displacementBA, &slopeRG, &slopeBA })
+			{
+				FFT(*texture, false);
+				FFT(*texture, true);
+			}
+			Permute(foamParameters);
+		}
+	};
+
+	template<typename Func>
+	double TimeMilliseconds(const Func& func)
+	{
+		// Warm up caches and the pool before measuring.
+		func();
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < BENCHMARK_ITERATIONS; ++i)
+		{
+			func();
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(t1 - t0).count() / BENCHMARK_ITERATIONS;
+	}
+
+	// Planes of a level camera at position looking along yaw, ax + by + cz + d >= 0 inside.
+	void FrustumPlanes(const float position[3], float yaw, float halfFov, float nearDistance, float farDistance, float outPlanes[6][4])
+	{
+		const float forward[3] = { std::sin(yaw), 0.0f, std::cos(yaw) };
+		const float right[3] = { std::cos(yaw), 0.0f, -std::sin(yaw) };
+		const float c = std::cos(halfFov), s = std::sin(halfFov);
+		const float normals[6][3] = {
+			{ c * right[0] + s * forward[0], 0.0f, c * right[2] + s * forward[2] },   // Left
+			{ -c * right[0] + s * forward[0], 0.0f, -c * right[2] + s * forward[2] }, // Right
+			{ s * forward[0], c, s * forward[2] },                                    // Bottom
+			{ s * forward[0], -c, s * forward[2] },                                   // Top
+			{ forward[0], forward[1], forward[2] },                                   // Near
+			{ -forward[0], -forward[1], -forward[2] },                                // Far
+		};
+		for (int i = 0; i < 6; ++i)
+		{
+			outPlanes[i][0] = normals[i][0];
+			outPlanes[i][1] = normals[i][1];
+			outPlanes[i][2] = normals[i][2];
+			outPlanes[i][3] = -(normals[i][0] * position[0] + normals[i][1] * position[1] + normals[i][2] * position[2]);
+		}
+		outPlanes[4][3] -= nearDistance;
+		outPlanes[5][3] += farDistance;
+	}
+}
+
+bool OceanBenchmark::RunSpectrum()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const uint32_t numCascades = sizeof(PATCH_SIZES) / sizeof(PATCH_SIZES[0]);
+
+	std::vector<std::complex<float>> noise(N * N);
+	OceanNoise::Generate(BENCHMARK_SEED, 0, N, noise.data());
+
+	const JonswapParameters params = DefaultParameters();
+	std::vector<float> fast(N * N * 4);
+	std::vector<float> reference(N * N * 4);
+
+	std::printf("H0 spectrum, %ux%u, %u threads\n", N, N, ThreadPool::Get().GetThreadCount());
+
+	bool passed = true;
+	for (uint32_t cascade = 0; cascade < numCascades; ++cascade)
+	{
+		const OceanCascadeDesc desc = CascadeDesc(cascade);
+
+		double referenceTime = TimeMilliseconds([&]() { OceanSpectrum::BuildH0Reference(params, desc, noise.data(), reference.data()); });
+		double fastTime = TimeMilliseconds([&]() { OceanSpectrum::BuildH0(params, desc, noise.data(), fast.data()); });
+
+		// The approximated exp/log differ from the CRT in the last couple of bits,
+		// so compare against the largest amplitude of the cascade.
+		float peak = 0.0f;
+		float maxError = 0.0f;
+		for (size_t i = 0; i < reference.size(); ++i)
+		{
+			peak = std::max(peak, std::abs(reference[i]));
+			maxError = std::max(maxError, std::abs(fast[i] - reference[i]));
+		}
+		const float relativeError = peak > 0.0f ? maxError / peak : maxError;
+		const bool cascadePassed = relativeError < 1e-4f;
+		passed &= cascadePassed;
+
+		std::printf("  cascade %u: scalar %8.3f ms, simd+mt %8.3f ms (%5.2fx), max error %.3e (%.3e of peak) %s\n",
+		            cascade, referenceTime, fastTime, referenceTime / fastTime, maxError, relativeError,
+		            cascadePassed ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunNoise()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	bool passed = true;
+
+	// Known answers from the Random123 distribution (kat_vectors, philox4x32 10 rounds).
+	struct KnownAnswer
+	{
+		uint32_t counter[4];
+		uint32_t key[2];
+		uint32_t expected[4];
+	};
+	const KnownAnswer knownAnswers[] =
+	{
+		{ { 0, 0, 0, 0 }, { 0, 0 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+	bool philoxPassed = true;
+	for (const KnownAnswer& answer : knownAnswers)
+	{
+		uint32_t out[4];
+		OceanNoise::Philox4x32(answer.counter, answer.key, out);
+		for (int i = 0; i < 4; ++i)
+			philoxPassed &= out[i] == answer.expected[i];
+	}
+	passed &= philoxPassed;
+
+	std::printf("Gaussian noise, %ux%u\n", N, N);
+	std::printf("  philox4x32-10 known answers %s\n", philoxPassed ? "ok" : "FAILED");
+
+	std::vector<std::complex<float>> field(N * N);
+	std::vector<std::complex<float>> scalarField(N * N);
+
+	double fieldTime = TimeMilliseconds([&]() { OceanNoise::Generate(BENCHMARK_SEED, 1, N, field.data()); });
+	double scalarTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t m = 0; m < N; ++m)
+				for (uint32_t n = 0; n < N; ++n)
+					scalarField[m * N + n] = OceanNoise::GaussianPair(BENCHMARK_SEED, 1, m, n);
+		});
+
+	// The SSE path uses approximated log/sin/cos, it should match the CRT closely.
+	float maxError = 0.0f;
+	double mean = 0.0;
+	double variance = 0.0;
+	double correlation = 0.0;
+	for (size_t i = 0; i < field.size(); ++i)
+	{
+		maxError = std::max(maxError, std::abs(field[i] - scalarField[i]));
+		mean += field[i].real() + field[i].imag();
+		variance += field[i].real() * field[i].real() + field[i].imag() * field[i].imag();
+		correlation += field[i].real() * field[i].imag();
+	}
+	const double count = 2.0 * field.size();
+	mean /= count;
+	variance = variance / count - mean * mean;
+	correlation /= field.size();
+
+	// Regenerating a sub range has to give the exact same numbers.
+	std::vector<std::complex<float>> partial(N * N);
+	OceanNoise::GenerateRows(BENCHMARK_SEED, 1, N, N / 2, N / 2 + 3, partial.data());
+	bool reproducible = std::equal(partial.begin() + (N / 2) * N, partial.begin() + (N / 2 + 3) * N, field.begin() + (N / 2) * N);
+
+	// Statistics of 2 * 512^2 samples, the bounds are several standard errors wide.
+	const bool statisticsPassed = std::abs(mean) < 0.01 && std::abs(variance - 1.0) < 0.01 && std::abs(correlation) < 0.01;
+	const bool fieldPassed = maxError < 1e-4f && reproducible && statisticsPassed;
+	passed &= fieldPassed;
+
+	std::printf("  scalar %8.3f ms, simd+mt %8.3f ms (%5.2fx), max error %.3e, mean %.4f, variance %.4f, correlation %.4f, reproducible %s %s\n",
+	            scalarTime, fieldTime, scalarTime / fieldTime, maxError, mean, variance, correlation,
+	            reproducible ? "yes" : "no", fieldPassed ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunSpectrumRebuild()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const uint32_t cascadeIndex = 1;
+
+	struct Edit
+	{
+		const char* name;
+		void (*apply)(JonswapParameters& params, OceanCascadeDesc& desc);
+	};
+	const Edit edits[] =
+	{
+		{ "scale", [](JonswapParameters& params, OceanCascadeDesc&) { params.scale *= 1.5f; } },
+		{ "wind direction", [](JonswapParameters& params, OceanCascadeDesc&) { params.windDirection += 30.0f; } },
+		{ "gamma", [](JonswapParameters& params, OceanCascadeDesc&) { params.gamma += 0.5f; } },
+		{ "wind speed", [](JonswapParameters& params, OceanCascadeDesc&) { params.windSpeed += 2.0f; } },
+		{ "patch size", [](JonswapParameters&, OceanCascadeDesc& desc) { desc.patchSize *= 0.75f; } },
+	};
+
+	std::printf("H0 incremental rebuild, %ux%u\n", N, N);
+
+	std::vector<std::complex<float>> noise(N * N);
+	OceanNoise::Generate(BENCHMARK_SEED, cascadeIndex, N, noise.data());
+	std::vector<float> reference(N * N * 4);
+
+	bool passed = true;
+	for (const Edit& edit : edits)
+	{
+		OceanCascadeSpectrum spectrum;
+		JonswapParameters params = DefaultParameters();
+		OceanCascadeDesc desc = CascadeDesc(cascadeIndex);
+		JonswapParameters edited = params;
+		OceanCascadeDesc editedDesc = desc;
+		edit.apply(edited, editedDesc);
+		edited.angle = edited.windDirection / 180.0f * PI;
+		edited.alpha = OceanSpectrum::JonswapAlpha(edited.fetch, edited.windSpeed);
+		edited.peakOmega = OceanSpectrum::JonswapPeakFequency(edited.fetch, edited.windSpeed);
+
+		// Alternate between the two states so every Update has work to do.
+		uint32_t flags = SDF_None;
+		bool toggle = false;
+		double rebuildTime = TimeMilliseconds([&]()
+			{
+				toggle = !toggle;
+				flags = spectrum.Update(toggle ? edited : params, toggle ? editedDesc : desc, BENCHMARK_SEED, cascadeIndex);
+			});
+		double fullTime = TimeMilliseconds([&]() { OceanSpectrum::BuildH0(edited, editedDesc, noise.data(), reference.data()); });
+
+		// Make sure the cache ends on the edited state and compare with a build from scratch.
+		if (!toggle)
+			spectrum.Update(edited, editedDesc, BENCHMARK_SEED, cascadeIndex);
+
+		const std::vector<float>& packed = spectrum.GetPackedH0();
+		float maxError = 0.0f;
+		for (size_t i = 0; i < reference.size(); ++i)
+			maxError = std::max(maxError, std::abs(packed[i] - reference[i]));
+
+		const bool editPassed = maxError == 0.0f;
+		passed &= editPassed;
+
+		std::printf("  %-14s full %8.3f ms, incremental %8.3f ms (%5.2fx), flags 0x%02x, max error %.3e %s\n",
+		            edit.name, fullTime, rebuildTime, fullTime / rebuildTime, flags, maxError, editPassed ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunCpuSimulator()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const uint32_t numCascades = NUM_CASCADES;
+	const OceanFoamParameters foamParameters = DefaultFoamParameters();
+
+	OceanCpuSimulator simulator;
+	SetupSimulator(simulator);
+
+	std::vector<GpuReference> references(numCascades);
+	for (uint32_t cascade = 0; cascade < numCascades; ++cascade)
+	{
+		references[cascade].N = N;
+		references[cascade].patchSize = PATCH_SIZES[cascade];
+	}
+
+	std::printf("CPU simulation, %u cascades of %ux%u\n", numCascades, N, N);
+
+	bool passed = true;
+	const float times[] = { 2.5f, 2.5f + 1.0f / 60.0f };
+	for (float time : times)
+	{
+		simulator.Simulate(time, foamParameters);
+		for (uint32_t cascade = 0; cascade < numCascades; ++cascade)
+			references[cascade].Simulate(simulator.GetCascade(cascade).H0, time, foamParameters);
+	}
+
+	for (uint32_t cascade = 0; cascade < numCascades; ++cascade)
+	{
+		const OceanCpuSimulator::Cascade& result = simulator.GetCascade(cascade);
+		const GpuReference& reference = references[cascade];
+
+		const std::vector<float>* planes[][2] =
+		{
+			{ &result.displacementX, &reference.displacement[0] },
+			{ &result.displacementY, &reference.displacement[1] },
+			{ &result.displacementZ, &reference.displacement[2] },
+			{ &result.slopeX, &reference.slope[0] },
+			{ &result.slopeZ, &reference.slope[1] },
+		};
+
+		// Different FFT algorithms round differently, compare against the field's range.
+		float maxRelativeError = 0.0f;
+		for (auto& plane : planes)
+		{
+			float peak = 0.0f;
+			float maxError = 0.0f;
+			for (size_t i = 0; i < plane[1]->size(); ++i)
+			{
+				peak = std::max(peak, std::abs((*plane[1])[i]));
+				maxError = std::max(maxError, std::abs((*plane[0])[i] - (*plane[1])[i]));
+			}
+			maxRelativeError = std::max(maxRelativeError, peak > 0.0f ? maxError / peak : maxError);
+		}
+
+		// Foam is thresholded, a texel right at the threshold may go either way.
+		uint32_t foamMismatches = 0;
+		for (size_t i = 0; i < reference.foam.size(); ++i)
+			foamMismatches += std::abs(result.foam[i] - reference.foam[i]) > 1e-3f;
+
+		const bool cascadePassed = maxRelativeError < 1e-4f && foamMismatches <= N * N / 1000;
+		passed &= cascadePassed;
+
+		std::printf("  cascade %u: max error %.3e of range, foam mismatches %u %s\n",
+		            cascade, maxRelativeError, foamMismatches, cascadePassed ? "ok" : "FAILED");
+	}
+
+	double simulateTime = TimeMilliseconds([&]() { simulator.Simulate(3.0f, foamParameters); });
+	std::printf("  simulate %8.3f ms for all cascades, %u threads\n", simulateTime, ThreadPool::Get().GetThreadCount());
+
+	return passed;
+}
+
+bool OceanBenchmark::RunSurfaceQuery()
+{
+	const uint32_t numPoints = 4096;
+
+	OceanCpuSimulator simulator;
+	SetupSimulator(simulator);
+	simulator.Simulate(2.5f, DefaultFoamParameters());
+
+	// Probes spread over a few of the largest patches.
+	std::vector<float> x(numPoints), z(numPoints);
+	uint32_t state = 12345;
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) * (1.0f / 16777216.0f); };
+	for (uint32_t i = 0; i < numPoints; ++i)
+	{
+		x[i] = (random() * 2.0f - 1.0f) * 1500.0f;
+		z[i] = (random() * 2.0f - 1.0f) * 1500.0f;
+	}
+
+	struct Result
+	{
+		std::vector<float> height, normalX, normalY, normalZ, foam;
+		OceanSurfaceQuery query;
+
+		Result(const std::vector<float>& x, const std::vector<float>& z, uint32_t iterations)
+			: height(x.size()), normalX(x.size()), normalY(x.size()), normalZ(x.size()), foam(x.size())
+		{
+			query.x = x.data();
+			query.z = z.data();
+			query.count = static_cast<uint32_t>(x.size());
+			query.height = height.data();
+			query.normalX = normalX.data();
+			query.normalY = normalY.data();
+			query.normalZ = normalZ.data();
+			query.foam = foam.data();
+			query.iterations = iterations;
+		}
+	};
+
+	Result simd(x, z, OCEAN_QUERY_ITERATIONS);
+	Result scalar(x, z, OCEAN_QUERY_ITERATIONS);
+	Result converged(x, z, 32);
+
+	std::printf("Surface queries, %u points, %d iterations\n", numPoints, OCEAN_QUERY_ITERATIONS);
+
+	double scalarTime = TimeMilliseconds([&]() { OceanSurface::QueryReference(simulator, scalar.query); });
+	double simdTime = TimeMilliseconds([&]() { OceanSurface::Query(simulator, simd.query); });
+	OceanSurface::QueryReference(simulator, converged.query);
+
+	// Buoyancy probes sit in clusters around the hulls, which is kinder to the caches.
+	std::vector<float> clusterX(numPoints), clusterZ(numPoints);
+	for (uint32_t i = 0; i < numPoints; ++i)
+	{
+		const uint32_t hull = i / 256;
+		clusterX[i] = hull * 97.0f + random() * 40.0f;
+		clusterZ[i] = hull * -61.0f + random() * 12.0f;
+	}
+	Result clustered(clusterX, clusterZ, OCEAN_QUERY_ITERATIONS);
+	double clusteredTime = TimeMilliseconds([&]() { OceanSurface::Query(simulator, clustered.query); });
+
+	float maxHeightError = 0.0f;
+	float maxNormalError = 0.0f;
+	float maxFoamError = 0.0f;
+	float maxIterationError = 0.0f;
+	double meanIterationError = 0.0;
+	for (uint32_t i = 0; i < numPoints; ++i)
+	{
+		maxHeightError = std::max(maxHeightError, std::abs(simd.height[i] - scalar.height[i]));
+		maxNormalError = std::max(maxNormalError, std::abs(simd.normalX[i] - scalar.normalX[i]));
+		maxNormalError = std::max(maxNormalError, std::abs(simd.normalY[i] - scalar.normalY[i]));
+		maxNormalError = std::max(maxNormalError, std::abs(simd.normalZ[i] - scalar.normalZ[i]));
+		maxFoamError = std::max(maxFoamError, std::abs(simd.foam[i] - scalar.foam[i]));
+
+		float iterationError = std::abs(simd.height[i] - converged.height[i]);
+		maxIterationError = std::max(maxIterationError, iterationError);
+		meanIterationError += iterationError;
+	}
+	meanIterationError /= numPoints;
+
+	// Tail handling, an odd count has to give the same answers.
+	Result tail(x, z, OCEAN_QUERY_ITERATIONS);
+	tail.query.count = numPoints - 3;
+	OceanSurface::Query(simulator, tail.query);
+	bool tailMatches = std::equal(tail.height.begin(), tail.height.end() - 3, simd.height.begin());
+
+	bool passed = maxHeightError < 1e-4f && maxNormalError < 1e-5f && maxFoamError < 1e-5f && tailMatches;
+
+	std::printf("  scattered: scalar %8.3f ms, simd %8.3f ms (%5.2fx), %.1f ns per point, %u threads\n",
+	            scalarTime, simdTime, scalarTime / simdTime, simdTime * 1e6 / numPoints, ThreadPool::Get().GetThreadCount());
+	std::printf("  clustered:                    simd %8.3f ms,          %.1f ns per point\n",
+	            clusteredTime, clusteredTime * 1e6 / numPoints);
+	std::printf("  max error height %.3e, normal %.3e, foam %.3e, tail %s\n",
+	            maxHeightError, maxNormalError, maxFoamError, tailMatches ? "ok" : "FAILED");
+	std::printf("  height change to %d iterations: max %.3e m, mean %.3e m %s\n",
+	            converged.query.iterations, maxIterationError, meanIterationError, passed ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunHalfPrecision()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const OceanFoamParameters foamParameters = DefaultFoamParameters();
+
+	std::printf("Half precision, %u cascades of %ux%u, %s conversion\n", NUM_CASCADES, N, N, OceanHalf::HasF16C() ? "F16C" : "scalar");
+
+	// Every half, the midpoints between neighbours (the ties), values just
+	// off them, float subnormals, overflow, infinity and NaN.
+	std::vector<float> values;
+	for (uint32_t bits = 0; bits < 0x7c00; ++bits)
+	{
+		const float value = OceanHalf::ToFloat(static_cast<uint16_t>(bits));
+		const float next = OceanHalf::ToFloat(static_cast<uint16_t>(bits + 1));
+		const float middle = 0.5f * (value + next);
+		for (float v : { value, middle, std::nextafter(middle, 0.0f), std::nextafter(middle, next) })
+		{
+			values.push_back(v);
+			values.push_back(-v);
+		}
+	}
+	for (float v : { 1e-40f, 65504.0f, 65519.99f, 65520.0f, 1e10f, 1e38f, INFINITY, NAN })
+	{
+		values.push_back(v);
+		values.push_back(-v);
+	}
+	while (values.size() % 4)
+		values.push_back(0.0f);
+
+	// The array conversion against the scalar one, and RoundToHalf against a round trip.
+	std::vector<uint16_t> halves(values.size());
+	OceanHalf::FromFloat(values.data(), halves.data(), values.size());
+	std::vector<float> decoded(values.size());
+	OceanHalf::ToFloat(halves.data(), decoded.data(), halves.size());
+
+	auto sameValue = [](float a, float b) { return std::isnan(a) ? std::isnan(b) : std::memcmp(&a, &b, sizeof(a)) == 0; };
+	uint32_t encodeMismatches = 0;
+	uint32_t decodeMismatches = 0;
+	uint32_t roundMismatches = 0;
+	for (size_t i = 0; i < values.size(); i += 4)
+	{
+		float rounded[4];
+		simd::Store(rounded, simd::RoundToHalf(simd::Load(&values[i])));
+		for (size_t j = i; j < i + 4; ++j)
+		{
+			const uint16_t half = OceanHalf::FromFloat(values[j]);
+			encodeMismatches += !sameValue(OceanHalf::ToFloat(half), OceanHalf::ToFloat(halves[j]));
+			decodeMismatches += !sameValue(decoded[j], OceanHalf::ToFloat(halves[j]));
+			roundMismatches += !sameValue(rounded[j - i], OceanHalf::ToFloat(half));
+		}
+	}
+	const bool conversionsMatch = encodeMismatches == 0 && decodeMismatches == 0 && roundMismatches == 0;
+
+	// Packing the H0 of a cascade for the upload.
+	std::vector<float> H0(static_cast<size_t>(N) * N * 4);
+	std::vector<std::complex<float>> noise(static_cast<size_t>(N) * N);
+	OceanNoise::Generate(BENCHMARK_SEED, 0, N, noise.data());
+	OceanSpectrum::BuildH0(DefaultParameters(), CascadeDesc(0), noise.data(), H0.data());
+	std::vector<uint16_t> packed(H0.size());
+	double scalarTime = TimeMilliseconds([&]()
+	{
+		for (size_t i = 0; i < H0.size(); ++i)
+			packed[i] = OceanHalf::FromFloat(H0[i]);
+	});
+	double arrayTime = TimeMilliseconds([&]() { OceanHalf::FromFloat(H0.data(), packed.data(), H0.size()); });
+
+	std::printf("  %zu values: encode %u, decode %u, RoundToHalf %u mismatches %s\n",
+	            values.size(), encodeMismatches, decodeMismatches, roundMismatches, conversionsMatch ? "ok" : "FAILED");
+	std::printf("  pack H0: scalar %8.3f ms, array %8.3f ms (%5.2fx)\n", scalarTime, arrayTime, scalarTime / arrayTime);
+
+	// The same frames in full precision, with only H0 rounded and with every
+	// texture store rounded like the R16G16B16A16_FLOAT targets.
+	OceanCpuSimulator full, halfH0, halfTargets;
+	SetupSimulator(full);
+	SetupSimulator(halfH0);
+	SetupSimulator(halfTargets);
+	halfTargets.SetHalfPrecision(true);
+	for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+	{
+		// Exactly what the upload stores, scale included.
+		std::vector<float> rounded = halfH0.GetCascade(cascade).H0;
+		const float scale = halfH0.GetCascade(cascade).H0Scale;
+		std::vector<uint16_t> roundedHalves(rounded.size());
+		OceanHalf::FromFloat(rounded.data(), roundedHalves.data(), rounded.size(), scale);
+		OceanHalf::ToFloat(roundedHalves.data(), rounded.data(), rounded.size());
+		for (float& value : rounded)
+			value /= scale;
+		halfH0.SetCascade(cascade, CascadeDesc(cascade), rounded.data());
+	}
+
+	struct FieldError
+	{
+		double maxError = 0.0;
+		double squaredError = 0.0;
+		double peak = 0.0;
+		size_t count = 0;
+
+		void Add(const std::vector<float>& reference, const std::vector<float>& result)
+		{
+			for (size_t i = 0; i < reference.size(); ++i)
+			{
+				const double error = std::abs(static_cast<double>(result[i]) - reference[i]);
+				maxError = std::max(maxError, error);
+				squaredError += error * error;
+				peak = std::max(peak, static_cast<double>(std::abs(reference[i])));
+			}
+			count += reference.size();
+		}
+		double Rms() const { return count ? std::sqrt(squaredError / count) : 0.0; }
+	};
+
+	const float times[] = { 2.5f, 61.3f, 377.0f };
+	FieldError height[2][NUM_CASCADES], horizontal[2][NUM_CASCADES], slope[2][NUM_CASCADES];
+	for (float time : times)
+	{
+		full.Simulate(time, foamParameters);
+		halfH0.Simulate(time, foamParameters);
+		halfTargets.Simulate(time, foamParameters);
+
+		const OceanCpuSimulator* results[] = { &halfH0, &halfTargets };
+		for (uint32_t variant = 0; variant < 2; ++variant)
+		{
+			for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+			{
+				const OceanCpuSimulator::Cascade& reference = full.GetCascade(cascade);
+				const OceanCpuSimulator::Cascade& result = results[variant]->GetCascade(cascade);
+				height[variant][cascade].Add(reference.displacementY, result.displacementY);
+				horizontal[variant][cascade].Add(reference.displacementX, result.displacementX);
+				horizontal[variant][cascade].Add(reference.displacementZ, result.displacementZ);
+				slope[variant][cascade].Add(reference.slopeX, result.slopeX);
+				slope[variant][cascade].Add(reference.slopeZ, result.slopeZ);
+			}
+		}
+	}
+
+	for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+	{
+		std::printf("  cascade %u (%5.1f m), peak height %.3e m:\n", cascade, PATCH_SIZES[cascade], height[0][cascade].peak);
+		for (uint32_t variant = 0; variant < 2; ++variant)
+		{
+			std::printf("    %-12s height max %.2e rms %.2e m, horizontal max %.2e m, slope max %.2e\n",
+			            variant == 0 ? "half H0" : "half targets", height[variant][cascade].maxError, height[variant][cascade].Rms(),
+			            horizontal[variant][cascade].maxError, slope[variant][cascade].maxError);
+		}
+	}
+
+	// What the shaders see: all cascades summed at points spread over the largest patch.
+	const uint32_t numPoints = 4096;
+	std::vector<float> x(numPoints), z(numPoints);
+	uint32_t state = 4242;
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) * (1.0f / 16777216.0f); };
+	for (uint32_t i = 0; i < numPoints; ++i)
+	{
+		x[i] = random() * PATCH_SIZES[0];
+		z[i] = random() * PATCH_SIZES[0];
+	}
+
+	std::vector<float> surfaceHeights[3], normalY[3];
+	const OceanCpuSimulator* simulators[] = { &full, &halfH0, &halfTargets };
+	for (uint32_t variant = 0; variant < 3; ++variant)
+	{
+		surfaceHeights[variant].resize(numPoints);
+		normalY[variant].resize(numPoints);
+		OceanSurfaceQuery query;
+		query.x = x.data();
+		query.z = z.data();
+		query.count = numPoints;
+		query.height = surfaceHeights[variant].data();
+		query.normalY = normalY[variant].data();
+		OceanSurface::Query(*simulators[variant], query);
+	}
+
+	float peakHeight = 0.0f;
+	for (float height : surfaceHeights[0])
+		peakHeight = std::max(peakHeight, std::abs(height));
+	std::printf("  surface at %u points, peak height %.3f m\n", numPoints, peakHeight);
+
+	bool passed = conversionsMatch;
+	for (uint32_t variant = 1; variant < 3; ++variant)
+	{
+		float maxHeightError = 0.0f;
+		float maxNormalError = 0.0f;
+		for (uint32_t i = 0; i < numPoints; ++i)
+		{
+			maxHeightError = std::max(maxHeightError, std::abs(surfaceHeights[variant][i] - surfaceHeights[0][i]));
+			maxNormalError = std::max(maxNormalError, std::abs(normalY[variant][i] - normalY[0][i]));
+		}
+		const bool variantPassed = maxHeightError <= HALF_HEIGHT_ERROR_BUDGET && maxNormalError <= HALF_NORMAL_ERROR_BUDGET;
+		passed &= variantPassed;
+
+		std::printf("    %-12s max height error %.2e m (budget %.0e), normal.y %.2e (budget %.0e) %s\n",
+		            variant == 1 ? "half H0" : "half targets", maxHeightError, HALF_HEIGHT_ERROR_BUDGET,
+		            maxNormalError, HALF_NORMAL_ERROR_BUDGET, variantPassed ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunH0Cache()
+{
+	namespace fs = std::filesystem;
+
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const uint64_t entrySize = 32 + static_cast<uint64_t>(N) * N * 4 * sizeof(float);
+	const fs::path directory = fs::temp_directory_path() / "ev_ocean_h0_cache_benchmark";
+
+	// Room for two entries, so the third one evicts the least recently used.
+	OceanH0Cache cache(directory, entrySize * 2 + entrySize / 2);
+	cache.Clear();
+
+	const JonswapParameters params = DefaultParameters();
+	std::vector<std::complex<float>> noise(N * N);
+	std::vector<float> H0[3];
+	uint64_t keys[3];
+	for (uint32_t cascade = 0; cascade < 3; ++cascade)
+	{
+		const OceanCascadeDesc desc = CascadeDesc(cascade);
+		H0[cascade].resize(N * N * 4);
+		OceanNoise::Generate(BENCHMARK_SEED, cascade, N, noise.data());
+		OceanSpectrum::BuildH0(params, desc, noise.data(), H0[cascade].data());
+		keys[cascade] = OceanH0Cache::MakeKey(params, desc, BENCHMARK_SEED, cascade);
+	}
+
+	std::printf("H0 disk cache, %ux%u, %s\n", N, N, directory.string().c_str());
+
+	// Any parameter, the seed and the cascade index have to change the key.
+	JonswapParameters scaled = params;
+	scaled.scale += 0.001f;
+	bool keysDiffer = keys[0] != keys[1] && keys[1] != keys[2] &&
+		OceanH0Cache::MakeKey(scaled, CascadeDesc(0), BENCHMARK_SEED, 0) != keys[0] &&
+		OceanH0Cache::MakeKey(params, CascadeDesc(0), BENCHMARK_SEED + 1, 0) != keys[0] &&
+		OceanH0Cache::MakeKey(params, CascadeDesc(0), BENCHMARK_SEED, 1) != keys[0];
+
+	// Round trip.
+	double storeTime = TimeMilliseconds([&]() { cache.Store(keys[0], N, H0[0].data()); });
+	OceanCachedH0 cached;
+	bool roundTrip = cache.Load(keys[0], N, cached) &&
+		std::memcmp(cached.packedH0, H0[0].data(), H0[0].size() * sizeof(float)) == 0;
+	cached = OceanCachedH0();
+
+	// Mapping plus a read of every texel, what the texture upload does.
+	std::vector<float> upload(N * N * 4);
+	double loadTime = TimeMilliseconds([&]()
+	{
+		OceanCachedH0 h0;
+		if (cache.Load(keys[0], N, h0))
+			std::memcpy(upload.data(), h0.packedH0, upload.size() * sizeof(float));
+	});
+	double buildTime = TimeMilliseconds([&]()
+	{
+		OceanNoise::Generate(BENCHMARK_SEED, 0, N, noise.data());
+		OceanSpectrum::BuildH0(params, CascadeDesc(0), noise.data(), upload.data());
+	});
+
+	// A wrong resolution or a truncated file is a miss, and the broken file is removed.
+	bool rejectsResolution = !cache.Load(keys[0], N / 2, cached);
+	cache.Store(keys[1], N, H0[1].data());
+	{
+		OceanCachedH0 probe;
+		cache.Load(keys[1], N, probe);
+	}
+	fs::path brokenPath;
+	for (const fs::directory_entry& file : fs::directory_iterator(directory))
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(keys[1]));
+		if (file.path().stem() == name)
+			brokenPath = file.path();
+	}
+	fs::resize_file(brokenPath, entrySize - 16);
+	bool rejectsTruncated = !cache.Load(keys[1], N, cached) && !fs::exists(brokenPath);
+
+	// LRU: store 0 and 1, use 0, store 2, 1 has to go.
+	cache.Clear();
+	cache.Store(keys[0], N, H0[0].data());
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	cache.Store(keys[1], N, H0[1].data());
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	{
+		OceanCachedH0 touched;
+		cache.Load(keys[0], N, touched);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	cache.Store(keys[2], N, H0[2].data());
+
+	OceanCachedH0 entries[3];
+	bool evictsLRU = cache.Load(keys[0], N, entries[0]) && !cache.Load(keys[1], N, entries[1]) && cache.Load(keys[2], N, entries[2]) &&
+		cache.GetSize() <= entrySize * 2 + entrySize / 2;
+	for (OceanCachedH0& entry : entries)
+		entry = OceanCachedH0();
+
+	cache.Clear();
+	std::error_code error;
+	fs::remove_all(directory, error);
+
+	bool passed = keysDiffer && roundTrip && rejectsResolution && rejectsTruncated && evictsLRU;
+	std::printf("  build %8.3f ms, cached load %8.3f ms (%5.2fx), store %8.3f ms\n",
+	            buildTime, loadTime, buildTime / loadTime, storeTime);
+	std::printf("  keys %s, round trip %s, rejects resolution %s, truncated %s, lru eviction %s\n",
+	            keysDiffer ? "ok" : "FAILED", roundTrip ? "ok" : "FAILED", rejectsResolution ? "ok" : "FAILED",
+	            rejectsTruncated ? "ok" : "FAILED", evictsLRU ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunClip()
+{
+	namespace fs = std::filesystem;
+
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const fs::path directory = fs::temp_directory_path() / "ev_ocean_clip_benchmark";
+	fs::create_directories(directory);
+
+	OceanCpuSimulator simulator;
+	SetupSimulator(simulator);
+	const OceanFoamParameters foamParameters = DefaultFoamParameters();
+
+	std::printf("Baked clip, %u cascades of %ux%u\n", NUM_CASCADES, N, N);
+
+	// The simulation has to loop for the clip to loop.
+	const float repeatTime = 8.0f;
+	simulator.SetRepeatTime(repeatTime);
+	simulator.Simulate(1.25f, foamParameters);
+	std::vector<float> firstLoop = simulator.GetCascade(1).displacementY;
+	simulator.Simulate(1.25f + repeatTime, foamParameters);
+	float maxLoopError = 0.0f;
+	for (size_t i = 0; i < firstLoop.size(); ++i)
+		maxLoopError = std::max(maxLoopError, std::abs(firstLoop[i] - simulator.GetCascade(1).displacementY[i]));
+	bool loops = maxLoopError < 1e-3f;
+
+	// Round trip of a few simulated frames in both formats.
+	const uint32_t frameCount = 3;
+	bool passed = loops;
+	for (OceanClipFormat format : { OCF_Half, OCF_Unorm16 })
+	{
+		const char* formatName = format == OCF_Half ? "half" : "unorm16";
+		const fs::path path = directory / (std::string(formatName) + ".clip");
+
+		OceanClipDesc desc;
+		desc.format = format;
+		desc.frameRate = 30.0f;
+		desc.frameCount = frameCount;
+		for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+			desc.cascades.push_back({ N, PATCH_SIZES[cascade] });
+
+		// Keep the simulated frames to compare the decoded ones against.
+		std::vector<std::vector<float>> frames[frameCount];
+		OceanClipWriter writer;
+		bool written = writer.Open(path, desc);
+		double encodeTime = 0.0;
+		for (uint32_t frame = 0; frame < frameCount && written; ++frame)
+		{
+			simulator.Simulate(2.0f + frame / desc.frameRate, foamParameters);
+			auto t0 = std::chrono::high_resolution_clock::now();
+			written &= writer.WriteFrame(simulator);
+			auto t1 = std::chrono::high_resolution_clock::now();
+			encodeTime += std::chrono::duration<double, std::milli>(t1 - t0).count() / frameCount;
+
+			for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+			{
+				const OceanCpuSimulator::Cascade& result = simulator.GetCascade(cascade);
+				for (const std::vector<float>* plane : { &result.displacementX, &result.displacementY, &result.displacementZ, &result.foam, &result.slopeX, &result.slopeZ })
+					frames[frame].push_back(*plane);
+			}
+		}
+		written &= !writer.WriteFrame(simulator) && writer.Close();
+
+		OceanClipReader reader;
+		bool opened = written && reader.Open(path) && reader.GetDesc().frameCount == frameCount &&
+			reader.GetDesc().cascades.size() == NUM_CASCADES && reader.GetFrame(frameCount / desc.frameRate + 0.01) == 0;
+
+		// Half keeps 11 significant bits, unorm16 is off by at most half a step of the channel's range.
+		bool decoded = opened;
+		float maxError = 0.0f;
+		bool boundsMatch = true;
+		std::vector<OceanClipFrame> cascades;
+		std::vector<float> values(N * N);
+		for (uint32_t frame = 0; frame < frameCount && decoded; ++frame)
+		{
+			decoded &= reader.Decode(frame, cascades);
+			for (uint32_t cascade = 0; cascade < NUM_CASCADES && decoded; ++cascade)
+			{
+				float maxAbs[OCC_Count] = {};
+				for (uint32_t channel = 0; channel < OCC_Count; ++channel)
+				{
+					const std::vector<float>& reference = frames[frame][cascade * OCC_Count + channel];
+					cascades[cascade].ToFloat(channel, values.data());
+					const float step = cascades[cascade].scale[channel];
+					for (size_t i = 0; i < reference.size(); ++i)
+					{
+						const float error = std::abs(values[i] - reference[i]);
+						const float bound = format == OCF_Half ? std::abs(reference[i]) / 2048.0f + 6e-8f : step * 0.5f + (std::abs(reference[i]) + std::abs(cascades[cascade].bias[channel])) * 1e-6f;
+						maxError = std::max(maxError, bound > 0.0f ? error / bound : error);
+						maxAbs[channel] = std::max(maxAbs[channel], std::abs(values[i]));
+					}
+				}
+
+				// The culling bounds of a frame have to be the exact extremes of what it decodes to.
+				const OceanDisplacementBounds frameBounds = cascades[cascade].GetDisplacementBounds();
+				boundsMatch &= frameBounds.horizontal == std::max(maxAbs[OCC_DisplacementX], maxAbs[OCC_DisplacementZ]) &&
+				               frameBounds.vertical == maxAbs[OCC_DisplacementY];
+			}
+		}
+		decoded &= maxError <= 1.0f && boundsMatch;
+
+		std::vector<uint16_t> displacement(N * N * 4), slope(N * N * 2), foam(N * N);
+		double decodeTime = TimeMilliseconds([&]() { reader.Decode(1, cascades); });
+		double uploadTime = TimeMilliseconds([&]()
+		{
+			for (const OceanClipFrame& cascade : cascades)
+				cascade.ToHalfTexels(displacement.data(), slope.data(), foam.data());
+		});
+
+		const double rawSize = static_cast<double>(frameCount) * NUM_CASCADES * N * N * static_cast<uint32_t>(OCC_Count) * sizeof(uint16_t);
+		const double ratio = opened ? rawSize / reader.GetSize() : 0.0;
+		reader.Close();
+
+		const bool formatPassed = written && opened && decoded;
+		passed &= formatPassed;
+		std::printf("  %-7s encode %8.3f ms, decode %8.3f ms, to half texels %8.3f ms per frame\n", formatName, encodeTime, decodeTime, uploadTime);
+		std::printf("          %5.2f:1 over 16 bit, %5.2f:1 over 32 bit, max error %.3f of the quantization bound, displacement bounds %s %s\n",
+		            ratio, ratio * 2.0, maxError, boundsMatch ? "exact" : "off", formatPassed ? "ok" : "FAILED");
+	}
+
+	// A truncated clip can't be opened, the index would point past the end.
+	const fs::path truncatedPath = directory / "half.clip";
+	fs::resize_file(truncatedPath, fs::file_size(truncatedPath) - 64);
+	OceanClipReader truncated;
+	bool rejectsTruncated = !truncated.Open(truncatedPath);
+
+	// A complete bake, small enough to run here.
+	OceanClipBakeSettings settings = OceanClipBaker::DefaultSettings(64);
+	settings.frameRate = 10.0f;
+	settings.repeatTime = 2.0f;
+	const fs::path bakePath = directory / "bake.clip";
+	OceanClipReader baked;
+	std::vector<OceanClipFrame> cascades;
+	bool bakes = OceanClipBaker::Bake(settings, bakePath) && baked.Open(bakePath) && baked.GetDesc().frameCount == 20 &&
+		baked.Decode(19, cascades) && cascades.size() == settings.cascades.size();
+	baked.Close();
+
+	std::error_code error;
+	fs::remove_all(directory, error);
+
+	passed &= rejectsTruncated && bakes;
+	std::printf("  loops %s (%.2e), rejects truncated %s, bake %s\n",
+	            loops ? "ok" : "FAILED", maxLoopError, rejectsTruncated ? "ok" : "FAILED", bakes ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunCascadePlanner()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const std::vector<uint32_t> resolutions(NUM_CASCADES, N);
+
+	std::vector<std::complex<float>> noise(N * N);
+	std::vector<float> H0(N * N * 4);
+
+	std::printf("Cascade planner, %u cascades at %u^2\n", NUM_CASCADES, N);
+
+	// Wind speed and short wave fade. The strong fade leaves the smallest cascade without energy.
+	const float cases[][2] = { { 0.5f, 0.01f }, { 5.0f, 0.01f }, { 20.0f, 0.01f }, { 0.5f, 0.1f } };
+
+	bool passed = true;
+	for (const auto& [windSpeed, shortWavesFade] : cases)
+	{
+		JonswapParameters params = DefaultParameters();
+		params.windSpeed = windSpeed;
+		params.shortWavesFade = shortWavesFade;
+		params.alpha = OceanSpectrum::JonswapAlpha(params.fetch, params.windSpeed);
+		params.peakOmega = OceanSpectrum::JonswapPeakFequency(params.fetch, params.windSpeed);
+
+		OceanCascadePlan plan;
+		double planTime = TimeMilliseconds([&]() { plan = OceanCascadePlanner::Plan(params, resolutions); });
+
+		float totalHeight = 0.0f;
+		float totalSlope = 0.0f;
+		for (uint32_t i = 0; i < NUM_CASCADES; ++i)
+		{
+			totalHeight += plan.heightEnergy[i];
+			totalSlope += plan.slopeEnergy[i];
+		}
+
+		std::printf("  wind %4.1f m/s, short wave fade %.2f, planned in %.3f ms\n", windSpeed, shortWavesFade, planTime);
+		for (uint32_t i = 0; i < NUM_CASCADES; ++i)
+		{
+			const OceanCascadeDesc& desc = plan.cascades[i];
+
+			// The cascades have to tile k-space: each one starts where the last one ended.
+			bool contiguous = desc.lowCutoff < desc.highCutoff && (i == 0 || desc.lowCutoff == plan.cascades[i - 1].highCutoff);
+
+			// The integral has to predict what BuildH0 actually puts into the
+			// cascade. Only checked where the cascade matters, the relative error
+			// of a near empty cascade is dominated by the noise of a few texels.
+			float measuredHeight, measuredSlope;
+			OceanNoise::Generate(BENCHMARK_SEED, i, N, noise.data());
+			OceanSpectrum::BuildH0(params, desc, noise.data(), H0.data());
+			OceanCascadePlanner::MeasureEnergy(desc, H0.data(), measuredHeight, measuredSlope);
+
+			float heightRatio = measuredHeight / std::max(plan.heightEnergy[i], 1e-30f);
+			float slopeRatio = measuredSlope / std::max(plan.slopeEnergy[i], 1e-30f);
+			bool heightMatches = plan.heightEnergy[i] < 0.01f * totalHeight || std::abs(heightRatio - 1.0f) < 0.1f;
+			bool slopeMatches = plan.slopeEnergy[i] < 0.01f * totalSlope || std::abs(slopeRatio - 1.0f) < 0.1f;
+
+			// A skipped cascade has to be below the threshold in both energies.
+			bool culledCorrectly = plan.IsActive(i) || (plan.heightEnergy[i] < 1e-3f * totalHeight && plan.slopeEnergy[i] < 1e-3f * totalSlope);
+
+			bool cascadePassed = contiguous && heightMatches && slopeMatches && culledCorrectly;
+			passed &= cascadePassed;
+
+			std::printf("    cascade %u: %7.2f m, k [%8.4f, %8.2f], height %6.2f%% (measured %5.3fx), slope %6.2f%% (measured %5.3fx) %s %s\n",
+			            i, desc.patchSize, desc.lowCutoff, desc.highCutoff,
+			            100.0f * plan.heightEnergy[i] / totalHeight, heightRatio,
+			            100.0f * plan.slopeEnergy[i] / totalSlope, slopeRatio,
+			            plan.IsActive(i) ? "active " : "skipped", cascadePassed ? "ok" : "FAILED");
+		}
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunDisplacementBounds()
+{
+	const uint32_t N = BENCHMARK_RESOLUTION;
+	const OceanFoamParameters foamParameters = DefaultFoamParameters();
+
+	OceanCpuSimulator simulator;
+	SetupSimulator(simulator);
+
+	std::printf("Displacement bounds, %u cascades of %ux%u\n", NUM_CASCADES, N, N);
+
+	std::vector<OceanDisplacementBounds> bounds(NUM_CASCADES);
+	double boundsTime = TimeMilliseconds([&]()
+	{
+		for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+		{
+			const OceanCpuSimulator::Cascade& data = simulator.GetCascade(cascade);
+			bounds[cascade] = OceanSpectrum::DisplacementBounds(data.desc, data.H0.data(), OceanCpuSimulator::LAMBDA);
+		}
+	});
+
+	// The largest displacement seen over a spread of times, scattered over the whole period.
+	std::vector<OceanDisplacementBounds> observed(NUM_CASCADES);
+	const uint32_t numTimes = 24;
+	for (uint32_t i = 0; i < numTimes; ++i)
+	{
+		simulator.Simulate(i * (OCEAN_REPEAT_TIME / numTimes) + 0.37f * i, foamParameters);
+		for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+		{
+			const OceanCpuSimulator::Cascade& data = simulator.GetCascade(cascade);
+			for (size_t j = 0; j < data.displacementY.size(); ++j)
+			{
+				observed[cascade].horizontal = std::max({ observed[cascade].horizontal, std::abs(data.displacementX[j]), std::abs(data.displacementZ[j]) });
+				observed[cascade].vertical = std::max(observed[cascade].vertical, std::abs(data.displacementY[j]));
+			}
+		}
+	}
+
+	bool passed = true;
+	for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+	{
+		// The bound has to hold everywhere, up to the rounding of the FFT.
+		const bool cascadePassed = observed[cascade].horizontal <= bounds[cascade].horizontal * 1.001f &&
+		                           observed[cascade].vertical <= bounds[cascade].vertical * 1.001f;
+		passed &= cascadePassed;
+
+		std::printf("  cascade %u: bound %7.3f m sideways, %7.3f m vertical, largest seen %6.3f m / %6.3f m (%4.1fx / %4.1fx below) %s\n",
+		            cascade, bounds[cascade].horizontal, bounds[cascade].vertical,
+		            observed[cascade].horizontal, observed[cascade].vertical,
+		            bounds[cascade].horizontal / std::max(observed[cascade].horizontal, 1e-6f),
+		            bounds[cascade].vertical / std::max(observed[cascade].vertical, 1e-6f),
+		            cascadePassed ? "ok" : "FAILED");
+	}
+	std::printf("  bounds of all cascades in %.3f ms\n", boundsTime);
+
+	// The default configuration draws the GPU simulation without simulating on the
+	// CPU, floating boats or a clip. Its only bounds are the ones of the spectrum
+	// build, the quadtree still has to cull with them.
+	const std::vector<uint32_t> resolutions(NUM_CASCADES, N);
+	const JonswapParameters params = DefaultParameters();
+	const OceanCascadePlan plan = OceanCascadePlanner::Plan(params, resolutions);
+	std::vector<std::complex<float>> noise(N * N);
+	std::vector<float> H0(N * N * 4);
+	std::vector<OceanDisplacementBounds> buildBounds(NUM_CASCADES);
+	for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+	{
+		OceanNoise::Generate(BENCHMARK_SEED, cascade, N, noise.data());
+		OceanSpectrum::BuildH0(params, plan.cascades[cascade], noise.data(), H0.data());
+		buildBounds[cascade] = OceanSpectrum::DisplacementBounds(plan.cascades[cascade], H0.data(), OceanCpuSimulator::LAMBDA);
+	}
+
+	OceanQuadtree quadtree;
+	quadtree.SetDisplacementBounds(OceanSpectrum::SumDisplacementBounds(buildBounds.data(), NUM_CASCADES, plan.activeMask));
+	const OceanDisplacementBounds& culled = quadtree.GetDisplacementBounds();
+	const bool gpuPathBounded = culled.horizontal > 0.0f && culled.vertical > 0.0f;
+	passed &= gpuPathBounded;
+	std::printf("  GPU only: quadtree culls with %.3f m sideways, %.3f m vertical %s\n",
+	            culled.horizontal, culled.vertical, gpuPathBounded ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunCascadeMasking()
+{
+	OceanQuadtree quadtree;
+	quadtree.ClassifyCascades(PATCH_SIZES, NUM_CASCADES, BENCHMARK_FOCAL_LENGTH);
+	const OceanQuadtreeSettings& settings = quadtree.GetSettings();
+	const uint32_t patchVertices = (settings.gridResolution + 1) * (settings.gridResolution + 1);
+
+	std::printf("Cascade masking, patches of %.0f / %.0f / %.0f / %.0f m, %.1f samples per patch\n",
+	            PATCH_SIZES[0], PATCH_SIZES[1], PATCH_SIZES[2], PATCH_SIZES[3], settings.minSamplesPerPatch);
+
+	// Every level samples the leading cascades whose patch spans enough of its
+	// samples and at least minCascades, and the counts only go down with distance.
+	bool passed = true;
+	for (uint32_t lod = 0; lod < settings.lodCount; ++lod)
+	{
+		const float vertexSpacing = settings.leafSize * static_cast<float>(1u << lod) / settings.gridResolution;
+		const float pixelSize = lod > 0 ? quadtree.GetRange(lod - 1) / BENCHMARK_FOCAL_LENGTH : 0.0f;
+		const float sampleSpacing = std::max(vertexSpacing, pixelSize);
+
+		uint32_t expected = 0;
+		for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+			expected += PATCH_SIZES[cascade] >= settings.minSamplesPerPatch * sampleSpacing;
+		expected = std::clamp(expected, settings.minCascades, NUM_CASCADES);
+
+		const uint32_t count = quadtree.GetCascadeCount(lod);
+		const bool levelPassed = count == expected && (lod == 0 || count <= quadtree.GetCascadeCount(lod - 1));
+		passed &= levelPassed;
+
+		std::printf("  level %2u: %6.2f m between vertices, %5.2f m per pixel, %u cascades %s\n",
+		            lod, vertexSpacing, pixelSize, count, levelPassed ? "ok" : "FAILED");
+	}
+
+	// Displacement fetches per frame, against sampling every cascade on every node.
+	const float cameras[][3] = { { 3.7f, 2.0f, -11.3f }, { -88.1f, 150.0f, 40.6f } };
+	std::vector<OceanQuadtreeNode> nodes;
+	for (const float* camera : cameras)
+	{
+		quadtree.Select(camera, nullptr, nodes);
+
+		uint64_t fetches = 0;
+		uint32_t perCount[NUM_CASCADES + 1] = {};
+		for (const OceanQuadtreeNode& node : nodes)
+		{
+			fetches += static_cast<uint64_t>(node.cascadeCount) * patchVertices;
+			++perCount[static_cast<uint32_t>(node.cascadeCount)];
+		}
+		const uint64_t fullFetches = static_cast<uint64_t>(nodes.size()) * NUM_CASCADES * patchVertices;
+
+		const bool cameraPassed = fetches < fullFetches;
+		passed &= cameraPassed;
+
+		std::printf("  camera at %6.1f m: %4u / %4u / %4u nodes with 4 / 3 / 2 cascades, %.2fM of %.2fM fetches (%.0f%% saved) %s\n",
+		            camera[1], perCount[4], perCount[3], perCount[2], fetches / 1e6, fullFetches / 1e6,
+		            100.0 * (fullFetches - fetches) / fullFetches, cameraPassed ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunQuadtree()
+{
+	OceanQuadtree quadtree;
+	quadtree.ClassifyCascades(PATCH_SIZES, NUM_CASCADES, BENCHMARK_FOCAL_LENGTH);
+	const OceanQuadtreeSettings& settings = quadtree.GetSettings();
+	const float rootSize = quadtree.GetRootSize();
+	const uint32_t G = settings.gridResolution;
+	const uint32_t patchVertices = (G + 1) * (G + 1);
+
+	// What the uniform grid used to cost.
+	const uint32_t planeVertices = (UNIFORM_GRID_RESOLUTION + 1) * (UNIFORM_GRID_RESOLUTION + 1);
+
+	std::printf("Ocean quadtree, %u levels from %.0f m nodes, %u^2 patch, root %.0f m\n",
+	            settings.lodCount, settings.leafSize, G, rootSize);
+
+	// Camera positions (x, height, z), off the node grid on purpose.
+	const float cameras[][3] = { { 3.7f, 2.0f, -11.3f }, { 517.2f, 25.0f, 1203.9f }, { -88.1f, 150.0f, 40.6f }, { 10.0f, 1200.0f, 10.0f } };
+
+	bool passed = true;
+	std::vector<OceanQuadtreeNode> nodes;
+	for (const float* camera : cameras)
+	{
+		quadtree.Select(camera, nullptr, nodes);
+
+		// The nodes have to cover the root exactly once.
+		double area = 0.0;
+		bool disjoint = true;
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			area += static_cast<double>(nodes[i].size) * nodes[i].size;
+			for (size_t j = i + 1; j < nodes.size(); ++j)
+			{
+				const OceanQuadtreeNode& a = nodes[i];
+				const OceanQuadtreeNode& b = nodes[j];
+				const bool overlapX = a.x < b.x + b.size && b.x < a.x + a.size;
+				const bool overlapZ = a.z < b.z + b.size && b.z < a.z + a.size;
+				disjoint &= !(overlapX && overlapZ);
+			}
+		}
+		const bool covered = std::abs(area - static_cast<double>(rootSize) * rootSize) < 1.0;
+
+		// Along every edge two neighbours share, both sides have to end up with
+		// the same vertices after the morph, otherwise there are cracks.
+		uint32_t sharedEdges = 0;
+		float maxLodStep = 0.0f;
+		float maxSeamError = 0.0f;
+		float maxWeightError = 0.0f;
+		for (const OceanQuadtreeNode& a : nodes)
+		{
+			for (const OceanQuadtreeNode& b : nodes)
+			{
+				// b to the right of a (axis 0) or above it (axis 1).
+				for (uint32_t axis = 0; axis < 2; ++axis)
+				{
+					const float aEdge = axis == 0 ? a.x + a.size : a.z + a.size;
+					const float bEdge = axis == 0 ? b.x : b.z;
+					const float aStart = axis == 0 ? a.z : a.x;
+					const float bStart = axis == 0 ? b.z : b.x;
+					const float start = std::max(aStart, bStart);
+					const float end = std::min(aStart + a.size, bStart + b.size);
+					if (aEdge != bEdge || start >= end)
+						continue;
+
+					++sharedEdges;
+					maxLodStep = std::max(maxLodStep, std::abs(a.lod - b.lod));
+
+					// Position along the edge and the weight of every cascade.
+					struct EdgeVertex
+					{
+						float along;
+						float weights[NUM_CASCADES];
+					};
+					auto edgeVertices = [&](const OceanQuadtreeNode& node, bool farEdge)
+					{
+						std::vector<EdgeVertex> vertices;
+						for (uint32_t i = 0; i <= G; ++i)
+						{
+							const uint32_t gridX = axis == 0 ? (farEdge ? G : 0) : i;
+							const uint32_t gridZ = axis == 0 ? i : (farEdge ? G : 0);
+							float x, z, morph;
+							quadtree.MorphVertex(node, gridX, gridZ, camera, x, z, morph);
+
+							EdgeVertex vertex;
+							vertex.along = axis == 0 ? z : x;
+							for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+								vertex.weights[cascade] = OceanQuadtree::CascadeWeight(node, cascade, morph);
+							if (vertex.along >= start - 1e-3f && vertex.along <= end + 1e-3f)
+								vertices.push_back(vertex);
+						}
+						std::sort(vertices.begin(), vertices.end(), [](const EdgeVertex& p, const EdgeVertex& q) { return p.along < q.along; });
+						vertices.erase(std::unique(vertices.begin(), vertices.end(),
+						                           [](const EdgeVertex& p, const EdgeVertex& q) { return std::abs(p.along - q.along) < 1e-3f; }), vertices.end());
+						return vertices;
+					};
+
+					const std::vector<EdgeVertex> aVertices = edgeVertices(a, true);
+					const std::vector<EdgeVertex> bVertices = edgeVertices(b, false);
+					if (aVertices.size() != bVertices.size())
+					{
+						maxSeamError = std::max(maxSeamError, end - start);
+						continue;
+					}
+					for (size_t i = 0; i < aVertices.size(); ++i)
+					{
+						maxSeamError = std::max(maxSeamError, std::abs(aVertices[i].along - bVertices[i].along));
+						// Skipped cascades fade out, the heights on both sides have to match as well.
+						for (uint32_t cascade = 0; cascade < NUM_CASCADES; ++cascade)
+							maxWeightError = std::max(maxWeightError, std::abs(aVertices[i].weights[cascade] - bVertices[i].weights[cascade]));
+					}
+				}
+			}
+		}
+
+		// Spacing of the grid under the camera.
+		float nearSpacing = 0.0f;
+		for (const OceanQuadtreeNode& node : nodes)
+		{
+			if (camera[0] >= node.x && camera[0] < node.x + node.size && camera[2] >= node.z && camera[2] < node.z + node.size)
+				nearSpacing = node.size / G;
+		}
+
+		const bool cameraPassed = covered && disjoint && maxLodStep <= 1.0f && maxSeamError < 1e-2f && maxWeightError < 1e-4f;
+		passed &= cameraPassed;
+
+		std::printf("  camera (%7.1f, %6.1f, %7.1f): %4zu nodes, %7zu vertices (%5.1f%% of the %u^2 plane), %4.1f m under the camera, "
+		            "%u shared edges, seam error %.2g m, cascade weight error %.2g %s\n",
+		            camera[0], camera[1], camera[2], nodes.size(), nodes.size() * patchVertices,
+		            100.0 * nodes.size() * patchVertices / planeVertices, UNIFORM_GRID_RESOLUTION, nearSpacing,
+		            sharedEdges, maxSeamError, maxWeightError, cameraPassed ? "ok" : "FAILED");
+	}
+
+	// A camera 10 m above the water looking along +z, 45 degree vertical field
+	// of view at 16:9 and a 5 km far plane, like the ocean scene.
+	const float camera[3] = { 0.0f, 10.0f, 0.0f };
+	const float tanY = std::tan(0.5f * 45.0f * PI / 180.0f);
+	const float tanX = tanY * 16.0f / 9.0f;
+	const float nearZ = 0.1f;
+	const float farZ = 5000.0f;
+	float planes[6][4] = {
+		{ 1.0f, 0.0f, tanX, 0.0f },  // Left
+		{ -1.0f, 0.0f, tanX, 0.0f }, // Right
+		{ 0.0f, 1.0f, tanY, 0.0f },  // Bottom
+		{ 0.0f, -1.0f, tanY, 0.0f }, // Top
+		{ 0.0f, 0.0f, 1.0f, 0.0f },  // Near
+		{ 0.0f, 0.0f, -1.0f, 0.0f }, // Far
+	};
+	for (float* plane : planes)
+	{
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (uint32_t i = 0; i < 3; ++i)
+			plane[i] /= length;
+		plane[3] = -(plane[0] * camera[0] + plane[1] * camera[1] + plane[2] * camera[2]);
+	}
+	planes[4][3] -= nearZ;
+	planes[5][3] += farZ;
+
+	// Grown by about the bounds of the default spectrum, see RunDisplacementBounds.
+	OceanDisplacementBounds displacementBounds;
+	displacementBounds.horizontal = 34.0f;
+	displacementBounds.vertical = 37.0f;
+	quadtree.SetDisplacementBounds(displacementBounds);
+
+	std::vector<OceanQuadtreeNode> allNodes;
+	quadtree.Select(camera, nullptr, allNodes);
+	double cullTime = TimeMilliseconds([&]() { quadtree.Select(camera, planes, nodes); });
+
+	// Culling only drops subtrees, so the SSE test has to keep exactly the
+	// nodes whose grown box isn't behind one of the planes.
+	std::vector<OceanQuadtreeNode> expected;
+	for (const OceanQuadtreeNode& node : allNodes)
+	{
+		const float boxMin[3] = { node.x - displacementBounds.horizontal, -displacementBounds.vertical, node.z - displacementBounds.horizontal };
+		const float boxMax[3] = { node.x + node.size + displacementBounds.horizontal, displacementBounds.vertical, node.z + node.size + displacementBounds.horizontal };
+
+		bool outside = false;
+		for (const float* plane : planes)
+		{
+			const float x = plane[0] >= 0.0f ? boxMax[0] : boxMin[0];
+			const float y = plane[1] >= 0.0f ? boxMax[1] : boxMin[1];
+			const float z = plane[2] >= 0.0f ? boxMax[2] : boxMin[2];
+			outside |= plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f;
+		}
+		if (!outside)
+			expected.push_back(node);
+	}
+
+	bool matchesReference = expected.size() == nodes.size();
+	for (size_t i = 0; matchesReference && i < nodes.size(); ++i)
+		matchesReference = std::memcmp(&expected[i], &nodes[i], sizeof(OceanQuadtreeNode)) == 0;
+
+	// Every visible point of the water has to stay covered.
+	uint32_t visiblePoints = 0;
+	uint32_t uncovered = 0;
+	const float spacing = farZ / 137.0f;
+	for (float z = 1.0f; z < farZ; z += spacing)
+	{
+		for (float x = -2.0f * farZ; x < 2.0f * farZ; x += spacing)
+		{
+			bool visible = true;
+			for (const float* plane : planes)
+				visible &= plane[0] * x + plane[1] * 0.0f + plane[2] * z + plane[3] >= 0.0f;
+			if (!visible)
+				continue;
+
+			++visiblePoints;
+			bool covered = false;
+			for (const OceanQuadtreeNode& node : nodes)
+				covered |= x >= node.x && x <= node.x + node.size && z >= node.z && z <= node.z + node.size;
+			uncovered += !covered;
+		}
+	}
+
+	const bool cullPassed = uncovered == 0 && matchesReference && nodes.size() < allNodes.size();
+	passed &= cullPassed;
+
+	std::printf("  frustum culled: %zu of %zu nodes, %zu vertices, selected in %.4f ms, %s the scalar test, %u of %u visible points uncovered %s\n",
+	            nodes.size(), allNodes.size(), nodes.size() * patchVertices, cullTime, matchesReference ? "matches" : "differs from",
+	            uncovered, visiblePoints, cullPassed ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunBuoyancy()
+{
+	// Appends the triangles of a box, faceCount of its faces, the top one last.
+	auto addBox = [](const float center[3], const float size[3], uint32_t faceCount, std::vector<float>& positions, std::vector<uint32_t>& indices)
+	{
+		const uint32_t first = static_cast<uint32_t>(positions.size() / 3);
+		for (uint32_t corner = 0; corner < 8; ++corner)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+				positions.push_back(center[axis] + ((corner >> axis) & 1 ? 0.5f : -0.5f) * size[axis]);
+		}
+		const uint32_t faces[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 2, 3, 7, 6 } };
+		for (uint32_t face = 0; face < faceCount; ++face)
+		{
+			for (uint32_t corner : { 0, 1, 2, 0, 2, 3 })
+				indices.push_back(first + faces[face][corner]);
+		}
+	};
+
+	// A 4 x 2 x 8 m box, off the origin so the centroid has to be found.
+	const float boxSize[3] = { 4.0f, 2.0f, 8.0f };
+	const float boxCenter[3] = { 0.3f, 1.0f, -0.2f };
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	addBox(boxCenter, boxSize, 6, positions, indices);
+
+	const OceanBuoyancyHull hull = OceanBuoyancy::VoxelizeHull(positions.data(), 8, indices.data(), static_cast<uint32_t>(indices.size()));
+	const uint32_t probeCount = static_cast<uint32_t>(hull.probeX.size());
+	const float s = hull.probeSize;
+
+	// The voxels can overshoot every face by up to half a voxel.
+	const float boxVolume = boxSize[0] * boxSize[1] * boxSize[2];
+	const float boxArea = 2.0f * (boxSize[0] * boxSize[1] + boxSize[1] * boxSize[2] + boxSize[0] * boxSize[2]);
+	float centroidError = 0.0f, inertiaError = 0.0f;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		centroidError = std::max(centroidError, std::abs(hull.centroid[axis] - boxCenter[axis]));
+		const float a = boxSize[(axis + 1) % 3], b = boxSize[(axis + 2) % 3];
+		const float expected = (a * a + b * b) / 12.0f;
+		inertiaError = std::max(inertiaError, std::abs(hull.inertia[axis * 4] - expected) / expected);
+	}
+	bool hullPassed = probeCount <= OCEAN_BUOYANCY_MAX_PROBES && probeCount >= OCEAN_BUOYANCY_MAX_PROBES / 2 &&
+	                        std::abs(hull.volume - boxVolume) <= 0.5f * s * boxArea && centroidError < 1e-3f && inertiaError < 0.25f;
+
+	std::printf("Buoyancy, %.0f x %.0f x %.0f m box\n", boxSize[0], boxSize[1], boxSize[2]);
+	std::printf("  hull: %u probes of %.2f m, %.1f of %.1f m^3, centroid off by %.1e m, inertia off by %.1f%% %s\n",
+	            probeCount, s, hull.volume, boxVolume, centroidError, 100.0f * inertiaError, hullPassed ? "ok" : "FAILED");
+
+	// Without its top the box has to come out the same, and a separate mast
+	// above it must not fill the air in between.
+	std::vector<float> openPositions, mastPositions;
+	std::vector<uint32_t> openIndices, mastIndices;
+	addBox(boxCenter, boxSize, 5, openPositions, openIndices);
+	addBox(boxCenter, boxSize, 6, mastPositions, mastIndices);
+	const float mastSize[3] = { 1.0f, 3.0f, 1.0f };
+	const float mastCenter[3] = { boxCenter[0], boxCenter[1] + 0.5f * boxSize[1] + 1.0f + 0.5f * mastSize[1], boxCenter[2] };
+	addBox(mastCenter, mastSize, 6, mastPositions, mastIndices);
+
+	const OceanBuoyancyHull openHull = OceanBuoyancy::VoxelizeHull(openPositions.data(), 8, openIndices.data(), static_cast<uint32_t>(openIndices.size()));
+	const OceanBuoyancyHull mastHull = OceanBuoyancy::VoxelizeHull(mastPositions.data(), 16, mastIndices.data(), static_cast<uint32_t>(mastIndices.size()));
+	uint32_t gapProbes = 0;
+	for (size_t i = 0; i < mastHull.probeY.size(); ++i)
+	{
+		const float y = mastHull.probeY[i] + mastHull.centroid[1];
+		gapProbes += y > boxCenter[1] + 0.5f * boxSize[1] + 0.5f * mastHull.probeSize && y < mastCenter[1] - 0.5f * mastSize[1] - 0.5f * mastHull.probeSize;
+	}
+	const bool openPassed = openHull.probeX.size() == probeCount && openHull.volume == hull.volume;
+	const bool mastPassed = gapProbes == 0 && mastHull.volume < hull.volume * 1.2f;
+	std::printf("  open top: %zu probes %s, with a mast: %zu probes, %u in the gap %s\n",
+	            openHull.probeX.size(), openPassed ? "ok" : "FAILED", mastHull.probeX.size(), gapProbes, mastPassed ? "ok" : "FAILED");
+	hullPassed &= openPassed && mastPassed;
+
+	// Still water. At 40% of the density of water, dropped from a metre above
+	// and tilted, the box settles where the probes displace its weight. Below
+	// the waterline every voxel layer is fully submerged, so the draft is
+	// mass / (density * waterplane area) and the same as for the real box.
+	OceanCpuSimulator still;
+	{
+		OceanCascadeDesc desc = CascadeDesc(0);
+		desc.resolution = 16;
+		std::vector<float> H0(static_cast<size_t>(desc.resolution) * desc.resolution * 4, 0.0f);
+		still.SetCascade(0, desc, H0.data());
+		still.Simulate(0.0f, DefaultFoamParameters());
+	}
+
+	OceanBuoyancy buoyancy;
+	const OceanBuoyancySettings& settings = buoyancy.GetSettings();
+	const float densityRatio = 0.4f;
+
+	float lowestProbe = 0.0f;
+	for (float y : hull.probeY)
+		lowestProbe = std::min(lowestProbe, y);
+	const uint32_t layers = static_cast<uint32_t>(std::round(-2.0f * lowestProbe / s)) + 1;
+	const float waterplaneArea = hull.volume / (layers * s);
+
+	OceanBuoyancyBodyDesc body;
+	body.hull = &hull;
+	body.mass = densityRatio * settings.waterDensity * hull.volume;
+	body.position[1] = 1.0f;
+	body.rotation[0] = std::sin(0.5f * 10.0f * PI / 180.0f);
+	body.rotation[3] = std::cos(0.5f * 10.0f * PI / 180.0f);
+	buoyancy.AddBody(body);
+
+	for (uint32_t frame = 0; frame < 60 * 60; ++frame)
+		buoyancy.Update(still, 1.0f / 60.0f);
+
+	const float draft = body.mass / (settings.waterDensity * waterplaneArea);
+	const float expectedHeight = -draft - (lowestProbe - 0.5f * s);
+	const float boxHeight = 0.5f * boxSize[1] - densityRatio * boxSize[1];
+
+	const OceanBuoyancyPose pose = buoyancy.GetPose(0);
+	const float submergedError = std::abs(buoyancy.GetSubmergedVolume(0) - body.mass / settings.waterDensity) / (body.mass / settings.waterDensity);
+	const float heightError = std::abs(pose.position[1] - expectedHeight);
+	const float tilt = 2.0f * std::asin(std::min(1.0f, std::sqrt(pose.rotation[0] * pose.rotation[0] + pose.rotation[2] * pose.rotation[2]))) * 180.0f / PI;
+	const bool restPassed = submergedError < 1e-3f && heightError < 1e-3f && tilt < 0.1f;
+
+	std::printf("  still water: centre at %.4f m (voxels %.4f m, box %.4f m), displaces %.3f%% off its weight, tilted %.3f deg %s\n",
+	            pose.position[1], expectedHeight, boxHeight, 100.0f * submergedError, tilt, restPassed ? "ok" : "FAILED");
+
+	// Bodies spread over the waves, stepped with frames of 1/30 s and with
+	// uneven frames. After the same number of steps they have to be bit for
+	// bit where the other run left them.
+	OceanCpuSimulator simulator;
+	SetupSimulator(simulator);
+	simulator.Simulate(10.0f, DefaultFoamParameters());
+
+	const uint32_t bodiesPerRow = 16;
+	const uint32_t bodyCount = bodiesPerRow * bodiesPerRow;
+	auto addBodies = [&](OceanBuoyancy& target)
+	{
+		for (uint32_t i = 0; i < bodyCount; ++i)
+		{
+			OceanBuoyancyBodyDesc desc = body;
+			desc.position[0] = (i % bodiesPerRow) * 40.0f - 300.0f;
+			desc.position[1] = 0.2f;
+			desc.position[2] = (i / bodiesPerRow) * 40.0f - 300.0f;
+			desc.rotation[0] = 0.0f;
+			desc.rotation[3] = 1.0f;
+			target.AddBody(desc);
+		}
+	};
+
+	const uint64_t targetSteps = 600;
+	auto runTo = [&](OceanBuoyancy& target, auto frameTime)
+	{
+		while (target.GetStepCount() < targetSteps)
+		{
+			const float remaining = (targetSteps - target.GetStepCount() - target.GetInterpolation()) * target.GetSettings().timeStep;
+			target.Update(simulator, std::min(frameTime(), remaining + 1e-5f));
+		}
+	};
+
+	OceanBuoyancy fixedFrames, unevenFrames;
+	addBodies(fixedFrames);
+	addBodies(unevenFrames);
+	runTo(fixedFrames, []() { return 1.0f / 30.0f; });
+	uint32_t state = 777;
+	runTo(unevenFrames, [&state]() { state = state * 1664525u + 1013904223u; return 0.004f + (state >> 8) * (0.041f / 16777216.0f); });
+
+	uint32_t mismatches = 0;
+	for (uint32_t i = 0; i < bodyCount; ++i)
+	{
+		float velocities[2][6];
+		fixedFrames.GetVelocity(i, velocities[0], velocities[0] + 3);
+		unevenFrames.GetVelocity(i, velocities[1], velocities[1] + 3);
+		mismatches += std::memcmp(velocities[0], velocities[1], sizeof(velocities[0])) != 0;
+	}
+	const bool determinismPassed = mismatches == 0;
+	std::printf("  %u bodies, %llu steps at 30 fps and at uneven frames: %u differ %s\n",
+	            bodyCount, static_cast<unsigned long long>(targetSteps), mismatches, determinismPassed ? "ok" : "FAILED");
+
+	// On moving water for 20 s, the surface simulated at 20 Hz. Every body
+	// has to stay finite, afloat and upright.
+	OceanBuoyancy waves;
+	addBodies(waves);
+	std::vector<float> x(bodyCount), z(bodyCount), height(bodyCount);
+	for (uint32_t frame = 0; frame < 20 * 20; ++frame)
+	{
+		simulator.Simulate(10.0f + frame / 20.0f, DefaultFoamParameters());
+		waves.Update(simulator, 1.0f / 20.0f);
+	}
+	float maxOffset = 0.0f, maxTilt = 0.0f;
+	bool finite = true;
+	for (uint32_t i = 0; i < bodyCount; ++i)
+	{
+		const OceanBuoyancyPose bodyPose = waves.GetPose(i);
+		for (float value : bodyPose.position)
+			finite &= std::isfinite(value);
+		for (float value : bodyPose.rotation)
+			finite &= std::isfinite(value);
+		x[i] = bodyPose.position[0];
+		z[i] = bodyPose.position[2];
+		const float sinHalf = std::sqrt(bodyPose.rotation[0] * bodyPose.rotation[0] + bodyPose.rotation[2] * bodyPose.rotation[2]);
+		maxTilt = std::max(maxTilt, 2.0f * std::asin(std::min(1.0f, sinHalf)) * 180.0f / PI);
+	}
+	OceanSurfaceQuery query;
+	query.x = x.data();
+	query.z = z.data();
+	query.count = bodyCount;
+	query.height = height.data();
+	OceanSurface::Query(simulator, query);
+	for (uint32_t i = 0; i < bodyCount; ++i)
+		maxOffset = std::max(maxOffset, std::abs(waves.GetPose(i).position[1] - (height[i] + boxHeight)));
+	const bool wavesPassed = finite && maxOffset < 0.5f * boxSize[1] && maxTilt < 45.0f;
+	std::printf("  on the waves for 20 s: %.2f m off the still water floating height at most, tilted %.1f deg at most %s\n",
+	            maxOffset, maxTilt, wavesPassed ? "ok" : "FAILED");
+
+	// One step of every body, on one thread and on the pool.
+	const double stepTime = TimeMilliseconds([&]() { waves.Update(simulator, settings.timeStep); });
+	const uint32_t probes = waves.GetProbeCount();
+	std::printf("  step: %u bodies, %u probes: %.3f ms, %.1fM probes/s\n", bodyCount, probes, stepTime, probes / stepTime / 1e3);
+
+	return hullPassed && restPassed && determinismPassed && wavesPassed;
+}
+
+bool OceanBenchmark::RunIrradiance()
+{
+	// Direction of the texel centres of a panorama and of a cubemap, the layouts OceanIrradiance reads.
+	auto panoramaDirection = [](uint32_t i, uint32_t j, uint32_t width, uint32_t height, double dir[3])
+	{
+		const double phi = 2.0 * PI * (i + 0.5) / width, theta = PI * (j + 0.5) / height;
+		dir[0] = -std::sin(theta) * std::sin(phi);
+		dir[1] = std::cos(theta);
+		dir[2] = -std::sin(theta) * std::cos(phi);
+	};
+	auto cubemapDirection = [](uint32_t face, uint32_t i, uint32_t j, uint32_t size, double dir[3])
+	{
+		const double u = (i + 0.5) * 2.0 / size - 1.0, v = (j + 0.5) * 2.0 / size - 1.0;
+		const double faceDir[6][3] = { { 1, -v, -u }, { -1, -v, u }, { u, 1, v }, { u, -1, -v }, { u, -v, 1 }, { -u, -v, -1 } };
+		const double length = std::sqrt(u * u + v * v + 1.0);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+			dir[axis] = faceDir[face][axis] / length;
+	};
+
+	using Environment = void (*)(const double dir[3], float outRgb[3]);
+	auto makePanorama = [&](Environment environment, uint32_t width, uint32_t height)
+	{
+		std::vector<float> rgba(size_t(width) * height * 4, 1.0f);
+		for (uint32_t j = 0; j < height; ++j)
+		{
+			for (uint32_t i = 0; i < width; ++i)
+			{
+				double dir[3];
+				panoramaDirection(i, j, width, height, dir);
+				environment(dir, &rgba[(size_t(j) * width + i) * 4]);
+			}
+		}
+		return rgba;
+	};
+	auto makeCubemap = [&](Environment environment, uint32_t size)
+	{
+		std::vector<float> rgba(size_t(6) * size * size * 4, 1.0f);
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t j = 0; j < size; ++j)
+			{
+				for (uint32_t i = 0; i < size; ++i)
+				{
+					double dir[3];
+					cubemapDirection(face, i, j, size, dir);
+					environment(dir, &rgba[((size_t(face) * size + j) * size + i) * 4]);
+				}
+			}
+		}
+		return rgba;
+	};
+	auto projectCubemap = [](const std::vector<float>& rgba, uint32_t size)
+	{
+		const float* faces[6];
+		for (uint32_t face = 0; face < 6; ++face)
+			faces[face] = rgba.data() + size_t(face) * size * size * 4;
+		return OceanIrradiance::ProjectCubemap(faces, size);
+	};
+
+	// Normals spread over the sphere (Fibonacci spiral).
+	constexpr uint32_t NORMAL_COUNT = 128;
+	std::vector<double> normals(NORMAL_COUNT * 3);
+	for (uint32_t n = 0; n < NORMAL_COUNT; ++n)
+	{
+		const double y = 1.0 - 2.0 * (n + 0.5) / NORMAL_COUNT, r = std::sqrt(1.0 - y * y);
+		const double phi = n * PI * (3.0 - std::sqrt(5.0));
+		normals[n * 3 + 0] = r * std::cos(phi);
+		normals[n * 3 + 1] = y;
+		normals[n * 3 + 2] = r * std::sin(phi);
+	}
+	// Largest error of the irradiance of the projection against expected(normal, rgb), relative to the largest expected value.
+	auto irradianceError = [&](const OceanSH9& projection, const auto& expected)
+	{
+		float constants[9][4];
+		OceanIrradiance::ToShaderConstants(projection, constants);
+		double maxError = 0.0, maxValue = 0.0;
+		for (uint32_t n = 0; n < NORMAL_COUNT; ++n)
+		{
+			const double* normal = &normals[n * 3];
+			float rgb[3];
+			double reference[3];
+			OceanIrradiance::Evaluate(constants, float(normal[0]), float(normal[1]), float(normal[2]), rgb);
+			expected(normal, reference);
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				maxError = std::max(maxError, std::abs(rgb[c] - reference[c]));
+				maxValue = std::max(maxValue, std::abs(reference[c]));
+			}
+		}
+		return maxError / maxValue;
+	};
+
+	// A linear environment L = a + b d.x has the irradiance / pi a + 2/3 b n.x,
+	// which the first two bands hold exactly. Only the solid angles and the
+	// basis are left to get wrong.
+	Environment linear = [](const double dir[3], float outRgb[3])
+	{
+		outRgb[0] = float(1.0 + 0.5 * dir[0]);
+		outRgb[1] = float(2.0 - 0.7 * dir[1]);
+		outRgb[2] = float(0.5 + 0.4 * dir[2]);
+	};
+	auto linearIrradiance = [](const double* normal, double outRgb[3])
+	{
+		outRgb[0] = 1.0 + 0.5 * normal[0] * 2.0 / 3.0;
+		outRgb[1] = 2.0 - 0.7 * normal[1] * 2.0 / 3.0;
+		outRgb[2] = 0.5 + 0.4 * normal[2] * 2.0 / 3.0;
+	};
+	const double panoramaLinearError = irradianceError(OceanIrradiance::ProjectPanorama(makePanorama(linear, 256, 128).data(), 256, 128), linearIrradiance);
+	const double cubemapLinearError = irradianceError(projectCubemap(makeCubemap(linear, 64), 64), linearIrradiance);
+	const bool linearPassed = panoramaLinearError < 1e-3 && cubemapLinearError < 1e-3;
+
+	std::printf("Irradiance\n");
+	std::printf("  linear environment: panorama %.1e, cubemap %.1e off the exact irradiance %s\n",
+	            panoramaLinearError, cubemapLinearError, linearPassed ? "ok" : "FAILED");
+
+	// A sky with a small bright sun and a dark ground, brute force integrated for every normal.
+	Environment sky = [](const double dir[3], float outRgb[3])
+	{
+		const double sun[3] = { 0.48, 0.6, -0.64 };
+		const double sunDot = dir[0] * sun[0] + dir[1] * sun[1] + dir[2] * sun[2];
+		// Cut off before the tail turns into denormals.
+		const double sunLight = sunDot > 0.9 ? 40.0 * std::exp((sunDot - 1.0) / 0.002) : 0.0;
+		const double skyLight = dir[1] > 0.0 ? 0.5 + 0.5 * dir[1] : 0.0;
+		const double ground = dir[1] > 0.0 ? 0.0 : 1.0;
+		outRgb[0] = float(sunLight + 0.2 * skyLight + 0.10 * ground);
+		outRgb[1] = float(sunLight * 0.9 + 0.4 * skyLight + 0.08 * ground);
+		outRgb[2] = float(sunLight * 0.8 + 0.8 * skyLight + 0.05 * ground);
+	};
+	constexpr uint32_t SKY_WIDTH = 512, SKY_HEIGHT = 256;
+	const std::vector<float> skyPanorama = makePanorama(sky, SKY_WIDTH, SKY_HEIGHT);
+	const OceanSH9 skyProjection = OceanIrradiance::ProjectPanorama(skyPanorama.data(), SKY_WIDTH, SKY_HEIGHT);
+
+	// The SSE rows against a texel by texel projection in doubles.
+	OceanSH9 reference;
+	std::vector<double> skyDirections(size_t(SKY_WIDTH) * SKY_HEIGHT * 3), skySolidAngles(size_t(SKY_WIDTH) * SKY_HEIGHT);
+	for (uint32_t j = 0; j < SKY_HEIGHT; ++j)
+	{
+		const double solidAngle = 2.0 * PI / SKY_WIDTH * (std::cos(PI * j / SKY_HEIGHT) - std::cos(PI * (j + 1) / SKY_HEIGHT));
+		for (uint32_t i = 0; i < SKY_WIDTH; ++i)
+		{
+			const size_t texel = size_t(j) * SKY_WIDTH + i;
+			double* dir = &skyDirections[texel * 3];
+			panoramaDirection(i, j, SKY_WIDTH, SKY_HEIGHT, dir);
+			skySolidAngles[texel] = solidAngle;
+			double basis[9];
+			OceanIrradiance::EvaluateBasis(dir[0], dir[1], dir[2], basis);
+			for (uint32_t k = 0; k < 9; ++k)
+				for (uint32_t c = 0; c < 3; ++c)
+					reference.rgb[k][c] += skyPanorama[texel * 4 + c] * basis[k] * solidAngle;
+		}
+	}
+	double coefficientError = 0.0, coefficientMax = 0.0;
+	for (uint32_t k = 0; k < 9; ++k)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			coefficientError = std::max(coefficientError, std::abs(skyProjection.rgb[k][c] - reference.rgb[k][c]));
+			coefficientMax = std::max(coefficientMax, std::abs(reference.rgb[k][c]));
+		}
+	}
+	const bool projectionPassed = coefficientError / coefficientMax < 1e-4;
+	std::printf("  sky projection: %.1e off the scalar projection %s\n", coefficientError / coefficientMax, projectionPassed ? "ok" : "FAILED");
+
+	auto bruteForceIrradiance = [&](const double* normal, double outRgb[3])
+	{
+		double sum[3] = {};
+		for (size_t texel = 0; texel < skySolidAngles.size(); ++texel)
+		{
+			const double* dir = &skyDirections[texel * 3];
+			const double cosine = normal[0] * dir[0] + normal[1] * dir[1] + normal[2] * dir[2];
+			if (cosine <= 0.0)
+				continue;
+			for (uint32_t c = 0; c < 3; ++c)
+				sum[c] += skyPanorama[texel * 4 + c] * cosine * skySolidAngles[texel];
+		}
+		for (uint32_t c = 0; c < 3; ++c)
+			outRgb[c] = sum[c] / PI;
+	};
+	// What 9 coefficients can't hold of the sun, the published bound for real environments is a few percent.
+	const double skyError = irradianceError(skyProjection, bruteForceIrradiance);
+	const double skyCubemapError = irradianceError(projectCubemap(makeCubemap(sky, 128), 128), bruteForceIrradiance);
+	const bool skyPassed = skyError < 0.05 && skyCubemapError < 0.05;
+	std::printf("  sunny sky: panorama %.1f%%, cubemap %.1f%% off the brute force irradiance %s\n",
+	            100.0 * skyError, 100.0 * skyCubemapError, skyPassed ? "ok" : "FAILED");
+
+	// The size of the sky4k.hdr panorama and the old cubemap.
+	const std::vector<float> largePanorama = makePanorama(sky, 4096, 2048);
+	const std::vector<float> largeCubemap = makeCubemap(sky, 1024);
+	const double panoramaTime = TimeMilliseconds([&]() { OceanIrradiance::ProjectPanorama(largePanorama.data(), 4096, 2048); });
+	const double cubemapTime = TimeMilliseconds([&]() { projectCubemap(largeCubemap, 1024); });
+	std::printf("  project 4096 x 2048 panorama: %.3f ms, %.0fM texels/s\n", panoramaTime, 4096.0 * 2048.0 / panoramaTime / 1e3);
+	std::printf("  project 6 x 1024^2 cubemap: %.3f ms, %.0fM texels/s\n", cubemapTime, 6.0 * 1024.0 * 1024.0 / cubemapTime / 1e3);
+
+	return linearPassed && projectionPassed && skyPassed;
+}
+
+bool OceanBenchmark::RunIBLBake()
+{
+	// An environment as a function of the unit direction, sampled into panoramas laid out like sky4k.hdr.
+	using Environment = void (*)(const double dir[3], float outRgb[3]);
+	auto makePanorama = [](Environment environment, uint32_t width, uint32_t height)
+	{
+		std::vector<float> rgba(size_t(width) * height * 4, 1.0f);
+		for (uint32_t j = 0; j < height; ++j)
+		{
+			for (uint32_t i = 0; i < width; ++i)
+			{
+				const double phi = 2.0 * PI * (i + 0.5) / width, theta = PI * (j + 0.5) / height;
+				const double dir[3] = { -std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi) };
+				environment(dir, &rgba[(size_t(j) * width + i) * 4]);
+			}
+		}
+		return rgba;
+	};
+	auto texelDirection = [](uint32_t face, uint32_t i, uint32_t j, uint32_t size, double dir[3])
+	{
+		const double u = (i + 0.5) * 2.0 / size - 1.0, v = (j + 0.5) * 2.0 / size - 1.0;
+		const double faceDir[6][3] = { { 1, -v, -u }, { -1, -v, u }, { u, 1, v }, { u, -1, -v }, { u, -v, 1 }, { -u, -v, -1 } };
+		const double length = std::sqrt(u * u + v * v + 1.0);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+			dir[axis] = faceDir[face][axis] / length;
+	};
+
+	// A sky with a small bright sun, which point sampling a narrow lobe misses or hits too often.
+	Environment sky = [](const double dir[3], float outRgb[3])
+	{
+		const double sun[3] = { 0.48, 0.6, -0.64 };
+		const double sunDot = dir[0] * sun[0] + dir[1] * sun[1] + dir[2] * sun[2];
+		const double sunLight = 8.0 * std::exp((sunDot - 1.0) / 0.001);
+		const double skyLight = dir[1] > 0.0 ? 0.5 + 0.5 * dir[1] : 0.0;
+		outRgb[0] = float(sunLight + 0.2 * skyLight + 0.05);
+		outRgb[1] = float(sunLight * 0.9 + 0.4 * skyLight + 0.04);
+		outRgb[2] = float(sunLight * 0.8 + 0.8 * skyLight + 0.03);
+	};
+
+	std::printf("IBL bake\n");
+
+	// Every texel of the resampled cubemap against the environment at its centre.
+	constexpr uint32_t PANORAMA_WIDTH = 1024, PANORAMA_HEIGHT = 512, CUBEMAP_SIZE = 128;
+	const std::vector<float> panorama = makePanorama(sky, PANORAMA_WIDTH, PANORAMA_HEIGHT);
+	const OceanCubemap environment = OceanIBLBaker::PanoramaToCubemap(panorama.data(), PANORAMA_WIDTH, PANORAMA_HEIGHT, 0, CUBEMAP_SIZE);
+	double cubemapError = 0.0;
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		for (uint32_t j = 0; j < CUBEMAP_SIZE; ++j)
+		{
+			for (uint32_t i = 0; i < CUBEMAP_SIZE; ++i)
+			{
+				double dir[3];
+				float expected[3];
+				texelDirection(face, i, j, CUBEMAP_SIZE, dir);
+				sky(dir, expected);
+				const float* texel = environment.GetFace(face, 0) + (size_t(j) * CUBEMAP_SIZE + i) * 4;
+				for (uint32_t c = 0; c < 3; ++c)
+					cubemapError = std::max(cubemapError, double(std::abs(texel[c] - expected[c]) / 8.0f));
+			}
+		}
+	}
+	const bool cubemapPassed = cubemapError < 0.01 && environment.mipLevels == 8;
+	std::printf("  panorama to cubemap: %.1e off the environment, %u mips %s\n", cubemapError, environment.mipLevels, cubemapPassed ? "ok" : "FAILED");
+
+	// The weights are normalized, so a constant environment has to come out unchanged at every roughness.
+	OceanCubemap constant;
+	constant.size = 32;
+	constant.mipLevels = 6;
+	constant.texels.assign(constant.GetOffset(6, 0), 0.75f);
+	const OceanCubemap constantSpecular = OceanIBLBaker::PrefilterSpecular(constant, 16, 5, 64);
+	double constantError = 0.0;
+	for (size_t texel = 0; texel < constantSpecular.texels.size(); texel += 4)
+		for (uint32_t c = 0; c < 3; ++c)
+			constantError = std::max(constantError, double(std::abs(constantSpecular.texels[texel + c] - 0.75f)));
+	const bool constantPassed = constantError < 1e-5;
+	std::printf("  constant environment: %.1e off after prefiltering %s\n", constantError, constantPassed ? "ok" : "FAILED");
+
+	// The prefiltered texels against the GGX integral over every texel of the
+	// environment: sum L NdotL D / sum NdotL D with V = N, the distribution of the
+	// sampled directions. Without its mips the environment is point sampled,
+	// which is what the source mips save samples against.
+	constexpr uint32_t SPECULAR_SIZE = 32, SPECULAR_MIPS = 5, SPECULAR_SAMPLES = 256;
+	const size_t faceTexels = size_t(CUBEMAP_SIZE) * CUBEMAP_SIZE;
+	OceanCubemap pointSampled;
+	pointSampled.size = CUBEMAP_SIZE;
+	pointSampled.mipLevels = 1;
+	for (uint32_t face = 0; face < 6; ++face)
+		pointSampled.texels.insert(pointSampled.texels.end(), environment.GetFace(face, 0), environment.GetFace(face, 0) + faceTexels * 4);
+	const OceanCubemap specular = OceanIBLBaker::PrefilterSpecular(environment, SPECULAR_SIZE, SPECULAR_MIPS, SPECULAR_SAMPLES);
+	const OceanCubemap pointSpecular = OceanIBLBaker::PrefilterSpecular(pointSampled, SPECULAR_SIZE, SPECULAR_MIPS, SPECULAR_SAMPLES);
+
+	std::vector<double> texelDirections(6 * faceTexels * 3), texelSolidAngles(6 * faceTexels);
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		for (uint32_t j = 0; j < CUBEMAP_SIZE; ++j)
+		{
+			for (uint32_t i = 0; i < CUBEMAP_SIZE; ++i)
+			{
+				const size_t texel = face * faceTexels + size_t(j) * CUBEMAP_SIZE + i;
+				texelDirection(face, i, j, CUBEMAP_SIZE, &texelDirections[texel * 3]);
+				const double u = (i + 0.5) * 2.0 / CUBEMAP_SIZE - 1.0, v = (j + 0.5) * 2.0 / CUBEMAP_SIZE - 1.0;
+				texelSolidAngles[texel] = 4.0 / double(faceTexels) / std::pow(u * u + v * v + 1.0, 1.5);
+			}
+		}
+	}
+	// Largest error of a few texels of every face per mip, relative to the brightest reference.
+	double specularError[SPECULAR_MIPS] = {}, pointError[SPECULAR_MIPS] = {};
+	bool specularPassed = true;
+	for (uint32_t mip = 1; mip < SPECULAR_MIPS; ++mip)
+	{
+		const double a2 = std::pow(double(mip) / (SPECULAR_MIPS - 1), 4.0);
+		const uint32_t mipSize = specular.GetMipSize(mip);
+		double maxReference = 0.0;
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				const uint32_t i = (k * 7 + face * 3) % mipSize, j = (k * 5 + face) % mipSize;
+				double N[3];
+				texelDirection(face, i, j, mipSize, N);
+				double sum[3] = {}, totalWeight = 0.0;
+				for (size_t texel = 0; texel < texelSolidAngles.size(); ++texel)
+				{
+					const double* L = &texelDirections[texel * 3];
+					const double NdotL = N[0] * L[0] + N[1] * L[1] + N[2] * L[2];
+					if (NdotL <= 0.0)
+						continue;
+					// N.H of the half vector between N and L.
+					const double NdotH = std::sqrt(0.5 * (1.0 + NdotL));
+					const double denominator = NdotH * NdotH * (a2 - 1.0) + 1.0;
+					const double weight = NdotL * a2 / (denominator * denominator) * texelSolidAngles[texel];
+					const float* color = environment.GetFace(uint32_t(texel / faceTexels), 0) + (texel % faceTexels) * 4;
+					for (uint32_t c = 0; c < 3; ++c)
+						sum[c] += color[c] * weight;
+					totalWeight += weight;
+				}
+				const size_t offset = (size_t(j) * mipSize + i) * 4;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					const double reference = sum[c] / totalWeight;
+					maxReference = std::max(maxReference, reference);
+					specularError[mip] = std::max(specularError[mip], std::abs(specular.GetFace(face, mip)[offset + c] - reference));
+					pointError[mip] = std::max(pointError[mip], std::abs(pointSpecular.GetFace(face, mip)[offset + c] - reference));
+				}
+			}
+		}
+		specularError[mip] /= maxReference;
+		pointError[mip] /= maxReference;
+		specularPassed &= specularError[mip] < 0.05;
+	}
+	std::printf("  GGX prefilter at roughness 0.25 to 1, %u samples: %.1f%% %.1f%% %.1f%% %.1f%% off the integral with source mips, %.1f%% %.1f%% %.1f%% %.1f%% point sampled %s\n",
+	            SPECULAR_SAMPLES, 100.0 * specularError[1], 100.0 * specularError[2], 100.0 * specularError[3], 100.0 * specularError[4],
+	            100.0 * pointError[1], 100.0 * pointError[2], 100.0 * pointError[3], 100.0 * pointError[4], specularPassed ? "ok" : "FAILED");
+
+	// A complete bake with the settings of the ocean scene, from a panorama of the size of sky4k.hdr.
+	const std::vector<float> largePanorama = makePanorama(sky, 4096, 2048);
+	const OceanIBLBakeSettings settings;
+	const OceanIBLBake bake = OceanIBLBaker::Bake(largePanorama.data(), 4096, 2048, 0, settings);
+	std::printf("  bake on %u threads: cubemap %.0f ms, irradiance %.0f ms, specular %.0f ms\n",
+	            ThreadPool::Get().GetThreadCount(), bake.times.cubemap, bake.times.irradiance, bake.times.specular);
+
+	return cubemapPassed && constantPassed && specularPassed;
+}
+
+bool OceanBenchmark::RunBrdfLut()
+{
+	std::printf("BRDF LUT\n");
+
+	// The integral at points between the texel centres, with 16 times the samples of the LUT.
+	constexpr uint32_t POINT_COUNT = 24, REFERENCE_SAMPLES = 16384;
+	std::vector<float> points, references;
+	for (uint32_t j = 0; j < POINT_COUNT; ++j)
+	{
+		for (uint32_t i = 0; i < POINT_COUNT; ++i)
+		{
+			const float NdotV = (i + 0.37f) / POINT_COUNT, roughness = (j + 0.61f) / POINT_COUNT;
+			float reference[2];
+			OceanIBLBaker::IntegrateBrdf(NdotV, roughness, REFERENCE_SAMPLES, reference);
+			points.insert(points.end(), { NdotV, roughness });
+			references.insert(references.end(), { reference[0], reference[1] });
+		}
+	}
+
+	// Largest error of what a bilinear clamped sampler reads from a stored LUT.
+	auto lutError = [&](const std::vector<uint8_t>& texels, const OceanBrdfLutDesc& desc)
+	{
+		std::vector<float> lut(size_t(desc.size) * desc.size * 2);
+		OceanBrdfLut::Decode(texels.data(), desc, lut.data());
+
+		double maxError = 0.0;
+		for (size_t p = 0; p < points.size() / 2; ++p)
+		{
+			const float x = std::clamp(points[p * 2] * desc.size - 0.5f, 0.0f, desc.size - 1.0f);
+			const float y = std::clamp(points[p * 2 + 1] * desc.size - 0.5f, 0.0f, desc.size - 1.0f);
+			const uint32_t x0 = static_cast<uint32_t>(x), y0 = static_cast<uint32_t>(y);
+			const uint32_t x1 = std::min(x0 + 1, desc.size - 1), y1 = std::min(y0 + 1, desc.size - 1);
+			const float fx = x - x0, fy = y - y0;
+			for (uint32_t c = 0; c < 2; ++c)
+			{
+				auto texel = [&](uint32_t tx, uint32_t ty) { return lut[(size_t(ty) * desc.size + tx) * 2 + c]; };
+				const float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fx;
+				const float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fx;
+				maxError = std::max(maxError, double(std::abs(top + (bottom - top) * fy - references[p * 2 + c])));
+			}
+		}
+		return maxError;
+	};
+
+	struct Option
+	{
+		const char* name;
+		OceanBrdfLutDesc desc;
+		double tolerance;
+	};
+	const Option options[] = {
+		{ "512^2 half   ", { 512, OBF_Half, 1024 }, 0.01 },
+		{ "256^2 half   ", { 256, OBF_Half, 1024 }, 0.01 },
+		{ "128^2 half   ", { 128, OBF_Half, 1024 }, 0.01 },
+		{ "128^2 unorm8 ", { 128, OBF_Unorm8, 1024 }, 0.01 },
+	};
+	bool accuracyPassed = true;
+	for (const Option& option : options)
+	{
+		std::vector<uint8_t> texels;
+		const double generateTime = TimeMilliseconds([&]() { texels = OceanBrdfLut::Generate(option.desc); });
+		const double error = lutError(texels, option.desc);
+		const bool passed = error < option.tolerance;
+		accuracyPassed &= passed;
+		std::printf("  %s %7.1f KB, generated in %7.2f ms, max error %.1e against %u samples %s\n", option.name, option.desc.GetPayloadSize() / 1024.0,
+		            generateTime, error, REFERENCE_SAMPLES, passed ? "ok" : "FAILED");
+	}
+
+	// Round trip through a file, and rejection of a truncated one.
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "ev_brdf_lut_benchmark.bin";
+	const OceanBrdfLutDesc desc = options[3].desc;
+	const std::vector<uint8_t> texels = OceanBrdfLut::Generate(desc);
+	bool roundTrip = OceanBrdfLut::Store(path, desc, texels.data());
+	{
+		OceanBrdfLutBlob blob;
+		roundTrip = roundTrip && OceanBrdfLut::Load(path, blob) && blob.desc == desc &&
+			std::memcmp(blob.texels, texels.data(), texels.size()) == 0;
+	}
+	std::error_code error;
+	std::filesystem::resize_file(path, sizeof(uint32_t) * 8 + texels.size() - 1, error);
+	OceanBrdfLutBlob truncated;
+	const bool rejectsTruncated = !error && !OceanBrdfLut::Load(path, truncated);
+	std::filesystem::remove(path, error);
+	std::printf("  round trip %s, truncated %s\n", roundTrip ? "ok" : "FAILED", rejectsTruncated ? "ok" : "FAILED");
+
+	return accuracyPassed && roundTrip && rejectsTruncated;
+}
+
+bool OceanBenchmark::RunTransformHierarchy()
+{
+	using namespace DirectX;
+	std::printf("Transform hierarchy\n");
+
+	constexpr uint32_t NODE_COUNT = 100000;
+	constexpr uint32_t CHAIN_LENGTH = 1000;
+	uint32_t state = static_cast<uint32_t>(BENCHMARK_SEED);
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) * (1.0f / 16777216.0f); };
+	auto randomTransform = [&]()
+	{
+		return XMMatrixRotationRollPitchYaw(random() * 0.2f, random() * 0.2f, random() * 0.2f) *
+			XMMatrixTranslation(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+	};
+
+	// What SceneNode::GetWorldTransform used to do for every node: walk up to the root.
+	std::vector<TransformHierarchy::Handle> parents;
+	std::vector<XMMATRIX> locals;
+	std::function<XMMATRIX(TransformHierarchy::Handle)> recursiveWorld = [&](TransformHierarchy::Handle handle)
+	{
+		return parents[handle] == TransformHierarchy::InvalidHandle ? locals[handle] : XMMatrixMultiply(locals[handle], recursiveWorld(parents[handle]));
+	};
+	std::vector<XMMATRIX> references;
+	auto worldError = [&](TransformHierarchy& hierarchy, const std::vector<uint8_t>& alive)
+	{
+		float maxError = 0.0f;
+		for (TransformHierarchy::Handle handle = 0; handle < parents.size(); ++handle)
+		{
+			if (!alive[handle])
+				continue;
+			XMFLOAT4X4 reference, world;
+			XMStoreFloat4x4(&reference, references[handle]);
+			XMStoreFloat4x4(&world, hierarchy.GetWorldTransform(handle));
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					maxError = std::max(maxError, std::abs(reference.m[r][c] - world.m[r][c]));
+		}
+		return maxError;
+	};
+
+	// Random trees are wide and shallow (about 30 levels), chains are as deep as they get.
+	struct Shape
+	{
+		const char* name;
+		std::function<uint32_t(uint32_t)> parent;
+	};
+	const Shape shapes[] = {
+		{ "wide ", [&](uint32_t i) { return i == 0 ? TransformHierarchy::InvalidHandle : static_cast<uint32_t>(random() * i); } },
+		{ "deep ", [&](uint32_t i) { return i % CHAIN_LENGTH == 0 ? TransformHierarchy::InvalidHandle : i - 1; } },
+	};
+	bool passed = true;
+	for (const Shape& shape : shapes)
+	{
+		TransformHierarchy hierarchy;
+		parents.resize(NODE_COUNT);
+		locals.resize(NODE_COUNT);
+		for (uint32_t i = 0; i < NODE_COUNT; ++i)
+		{
+			parents[i] = shape.parent(i);
+			locals[i] = randomTransform();
+			hierarchy.Create(locals[i], parents[i]);
+		}
+
+		references.resize(NODE_COUNT);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < NODE_COUNT; ++i)
+			references[i] = recursiveWorld(i);
+		const double recursiveTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Every root changed, so every node is recomputed.
+		const double fullTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < NODE_COUNT; ++i)
+				if (parents[i] == TransformHierarchy::InvalidHandle)
+					hierarchy.SetLocalTransform(i, locals[i]);
+			hierarchy.Update();
+		});
+
+		// One node in a hundred changed, with its subtree.
+		std::vector<uint32_t> changed(NODE_COUNT / 100);
+		for (uint32_t& handle : changed)
+			handle = static_cast<uint32_t>(random() * NODE_COUNT);
+		const double partialTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t handle : changed)
+				hierarchy.SetLocalTransform(handle, locals[handle]);
+			hierarchy.Update();
+		});
+
+		const float error = worldError(hierarchy, std::vector<uint8_t>(NODE_COUNT, 1));
+		const bool shapePassed = error < 1e-5f;
+		passed &= shapePassed;
+		std::printf("  %s %u nodes: walking to the root %8.2f ms, update all %6.2f ms, 1%% changed %6.2f ms, %.1e off %s\n", shape.name, NODE_COUNT,
+		            recursiveTime, fullTime, partialTime, error, shapePassed ? "ok" : "FAILED");
+	}
+
+	// Reparenting in both directions, then releasing most nodes so the arrays compact.
+	TransformHierarchy hierarchy;
+	constexpr uint32_t EDIT_COUNT = 10000;
+	parents.resize(EDIT_COUNT);
+	locals.resize(EDIT_COUNT);
+	for (uint32_t i = 0; i < EDIT_COUNT; ++i)
+	{
+		parents[i] = i == 0 ? TransformHierarchy::InvalidHandle : static_cast<uint32_t>(random() * i);
+		locals[i] = randomTransform();
+		hierarchy.Create(locals[i], parents[i]);
+	}
+	auto isAncestor = [&](TransformHierarchy::Handle ancestor, TransformHierarchy::Handle handle)
+	{
+		for (; handle != TransformHierarchy::InvalidHandle; handle = parents[handle])
+			if (handle == ancestor)
+				return true;
+		return false;
+	};
+	for (uint32_t edit = 0; edit < 1000; ++edit)
+	{
+		const uint32_t handle = static_cast<uint32_t>(random() * EDIT_COUNT);
+		const uint32_t parent = random() < 0.1f ? TransformHierarchy::InvalidHandle : static_cast<uint32_t>(random() * EDIT_COUNT);
+		if (parent != TransformHierarchy::InvalidHandle && isAncestor(handle, parent))
+			continue;
+		parents[handle] = parent;
+		hierarchy.SetParent(handle, parent);
+	}
+	std::vector<uint8_t> alive(EDIT_COUNT, 1);
+	for (uint32_t handle = 0; handle < EDIT_COUNT; ++handle)
+	{
+		if (random() < 0.7f)
+		{
+			alive[handle] = 0;
+			hierarchy.Destroy(handle);
+			for (uint32_t& parent : parents)
+				if (parent == handle)
+					parent = TransformHierarchy::InvalidHandle;
+		}
+	}
+
+	bool ordered = true;
+	for (uint32_t handle = 0; handle < EDIT_COUNT; ++handle)
+	{
+		if (alive[handle])
+		{
+			const TransformHierarchy::Handle parent = hierarchy.GetParent(handle);
+			ordered &= parent == parents[handle] && (parent == TransformHierarchy::InvalidHandle || hierarchy.GetIndex(parent) < hierarchy.GetIndex(handle));
+		}
+	}
+	for (uint32_t handle = 0; handle < EDIT_COUNT; ++handle)
+		if (alive[handle])
+			references[handle] = recursiveWorld(handle);
+	const float editError = worldError(hierarchy, alive);
+
+	float inverseError = 0.0f;
+	for (uint32_t handle = 0; handle < EDIT_COUNT; ++handle)
+	{
+		if (!alive[handle])
+			continue;
+		XMFLOAT4X4 product;
+		XMStoreFloat4x4(&product, XMMatrixMultiply(hierarchy.GetWorldTransform(handle), hierarchy.GetInverseWorldTransform(handle)));
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				inverseError = std::max(inverseError, std::abs(product.m[r][c] - (r == c ? 1.0f : 0.0f)));
+	}
+
+	const bool editsPassed = ordered && editError < 1e-5f && hierarchy.GetSize() < EDIT_COUNT && inverseError < 1e-4f;
+	std::printf("  reparented and released: %u of %u slots live, parents first %s, %.1e off, inverse %.1e off %s\n", hierarchy.GetLiveCount(),
+	            hierarchy.GetSize(), ordered ? "yes" : "no", editError, inverseError, editsPassed ? "ok" : "FAILED");
+
+	return passed && editsPassed;
+}
+
+bool OceanBenchmark::RunSceneBVH()
+{
+	std::printf("Scene BVH\n");
+
+	uint32_t state = static_cast<uint32_t>(BENCHMARK_SEED);
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) * (1.0f / 16777216.0f); };
+	auto box = [](float x, float y, float z, float sx, float sy, float sz)
+	{
+		return BVHBox{ { x - sx, y - sy, z - sz }, { x + sx, y + sy, z + sz } };
+	};
+
+	// Layouts like the scenes the renderer loads: an atrium of the size and mesh
+	// count of Sponza (floor tiles, two storeys of columns and arches, drapes and
+	// clutter), a chess set on a table, and a city of 100k boxes.
+	std::vector<BVHBox> atrium;
+	for (int x = 0; x < 14; ++x)
+		for (int z = 0; z < 6; ++z)
+			atrium.push_back(box(x * 2.0f - 13.0f, 0.0f, z * 2.0f - 5.0f, 1.0f, 0.05f, 1.0f));
+	for (int storey = 0; storey < 2; ++storey)
+	{
+		for (int x = 0; x < 12; ++x)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				const float y = storey * 6.0f;
+				atrium.push_back(box(x * 2.2f - 12.1f, y + 2.5f, side * 4.0f, 0.3f, 2.5f, 0.3f));
+				atrium.push_back(box(x * 2.2f - 11.0f, y + 5.5f, side * 4.0f, 1.1f, 0.5f, 0.3f));
+				atrium.push_back(box(x * 2.2f - 11.0f, y + 5.5f, side * 5.5f, 1.1f, 0.1f, 1.5f));
+				if (storey == 1)
+					atrium.push_back(box(x * 2.2f - 11.0f, 9.0f, side * 3.7f, 0.9f, 2.0f, 0.05f));
+			}
+		}
+	}
+	while (atrium.size() < 380)
+		atrium.push_back(box(random() * 28.0f - 14.0f, random() * 12.0f, random() * 14.0f - 7.0f, 0.1f + random() * 0.4f, 0.1f + random() * 0.4f, 0.1f + random() * 0.4f));
+
+	std::vector<BVHBox> chess = { box(0.0f, -0.4f, 0.0f, 0.8f, 0.4f, 0.8f), box(0.0f, 0.01f, 0.0f, 0.3f, 0.01f, 0.3f) };
+	for (int side = 0; side < 2; ++side)
+	{
+		for (int file = 0; file < 8; ++file)
+		{
+			for (int rank = 0; rank < 2; ++rank)
+			{
+				const float height = rank == 0 ? 0.03f + 0.01f * (file % 4) : 0.02f;
+				const float z = (side == 0 ? rank : 7 - rank) * 0.075f - 0.2625f;
+				chess.push_back(box(file * 0.075f - 0.2625f, 0.02f + height, z, 0.02f, height, 0.02f));
+			}
+		}
+	}
+
+	std::vector<BVHBox> city(100000);
+	for (BVHBox& building : city)
+	{
+		const float size = 1.0f + random() * 4.0f;
+		building = box(random() * 4000.0f - 2000.0f, size, random() * 4000.0f - 2000.0f, size, size, size);
+	}
+
+	auto rayEnter = [](const BVHBox& b, const float origin[3], const float direction[3], float maxDistance)
+	{
+		float enter = 0.0f, exit = maxDistance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float inverse = 1.0f / direction[axis];
+			float t0 = ((&b.min.x)[axis] - origin[axis]) * inverse, t1 = ((&b.max.x)[axis] - origin[axis]) * inverse;
+			if (t0 > t1)
+				std::swap(t0, t1);
+			enter = std::max(enter, t0);
+			exit = std::min(exit, t1);
+		}
+		return enter <= exit ? enter : -1.0f;
+	};
+
+	struct Layout
+	{
+		const char* name;
+		const std::vector<BVHBox>* boxes;
+		float extent;  // Cameras, rays and spheres are placed within this distance of the origin.
+		float farDistance;
+	};
+	const Layout layouts[] = {
+		{ "atrium", &atrium, 12.0f, 40.0f },
+		{ "chess ", &chess, 0.6f, 4.0f },
+		{ "city  ", &city, 1800.0f, 600.0f },
+	};
+
+	bool passed = true;
+	for (const Layout& layout : layouts)
+	{
+		const std::vector<BVHBox>& boxes = *layout.boxes;
+		const uint32_t count = static_cast<uint32_t>(boxes.size());
+		BoundingVolumeHierarchy bvh;
+		const double buildTime = TimeMilliseconds([&]() { bvh.Build(boxes.data(), count); });
+
+		// The same queries through the tree and against every box.
+		constexpr uint32_t QUERY_COUNT = 64;
+		std::vector<float> cameras(QUERY_COUNT * 4), rays(QUERY_COUNT * 6), spheres(QUERY_COUNT * 4);
+		for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+		{
+			const float height = layout.extent * 0.2f * random();
+			cameras[i * 4 + 0] = (random() * 2.0f - 1.0f) * layout.extent;
+			cameras[i * 4 + 1] = height;
+			cameras[i * 4 + 2] = (random() * 2.0f - 1.0f) * layout.extent;
+			cameras[i * 4 + 3] = random() * 2.0f * PI;
+			const float yaw = random() * 2.0f * PI, pitch = (random() - 0.5f) * 0.5f;
+			const float ray[6] = { cameras[i * 4], height, cameras[i * 4 + 2], std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw) };
+			std::copy(ray, ray + 6, rays.begin() + i * 6);
+			spheres[i * 4 + 0] = (random() * 2.0f - 1.0f) * layout.extent;
+			spheres[i * 4 + 1] = height;
+			spheres[i * 4 + 2] = (random() * 2.0f - 1.0f) * layout.extent;
+			spheres[i * 4 + 3] = layout.extent * 0.05f;
+		}
+
+		std::vector<std::vector<uint32_t>> treeResults(QUERY_COUNT), bruteResults(QUERY_COUNT);
+		float planes[QUERY_COUNT][6][4];
+		for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			FrustumPlanes(&cameras[i * 4], cameras[i * 4 + 3], 0.4f, 0.1f, layout.farDistance, planes[i]);
+		const double frustumTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			{
+				treeResults[i].clear();
+				bvh.QueryFrustum(planes[i], treeResults[i]);
+			}
+		}) / QUERY_COUNT;
+		const double frustumBruteTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			{
+				bruteResults[i].clear();
+				for (uint32_t item = 0; item < count; ++item)
+					if (IsBoxVisible(planes[i], boxes[item]))
+						bruteResults[i].push_back(item);
+			}
+		}) / QUERY_COUNT;
+		bool frustumMatches = true;
+		size_t visible = 0;
+		for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+		{
+			std::sort(treeResults[i].begin(), treeResults[i].end());
+			frustumMatches &= treeResults[i] == bruteResults[i];
+			visible += bruteResults[i].size();
+		}
+
+		std::vector<float> treeHits(QUERY_COUNT), bruteHits(QUERY_COUNT);
+		const float maxDistance = layout.extent * 4.0f;
+		const double rayTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			{
+				const float* ray = &rays[i * 6];
+				uint32_t item;
+				float distance;
+				treeHits[i] = bvh.RayCast({ ray[0], ray[1], ray[2] }, { ray[3], ray[4], ray[5] }, maxDistance, item, distance) ? distance : -1.0f;
+			}
+		}) / QUERY_COUNT;
+		const double rayBruteTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			{
+				bruteHits[i] = -1.0f;
+				for (uint32_t item = 0; item < count; ++item)
+				{
+					const float distance = rayEnter(boxes[item], &rays[i * 6], &rays[i * 6 + 3], maxDistance);
+					if (distance >= 0.0f && (bruteHits[i] < 0.0f || distance < bruteHits[i]))
+						bruteHits[i] = distance;
+				}
+			}
+		}) / QUERY_COUNT;
+		bool raysMatch = true;
+		for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+			raysMatch &= std::abs(treeHits[i] - bruteHits[i]) <= 1e-4f * std::max(1.0f, std::abs(bruteHits[i]));
+
+		bool spheresMatch = true;
+		for (uint32_t i = 0; i < QUERY_COUNT; ++i)
+		{
+			const float* sphere = &spheres[i * 4];
+			std::vector<uint32_t> overlaps, reference;
+			bvh.QuerySphere({ sphere[0], sphere[1], sphere[2] }, sphere[3], overlaps);
+			for (uint32_t item = 0; item < count; ++item)
+			{
+				const BVHBox& b = boxes[item];
+				const float dx = std::max({ b.min.x - sphere[0], 0.0f, sphere[0] - b.max.x });
+				const float dy = std::max({ b.min.y - sphere[1], 0.0f, sphere[1] - b.max.y });
+				const float dz = std::max({ b.min.z - sphere[2], 0.0f, sphere[2] - b.max.z });
+				if (dx * dx + dy * dy + dz * dz <= sphere[3] * sphere[3])
+					reference.push_back(item);
+			}
+			std::sort(overlaps.begin(), overlaps.end());
+			spheresMatch &= overlaps == reference;
+		}
+
+		// Small motion refits fine, scattering the items is what a rebuild is for.
+		std::vector<BVHBox> moved = boxes;
+		for (BVHBox& b : moved)
+		{
+			const float dx = (random() - 0.5f) * layout.extent * 0.02f, dz = (random() - 0.5f) * layout.extent * 0.02f;
+			b = { { b.min.x + dx, b.min.y, b.min.z + dz }, { b.max.x + dx, b.max.y, b.max.z + dz } };
+		}
+		const double refitTime = TimeMilliseconds([&]() { bvh.Refit(moved.data()); });
+		const float smallMotion = bvh.GetCost() / bvh.GetBuildCost();
+		for (BVHBox& b : moved)
+		{
+			const float dx = (random() - 0.5f) * layout.extent * 2.0f, dz = (random() - 0.5f) * layout.extent * 2.0f;
+			b = { { b.min.x + dx, b.min.y, b.min.z + dz }, { b.max.x + dx, b.max.y, b.max.z + dz } };
+		}
+		bvh.Refit(moved.data());
+		const float scattered = bvh.GetCost() / bvh.GetBuildCost();
+		bvh.Build(moved.data(), count);
+		const bool degradationDetected = smallMotion < 1.5f && scattered > 1.5f;
+
+		const bool layoutPassed = frustumMatches && raysMatch && spheresMatch && degradationDetected;
+		passed &= layoutPassed;
+		std::printf("  %s %6u boxes: built in %7.2f ms, %u nodes, depth %u, cost %.1f, refit %.3f ms\n", layout.name, count, buildTime,
+		            static_cast<uint32_t>(bvh.GetNodes().size()), bvh.GetDepth(), bvh.GetBuildCost(), refitTime);
+		std::printf("         frustum %.4f ms (all boxes %.4f ms, %.0f visible), ray %.4f ms (%.4f ms), cost after refits %.2fx / %.2fx scattered %s\n",
+		            frustumTime, frustumBruteTime, double(visible) / QUERY_COUNT, rayTime, rayBruteTime, smallMotion, scattered, layoutPassed ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunFrustumCulling()
+{
+	std::printf("Frustum culling\n");
+
+	uint32_t state = static_cast<uint32_t>(BENCHMARK_SEED) + 1;
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) * (1.0f / 16777216.0f); };
+
+	// The mesh count of Sponza and a large imported scene, boxes spread over the
+	// extent the cameras look around in.
+	const struct { uint32_t count; float extent; float farDistance; } sets[] = { { 380, 15.0f, 40.0f }, { 100000, 2000.0f, 600.0f } };
+
+	bool passed = true;
+	for (const auto& set : sets)
+	{
+		std::vector<BVHBox> boxes(set.count);
+		for (BVHBox& box : boxes)
+		{
+			const float x = (random() * 2.0f - 1.0f) * set.extent, y = random() * set.extent * 0.2f, z = (random() * 2.0f - 1.0f) * set.extent;
+			const float size = set.extent * (0.002f + random() * 0.01f);
+			box = { { x - size, y - size, z - size }, { x + size, y + size, z + size } };
+		}
+		CullingBoxes culling;
+		culling.Assign(boxes.data(), set.count);
+		BoundingVolumeHierarchy bvh;
+		bvh.Build(boxes.data(), set.count);
+
+		constexpr uint32_t CAMERA_COUNT = 32;
+		float planes[CAMERA_COUNT][6][4];
+		for (uint32_t i = 0; i < CAMERA_COUNT; ++i)
+		{
+			const float position[3] = { (random() * 2.0f - 1.0f) * set.extent, set.extent * 0.1f, (random() * 2.0f - 1.0f) * set.extent };
+			FrustumPlanes(position, random() * 2.0f * PI, 0.4f, 0.1f, set.farDistance, planes[i]);
+		}
+
+		std::vector<uint8_t> kernel(set.count), scalar(set.count);
+		uint64_t visible = 0;
+		const double kernelTime = TimeMilliseconds([&]()
+		{
+			visible = 0;
+			for (uint32_t i = 0; i < CAMERA_COUNT; ++i)
+				visible += CullBoxes(planes[i], culling, kernel.data());
+		}) / CAMERA_COUNT;
+		const double scalarTime = TimeMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < CAMERA_COUNT; ++i)
+				for (uint32_t item = 0; item < set.count; ++item)
+					scalar[item] = IsBoxVisible(planes[i], boxes[item]);
+		}) / CAMERA_COUNT;
+
+		// Every camera on its own, the kernel against the scalar test and the BVH.
+		bool matches = true;
+		for (uint32_t i = 0; i < CAMERA_COUNT; ++i)
+		{
+			const uint32_t count = CullBoxes(planes[i], culling, kernel.data());
+			std::vector<uint32_t> treeItems;
+			bvh.QueryFrustum(planes[i], treeItems);
+			std::sort(treeItems.begin(), treeItems.end());
+
+			std::vector<uint32_t> kernelItems;
+			for (uint32_t item = 0; item < set.count; ++item)
+			{
+				matches &= kernel[item] == static_cast<uint8_t>(IsBoxVisible(planes[i], boxes[item]));
+				if (kernel[item])
+					kernelItems.push_back(item);
+			}
+			matches &= count == kernelItems.size() && kernelItems == treeItems;
+		}
+
+		passed &= matches;
+		const double visibleFraction = double(visible) / (double(CAMERA_COUNT) * set.count);
+		std::printf("  %6u boxes: kernel %.4f ms, scalar %.4f ms (%.1fx), %.1f%% visible %s\n",
+		            set.count, kernelTime, scalarTime, scalarTime / kernelTime, 100.0 * visibleFraction, matches ? "ok" : "FAILED");
+	}
+
+	return passed;
+}
+
+bool OceanBenchmark::RunDrawList()
+{
+	std::printf("Draw list\n");
+
+	uint32_t state = static_cast<uint32_t>(BENCHMARK_SEED) + 2;
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+	// The radix sort against a stable sort of the same keys, on keys that differ
+	// in every field and on keys that only differ in depth.
+	bool passed = true;
+	for (const bool depthOnly : { false, true })
+	{
+		DrawList list;
+		std::vector<DrawItem> reference;
+		for (uint32_t i = 0; i < 100000; ++i)
+		{
+			const uint64_t key = depthOnly ? DrawList::MakeKey(0, 0, 3, 7, (random() % 10000) * 0.01f)
+			                               : DrawList::MakeKey(random() % 2, random() % 4, random() % 300, random() % 2000, (random() % 10000) * 0.01f);
+			list.Add(key, i);
+			reference.push_back({ key, i });
+		}
+
+		std::vector<DrawItem> unsorted = reference;
+		std::stable_sort(reference.begin(), reference.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+		list.Sort();
+		bool matches = true;
+		for (size_t i = 0; i < reference.size(); ++i)
+			matches &= list.GetItems()[i].key == reference[i].key && list.GetItems()[i].payload == reference[i].payload;
+
+		const double radixTime = TimeMilliseconds([&]()
+		{
+			list.Clear();
+			for (const DrawItem& item : unsorted)
+				list.Add(item.key, item.payload);
+			list.Sort();
+		});
+		const double sortTime = TimeMilliseconds([&]()
+		{
+			reference = unsorted;
+			std::sort(reference.begin(), reference.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+		});
+		passed &= matches;
+		std::printf("  100k %s keys: radix sort %.3f ms, std::sort %.3f ms %s\n", depthOnly ? "depth only" : "mixed     ", radixTime, sortTime, matches ? "ok" : "FAILED");
+	}
+
+	// Depth sorts front to back, and never into the mesh above it.
+	const bool depthOrdered = DrawList::MakeKey(0, 0, 1, 1, 0.5f) < DrawList::MakeKey(0, 0, 1, 1, 2.0f) &&
+	                          DrawList::MakeKey(0, 0, 1, 1, 1e30f) < DrawList::MakeKey(0, 0, 1, 2, 0.0f) &&
+	                          DrawList::MakeKey(0, 0, 1, 1, -1.0f) == DrawList::MakeKey(0, 0, 1, 1, 0.0f);
+	passed &= depthOrdered;
+
+	// Material and mesh changes of draws as a scene graph lists them and sorted.
+	// The layouts follow the test scenes: Sponza's 25 materials over 380 meshes,
+	// the chess set's pieces sharing 6 meshes and 2 materials, and the ocean
+	// scene's ships and light spheres.
+	struct Layout
+	{
+		const char* name;
+		std::vector<std::pair<uint32_t, uint32_t>> draws;  // Material and mesh.
+	};
+	Layout layouts[3] = { { "sponza", {} }, { "chess ", {} }, { "ocean ", {} } };
+	for (uint32_t mesh = 0; mesh < 380; ++mesh)
+		layouts[0].draws.push_back({ random() % 25, mesh });
+	layouts[1].draws.push_back({ 2, 6 });
+	for (uint32_t piece = 0; piece < 32; ++piece)
+	{
+		const uint32_t kinds[16] = { 0, 1, 2, 3, 4, 2, 1, 0, 5, 5, 5, 5, 5, 5, 5, 5 };
+		layouts[1].draws.push_back({ (piece / 8) % 2, kinds[piece % 16] });
+	}
+	for (uint32_t ship = 0; ship < 64; ++ship)
+	{
+		layouts[2].draws.push_back({ 0, 0 });
+		layouts[2].draws.push_back({ 1, 1 });
+		layouts[2].draws.push_back({ 2, 2 });
+	}
+	layouts[2].draws.push_back({ 3, 3 });
+	for (uint32_t light = 0; light < 16; ++light)
+		layouts[2].draws.push_back({ 4, 4 });
+
+	for (const Layout& layout : layouts)
+	{
+		// A draw that changes neither continues the instanced draw before it.
+		auto countChanges = [](const std::vector<DrawItem>& items, uint32_t& outMaterials, uint32_t& outMeshes, uint32_t& outInstancedDraws)
+		{
+			outMaterials = outMeshes = outInstancedDraws = 0;
+			for (size_t i = 0; i < items.size(); ++i)
+			{
+				const bool material = i == 0 || DrawList::GetMaterial(items[i].key) != DrawList::GetMaterial(items[i - 1].key);
+				const bool mesh = i == 0 || DrawList::GetMesh(items[i].key) != DrawList::GetMesh(items[i - 1].key);
+				outMaterials += material;
+				outMeshes += mesh;
+				outInstancedDraws += material || mesh;
+			}
+		};
+
+		DrawList list;
+		for (uint32_t i = 0; i < layout.draws.size(); ++i)
+			list.Add(DrawList::MakeKey(0, 0, layout.draws[i].first, layout.draws[i].second, static_cast<float>(random() % 100)), i);
+		uint32_t sceneMaterials, sceneMeshes, sceneInstanced, sortedMaterials, sortedMeshes, sortedInstanced;
+		countChanges(list.GetItems(), sceneMaterials, sceneMeshes, sceneInstanced);
+		list.Sort();
+		countChanges(list.GetItems(), sortedMaterials, sortedMeshes, sortedInstanced);
+
+		std::printf("  %s %3zu draws: material changes %3u -> %3u, mesh changes %3u -> %3u, instanced %3u -> %3u draws\n",
+		            layout.name, layout.draws.size(), sceneMaterials, sortedMaterials, sceneMeshes, sortedMeshes, sceneInstanced, sortedInstanced);
+	}
+	std::printf("  depth order %s\n", depthOrdered ? "ok" : "FAILED");
+
+	return passed;
+}
+
+bool OceanBenchmark::RunDrawInstancing()
+{
+	std::printf("Draw instancing\n");
+
+	uint32_t state = static_cast<uint32_t>(BENCHMARK_SEED) + 3;
+	auto random = [&state]() { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+	// A draw as SceneVisitor records it, the ids stand in for the material and mesh
+	// pointers. Key ids wrap, so a material 1 << MaterialBits apart sorts as the same.
+	struct Draw
+	{
+		uint32_t material;
+		uint32_t mesh;
+	};
+	auto run = [&](const char* name, const std::vector<Draw>& draws, float maxDepth, uint32_t expectedBatches)
+	{
+		DrawList list;
+		std::vector<float> depths(draws.size());
+		for (uint32_t i = 0; i < draws.size(); ++i)
+		{
+			depths[i] = static_cast<float>(random() % 1000) * 0.001f * maxDepth;
+			list.Add(DrawList::MakeKey(0, 0, draws[i].material, draws[i].mesh, depths[i]), i);
+		}
+		list.Sort();
+
+		std::vector<DrawBatch> batches;
+		list.GetBatches([&draws](uint32_t a, uint32_t b) { return draws[a].material == draws[b].material && draws[a].mesh == draws[b].mesh; }, batches);
+
+		// The instance data is laid out in sorted order, so a batch's first instance
+		// is its first item: the batches have to tile the list, every instance of a
+		// batch has to draw its mesh and material, and neighbours have to differ.
+		const std::vector<DrawItem>& items = list.GetItems();
+		bool passed = batches.size() == expectedBatches;
+		uint32_t firstInstance = 0;
+		uint32_t instanced = 0;
+		for (size_t b = 0; b < batches.size(); ++b)
+		{
+			const DrawBatch& batch = batches[b];
+			const Draw& draw = draws[items[batch.firstItem].payload];
+			passed &= batch.firstItem == firstInstance && batch.count > 0;
+			for (uint32_t i = 0; i < batch.count; ++i)
+			{
+				const uint32_t payload = items[batch.firstItem + i].payload;
+				passed &= draws[payload].material == draw.material && draws[payload].mesh == draw.mesh;
+				// Front to back within the batch.
+				passed &= i == 0 || depths[items[batch.firstItem + i - 1].payload] <= depths[payload];
+			}
+			if (b > 0)
+			{
+				const Draw& previous = draws[items[batches[b - 1].firstItem].payload];
+				passed &= previous.material != draw.material || previous.mesh != draw.mesh;
+				// The batches keep the order of the sorted keys.
+				passed &= items[batches[b - 1].firstItem].key <= items[batch.firstItem].key;
+			}
+			firstInstance += batch.count;
+			instanced += batch.count > 1 ? batch.count : 0;
+		}
+		passed &= firstInstance == draws.size();
+
+		std::printf("  %s %3zu draws -> %3zu draws, %3u meshes instanced %s\n", name, draws.size(), batches.size(), instanced, passed ? "ok" : "FAILED");
+		return passed;
+	};
+
+	// The ocean scene: 64 ships of 3 parts and 16 light spheres, recorded interleaved.
+	std::vector<Draw> ocean;
+	for (uint32_t ship = 0; ship < 64; ++ship)
+	{
+		for (uint32_t part = 0; part < 3; ++part)
+			ocean.push_back({ part, part });
+		if (ship % 4 == 0)
+			ocean.push_back({ 4, 4 });
+	}
+
+	// Unique draws between repeated ones, a single draw stays a batch of one.
+	std::vector<Draw> mixed;
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		mixed.push_back({ 7, 2 });
+		mixed.push_back({ 10 + i, 100 + i });
+		if (i % 5 == 0)
+			mixed.push_back({ 7, 3 });
+	}
+
+	// Materials whose ids wrap onto the same key field are never merged. At one
+	// depth the keys are equal and the stable sort keeps them alternating.
+	std::vector<Draw> wrapped;
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		wrapped.push_back({ 1, 5 });
+		wrapped.push_back({ 1 + (1u << DrawList::MaterialBits), 5 });
+	}
+
+	bool passed = true;
+	passed &= run("ocean  ", ocean, 100.0f, 4);
+	passed &= run("mixed  ", mixed, 100.0f, 42);
+	passed &= run("wrapped", wrapped, 0.0f, 16);
+	return passed;
+}
+
+int OceanBenchmark::RunAll()
+{
+	bool passed = true;
+	passed &= RunNoise();
+	passed &= RunSpectrum();
+	passed &= RunSpectrumRebuild();
+	passed &= RunH0Cache();
+	passed &= RunCpuSimulator();
+	passed &= RunSurfaceQuery();
+	passed &= RunHalfPrecision();
+	passed &= RunCascadePlanner();
+	passed &= RunDisplacementBounds();
+	passed &= RunQuadtree();
+	passed &= RunCascadeMasking();
+	passed &= RunClip();
+	passed &= RunBuoyancy();
+	passed &= RunIrradiance();
+	passed &= RunIBLBake();
+	passed &= RunBrdfLut();
+	passed &= RunTransformHierarchy();
+	passed &= RunSceneBVH();
+	passed &= RunFrustumCulling();
+	passed &= RunDrawList();
+	passed &= RunDrawInstancing();
+
+	std::printf(passed ? "All benchmarks passed\n" : "Some benchmarks FAILED\n");
+	return passed ? 0 : 1;
+}
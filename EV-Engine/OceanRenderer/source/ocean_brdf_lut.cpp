@@ -0,0 +1,137 @@
+#include "ocean_brdf_lut.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "ocean_half.h"
+#include "ocean_ibl_baker.h"
+
+// Bump whenever the integration or the packing changes the output.
+#define OCEAN_BRDF_LUT_VERSION 1
+
+using namespace EV;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t LUT_MAGIC = 0x44524245; // "EBRD"
+
+	struct OceanBrdfLutFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t size;
+		uint32_t format;
+		uint32_t sampleCount;
+		uint32_t texelSize;
+		uint64_t payloadSize;
+	};
+	static_assert(sizeof(OceanBrdfLutFileHeader) == 32, "The header is part of the file format");
+}
+
+std::vector<uint8_t> OceanBrdfLut::Generate(const OceanBrdfLutDesc& desc)
+{
+	const std::vector<float> scaleBias = OceanIBLBaker::IntegrateBrdf(desc.size, desc.sampleCount);
+	return Encode(scaleBias.data(), desc);
+}
+
+std::vector<uint8_t> OceanBrdfLut::Encode(const float* scaleBias, const OceanBrdfLutDesc& desc)
+{
+	const size_t count = size_t(desc.size) * desc.size * 2;
+	std::vector<uint8_t> texels(desc.GetPayloadSize());
+	if (desc.format == OBF_Half)
+	{
+		OceanHalf::FromFloat(scaleBias, reinterpret_cast<uint16_t*>(texels.data()), count);
+	}
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
+			texels[i] = static_cast<uint8_t>(std::clamp(scaleBias[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+	return texels;
+}
+
+void OceanBrdfLut::Decode(const uint8_t* texels, const OceanBrdfLutDesc& desc, float* outScaleBias)
+{
+	const size_t count = size_t(desc.size) * desc.size * 2;
+	if (desc.format == OBF_Half)
+	{
+		std::vector<uint16_t> halves(count);
+		std::memcpy(halves.data(), texels, count * sizeof(uint16_t));
+		OceanHalf::ToFloat(halves.data(), outScaleBias, count);
+	}
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
+			outScaleBias[i] = texels[i] / 255.0f;
+	}
+}
+
+bool OceanBrdfLut::Store(const fs::path& path, const OceanBrdfLutDesc& desc, const uint8_t* texels)
+{
+	OceanBrdfLutFileHeader header = {};
+	header.magic = LUT_MAGIC;
+	header.version = OCEAN_BRDF_LUT_VERSION;
+	header.size = desc.size;
+	header.format = desc.format;
+	header.sampleCount = desc.sampleCount;
+	header.texelSize = desc.GetTexelSize();
+	header.payloadSize = desc.GetPayloadSize();
+
+	fs::path temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(texels), static_cast<std::streamsize>(header.payloadSize));
+		if (!file)
+		{
+			file.close();
+			std::error_code error;
+			fs::remove(temporaryPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(temporaryPath, path, error);
+	if (error)
+	{
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool OceanBrdfLut::Load(const fs::path& path, OceanBrdfLutBlob& outBlob)
+{
+	OceanMappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	OceanBrdfLutFileHeader header;
+	if (file.GetSize() < sizeof(header))
+		return false;
+	std::memcpy(&header, file.GetData(), sizeof(header));
+
+	OceanBrdfLutDesc desc;
+	desc.size = header.size;
+	desc.format = static_cast<OceanBrdfLutFormat>(header.format);
+	desc.sampleCount = header.sampleCount;
+	const bool valid = header.magic == LUT_MAGIC && header.version == OCEAN_BRDF_LUT_VERSION && header.size > 0 &&
+		(desc.format == OBF_Half || desc.format == OBF_Unorm8) && header.texelSize == desc.GetTexelSize() &&
+		header.payloadSize == desc.GetPayloadSize() && file.GetSize() == sizeof(header) + header.payloadSize;
+	if (!valid)
+		return false;
+
+	outBlob.file = std::move(file);
+	outBlob.desc = desc;
+	outBlob.texels = outBlob.file.GetData() + sizeof(header);
+	return true;
+}
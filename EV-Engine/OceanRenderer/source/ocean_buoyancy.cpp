@@ -0,0 +1,585 @@
+#include "ocean_buoyancy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "ocean_simd.h"
+#include "ocean_surface_query.h"
+#include "utility/thread_pool.h"
+
+using namespace EV;
+using namespace EV::simd;
+
+namespace
+{
+	constexpr uint32_t LANES = 4;
+	// Bodies per thread pool job.
+	constexpr uint32_t BODIES_PER_JOB = 16;
+	// Attempts VoxelizeHull makes to bring the probe count close to the maximum.
+	constexpr uint32_t VOXELIZE_ATTEMPTS = 8;
+
+	// Rotation matrix of a unit quaternion, row major, world = R local.
+	void RotationMatrix(const float q[4], float outR[9])
+	{
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+		outR[0] = 1.0f - 2.0f * (y * y + z * z);
+		outR[1] = 2.0f * (x * y - w * z);
+		outR[2] = 2.0f * (x * z + w * y);
+		outR[3] = 2.0f * (x * y + w * z);
+		outR[4] = 1.0f - 2.0f * (x * x + z * z);
+		outR[5] = 2.0f * (y * z - w * x);
+		outR[6] = 2.0f * (x * z - w * y);
+		outR[7] = 2.0f * (y * z + w * x);
+		outR[8] = 1.0f - 2.0f * (x * x + y * y);
+	}
+
+	void Multiply(const float m[9], const float v[3], float out[3])
+	{
+		out[0] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2];
+		out[1] = m[3] * v[0] + m[4] * v[1] + m[5] * v[2];
+		out[2] = m[6] * v[0] + m[7] * v[1] + m[8] * v[2];
+	}
+
+	void MultiplyTransposed(const float m[9], const float v[3], float out[3])
+	{
+		out[0] = m[0] * v[0] + m[3] * v[1] + m[6] * v[2];
+		out[1] = m[1] * v[0] + m[4] * v[1] + m[7] * v[2];
+		out[2] = m[2] * v[0] + m[5] * v[1] + m[8] * v[2];
+	}
+
+	bool Invert(const float m[9], float out[9])
+	{
+		const float c0 = m[4] * m[8] - m[5] * m[7];
+		const float c1 = m[5] * m[6] - m[3] * m[8];
+		const float c2 = m[3] * m[7] - m[4] * m[6];
+		const float determinant = m[0] * c0 + m[1] * c1 + m[2] * c2;
+		if (!(std::abs(determinant) > 0.0f))
+			return false;
+
+		const float inverse = 1.0f / determinant;
+		out[0] = c0 * inverse;
+		out[1] = (m[2] * m[7] - m[1] * m[8]) * inverse;
+		out[2] = (m[1] * m[5] - m[2] * m[4]) * inverse;
+		out[3] = c1 * inverse;
+		out[4] = (m[0] * m[8] - m[2] * m[6]) * inverse;
+		out[5] = (m[2] * m[3] - m[0] * m[5]) * inverse;
+		out[6] = c2 * inverse;
+		out[7] = (m[1] * m[6] - m[0] * m[7]) * inverse;
+		out[8] = (m[0] * m[4] - m[1] * m[3]) * inverse;
+		return true;
+	}
+
+	float HorizontalSum(Vec4 v)
+	{
+		alignas(16) float lanes[LANES];
+		_mm_store_ps(lanes, v);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+
+	// Twice the signed area of (a, b, p) in the xz plane. Evaluated in the same
+	// vertex order whichever way round the edge is passed, so the triangles on
+	// both sides of an edge agree exactly on which side a point is.
+	float Edge(const float* a, const float* b, float px, float pz)
+	{
+		if (a[0] > b[0] || (a[0] == b[0] && a[2] > b[2]))
+			return -Edge(b, a, px, pz);
+		return (b[0] - a[0]) * (pz - a[2]) - (b[2] - a[2]) * (px - a[0]);
+	}
+
+	// Whether a point is on the inner side of a counter clockwise edge. A point
+	// on the edge belongs to one of the two triangles sharing it (the top-left
+	// rule of rasterizers), so a line through an edge crosses the surface once.
+	bool Covers(const float* a, const float* b, float edge)
+	{
+		if (edge != 0.0f)
+			return edge > 0.0f;
+		const float dx = b[0] - a[0], dz = b[2] - a[2];
+		return dz < 0.0f || (dz == 0.0f && dx > 0.0f);
+	}
+
+	// Voxels of edge size on a grid centred on the bounds.
+	void Voxelize(const float* positions, const uint32_t* indices, uint32_t indexCount, const float boundsMin[3], const float boundsMax[3],
+	              float size, OceanBuoyancyHull& outHull)
+	{
+		uint32_t cells[3];
+		float origin[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float extent = boundsMax[axis] - boundsMin[axis];
+			cells[axis] = std::max(1u, static_cast<uint32_t>(std::ceil(extent / size)));
+			origin[axis] = 0.5f * (boundsMin[axis] + boundsMax[axis] - cells[axis] * size);
+		}
+
+		// Heights where the vertical line through every column centre crosses the surface.
+		std::vector<std::vector<float>> crossings(static_cast<size_t>(cells[0]) * cells[2]);
+		for (uint32_t t = 0; t + 2 < indexCount; t += 3)
+		{
+			const float* a = positions + indices[t] * 3;
+			const float* b = positions + indices[t + 1] * 3;
+			const float* c = positions + indices[t + 2] * 3;
+
+			float area = Edge(a, b, c[0], c[2]);
+			if (area < 0.0f)
+			{
+				std::swap(b, c);
+				area = -area;
+			}
+			if (!(area > 0.0f))
+				continue;
+
+			// Columns whose centre (origin + (i + 0.5) size) lies within the triangle's bounds.
+			const float minX = std::min({ a[0], b[0], c[0] }), maxX = std::max({ a[0], b[0], c[0] });
+			const float minZ = std::min({ a[2], b[2], c[2] }), maxZ = std::max({ a[2], b[2], c[2] });
+			const int beginX = std::max(0, static_cast<int>(std::ceil((minX - origin[0]) / size - 0.5f)));
+			const int endX = std::min(static_cast<int>(cells[0]) - 1, static_cast<int>(std::floor((maxX - origin[0]) / size - 0.5f)));
+			const int beginZ = std::max(0, static_cast<int>(std::ceil((minZ - origin[2]) / size - 0.5f)));
+			const int endZ = std::min(static_cast<int>(cells[2]) - 1, static_cast<int>(std::floor((maxZ - origin[2]) / size - 0.5f)));
+
+			for (int k = beginZ; k <= endZ; ++k)
+			{
+				const float pz = origin[2] + (k + 0.5f) * size;
+				for (int i = beginX; i <= endX; ++i)
+				{
+					const float px = origin[0] + (i + 0.5f) * size;
+					const float ea = Edge(b, c, px, pz);
+					const float eb = Edge(c, a, px, pz);
+					const float ec = Edge(a, b, px, pz);
+					if (!Covers(b, c, ea) || !Covers(c, a, eb) || !Covers(a, b, ec))
+						continue;
+
+					const float y = (ea * a[1] + eb * b[1] + ec * c[1]) / area;
+					crossings[static_cast<size_t>(k) * cells[0] + i].push_back(y);
+				}
+			}
+		}
+
+		// Inside lies between the first and second crossing, the third and
+		// fourth and so on. An odd count means the mesh is open along the
+		// line, a hole or a missing deck. An open hull keeps the water out up
+		// to its rim, so everything from the lowest crossing up is taken.
+		outHull.probeX.clear();
+		outHull.probeY.clear();
+		outHull.probeZ.clear();
+		outHull.probeSize = size;
+		for (uint32_t k = 0; k < cells[2]; ++k)
+		{
+			for (uint32_t i = 0; i < cells[0]; ++i)
+			{
+				std::vector<float>& column = crossings[static_cast<size_t>(k) * cells[0] + i];
+				if (column.empty())
+					continue;
+				std::sort(column.begin(), column.end());
+				if (column.size() & 1)
+					column = { column.front(), boundsMax[1] };
+
+				for (uint32_t j = 0; j < cells[1]; ++j)
+				{
+					const float py = origin[1] + (j + 0.5f) * size;
+					bool inside = false;
+					for (size_t interval = 0; interval < column.size() && !inside; interval += 2)
+						inside = py >= column[interval] && py <= column[interval + 1];
+					if (!inside)
+						continue;
+					outHull.probeX.push_back(origin[0] + (i + 0.5f) * size);
+					outHull.probeY.push_back(py);
+					outHull.probeZ.push_back(origin[2] + (k + 0.5f) * size);
+				}
+			}
+		}
+	}
+}
+
+OceanBuoyancy::~OceanBuoyancy()
+{
+	Wait();
+}
+
+OceanBuoyancyHull OceanBuoyancy::VoxelizeHull(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                                              uint32_t maxProbes)
+{
+	assert(maxProbes > 0);
+
+	OceanBuoyancyHull hull;
+	if (vertexCount == 0 || indexCount < 3)
+		return hull;
+
+	float boundsMin[3], boundsMax[3];
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		boundsMin[axis] = std::numeric_limits<float>::infinity();
+		boundsMax[axis] = -std::numeric_limits<float>::infinity();
+	}
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], positions[indices[i] * 3 + axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], positions[indices[i] * 3 + axis]);
+		}
+	}
+
+	// Start from voxels that split the bounds into maxProbes cells and scale
+	// them with the cube root of the miss. Keep the fullest hull that fits.
+	const float extentX = boundsMax[0] - boundsMin[0];
+	const float extentY = boundsMax[1] - boundsMin[1];
+	const float extentZ = boundsMax[2] - boundsMin[2];
+	const float largest = std::max({ extentX, extentY, extentZ });
+	if (!(largest > 0.0f))
+		return hull;
+	const float thickness = 1e-3f * largest;
+	float size = std::cbrt(std::max(extentX, thickness) * std::max(extentY, thickness) * std::max(extentZ, thickness) / maxProbes);
+
+	OceanBuoyancyHull attempt;
+	for (uint32_t i = 0; i < VOXELIZE_ATTEMPTS; ++i)
+	{
+		Voxelize(positions, indices, indexCount, boundsMin, boundsMax, size, attempt);
+		const size_t count = attempt.probeX.size();
+		if (count <= maxProbes && count > hull.probeX.size())
+			hull = attempt;
+		if (count == 0)
+			size *= 0.5f;
+		else if (count > maxProbes)
+			size *= 1.01f * std::cbrt(static_cast<float>(count) / maxProbes);
+		else if (count > 0.9f * maxProbes)
+			break;
+		else
+			size *= std::cbrt(static_cast<float>(count) / maxProbes);
+	}
+
+	const size_t count = hull.probeX.size();
+	if (count == 0)
+		return hull;
+
+	hull.volume = count * hull.probeSize * hull.probeSize * hull.probeSize;
+
+	double centroid[3] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		centroid[0] += hull.probeX[i];
+		centroid[1] += hull.probeY[i];
+		centroid[2] += hull.probeZ[i];
+	}
+	for (uint32_t axis = 0; axis < 3; ++axis)
+		hull.centroid[axis] = static_cast<float>(centroid[axis] / count);
+
+	// Point masses at the voxel centres, plus the s^2 / 6 a cube of edge s has about its own centre.
+	double inertia[9] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		const double x = (hull.probeX[i] -= hull.centroid[0]);
+		const double y = (hull.probeY[i] -= hull.centroid[1]);
+		const double z = (hull.probeZ[i] -= hull.centroid[2]);
+		inertia[0] += y * y + z * z;
+		inertia[4] += x * x + z * z;
+		inertia[8] += x * x + y * y;
+		inertia[1] -= x * y;
+		inertia[2] -= x * z;
+		inertia[5] -= y * z;
+	}
+	inertia[3] = inertia[1];
+	inertia[6] = inertia[2];
+	inertia[7] = inertia[5];
+
+	const double cube = hull.probeSize * hull.probeSize / 6.0;
+	for (uint32_t i = 0; i < 9; ++i)
+		hull.inertia[i] = static_cast<float>(inertia[i] / count + (i % 4 == 0 ? cube : 0.0));
+
+	return hull;
+}
+
+void OceanBuoyancy::SetSettings(const OceanBuoyancySettings& settings)
+{
+	assert(settings.timeStep > 0.0f && settings.maxSteps > 0);
+
+	Wait();
+	m_settings = settings;
+}
+
+uint32_t OceanBuoyancy::AddBody(const OceanBuoyancyBodyDesc& desc)
+{
+	assert(desc.hull && desc.mass > 0.0f);
+
+	Wait();
+
+	const OceanBuoyancyHull& hull = *desc.hull;
+	const float* d = desc.centerOfMassOffset;
+
+	Body body = {};
+	body.probeBegin = static_cast<uint32_t>(m_probeVolume.size());
+	body.probeSize = hull.probeSize;
+	body.inverseMass = 1.0f / desc.mass;
+
+	// Parallel axis theorem, from the centroid to the centre of mass.
+	float inertia[9];
+	const float dd = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+	for (uint32_t row = 0; row < 3; ++row)
+	{
+		for (uint32_t column = 0; column < 3; ++column)
+			inertia[row * 3 + column] = desc.mass * (hull.inertia[row * 3 + column] + (row == column ? dd : 0.0f) - d[row] * d[column]);
+	}
+	if (!Invert(inertia, body.inverseInertia))
+		std::fill(std::begin(body.inverseInertia), std::end(body.inverseInertia), 0.0f);
+
+	std::copy(desc.position, desc.position + 3, body.position);
+	std::copy(desc.rotation, desc.rotation + 4, body.rotation);
+	std::copy(desc.position, desc.position + 3, body.previousPosition);
+	std::copy(desc.rotation, desc.rotation + 4, body.previousRotation);
+
+	const size_t count = hull.probeX.size();
+	const size_t padded = (count + LANES - 1) / LANES * LANES;
+	const float probeVolume = hull.probeSize * hull.probeSize * hull.probeSize;
+	for (size_t i = 0; i < padded; ++i)
+	{
+		m_localX.push_back(i < count ? hull.probeX[i] - d[0] : 0.0f);
+		m_localY.push_back(i < count ? hull.probeY[i] - d[1] : 0.0f);
+		m_localZ.push_back(i < count ? hull.probeZ[i] - d[2] : 0.0f);
+		m_probeVolume.push_back(i < count ? probeVolume : 0.0f);
+	}
+	body.probeEnd = static_cast<uint32_t>(m_probeVolume.size());
+
+	const size_t probes = m_probeVolume.size();
+	m_offsetX.resize(probes);
+	m_offsetY.resize(probes);
+	m_offsetZ.resize(probes);
+	m_worldX.resize(probes);
+	m_worldZ.resize(probes);
+	m_waterHeight.resize(probes);
+
+	m_bodies.push_back(body);
+	return static_cast<uint32_t>(m_bodies.size() - 1);
+}
+
+void OceanBuoyancy::Clear()
+{
+	Wait();
+
+	m_bodies.clear();
+	for (std::vector<float>* probes : { &m_localX, &m_localY, &m_localZ, &m_offsetX, &m_offsetY, &m_offsetZ,
+	                                     &m_worldX, &m_worldZ, &m_waterHeight, &m_probeVolume })
+		probes->clear();
+	m_accumulator = 0.0;
+}
+
+void OceanBuoyancy::Update(const OceanCpuSimulator& simulator, float frameTime)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const double timeStep = m_settings.timeStep;
+	m_accumulator += std::max(frameTime, 0.0f);
+
+	m_lastSteps = 0;
+	while (m_accumulator >= timeStep && m_lastSteps < m_settings.maxSteps)
+	{
+		Step(simulator);
+		m_accumulator -= timeStep;
+		++m_lastSteps;
+	}
+	// Time that doesn't fit in maxSteps is dropped.
+	m_accumulator = std::min(m_accumulator, timeStep);
+
+	m_updateTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void OceanBuoyancy::UpdateAsync(const OceanCpuSimulator& simulator, float frameTime)
+{
+	Wait();
+	m_task = std::async(std::launch::async, [this, &simulator, frameTime]() { Update(simulator, frameTime); });
+}
+
+void OceanBuoyancy::Wait()
+{
+	if (m_task.valid())
+		m_task.get();
+}
+
+OceanBuoyancyPose OceanBuoyancy::GetPose(uint32_t bodyIndex) const
+{
+	const Body& body = m_bodies[bodyIndex];
+	const float t = GetInterpolation();
+
+	OceanBuoyancyPose pose;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+		pose.position[axis] = body.previousPosition[axis] + (body.position[axis] - body.previousPosition[axis]) * t;
+
+	// Normalized lerp along the shorter arc, the rotation of one step is small.
+	const float* a = body.previousRotation;
+	const float* b = body.rotation;
+	const float sign = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f ? -1.0f : 1.0f;
+	float length = 0.0f;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		pose.rotation[i] = a[i] + (sign * b[i] - a[i]) * t;
+		length += pose.rotation[i] * pose.rotation[i];
+	}
+	const float inverseLength = 1.0f / std::sqrt(length);
+	for (uint32_t i = 0; i < 4; ++i)
+		pose.rotation[i] *= inverseLength;
+
+	return pose;
+}
+
+void OceanBuoyancy::GetVelocity(uint32_t bodyIndex, float outLinear[3], float outAngular[3]) const
+{
+	const Body& body = m_bodies[bodyIndex];
+	std::copy(body.linearVelocity, body.linearVelocity + 3, outLinear);
+	std::copy(body.angularVelocity, body.angularVelocity + 3, outAngular);
+}
+
+void OceanBuoyancy::Step(const OceanCpuSimulator& simulator)
+{
+	const uint32_t bodyCount = GetBodyCount();
+	if (bodyCount == 0)
+		return;
+
+	ThreadPool::Get().ParallelFor(0, bodyCount, BODIES_PER_JOB, [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t body = begin; body < end; ++body)
+				TransformProbes(body);
+		});
+
+	// The water above every probe of every body in one batch.
+	OceanSurfaceQuery query;
+	query.x = m_worldX.data();
+	query.z = m_worldZ.data();
+	query.count = GetProbeCount();
+	query.height = m_waterHeight.data();
+	query.iterations = m_settings.queryIterations;
+	OceanSurface::Query(simulator, query);
+
+	ThreadPool::Get().ParallelFor(0, bodyCount, BODIES_PER_JOB, [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t body = begin; body < end; ++body)
+				Integrate(body);
+		});
+	++m_stepCount;
+}
+
+void OceanBuoyancy::TransformProbes(uint32_t bodyIndex)
+{
+	const Body& body = m_bodies[bodyIndex];
+
+	float R[9];
+	RotationMatrix(body.rotation, R);
+	Vec4 r[9];
+	for (uint32_t i = 0; i < 9; ++i)
+		r[i] = Set(R[i]);
+	const Vec4 positionX = Set(body.position[0]);
+	const Vec4 positionZ = Set(body.position[2]);
+
+	for (uint32_t i = body.probeBegin; i < body.probeEnd; i += LANES)
+	{
+		const Vec4 x = Load(&m_localX[i]);
+		const Vec4 y = Load(&m_localY[i]);
+		const Vec4 z = Load(&m_localZ[i]);
+
+		const Vec4 offsetX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], x), _mm_mul_ps(r[1], y)), _mm_mul_ps(r[2], z));
+		const Vec4 offsetY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[3], x), _mm_mul_ps(r[4], y)), _mm_mul_ps(r[5], z));
+		const Vec4 offsetZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[6], x), _mm_mul_ps(r[7], y)), _mm_mul_ps(r[8], z));
+
+		Store(&m_offsetX[i], offsetX);
+		Store(&m_offsetY[i], offsetY);
+		Store(&m_offsetZ[i], offsetZ);
+		Store(&m_worldX[i], _mm_add_ps(positionX, offsetX));
+		Store(&m_worldZ[i], _mm_add_ps(positionZ, offsetZ));
+	}
+}
+
+void OceanBuoyancy::Integrate(uint32_t bodyIndex)
+{
+	Body& body = m_bodies[bodyIndex];
+	const float dt = m_settings.timeStep;
+
+	// A probe is a voxel of edge probeSize around its centre, the part below
+	// the water is submerged. It's pushed up with the weight of that water and
+	// dragged against the velocity of its centre, v + w x r.
+	const Vec4 zero = _mm_setzero_ps();
+	const Vec4 one = Set(1.0f);
+	const Vec4 positionY = Set(body.position[1]);
+	const Vec4 inverseSize = Set(1.0f / body.probeSize);
+	const Vec4 half = Set(0.5f);
+	const Vec4 density = Set(m_settings.waterDensity);
+	const Vec4 gravity = Set(m_settings.gravity);
+	const Vec4 drag = Set(m_settings.drag);
+	const Vec4 vx = Set(body.linearVelocity[0]), vy = Set(body.linearVelocity[1]), vz = Set(body.linearVelocity[2]);
+	const Vec4 wx = Set(body.angularVelocity[0]), wy = Set(body.angularVelocity[1]), wz = Set(body.angularVelocity[2]);
+
+	Vec4 forceX = zero, forceY = zero, forceZ = zero;
+	Vec4 torqueX = zero, torqueY = zero, torqueZ = zero;
+	Vec4 submerged = zero;
+	for (uint32_t i = body.probeBegin; i < body.probeEnd; i += LANES)
+	{
+		const Vec4 rx = Load(&m_offsetX[i]);
+		const Vec4 ry = Load(&m_offsetY[i]);
+		const Vec4 rz = Load(&m_offsetZ[i]);
+
+		const Vec4 depth = _mm_sub_ps(Load(&m_waterHeight[i]), _mm_add_ps(positionY, ry));
+		const Vec4 fraction = Min(Max(_mm_add_ps(_mm_mul_ps(depth, inverseSize), half), zero), one);
+		const Vec4 volume = _mm_mul_ps(Load(&m_probeVolume[i]), fraction);
+		const Vec4 mass = _mm_mul_ps(density, volume);
+		submerged = _mm_add_ps(submerged, volume);
+
+		const Vec4 ux = _mm_add_ps(vx, _mm_sub_ps(_mm_mul_ps(wy, rz), _mm_mul_ps(wz, ry)));
+		const Vec4 uy = _mm_add_ps(vy, _mm_sub_ps(_mm_mul_ps(wz, rx), _mm_mul_ps(wx, rz)));
+		const Vec4 uz = _mm_add_ps(vz, _mm_sub_ps(_mm_mul_ps(wx, ry), _mm_mul_ps(wy, rx)));
+
+		const Vec4 fx = _mm_mul_ps(mass, _mm_mul_ps(drag, _mm_sub_ps(zero, ux)));
+		const Vec4 fy = _mm_mul_ps(mass, _mm_sub_ps(gravity, _mm_mul_ps(drag, uy)));
+		const Vec4 fz = _mm_mul_ps(mass, _mm_mul_ps(drag, _mm_sub_ps(zero, uz)));
+
+		forceX = _mm_add_ps(forceX, fx);
+		forceY = _mm_add_ps(forceY, fy);
+		forceZ = _mm_add_ps(forceZ, fz);
+		torqueX = _mm_add_ps(torqueX, _mm_sub_ps(_mm_mul_ps(ry, fz), _mm_mul_ps(rz, fy)));
+		torqueY = _mm_add_ps(torqueY, _mm_sub_ps(_mm_mul_ps(rz, fx), _mm_mul_ps(rx, fz)));
+		torqueZ = _mm_add_ps(torqueZ, _mm_sub_ps(_mm_mul_ps(rx, fy), _mm_mul_ps(ry, fx)));
+	}
+
+	const float force[3] = { HorizontalSum(forceX), HorizontalSum(forceY), HorizontalSum(forceZ) };
+	const float torque[3] = { HorizontalSum(torqueX), HorizontalSum(torqueY), HorizontalSum(torqueZ) };
+	body.submergedVolume = HorizontalSum(submerged);
+
+	std::copy(body.position, body.position + 3, body.previousPosition);
+	std::copy(body.rotation, body.rotation + 4, body.previousRotation);
+
+	// Semi-implicit Euler, the velocities first and the pose with the new
+	// ones. The world inverse inertia is R I^-1 R^T. The gyroscopic term is
+	// left out, floating bodies turn slowly.
+	body.linearVelocity[0] += force[0] * body.inverseMass * dt;
+	body.linearVelocity[1] += (force[1] * body.inverseMass - m_settings.gravity) * dt;
+	body.linearVelocity[2] += force[2] * body.inverseMass * dt;
+
+	float R[9];
+	RotationMatrix(body.rotation, R);
+	float localTorque[3], localAcceleration[3], acceleration[3];
+	MultiplyTransposed(R, torque, localTorque);
+	Multiply(body.inverseInertia, localTorque, localAcceleration);
+	Multiply(R, localAcceleration, acceleration);
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		body.angularVelocity[axis] += acceleration[axis] * dt;
+		body.position[axis] += body.linearVelocity[axis] * dt;
+	}
+
+	// dq/dt = (w, 0) q / 2
+	const float* w = body.angularVelocity;
+	float* q = body.rotation;
+	const float dq[4] = {
+		q[3] * w[0] + w[1] * q[2] - w[2] * q[1],
+		q[3] * w[1] + w[2] * q[0] - w[0] * q[2],
+		q[3] * w[2] + w[0] * q[1] - w[1] * q[0],
+		-(w[0] * q[0] + w[1] * q[1] + w[2] * q[2]),
+	};
+	float length = 0.0f;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		q[i] += 0.5f * dt * dq[i];
+		length += q[i] * q[i];
+	}
+	const float inverseLength = 1.0f / std::sqrt(length);
+	for (uint32_t i = 0; i < 4; ++i)
+		q[i] *= inverseLength;
+}
@@ -0,0 +1,156 @@
+#include "ocean_cascade_planner.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#define PI 3.14159265359f
+
+using namespace EV;
+
+namespace
+{
+	// Samples of the energy integral. |k| is sampled logarithmically, the
+	// spectrum spans many decades within a single cascade.
+	constexpr uint32_t RADIAL_SAMPLES = 256;
+	constexpr uint32_t ANGULAR_SAMPLES = 64;
+
+	// Low cutoff of the first cascade, as Ocean::GenerateH0 always used.
+	constexpr float FIRST_LOW_CUTOFF = 0.001f;
+
+	float NyquistLimit(uint32_t resolution, float patchSize)
+	{
+		return resolution * PI / patchSize;
+	}
+}
+
+OceanCascadePlan OceanCascadePlanner::Plan(const JonswapParameters& params, const std::vector<uint32_t>& resolutions,
+                                           const OceanCascadePlannerSettings& settings)
+{
+	assert(!resolutions.empty() && resolutions.size() <= 32);
+	assert(settings.smallestPatchSize > 0.0f && settings.smallestPatchSize <= settings.largestPatchSize);
+
+	const uint32_t count = static_cast<uint32_t>(resolutions.size());
+	const float ratio = count > 1 ? std::pow(settings.largestPatchSize / settings.smallestPatchSize, 1.0f / (count - 1)) : 1.0f;
+
+	OceanCascadePlan plan;
+	plan.cascades.resize(count);
+	plan.heightEnergy.resize(count);
+	plan.slopeEnergy.resize(count);
+
+	float patchSize = settings.largestPatchSize;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		OceanCascadeDesc& desc = plan.cascades[i];
+		desc.resolution = resolutions[i];
+		desc.depth = settings.depth;
+
+		if (i == 0)
+		{
+			desc.lowCutoff = FIRST_LOW_CUTOFF;
+			desc.patchSize = patchSize;
+		}
+		else
+		{
+			// Continue where the previous cascade stopped. The cutoff sits
+			// lowCutoff * patchSize / 2pi texels from the origin, keep that
+			// between the minimum and a quarter of the resolution, so the
+			// cascade neither undersamples its longest waves nor ends up empty
+			// when it runs at a much lower resolution than the one before.
+			desc.lowCutoff = plan.cascades[i - 1].highCutoff;
+			patchSize /= ratio;
+
+			const float texelsPerK = 1.0f / (2.0f * PI);
+			const float minPatchSize = settings.minLowCutoffTexels / (desc.lowCutoff * texelsPerK);
+			const float maxPatchSize = 0.25f * desc.resolution / (desc.lowCutoff * texelsPerK);
+			desc.patchSize = std::clamp(patchSize, minPatchSize, std::max(minPatchSize, maxPatchSize));
+		}
+
+		desc.highCutoff = NyquistLimit(desc.resolution, desc.patchSize);
+		IntegrateEnergy(params, desc.lowCutoff, desc.highCutoff, desc.depth, plan.heightEnergy[i], plan.slopeEnergy[i]);
+	}
+
+	float totalHeight = 0.0f;
+	float totalSlope = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		totalHeight += plan.heightEnergy[i];
+		totalSlope += plan.slopeEnergy[i];
+	}
+
+	plan.activeMask = 1;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		const bool carriesHeight = totalHeight > 0.0f && plan.heightEnergy[i] >= settings.minEnergyFraction * totalHeight;
+		const bool carriesSlope = totalSlope > 0.0f && plan.slopeEnergy[i] >= settings.minEnergyFraction * totalSlope;
+		if (carriesHeight || carriesSlope)
+			plan.activeMask |= 1u << i;
+	}
+
+	return plan;
+}
+
+void OceanCascadePlanner::IntegrateEnergy(const JonswapParameters& params, float lowK, float highK, float depth,
+                                          float& outHeight, float& outSlope)
+{
+	outHeight = 0.0f;
+	outSlope = 0.0f;
+	if (!(highK > lowK) || lowK <= 0.0f)
+		return;
+
+	// BuildH0 gives every texel a squared amplitude of 2 S(omega) D(theta, omega) fade |domega/dk| / k dk^2
+	// and multiplies it with complex noise of variance 2. A texel covers dk^2 = k dk dtheta, so
+	// E[sum |H0|^2] = integral of 4 S D fade |domega/dk| dk dtheta, and k dk = k^2 d(ln k) for the log sampling.
+	const float logLow = std::log(lowK);
+	const float logStep = (std::log(highK) - logLow) / (RADIAL_SAMPLES - 1);
+	const float angleStep = 2.0f * PI / ANGULAR_SAMPLES;
+
+	double height = 0.0;
+	double slope = 0.0;
+	for (uint32_t i = 0; i < RADIAL_SAMPLES; ++i)
+	{
+		const float k = std::exp(logLow + i * logStep);
+		const float omega = OceanSpectrum::DispersionRelation(k, depth);
+
+		// The directional term is periodic, the midpoint rule is exact enough.
+		float directional = 0.0f;
+		for (uint32_t j = 0; j < ANGULAR_SAMPLES; ++j)
+			directional += OceanSpectrum::DirectionSpectrum(params, -PI + (j + 0.5f) * angleStep, omega);
+		directional *= angleStep;
+
+		const float spectrum = OceanSpectrum::JONSWAP(params, omega, depth) * OceanSpectrum::ShortWavesFade(params, k);
+		const float density = 4.0f * spectrum * std::max(directional, 0.0f) * std::abs(OceanSpectrum::DispersionDerivative(k, depth)) * k;
+
+		const float weight = (i == 0 || i == RADIAL_SAMPLES - 1) ? 0.5f * logStep : logStep;
+		height += static_cast<double>(density) * weight;
+		slope += static_cast<double>(density) * k * k * weight;
+	}
+
+	outHeight = static_cast<float>(height);
+	outSlope = static_cast<float>(slope);
+}
+
+void OceanCascadePlanner::MeasureEnergy(const OceanCascadeDesc& cascade, const float* packedH0, float& outHeight, float& outSlope)
+{
+	const uint32_t N = cascade.resolution;
+	const float deltaK = 2.0f * PI / cascade.patchSize;
+
+	double height = 0.0;
+	double slope = 0.0;
+	for (uint32_t m = 0; m < N; ++m)
+	{
+		const float ky = (m - N / 2.0f) * deltaK;
+		for (uint32_t n = 0; n < N; ++n)
+		{
+			const float kx = (n - N / 2.0f) * deltaK;
+			const float* texel = packedH0 + (static_cast<size_t>(m) * N + n) * 4;
+			const double energy = static_cast<double>(texel[0]) * texel[0] + static_cast<double>(texel[1]) * texel[1];
+
+			height += energy;
+			slope += energy * (kx * kx + ky * ky);
+		}
+	}
+
+	outHeight = static_cast<float>(height);
+	outSlope = static_cast<float>(slope);
+}
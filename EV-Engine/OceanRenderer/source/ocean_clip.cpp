@@ -0,0 +1,745 @@
+#include "ocean_clip.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstring>
+
+#include "ocean_cascade_planner.h"
+#include "ocean_half.h"
+#include "ocean_noise.h"
+#include "utility/thread_pool.h"
+
+#define PI 3.14159265359f
+
+// Bump whenever the layout of the file or the coding of the planes changes.
+#define OCEAN_CLIP_VERSION 1
+
+using namespace EV;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t CLIP_MAGIC = 0x4c434f45; // "EOCL"
+
+	// Quotients from here on are escaped and followed by the raw 16 bit residual.
+	constexpr uint32_t RICE_LIMIT = 24;
+	constexpr uint32_t RICE_MAX_PARAMETER = 15;
+
+	// Foam converges to its periodic state within 1e-3 after ln(1000) / decay frames.
+	const float PREROLL_DECAY = 6.9077553f;
+	constexpr uint32_t PREROLL_MAX_LOOPS = 2;
+
+	struct OceanClipFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t cascadeCount;
+		uint32_t frameCount;
+		float frameRate;
+		uint64_t reserved;
+	};
+	static_assert(sizeof(OceanClipFileHeader) == 32, "The header is part of the file format");
+	static_assert(sizeof(OceanClipCascade) == 8, "The cascades are part of the file format");
+	static_assert(sizeof(OceanClipIndexEntry) == 16, "The index is part of the file format");
+
+	struct OceanClipChunkHeader
+	{
+		float scale[OCC_Count];
+		float bias[OCC_Count];
+		uint32_t planeSize[OCC_Count];
+	};
+
+	uint64_t IndexOffset(uint32_t cascadeCount)
+	{
+		return sizeof(OceanClipFileHeader) + sizeof(OceanClipCascade) * cascadeCount;
+	}
+
+	// Maps half floats to integers in the order of their values, so the
+	// difference of two nearby values stays small across the sign change.
+	uint16_t HalfToOrdered(uint16_t half)
+	{
+		return static_cast<uint16_t>((half & 0x8000) ? ~half : (half | 0x8000));
+	}
+
+	uint16_t OrderedToHalf(uint16_t ordered)
+	{
+		return static_cast<uint16_t>((ordered & 0x8000) ? (ordered & 0x7fff) : ~ordered);
+	}
+
+	// LOCO-I median edge detector, the median of left, up and the gradient left + up - upLeft.
+	int32_t Predict(int32_t left, int32_t up, int32_t upLeft)
+	{
+		return std::max(std::min(left, up), std::min(std::max(left, up), left + up - upLeft));
+	}
+
+	int32_t PredictTexel(const uint16_t* plane, uint32_t N, uint32_t m, uint32_t n)
+	{
+		const size_t index = static_cast<size_t>(m) * N + n;
+		if (m == 0)
+			return n == 0 ? 0x8000 : plane[index - 1];
+		if (n == 0)
+			return plane[index - N];
+		return Predict(plane[index - 1], plane[index - N], plane[index - N - 1]);
+	}
+
+	uint16_t ZigZag(uint16_t residual)
+	{
+		const int16_t value = static_cast<int16_t>(residual);
+		return static_cast<uint16_t>((value << 1) ^ (value >> 15));
+	}
+
+	uint16_t UnZigZag(uint32_t value)
+	{
+		return static_cast<uint16_t>((value >> 1) ^ (0u - (value & 1)));
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+		// bits <= 32
+		void Put(uint32_t value, uint32_t bits)
+		{
+			m_buffer |= static_cast<uint64_t>(value) << m_count;
+			m_count += bits;
+			while (m_count >= 8)
+			{
+				m_out.push_back(static_cast<uint8_t>(m_buffer));
+				m_buffer >>= 8;
+				m_count -= 8;
+			}
+		}
+
+		void Flush()
+		{
+			if (m_count > 0)
+				m_out.push_back(static_cast<uint8_t>(m_buffer));
+			m_buffer = 0;
+			m_count = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& m_out;
+		uint64_t m_buffer = 0;
+		uint32_t m_count = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, const uint8_t* end) : m_data(data), m_end(end) {}
+
+		// Tops the buffer up to at least 57 bits, reads past the end return zeros.
+		void Refill()
+		{
+			if (m_end - m_data >= 8)
+			{
+				uint64_t bytes;
+				std::memcpy(&bytes, m_data, sizeof(bytes));
+				m_buffer |= bytes << m_count;
+				m_data += (63 - m_count) >> 3;
+				m_count |= 56;
+			}
+			else
+			{
+				while (m_count <= 56)
+				{
+					const uint64_t byte = m_data < m_end ? *m_data++ : 0;
+					m_buffer |= byte << m_count;
+					m_count += 8;
+				}
+			}
+		}
+
+		uint64_t Peek() const { return m_buffer; }
+
+		void Consume(uint32_t bits)
+		{
+			m_buffer >>= bits;
+			m_count -= bits;
+		}
+
+	private:
+		const uint8_t* m_data;
+		const uint8_t* m_end;
+		uint64_t m_buffer = 0;
+		uint32_t m_count = 0;
+	};
+
+	// Plane layout: one Rice parameter per row, then the bit stream of all rows.
+	void EncodePlane(const uint16_t* plane, uint32_t N, std::vector<uint8_t>& out)
+	{
+		out.assign(N, 0);
+		BitWriter writer(out);
+		std::vector<uint16_t> residuals(N);
+
+		for (uint32_t m = 0; m < N; ++m)
+		{
+			const uint16_t* row = plane + static_cast<size_t>(m) * N;
+			for (uint32_t n = 0; n < N; ++n)
+				residuals[n] = ZigZag(static_cast<uint16_t>(row[n] - PredictTexel(plane, N, m, n)));
+
+			// Cheapest parameter for the row, ignoring the escapes.
+			uint32_t bestParameter = 0;
+			uint64_t bestCost = UINT64_MAX;
+			for (uint32_t k = 0; k <= RICE_MAX_PARAMETER; ++k)
+			{
+				uint64_t cost = static_cast<uint64_t>(N) * (k + 1);
+				for (uint32_t n = 0; n < N; ++n)
+					cost += residuals[n] >> k;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestParameter = k;
+				}
+			}
+			out[m] = static_cast<uint8_t>(bestParameter);
+
+			const uint32_t mask = (1u << bestParameter) - 1;
+			for (uint32_t n = 0; n < N; ++n)
+			{
+				const uint32_t quotient = residuals[n] >> bestParameter;
+				if (quotient < RICE_LIMIT)
+				{
+					// quotient ones, a terminating zero, then the low bits.
+					writer.Put((1u << quotient) - 1, quotient + 1);
+					writer.Put(residuals[n] & mask, bestParameter);
+				}
+				else
+				{
+					writer.Put((1u << RICE_LIMIT) - 1, RICE_LIMIT);
+					writer.Put(residuals[n], 16);
+				}
+			}
+		}
+		writer.Flush();
+	}
+
+	uint16_t ReadResidual(BitReader& reader, uint32_t k)
+	{
+		reader.Refill();
+		uint32_t value;
+		const uint32_t quotient = static_cast<uint32_t>(std::countr_one(reader.Peek()));
+		if (quotient < RICE_LIMIT)
+		{
+			reader.Consume(quotient + 1);
+			value = (quotient << k) | static_cast<uint32_t>(reader.Peek() & ((1ull << k) - 1));
+			reader.Consume(k);
+		}
+		else
+		{
+			reader.Consume(RICE_LIMIT);
+			value = static_cast<uint32_t>(reader.Peek() & 0xffff);
+			reader.Consume(16);
+		}
+		return UnZigZag(value);
+	}
+
+	bool DecodePlane(const uint8_t* data, uint64_t size, uint32_t N, uint16_t* plane)
+	{
+		if (size < N)
+			return false;
+
+		const uint8_t* parameters = data;
+		BitReader reader(data + N, data + size);
+
+		for (uint32_t m = 0; m < N; ++m)
+		{
+			const uint32_t k = parameters[m];
+			if (k > RICE_MAX_PARAMETER)
+				return false;
+
+			// Same predictions as PredictTexel, with the edges peeled off.
+			uint16_t* row = plane + static_cast<size_t>(m) * N;
+			if (m == 0)
+			{
+				row[0] = static_cast<uint16_t>(0x8000 + ReadResidual(reader, k));
+				for (uint32_t n = 1; n < N; ++n)
+					row[n] = static_cast<uint16_t>(row[n - 1] + ReadResidual(reader, k));
+				continue;
+			}
+
+			const uint16_t* up = row - N;
+			row[0] = static_cast<uint16_t>(up[0] + ReadResidual(reader, k));
+			for (uint32_t n = 1; n < N; ++n)
+				row[n] = static_cast<uint16_t>(Predict(row[n - 1], up[n], up[n - 1]) + ReadResidual(reader, k));
+		}
+		return true;
+	}
+
+	const std::vector<float>& GetChannel(const OceanCpuSimulator::Cascade& cascade, uint32_t channel)
+	{
+		switch (channel)
+		{
+		case OCC_DisplacementX: return cascade.displacementX;
+		case OCC_DisplacementY: return cascade.displacementY;
+		case OCC_DisplacementZ: return cascade.displacementZ;
+		case OCC_Foam: return cascade.foam;
+		case OCC_SlopeX: return cascade.slopeX;
+		default: return cascade.slopeZ;
+		}
+	}
+
+	// Quantizes a channel into codes that predict well: ordered halves or unorm16.
+	void Quantize(OceanClipFormat format, const std::vector<float>& values, uint16_t* outCodes, float& outScale, float& outBias)
+	{
+		outScale = 1.0f;
+		outBias = 0.0f;
+
+		if (format == OCF_Half)
+		{
+			OceanHalf::FromFloat(values.data(), outCodes, values.size());
+			for (size_t i = 0; i < values.size(); ++i)
+				outCodes[i] = HalfToOrdered(outCodes[i]);
+			return;
+		}
+
+		const auto [minimum, maximum] = std::minmax_element(values.begin(), values.end());
+		const float range = *maximum - *minimum;
+		outBias = *minimum;
+		outScale = range / 65535.0f;
+		const float invScale = range > 0.0f ? 65535.0f / range : 0.0f;
+		for (size_t i = 0; i < values.size(); ++i)
+			outCodes[i] = static_cast<uint16_t>(std::min(65535.0f, std::nearbyint((values[i] - outBias) * invScale)));
+	}
+}
+
+void OceanClipFrame::ToFloat(uint32_t channel, float* outValues) const
+{
+	const std::vector<uint16_t>& plane = planes[channel];
+	if (format == OCF_Half)
+	{
+		OceanHalf::ToFloat(plane.data(), outValues, plane.size());
+	}
+	else
+	{
+		for (size_t i = 0; i < plane.size(); ++i)
+			outValues[i] = plane[i] * scale[channel] + bias[channel];
+	}
+}
+
+OceanDisplacementBounds OceanClipFrame::GetDisplacementBounds() const
+{
+	float maxAbs[3] = {};
+	for (uint32_t channel = OCC_DisplacementX; channel <= OCC_DisplacementZ; ++channel)
+	{
+		const std::vector<uint16_t>& plane = planes[channel];
+		if (format == OCF_Half)
+		{
+			// Without the sign bit half floats sort like their codes.
+			uint16_t maxCode = 0;
+			for (uint16_t code : plane)
+				maxCode = std::max<uint16_t>(maxCode, code & 0x7fff);
+			maxAbs[channel] = OceanHalf::ToFloat(maxCode);
+		}
+		else if (!plane.empty())
+		{
+			const auto [minCode, maxCode] = std::minmax_element(plane.begin(), plane.end());
+			maxAbs[channel] = std::max(std::abs(*minCode * scale[channel] + bias[channel]), std::abs(*maxCode * scale[channel] + bias[channel]));
+		}
+	}
+
+	OceanDisplacementBounds bounds;
+	bounds.horizontal = std::max(maxAbs[OCC_DisplacementX], maxAbs[OCC_DisplacementZ]);
+	bounds.vertical = maxAbs[OCC_DisplacementY];
+	return bounds;
+}
+
+void OceanClipFrame::ToHalfTexels(uint16_t* outDisplacement, uint16_t* outSlope, uint16_t* outFoam) const
+{
+	struct Target
+	{
+		uint16_t* texels;
+		uint32_t stride;
+	};
+	const Target targets[OCC_Count] =
+	{
+		{ outDisplacement + 0, 4 },
+		{ outDisplacement + 1, 4 },
+		{ outDisplacement + 2, 4 },
+		{ outDisplacement + 3, 4 },
+		{ outSlope + 0, 2 },
+		{ outSlope + 1, 2 },
+	};
+
+	const size_t count = static_cast<size_t>(resolution) * resolution;
+	for (uint32_t channel = 0; channel < OCC_Count; ++channel)
+	{
+		const uint16_t* plane = planes[channel].data();
+		uint16_t* texels = targets[channel].texels;
+		const uint32_t stride = targets[channel].stride;
+
+		if (format == OCF_Half)
+		{
+			for (size_t i = 0; i < count; ++i)
+				texels[i * stride] = plane[i];
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+				texels[i * stride] = OceanHalf::FromFloat(plane[i] * scale[channel] + bias[channel]);
+		}
+	}
+
+	for (size_t i = 0; i < count; ++i)
+		outFoam[i] = outDisplacement[i * 4 + 3];
+}
+
+OceanClipWriter::~OceanClipWriter()
+{
+	Abandon();
+}
+
+void OceanClipWriter::Abandon()
+{
+	if (!m_file.is_open())
+		return;
+
+	m_file.close();
+	std::error_code error;
+	fs::remove(m_temporaryPath, error);
+}
+
+bool OceanClipWriter::Open(const fs::path& path, const OceanClipDesc& desc)
+{
+	Abandon();
+
+	if (desc.frameCount == 0 || desc.frameRate <= 0.0f || desc.cascades.empty())
+		return false;
+
+	m_path = path;
+	m_temporaryPath = path;
+	m_temporaryPath += ".tmp";
+	m_desc = desc;
+	m_index.assign(static_cast<size_t>(desc.frameCount) * desc.cascades.size(), OceanClipIndexEntry{});
+	m_frame = 0;
+
+	m_file.open(m_temporaryPath, std::ios::binary | std::ios::trunc);
+	if (!m_file)
+		return false;
+
+	OceanClipFileHeader header = {};
+	header.magic = CLIP_MAGIC;
+	header.version = OCEAN_CLIP_VERSION;
+	header.format = desc.format;
+	header.cascadeCount = static_cast<uint32_t>(desc.cascades.size());
+	header.frameCount = desc.frameCount;
+	header.frameRate = desc.frameRate;
+
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_file.write(reinterpret_cast<const char*>(desc.cascades.data()), sizeof(OceanClipCascade) * desc.cascades.size());
+	// Placeholder, Close fills in the index once the chunk sizes are known.
+	m_file.write(reinterpret_cast<const char*>(m_index.data()), sizeof(OceanClipIndexEntry) * m_index.size());
+	m_offset = IndexOffset(header.cascadeCount) + sizeof(OceanClipIndexEntry) * m_index.size();
+
+	if (!m_file)
+	{
+		Abandon();
+		return false;
+	}
+	return true;
+}
+
+bool OceanClipWriter::WriteFrame(const OceanCpuSimulator& simulator)
+{
+	const uint32_t cascadeCount = static_cast<uint32_t>(m_desc.cascades.size());
+	if (!m_file.is_open() || m_frame >= m_desc.frameCount || simulator.GetCascadeCount() != cascadeCount)
+		return false;
+	for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+	{
+		if (simulator.GetCascade(cascade).desc.resolution != m_desc.cascades[cascade].resolution)
+			return false;
+	}
+
+	// Every plane of every cascade is coded on its own.
+	std::vector<OceanClipChunkHeader> chunks(cascadeCount);
+	std::vector<std::vector<uint8_t>> planes(cascadeCount * OCC_Count);
+	ThreadPool::Get().ParallelFor(0, cascadeCount * OCC_Count, 1, [&](uint32_t begin, uint32_t end)
+	{
+		std::vector<uint16_t> codes;
+		for (uint32_t job = begin; job < end; ++job)
+		{
+			const uint32_t cascade = job / OCC_Count;
+			const uint32_t channel = job % OCC_Count;
+			const uint32_t N = m_desc.cascades[cascade].resolution;
+			OceanClipChunkHeader& chunk = chunks[cascade];
+
+			codes.resize(static_cast<size_t>(N) * N);
+			Quantize(m_desc.format, GetChannel(simulator.GetCascade(cascade), channel), codes.data(), chunk.scale[channel], chunk.bias[channel]);
+			EncodePlane(codes.data(), N, planes[job]);
+			chunk.planeSize[channel] = static_cast<uint32_t>(planes[job].size());
+		}
+	});
+
+	for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+	{
+		OceanClipIndexEntry& entry = m_index[static_cast<size_t>(m_frame) * cascadeCount + cascade];
+		entry.offset = m_offset;
+		entry.size = sizeof(OceanClipChunkHeader);
+
+		m_file.write(reinterpret_cast<const char*>(&chunks[cascade]), sizeof(OceanClipChunkHeader));
+		for (uint32_t channel = 0; channel < OCC_Count; ++channel)
+		{
+			const std::vector<uint8_t>& plane = planes[cascade * OCC_Count + channel];
+			m_file.write(reinterpret_cast<const char*>(plane.data()), plane.size());
+			entry.size += plane.size();
+		}
+		m_offset += entry.size;
+	}
+
+	++m_frame;
+	return static_cast<bool>(m_file);
+}
+
+bool OceanClipWriter::Close()
+{
+	if (!m_file.is_open())
+		return false;
+
+	if (m_frame != m_desc.frameCount)
+	{
+		Abandon();
+		return false;
+	}
+
+	m_file.seekp(static_cast<std::streamoff>(IndexOffset(static_cast<uint32_t>(m_desc.cascades.size()))));
+	m_file.write(reinterpret_cast<const char*>(m_index.data()), sizeof(OceanClipIndexEntry) * m_index.size());
+	if (!m_file)
+	{
+		Abandon();
+		return false;
+	}
+	m_file.close();
+
+	std::error_code error;
+	fs::rename(m_temporaryPath, m_path, error);
+	if (error)
+	{
+		fs::remove(m_temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool OceanClipReader::Open(const fs::path& path)
+{
+	Close();
+
+	if (!m_file.Open(path))
+		return false;
+
+	// Reject anything that doesn't look exactly like what OceanClipWriter writes.
+	OceanClipFileHeader header;
+	bool valid = m_file.GetSize() >= sizeof(header);
+	if (valid)
+	{
+		std::memcpy(&header, m_file.GetData(), sizeof(header));
+		valid = header.magic == CLIP_MAGIC && header.version == OCEAN_CLIP_VERSION &&
+			(header.format == OCF_Half || header.format == OCF_Unorm16) &&
+			header.cascadeCount > 0 && header.frameCount > 0 && header.frameRate > 0.0f;
+	}
+
+	const uint64_t indexSize = valid ? sizeof(OceanClipIndexEntry) * header.frameCount * header.cascadeCount : 0;
+	valid = valid && m_file.GetSize() >= IndexOffset(header.cascadeCount) + indexSize;
+
+	if (valid)
+	{
+		m_desc.format = static_cast<OceanClipFormat>(header.format);
+		m_desc.frameRate = header.frameRate;
+		m_desc.frameCount = header.frameCount;
+		m_desc.cascades.resize(header.cascadeCount);
+		std::memcpy(m_desc.cascades.data(), m_file.GetData() + sizeof(header), sizeof(OceanClipCascade) * header.cascadeCount);
+
+		for (const OceanClipCascade& cascade : m_desc.cascades)
+		{
+			const uint32_t N = cascade.resolution;
+			valid &= N >= 4 && N <= 4096 && (N & (N - 1)) == 0;
+		}
+
+		m_index = reinterpret_cast<const OceanClipIndexEntry*>(m_file.GetData() + IndexOffset(header.cascadeCount));
+		for (uint64_t i = 0; valid && i < static_cast<uint64_t>(header.frameCount) * header.cascadeCount; ++i)
+		{
+			valid = m_index[i].size >= sizeof(OceanClipChunkHeader) && m_index[i].offset <= m_file.GetSize() &&
+				m_index[i].size <= m_file.GetSize() - m_index[i].offset;
+		}
+	}
+
+	if (!valid)
+		Close();
+	return valid;
+}
+
+void OceanClipReader::Close()
+{
+	m_file.Close();
+	m_desc = OceanClipDesc();
+	m_index = nullptr;
+}
+
+uint32_t OceanClipReader::GetFrame(double time) const
+{
+	double frame = std::fmod(std::floor(time * m_desc.frameRate), static_cast<double>(m_desc.frameCount));
+	if (frame < 0.0)
+		frame += m_desc.frameCount;
+	return std::min(static_cast<uint32_t>(frame), m_desc.frameCount - 1);
+}
+
+bool OceanClipReader::Decode(uint32_t frame, std::vector<OceanClipFrame>& outCascades) const
+{
+	if (!IsOpen() || frame >= m_desc.frameCount)
+		return false;
+
+	const uint32_t cascadeCount = static_cast<uint32_t>(m_desc.cascades.size());
+	outCascades.resize(cascadeCount);
+
+	// Chunk headers first, they give the offset of every plane.
+	struct Plane
+	{
+		const uint8_t* data;
+		uint32_t size;
+	};
+	std::vector<Plane> planes(cascadeCount * OCC_Count);
+	for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+	{
+		const OceanClipIndexEntry& entry = m_index[static_cast<size_t>(frame) * cascadeCount + cascade];
+		const uint8_t* chunkData = m_file.GetData() + entry.offset;
+
+		OceanClipChunkHeader chunk;
+		std::memcpy(&chunk, chunkData, sizeof(chunk));
+
+		uint64_t offset = sizeof(chunk);
+		for (uint32_t channel = 0; channel < OCC_Count; ++channel)
+		{
+			planes[cascade * OCC_Count + channel] = { chunkData + offset, chunk.planeSize[channel] };
+			offset += chunk.planeSize[channel];
+		}
+		if (offset != entry.size)
+			return false;
+
+		OceanClipFrame& out = outCascades[cascade];
+		const uint32_t N = m_desc.cascades[cascade].resolution;
+		out.format = m_desc.format;
+		out.resolution = N;
+		for (uint32_t channel = 0; channel < OCC_Count; ++channel)
+		{
+			out.planes[channel].resize(static_cast<size_t>(N) * N);
+			out.scale[channel] = chunk.scale[channel];
+			out.bias[channel] = chunk.bias[channel];
+		}
+	}
+
+	std::atomic_bool valid = true;
+	ThreadPool::Get().ParallelFor(0, cascadeCount * OCC_Count, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t job = begin; job < end; ++job)
+		{
+			const uint32_t cascade = job / OCC_Count;
+			const uint32_t channel = job % OCC_Count;
+			OceanClipFrame& out = outCascades[cascade];
+
+			uint16_t* plane = out.planes[channel].data();
+			if (!DecodePlane(planes[job].data, planes[job].size, out.resolution, plane))
+			{
+				valid = false;
+				continue;
+			}
+
+			if (out.format == OCF_Half)
+			{
+				for (size_t i = 0; i < out.planes[channel].size(); ++i)
+					plane[i] = OrderedToHalf(plane[i]);
+			}
+		}
+	});
+
+	return valid;
+}
+
+OceanClipBakeSettings OceanClipBaker::DefaultSettings(uint32_t resolution)
+{
+	OceanClipBakeSettings settings;
+
+	// Same values as Ocean::UpdateSpectrumParameters.
+	JonswapParameters& params = settings.params;
+	params.scale = 1.0f;
+	params.spreadBlend = 1.0f;
+	params.swell = 0.198f;
+	params.gamma = 3.3f;
+	params.shortWavesFade = 0.01f;
+	params.windDirection = 0.0f;
+	params.fetch = 100000.0f;
+	params.windSpeed = 0.5f;
+	params.angle = params.windDirection / 180.0f * PI;
+	params.alpha = OceanSpectrum::JonswapAlpha(params.fetch, params.windSpeed);
+	params.peakOmega = OceanSpectrum::JonswapPeakFequency(params.fetch, params.windSpeed);
+
+	// Cascades as Ocean::PlanCascades lays them out by default. Skipped
+	// cascades are baked as well, the clip format has no notion of them.
+	settings.cascades = OceanCascadePlanner::Plan(params, std::vector<uint32_t>(4, resolution)).cascades;
+
+	settings.foamParameters.decay = 0.008f;
+	settings.foamParameters.bias = 0.311f;
+	settings.foamParameters.add = 0.023f;
+	settings.foamParameters.threshold = 0.023f;
+	return settings;
+}
+
+bool OceanClipBaker::Bake(const OceanClipBakeSettings& settings, const fs::path& path,
+                          const std::function<bool(uint32_t, uint32_t)>& progress)
+{
+	if (settings.cascades.empty() || settings.frameRate <= 0.0f || settings.repeatTime <= 0.0f)
+		return false;
+
+	OceanCpuSimulator simulator;
+	OceanClipDesc desc;
+	desc.format = settings.format;
+	desc.frameRate = settings.frameRate;
+	desc.frameCount = std::max(1u, static_cast<uint32_t>(std::lround(settings.repeatTime * settings.frameRate)));
+
+	for (uint32_t cascade = 0; cascade < settings.cascades.size(); ++cascade)
+	{
+		const OceanCascadeDesc& cascadeDesc = settings.cascades[cascade];
+		const uint32_t N = cascadeDesc.resolution;
+		std::vector<std::complex<float>> noise(static_cast<size_t>(N) * N);
+		std::vector<float> H0(static_cast<size_t>(N) * N * 4);
+		OceanNoise::Generate(settings.seed, cascade, N, noise.data());
+		OceanSpectrum::BuildH0(settings.params, cascadeDesc, noise.data(), H0.data());
+		simulator.SetCascade(cascade, cascadeDesc, H0.data());
+
+		desc.cascades.push_back({ N, cascadeDesc.patchSize });
+	}
+
+	// A whole number of frames per period, so the last frame runs into the first.
+	simulator.SetRepeatTime(desc.GetDuration());
+
+	OceanClipWriter writer;
+	if (!writer.Open(path, desc))
+		return false;
+
+	// Foam carries over from frame to frame. Run the end of the loop first, until
+	// the foam is close to its periodic state, so the loop has no seam.
+	const float decay = settings.foamParameters.decay;
+	const uint32_t maxPreRoll = desc.frameCount * PREROLL_MAX_LOOPS;
+	const uint32_t preRoll = decay > 0.0f ? std::min(maxPreRoll, static_cast<uint32_t>(std::ceil(PREROLL_DECAY / decay))) : maxPreRoll;
+	for (uint32_t i = 0; i < preRoll; ++i)
+	{
+		const uint32_t frame = (desc.frameCount - preRoll % desc.frameCount + i) % desc.frameCount;
+		simulator.Simulate(frame / desc.frameRate, settings.foamParameters);
+	}
+
+	for (uint32_t frame = 0; frame < desc.frameCount; ++frame)
+	{
+		simulator.Simulate(frame / desc.frameRate, settings.foamParameters);
+		if (!writer.WriteFrame(simulator))
+			return false;
+		if (progress && !progress(frame + 1, desc.frameCount))
+			return false;
+	}
+
+	return writer.Close();
+}
@@ -0,0 +1,500 @@
+#include "ocean_cpu_simulator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include "ocean_half.h"
+#include "ocean_simd.h"
+#include "utility/thread_pool.h"
+
+#define PI 3.14159265359f
+#define GRAVITY 9.81f
+
+using namespace EV;
+using namespace EV::simd;
+
+namespace
+{
+	// Lines of one field transformed together, one per SSE lane.
+	constexpr uint32_t LANES = 4;
+	// Columns gathered at once in the column pass, a cache line of floats.
+	constexpr uint32_t COLUMN_STRIP = 16;
+	// Complex fields per texel, each packs two real fields as re + i * im.
+	constexpr uint32_t FIELDS = 4;
+
+	// Per thread work memory, grown on demand and reused across frames.
+	float* GetScratch(size_t floatCount)
+	{
+		thread_local std::vector<float> scratch;
+		if (scratch.size() < floatCount)
+			scratch.resize(floatCount);
+		return scratch.data();
+	}
+
+	// Twiddles of every radix-4 stage: (w1, w2, w3) = e^(i * (1, 2, 3) * 2 pi p / n) for p < n / 4.
+	std::vector<float> BuildTwiddles(uint32_t N)
+	{
+		std::vector<float> twiddles;
+		for (uint32_t n = N; n >= 4; n /= 4)
+		{
+			const double theta = 2.0 * 3.14159265358979323846 / n;
+			for (uint32_t p = 0; p < n / 4; ++p)
+			{
+				for (uint32_t r = 1; r <= 3; ++r)
+				{
+					twiddles.push_back(static_cast<float>(std::cos(theta * p * r)));
+					twiddles.push_back(static_cast<float>(std::sin(theta * p * r)));
+				}
+			}
+		}
+		return twiddles;
+	}
+
+	const std::vector<float>& GetTwiddles(uint32_t N)
+	{
+		// Resolutions are powers of two, so a table per exponent is enough.
+		static std::vector<float> tables[32];
+		static std::once_flag built[32];
+
+		uint32_t log2N = 0;
+		while ((1u << log2N) < N)
+			++log2N;
+		std::call_once(built[log2N], [&]() { tables[log2N] = BuildTwiddles(N); });
+		return tables[log2N];
+	}
+
+	inline void ComplexMultiply(Vec4 ar, Vec4 ai, Vec4 br, Vec4 bi, Vec4* outR, Vec4* outI)
+	{
+		*outR = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+		*outI = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+	}
+
+	inline void Transpose(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+	{
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	}
+}
+
+void OceanCpuSimulator::InverseFFT4(uint32_t N, float* re, float* im, float* scratch)
+{
+	const float* twiddles = GetTwiddles(N).data();
+
+	float* xr = re;
+	float* xi = im;
+	float* yr = scratch;
+	float* yi = scratch + N * LANES;
+
+	uint32_t n = N;
+	uint32_t s = 1;
+
+	// Stockham autosort, every stage reads x and writes y in order, no bit reversal pass.
+	while (n >= 4)
+	{
+		const uint32_t n1 = n / 4;
+		for (uint32_t p = 0; p < n1; ++p)
+		{
+			const Vec4 w1r = Set(twiddles[0]), w1i = Set(twiddles[1]);
+			const Vec4 w2r = Set(twiddles[2]), w2i = Set(twiddles[3]);
+			const Vec4 w3r = Set(twiddles[4]), w3i = Set(twiddles[5]);
+			twiddles += 6;
+
+			for (uint32_t q = 0; q < s; ++q)
+			{
+				const uint32_t a = (q + s * p) * LANES;
+				const uint32_t b = a + s * n1 * LANES;
+				const uint32_t c = b + s * n1 * LANES;
+				const uint32_t d = c + s * n1 * LANES;
+
+				Vec4 ar = Load(xr + a), ai = Load(xi + a);
+				Vec4 br = Load(xr + b), bi = Load(xi + b);
+				Vec4 cr = Load(xr + c), ci = Load(xi + c);
+				Vec4 dr = Load(xr + d), di = Load(xi + d);
+
+				Vec4 apcR = _mm_add_ps(ar, cr), apcI = _mm_add_ps(ai, ci);
+				Vec4 amcR = _mm_sub_ps(ar, cr), amcI = _mm_sub_ps(ai, ci);
+				Vec4 bpdR = _mm_add_ps(br, dr), bpdI = _mm_add_ps(bi, di);
+				// i * (b - d)
+				Vec4 jbmdR = _mm_sub_ps(di, bi), jbmdI = _mm_sub_ps(br, dr);
+
+				const uint32_t out = (q + s * 4 * p) * LANES;
+				const uint32_t stride = s * LANES;
+
+				Store(yr + out, _mm_add_ps(apcR, bpdR));
+				Store(yi + out, _mm_add_ps(apcI, bpdI));
+
+				Vec4 tr, ti;
+				ComplexMultiply(w1r, w1i, _mm_add_ps(amcR, jbmdR), _mm_add_ps(amcI, jbmdI), &tr, &ti);
+				Store(yr + out + stride, tr);
+				Store(yi + out + stride, ti);
+
+				ComplexMultiply(w2r, w2i, _mm_sub_ps(apcR, bpdR), _mm_sub_ps(apcI, bpdI), &tr, &ti);
+				Store(yr + out + stride * 2, tr);
+				Store(yi + out + stride * 2, ti);
+
+				ComplexMultiply(w3r, w3i, _mm_sub_ps(amcR, jbmdR), _mm_sub_ps(amcI, jbmdI), &tr, &ti);
+				Store(yr + out + stride * 3, tr);
+				Store(yi + out + stride * 3, ti);
+			}
+		}
+
+		n /= 4;
+		s *= 4;
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	// Odd powers of two end with a radix-2 stage, its twiddle is 1.
+	if (n == 2)
+	{
+		for (uint32_t q = 0; q < s; ++q)
+		{
+			const uint32_t a = q * LANES;
+			const uint32_t b = (q + s) * LANES;
+
+			Vec4 ar = Load(xr + a), ai = Load(xi + a);
+			Vec4 br = Load(xr + b), bi = Load(xi + b);
+
+			Store(yr + a, _mm_add_ps(ar, br));
+			Store(yi + a, _mm_add_ps(ai, bi));
+			Store(yr + b, _mm_sub_ps(ar, br));
+			Store(yi + b, _mm_sub_ps(ai, bi));
+		}
+
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	if (xr != re)
+	{
+		std::memcpy(re, xr, N * LANES * sizeof(float));
+		std::memcpy(im, xi, N * LANES * sizeof(float));
+	}
+}
+
+void OceanCpuSimulator::SetCascadeCount(uint32_t count)
+{
+	m_cascades.resize(count);
+}
+
+void OceanCpuSimulator::SetCascade(uint32_t cascade, const OceanCascadeDesc& desc, const float* packedH0)
+{
+	const uint32_t N = desc.resolution;
+	assert(N >= 4 && (N & (N - 1)) == 0 && "The resolution has to be a power of two");
+
+	if (cascade >= m_cascades.size())
+		m_cascades.resize(cascade + 1);
+
+	Cascade& data = m_cascades[cascade];
+	const size_t count = static_cast<size_t>(N) * N;
+
+	if (data.desc.resolution != N)
+	{
+		for (auto* plane : { &data.displacementX, &data.displacementY, &data.displacementZ, &data.slopeX, &data.slopeZ })
+			plane->assign(count, 0.0f);
+		for (auto& plane : data.spectrum)
+			plane.assign(count, 0.0f);
+		data.foam.assign(count, 0.0f);
+		data.surface.assign(count * SURFACE_STRIDE, 0.0f);
+	}
+
+	data.desc = desc;
+	data.H0.assign(packedH0, packedH0 + count * 4);
+	data.H0Scale = OceanHalf::RangeScale(packedH0, count * 4);
+}
+
+void OceanCpuSimulator::SetHalfPrecision(bool halfPrecision)
+{
+	m_halfPrecision = halfPrecision;
+}
+
+void OceanCpuSimulator::SetRepeatTime(float repeatTime)
+{
+	assert(repeatTime > 0.0f);
+	m_repeatTime = repeatTime;
+}
+
+void OceanCpuSimulator::ResetFoam()
+{
+	for (Cascade& cascade : m_cascades)
+		std::fill(cascade.foam.begin(), cascade.foam.end(), 0.0f);
+}
+
+void OceanCpuSimulator::AnimateAndTransformRows(Cascade& cascade, float time, uint32_t rowBegin, uint32_t rowEnd)
+{
+	const uint32_t N = cascade.desc.resolution;
+	const float patchSize = cascade.desc.patchSize;
+
+	// Lines of the 4 fields, split in real and imaginary parts, plus the FFT scratch.
+	float* lines = GetScratch(N * LANES * (FIELDS * 2 + 2));
+	float* fftScratch = lines + N * LANES * FIELDS * 2;
+
+	const float w = 2.0f * PI / m_repeatTime;
+	// The phase repeats every m_repeatTime, wrapping the time first keeps sin/cos
+	// in range. The GPU evaluates floor(...) * w * time directly.
+	const float repeatFraction = std::fmod(time, m_repeatTime) / m_repeatTime;
+	const Vec4 laneOffset = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const Vec4 h0Scale = Set(cascade.H0Scale);
+	const Vec4 h0InvScale = Set(1.0f / cascade.H0Scale);
+
+	for (uint32_t m0 = rowBegin; m0 < rowEnd; m0 += LANES)
+	{
+		for (uint32_t n = 0; n < N; n += LANES)
+		{
+			// Fields of 4 rows x 4 columns, [field * 2 + part][row], lanes are columns.
+			Vec4 block[FIELDS * 2][LANES];
+
+			const Vec4 kx = _mm_div_ps(_mm_mul_ps(Set(2.0f * PI), _mm_add_ps(Set(n - N / 2.0f), laneOffset)), Set(patchSize));
+
+			for (uint32_t r = 0; r < LANES; ++r)
+			{
+				const uint32_t m = m0 + r;
+				const Vec4 ky = Set(2.0f * PI * (m - N / 2.0f) / patchSize);
+
+				// H0 is packed per texel, transpose to (h0.re, h0.im, h0conj.re, h0conj.im) planes.
+				const float* texel = cascade.H0.data() + (static_cast<size_t>(m) * N + n) * 4;
+				Vec4 h0r = Load(texel), h0i = Load(texel + 4), h0cr = Load(texel + 8), h0ci = Load(texel + 12);
+				Transpose(h0r, h0i, h0cr, h0ci);
+				if (m_halfPrecision)
+				{
+					h0r = _mm_mul_ps(RoundToHalf(_mm_mul_ps(h0r, h0Scale)), h0InvScale);
+					h0i = _mm_mul_ps(RoundToHalf(_mm_mul_ps(h0i, h0Scale)), h0InvScale);
+					h0cr = _mm_mul_ps(RoundToHalf(_mm_mul_ps(h0cr, h0Scale)), h0InvScale);
+					h0ci = _mm_mul_ps(RoundToHalf(_mm_mul_ps(h0ci, h0Scale)), h0InvScale);
+				}
+
+				Vec4 k = Sqrt(_mm_add_ps(_mm_mul_ps(kx, kx), _mm_mul_ps(ky, ky)));
+				Vec4 kRcp = Select(_mm_cmplt_ps(k, Set(0.0001f)), Set(1.0f), _mm_div_ps(Set(1.0f), k));
+
+				Vec4 dispersion = Floor(_mm_div_ps(Sqrt(_mm_mul_ps(Set(GRAVITY), k)), Set(w)));
+				Vec4 cycles = _mm_mul_ps(dispersion, Set(repeatFraction));
+				cycles = _mm_sub_ps(cycles, Floor(cycles));
+				Vec4 es, ec;
+				SinCos(_mm_mul_ps(cycles, Set(2.0f * PI)), &es, &ec);
+
+				// htilde = h0 * e^(i w t) + conj(h0(-k)) * e^(-i w t)
+				Vec4 htr = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(h0r, ec), _mm_mul_ps(h0i, es)), _mm_add_ps(_mm_mul_ps(h0cr, ec), _mm_mul_ps(h0ci, es)));
+				Vec4 hti = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h0r, es), _mm_mul_ps(h0i, ec)), _mm_sub_ps(_mm_mul_ps(h0ci, ec), _mm_mul_ps(h0cr, es)));
+				Vec4 ihr = _mm_sub_ps(_mm_setzero_ps(), hti);
+				Vec4 ihi = htr;
+
+				Vec4 kxRcp = _mm_mul_ps(kx, kRcp);
+				Vec4 kyRcp = _mm_mul_ps(ky, kRcp);
+
+				Vec4 dxR = _mm_mul_ps(ihr, kxRcp), dxI = _mm_mul_ps(ihi, kxRcp);
+				Vec4 dzR = _mm_mul_ps(ihr, kyRcp), dzI = _mm_mul_ps(ihi, kyRcp);
+				Vec4 xx = _mm_mul_ps(_mm_mul_ps(kx, kx), kRcp);
+				Vec4 xz = _mm_mul_ps(_mm_mul_ps(kx, ky), kRcp);
+				Vec4 zz = _mm_mul_ps(_mm_mul_ps(ky, ky), kRcp);
+				Vec4 dxxR = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), htr), xx), dxxI = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), hti), xx);
+				Vec4 dzxR = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), htr), xz), dzxI = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), hti), xz);
+				Vec4 dzzR = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), htr), zz), dzzI = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), hti), zz);
+				Vec4 dyxR = _mm_mul_ps(ihr, kx), dyxI = _mm_mul_ps(ihi, kx);
+				Vec4 dyzR = _mm_mul_ps(ihr, ky), dyzI = _mm_mul_ps(ihi, ky);
+
+				// Pack two real fields per complex field, a + i * b.
+				block[0][r] = _mm_sub_ps(dxR, dzI);   block[1][r] = _mm_add_ps(dxI, dzR);
+				block[2][r] = _mm_sub_ps(htr, dzxI);  block[3][r] = _mm_add_ps(hti, dzxR);
+				block[4][r] = _mm_sub_ps(dyxR, dyzI); block[5][r] = _mm_add_ps(dyxI, dyzR);
+				block[6][r] = _mm_sub_ps(dxxR, dzzI); block[7][r] = _mm_add_ps(dxxI, dzzR);
+			}
+
+			// Lanes become rows for the FFT.
+			for (uint32_t plane = 0; plane < FIELDS * 2; ++plane)
+			{
+				if (m_halfPrecision)
+				{
+					for (uint32_t r = 0; r < LANES; ++r)
+						block[plane][r] = RoundToHalf(block[plane][r]);
+				}
+				Transpose(block[plane][0], block[plane][1], block[plane][2], block[plane][3]);
+				float* line = lines + plane * N * LANES + n * LANES;
+				for (uint32_t c = 0; c < LANES; ++c)
+					Store(line + c * LANES, block[plane][c]);
+			}
+		}
+
+		for (uint32_t field = 0; field < FIELDS; ++field)
+		{
+			InverseFFT4(N, lines + field * 2 * N * LANES, lines + (field * 2 + 1) * N * LANES, fftScratch);
+		}
+
+		// Back to row major planes.
+		for (uint32_t plane = 0; plane < FIELDS * 2; ++plane)
+		{
+			const float* line = lines + plane * N * LANES;
+			float* out = cascade.spectrum[plane].data() + static_cast<size_t>(m0) * N;
+			for (uint32_t n = 0; n < N; n += LANES)
+			{
+				Vec4 c0 = Load(line + (n + 0) * LANES), c1 = Load(line + (n + 1) * LANES);
+				Vec4 c2 = Load(line + (n + 2) * LANES), c3 = Load(line + (n + 3) * LANES);
+				Transpose(c0, c1, c2, c3);
+				if (m_halfPrecision)
+				{
+					c0 = RoundToHalf(c0);
+					c1 = RoundToHalf(c1);
+					c2 = RoundToHalf(c2);
+					c3 = RoundToHalf(c3);
+				}
+				Store(out + 0 * N + n, c0);
+				Store(out + 1 * N + n, c1);
+				Store(out + 2 * N + n, c2);
+				Store(out + 3 * N + n, c3);
+			}
+		}
+	}
+}
+
+void OceanCpuSimulator::TransformColumnsAndPermute(Cascade& cascade, const OceanFoamParameters& foamParameters, uint32_t columnBegin, uint32_t columnEnd)
+{
+	const uint32_t N = cascade.desc.resolution;
+	const uint32_t strip = std::min(COLUMN_STRIP, N);
+	const uint32_t batches = strip / LANES;
+
+	// [plane][batch] lines of N * LANES floats, plus the FFT scratch.
+	float* lines = GetScratch(N * LANES * (FIELDS * 2 * batches + 2));
+	float* fftScratch = lines + N * LANES * FIELDS * 2 * batches;
+	auto Line = [&](uint32_t plane, uint32_t batch) { return lines + (plane * batches + batch) * N * LANES; };
+
+	const Vec4 lambda = Set(LAMBDA);
+	const Vec4 one = Set(1.0f);
+	const Vec4 decay = Set(std::exp(-foamParameters.decay));
+	const Vec4 bias = Set(foamParameters.bias);
+	const Vec4 add = Set(foamParameters.add);
+	const Vec4 threshold = Set(foamParameters.threshold);
+
+	for (uint32_t n0 = columnBegin; n0 < columnEnd; n0 += strip)
+	{
+		// Gather full cache lines of every row into the column batches.
+		for (uint32_t plane = 0; plane < FIELDS * 2; ++plane)
+		{
+			const float* source = cascade.spectrum[plane].data() + n0;
+			for (uint32_t m = 0; m < N; ++m)
+			{
+				for (uint32_t batch = 0; batch < batches; ++batch)
+					Store(Line(plane, batch) + m * LANES, Load(source + static_cast<size_t>(m) * N + batch * LANES));
+			}
+		}
+
+		for (uint32_t batch = 0; batch < batches; ++batch)
+		{
+			for (uint32_t field = 0; field < FIELDS; ++field)
+				InverseFFT4(N, Line(field * 2, batch), Line(field * 2 + 1, batch), fftScratch);
+		}
+
+		// The column pass stores its result before permute.hlsl reads it back.
+		if (m_halfPrecision)
+		{
+			float* values = Line(0, 0);
+			for (size_t i = 0; i < static_cast<size_t>(FIELDS * 2 * batches) * N * LANES; i += LANES)
+				Store(values + i, RoundToHalf(Load(values + i)));
+		}
+
+		// permute.hlsl
+		for (uint32_t batch = 0; batch < batches; ++batch)
+		{
+			const uint32_t n = n0 + batch * LANES;
+			for (uint32_t m = 0; m < N; ++m)
+			{
+				// (-1)^(x + y), n is a multiple of 4 so the pattern only depends on the row.
+				const Vec4 sign = (m & 1) ? _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f) : _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+				const uint32_t offset = m * LANES;
+
+				Vec4 dx = _mm_mul_ps(sign, Load(Line(0, batch) + offset));
+				Vec4 dz = _mm_mul_ps(sign, Load(Line(1, batch) + offset));
+				Vec4 dy = _mm_mul_ps(sign, Load(Line(2, batch) + offset));
+				Vec4 dzx = _mm_mul_ps(sign, Load(Line(3, batch) + offset));
+				Vec4 dyx = _mm_mul_ps(sign, Load(Line(4, batch) + offset));
+				Vec4 dyz = _mm_mul_ps(sign, Load(Line(5, batch) + offset));
+				Vec4 dxx = _mm_mul_ps(sign, Load(Line(6, batch) + offset));
+				Vec4 dzz = _mm_mul_ps(sign, Load(Line(7, batch) + offset));
+
+				Vec4 slopeX = _mm_div_ps(dyx, _mm_add_ps(one, Abs(_mm_mul_ps(dxx, lambda))));
+				Vec4 slopeZ = _mm_div_ps(dyz, _mm_add_ps(one, Abs(_mm_mul_ps(dzz, lambda))));
+
+				Vec4 jacobian = _mm_mul_ps(_mm_add_ps(one, _mm_mul_ps(lambda, dxx)), _mm_add_ps(one, _mm_mul_ps(lambda, dzz)));
+				jacobian = _mm_sub_ps(jacobian, _mm_mul_ps(_mm_mul_ps(lambda, lambda), _mm_mul_ps(dzx, dzx)));
+
+				const size_t index = static_cast<size_t>(m) * N + n;
+				Vec4 foam = _mm_mul_ps(Load(&cascade.foam[index]), decay);
+				foam = Min(Max(foam, _mm_setzero_ps()), one);
+				Vec4 biasedJacobian = Max(_mm_setzero_ps(), _mm_sub_ps(bias, jacobian));
+				foam = _mm_add_ps(foam, _mm_and_ps(_mm_cmpgt_ps(biasedJacobian, threshold), _mm_mul_ps(add, biasedJacobian)));
+
+				// Foam accumulates in the 32 bit foam target, it isn't rounded.
+				Vec4 displacementX = _mm_mul_ps(lambda, dx), displacementY = dy, displacementZ = _mm_mul_ps(lambda, dz);
+				if (m_halfPrecision)
+				{
+					displacementX = RoundToHalf(displacementX);
+					displacementY = RoundToHalf(displacementY);
+					displacementZ = RoundToHalf(displacementZ);
+					slopeX = RoundToHalf(slopeX);
+					slopeZ = RoundToHalf(slopeZ);
+				}
+				Store(&cascade.displacementX[index], displacementX);
+				Store(&cascade.displacementY[index], displacementY);
+				Store(&cascade.displacementZ[index], displacementZ);
+				Store(&cascade.foam[index], foam);
+				Store(&cascade.slopeX[index], slopeX);
+				Store(&cascade.slopeZ[index], slopeZ);
+
+				// Interleaved copy for the surface queries, one 32 byte texel each.
+				Vec4 texel0 = displacementX, texel1 = displacementY, texel2 = displacementZ, texel3 = foam;
+				Vec4 slope0 = slopeX, slope1 = slopeZ, slope2 = _mm_setzero_ps(), slope3 = _mm_setzero_ps();
+				Transpose(texel0, texel1, texel2, texel3);
+				Transpose(slope0, slope1, slope2, slope3);
+				float* surface = &cascade.surface[index * SURFACE_STRIDE];
+				Store(surface + 0, texel0);
+				Store(surface + 4, slope0);
+				Store(surface + 8, texel1);
+				Store(surface + 12, slope1);
+				Store(surface + 16, texel2);
+				Store(surface + 20, slope2);
+				Store(surface + 24, texel3);
+				Store(surface + 28, slope3);
+			}
+		}
+	}
+}
+
+void OceanCpuSimulator::Simulate(float time, const OceanFoamParameters& foamParameters)
+{
+	// One job list over all cascades, so small cascades don't leave cores idle.
+	struct Job
+	{
+		uint32_t cascade;
+		uint32_t begin;
+		uint32_t end;
+	};
+	std::vector<Job> rowJobs;
+	std::vector<Job> columnJobs;
+
+	for (uint32_t c = 0; c < m_cascades.size(); ++c)
+	{
+		const uint32_t N = m_cascades[c].desc.resolution;
+		if (N == 0)
+			continue;
+
+		const uint32_t rowsPerJob = std::max(LANES, N / 64);
+		for (uint32_t row = 0; row < N; row += rowsPerJob)
+			rowJobs.push_back({ c, row, std::min(N, row + rowsPerJob) });
+
+		const uint32_t strip = std::min(COLUMN_STRIP, N);
+		for (uint32_t column = 0; column < N; column += strip)
+			columnJobs.push_back({ c, column, column + strip });
+	}
+
+	ThreadPool& pool = ThreadPool::Get();
+	pool.ParallelFor(0, static_cast<uint32_t>(rowJobs.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			AnimateAndTransformRows(m_cascades[rowJobs[i].cascade], time, rowJobs[i].begin, rowJobs[i].end);
+	});
+	pool.ParallelFor(0, static_cast<uint32_t>(columnJobs.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			TransformColumnsAndPermute(m_cascades[columnJobs[i].cascade], foamParameters, columnJobs[i].begin, columnJobs[i].end);
+	});
+}
@@ -0,0 +1,344 @@
+#include "ocean_h0_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "ocean_hash.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bump whenever the H0 generator (spectrum, noise, packing) changes its output.
+#define OCEAN_H0_CACHE_VERSION 1
+
+using namespace EV;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t CACHE_MAGIC = 0x30484f45; // "EOH0"
+	const char* CACHE_EXTENSION = ".h0";
+
+	struct OceanH0FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t resolution;
+		uint32_t texelSize; // Bytes per texel, RGBA32F
+		uint64_t payloadSize;
+	};
+	static_assert(sizeof(OceanH0FileHeader) == 32, "The header is part of the file format");
+
+	uint64_t PayloadSize(uint32_t resolution)
+	{
+		return static_cast<uint64_t>(resolution) * resolution * 4 * sizeof(float);
+	}
+}
+
+OceanMappedFile::~OceanMappedFile()
+{
+	Close();
+}
+
+OceanMappedFile::OceanMappedFile(OceanMappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+OceanMappedFile& OceanMappedFile::operator=(OceanMappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+#ifdef _WIN32
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+#endif
+	}
+	return *this;
+}
+
+bool OceanMappedFile::Open(const fs::path& path)
+{
+	Close();
+
+#ifdef _WIN32
+	// Share everything, so the cache can still touch, replace or evict the file while it is mapped.
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+	                          nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	void* view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+		view = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<uint64_t>(status.st_size);
+#endif
+	return true;
+}
+
+void OceanMappedFile::Close()
+{
+	if (!m_data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_file = nullptr;
+	m_mapping = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+OceanH0Cache::OceanH0Cache(const fs::path& directory, uint64_t maxSize)
+	: m_directory(directory)
+	, m_maxSize(maxSize)
+{
+	std::error_code error;
+	fs::create_directories(m_directory, error);
+}
+
+uint64_t OceanH0Cache::MakeKey(const JonswapParameters& params, const OceanCascadeDesc& cascade, uint64_t seed, uint32_t cascadeIndex)
+{
+	OceanHasher hasher;
+	hasher.Add(static_cast<uint32_t>(OCEAN_H0_CACHE_VERSION));
+
+	hasher.Add(params.scale);
+	hasher.Add(params.spreadBlend);
+	hasher.Add(params.swell);
+	hasher.Add(params.gamma);
+	hasher.Add(params.shortWavesFade);
+	hasher.Add(params.windDirection);
+	hasher.Add(params.fetch);
+	hasher.Add(params.windSpeed);
+	hasher.Add(params.angle);
+	hasher.Add(params.alpha);
+	hasher.Add(params.peakOmega);
+
+	hasher.Add(cascade.patchSize);
+	hasher.Add(cascade.lowCutoff);
+	hasher.Add(cascade.highCutoff);
+	hasher.Add(cascade.depth);
+	hasher.Add(cascade.resolution);
+
+	hasher.Add(seed);
+	hasher.Add(cascadeIndex);
+	return hasher.Get();
+}
+
+fs::path OceanH0Cache::GetPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return m_directory / (std::string(name) + CACHE_EXTENSION);
+}
+
+bool OceanH0Cache::Load(uint64_t key, uint32_t resolution, OceanCachedH0& outH0)
+{
+	const fs::path path = GetPath(key);
+
+	OceanMappedFile file;
+	if (!file.Open(path))
+	{
+		++m_misses;
+		return false;
+	}
+
+	// Reject anything that doesn't look exactly like what Store writes.
+	OceanH0FileHeader header;
+	bool valid = file.GetSize() >= sizeof(header);
+	if (valid)
+	{
+		std::memcpy(&header, file.GetData(), sizeof(header));
+		valid = header.magic == CACHE_MAGIC && header.version == OCEAN_H0_CACHE_VERSION && header.key == key &&
+			header.resolution == resolution && header.texelSize == 4 * sizeof(float) &&
+			header.payloadSize == PayloadSize(resolution) && file.GetSize() == sizeof(header) + header.payloadSize;
+	}
+
+	if (!valid)
+	{
+		file.Close();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::error_code error;
+		fs::remove(path, error);
+		++m_misses;
+		return false;
+	}
+
+	// Touch the entry so the eviction sees it as recently used.
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::error_code error;
+		fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+	}
+
+	outH0.file = std::move(file);
+	outH0.packedH0 = reinterpret_cast<const float*>(outH0.file.GetData() + sizeof(header));
+	outH0.resolution = resolution;
+	++m_hits;
+	return true;
+}
+
+bool OceanH0Cache::Store(uint64_t key, uint32_t resolution, const float* packedH0)
+{
+	OceanH0FileHeader header = {};
+	header.magic = CACHE_MAGIC;
+	header.version = OCEAN_H0_CACHE_VERSION;
+	header.key = key;
+	header.resolution = resolution;
+	header.texelSize = 4 * sizeof(float);
+	header.payloadSize = PayloadSize(resolution);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const fs::path path = GetPath(key);
+	fs::path temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(packedH0), static_cast<std::streamsize>(header.payloadSize));
+		if (!file)
+		{
+			file.close();
+			std::error_code error;
+			fs::remove(temporaryPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(temporaryPath, path, error);
+	if (error)
+	{
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+
+	TrimLocked();
+	return true;
+}
+
+void OceanH0Cache::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TrimLocked();
+}
+
+void OceanH0Cache::TrimLocked()
+{
+	struct Entry
+	{
+		fs::path path;
+		uint64_t size;
+		fs::file_time_type lastUse;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t totalSize = 0;
+
+	std::error_code error;
+	for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+	{
+		if (!file.is_regular_file(error) || file.path().extension() != CACHE_EXTENSION)
+			continue;
+
+		Entry entry{ file.path(), file.file_size(error), file.last_write_time(error) };
+		if (error)
+			continue;
+
+		totalSize += entry.size;
+		entries.push_back(std::move(entry));
+	}
+
+	if (totalSize <= m_maxSize)
+		return;
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+	for (const Entry& entry : entries)
+	{
+		if (totalSize <= m_maxSize)
+			break;
+
+		if (fs::remove(entry.path, error))
+			totalSize -= entry.size;
+	}
+}
+
+void OceanH0Cache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code error;
+	for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+	{
+		if (file.path().extension() == CACHE_EXTENSION)
+			fs::remove(file.path(), error);
+	}
+}
+
+uint64_t OceanH0Cache::GetSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint64_t totalSize = 0;
+	std::error_code error;
+	for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+	{
+		if (file.path().extension() == CACHE_EXTENSION && file.is_regular_file(error))
+			totalSize += file.file_size(error);
+	}
+	return totalSize;
+}
@@ -0,0 +1,164 @@
+#include "ocean_half.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace EV;
+
+// The project builds for the SSE2 baseline, the F16C functions are compiled
+// for it on their own and only called after the CPUID check.
+#if defined(__GNUC__) || defined(__clang__)
+#define OCEAN_TARGET_F16C __attribute__((target("f16c")))
+#else
+#define OCEAN_TARGET_F16C
+#endif
+
+namespace
+{
+	bool DetectF16C()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		const bool f16c = (info[2] & (1 << 29)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		// The instructions are VEX encoded, the OS has to save the AVX state.
+		return f16c && avx && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("f16c");
+#endif
+	}
+
+	OCEAN_TARGET_F16C void FromFloatF16C(const float* values, uint16_t* outHalves, size_t count, float scale)
+	{
+		const __m128 scale4 = _mm_set1_ps(scale);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i low = _mm_cvtps_ph(_mm_mul_ps(_mm_loadu_ps(values + i), scale4), _MM_FROUND_TO_NEAREST_INT);
+			const __m128i high = _mm_cvtps_ph(_mm_mul_ps(_mm_loadu_ps(values + i + 4), scale4), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outHalves + i), _mm_unpacklo_epi64(low, high));
+		}
+		for (; i < count; ++i)
+			outHalves[i] = OceanHalf::FromFloat(values[i] * scale);
+	}
+
+	OCEAN_TARGET_F16C void ToFloatF16C(const uint16_t* halves, float* outValues, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + i));
+			_mm_storeu_ps(outValues + i, _mm_cvtph_ps(packed));
+			_mm_storeu_ps(outValues + i + 4, _mm_cvtph_ps(_mm_unpackhi_epi64(packed, packed)));
+		}
+		for (; i < count; ++i)
+			outValues[i] = OceanHalf::ToFloat(halves[i]);
+	}
+}
+
+// Round to nearest even, overflows to infinity.
+uint16_t OceanHalf::FromFloat(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t magnitude = bits & 0x7fffffff;
+
+	if (magnitude >= 0x7f800000) // Inf and NaN
+		return static_cast<uint16_t>(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+	if (magnitude >= 0x477ff000) // Rounds past 65504
+		return static_cast<uint16_t>(sign | 0x7c00);
+	if (magnitude < 0x38800000) // Below 2^-14, subnormal halves count in steps of 2^-24
+	{
+		float absolute;
+		std::memcpy(&absolute, &magnitude, sizeof(absolute));
+		return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(absolute * 16777216.0f)));
+	}
+
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	const uint32_t remainder = magnitude & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		++half;
+	return static_cast<uint16_t>(sign | half);
+}
+
+float OceanHalf::ToFloat(uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		float value = mantissa * (1.0f / 16777216.0f);
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits |= sign;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void OceanHalf::FromFloat(const float* values, uint16_t* outHalves, size_t count, float scale)
+{
+	if (HasF16C())
+	{
+		FromFloatF16C(values, outHalves, count, scale);
+		return;
+	}
+	for (size_t i = 0; i < count; ++i)
+		outHalves[i] = FromFloat(values[i] * scale);
+}
+
+void OceanHalf::ToFloat(const uint16_t* halves, float* outValues, size_t count)
+{
+	if (HasF16C())
+	{
+		ToFloatF16C(halves, outValues, count);
+		return;
+	}
+	for (size_t i = 0; i < count; ++i)
+		outValues[i] = ToFloat(halves[i]);
+}
+
+float OceanHalf::RangeScale(const float* values, size_t count)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 maximum4 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		maximum4 = _mm_max_ps(maximum4, _mm_and_ps(_mm_loadu_ps(values + i), absMask));
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, maximum4);
+	float maximum = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+	for (; i < count; ++i)
+		maximum = std::max(maximum, std::abs(values[i]));
+	if (!(maximum > 0.0f) || !std::isfinite(maximum))
+		return 1.0f;
+
+	// maximum = m 2^e with m in [0.5, 1).
+	int exponent;
+	std::frexp(maximum, &exponent);
+	return std::ldexp(1.0f, 14 - exponent);
+}
+
+bool OceanHalf::HasF16C()
+{
+	static const bool hasF16C = DetectF16C();
+	return hasF16C;
+}
@@ -0,0 +1,395 @@
+#include "ocean_ibl_baker.h"
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include "utility/thread_pool.h"
+
+using namespace EV;
+
+#define PI 3.14159265358979323846
+
+namespace
+{
+	// Texel rows per thread pool job.
+	constexpr uint32_t ROWS_PER_JOB = 4;
+
+	// Rows of RotateUV in pano_to_cubemap_CS.hlsl, direction = R (u, v, 1).
+	constexpr float FACE_ROTATION[6][9] = {
+		{ 0, 0, 1, 0, -1, 0, -1, 0, 0 },  // +X
+		{ 0, 0, -1, 0, -1, 0, 1, 0, 0 },  // -X
+		{ 1, 0, 0, 0, 0, 1, 0, 1, 0 },    // +Y
+		{ 1, 0, 0, 0, 0, -1, 0, -1, 0 },  // -Y
+		{ 1, 0, 0, 0, -1, 0, 0, 0, 1 },   // +Z
+		{ -1, 0, 0, 0, -1, 0, 0, 0, -1 }, // -Z
+	};
+
+	// Unit direction through the centre of texel (i, j) of a face.
+	inline void TexelDirection(uint32_t face, uint32_t i, uint32_t j, uint32_t size, float outDirection[3])
+	{
+		const float u = (i + 0.5f) * 2.0f / size - 1.0f;
+		const float v = (j + 0.5f) * 2.0f / size - 1.0f;
+		const float* R = FACE_ROTATION[face];
+		const float inverseLength = 1.0f / std::sqrt(u * u + v * v + 1.0f);
+		for (uint32_t k = 0; k < 3; ++k)
+			outDirection[k] = (R[k * 3 + 0] * u + R[k * 3 + 1] * v + R[k * 3 + 2]) * inverseLength;
+	}
+
+	// The inverse of TexelDirection, the face of the major axis and (u, v) in [-1, 1].
+	inline uint32_t DirectionToFace(float x, float y, float z, float& outU, float& outV)
+	{
+		const float ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+		if (ax >= ay && ax >= az)
+		{
+			outU = (x > 0.0f ? -z : z) / ax;
+			outV = -y / ax;
+			return x > 0.0f ? 0 : 1;
+		}
+		if (ay >= az)
+		{
+			outU = x / ay;
+			outV = (y > 0.0f ? z : -z) / ay;
+			return y > 0.0f ? 2 : 3;
+		}
+		outU = (z > 0.0f ? x : -x) / az;
+		outV = -y / az;
+		return z > 0.0f ? 4 : 5;
+	}
+
+	inline void SampleFace(const float* texels, uint32_t size, float u, float v, float weight, float inOutRgb[3])
+	{
+		const float x = std::clamp((u + 1.0f) * 0.5f * size - 0.5f, 0.0f, size - 1.0f);
+		const float y = std::clamp((v + 1.0f) * 0.5f * size - 0.5f, 0.0f, size - 1.0f);
+		const uint32_t x0 = static_cast<uint32_t>(x), y0 = static_cast<uint32_t>(y);
+		const uint32_t x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+		const float fx = x - x0, fy = y - y0;
+
+		const float* t00 = texels + (size_t(y0) * size + x0) * 4;
+		const float* t10 = texels + (size_t(y0) * size + x1) * 4;
+		const float* t01 = texels + (size_t(y1) * size + x0) * 4;
+		const float* t11 = texels + (size_t(y1) * size + x1) * 4;
+		const float w00 = (1.0f - fx) * (1.0f - fy) * weight, w10 = fx * (1.0f - fy) * weight;
+		const float w01 = (1.0f - fx) * fy * weight, w11 = fx * fy * weight;
+		for (uint32_t c = 0; c < 3; ++c)
+			inOutRgb[c] += t00[c] * w00 + t10[c] * w10 + t01[c] * w01 + t11[c] * w11;
+	}
+
+	// Van der Corput sequence, the second coordinate of the Hammersley points.
+	inline float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return float(bits) * 2.3283064365386963e-10f;
+	}
+
+	// Half vector of Hammersley point i of count around +z, like ImportanceSampleGGX.
+	inline void ImportanceSampleGGX(uint32_t i, uint32_t count, float roughness, float outH[3])
+	{
+		const float a = roughness * roughness;
+		const float phi = float(2.0 * PI) * i / count;
+		const float xi = RadicalInverse(i);
+		const float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (a * a - 1.0f) * xi));
+		const float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+		outH[0] = std::cos(phi) * sinTheta;
+		outH[1] = std::sin(phi) * sinTheta;
+		outH[2] = cosTheta;
+	}
+
+	inline float DistributionGGX(float NdotH, float roughness)
+	{
+		const float a = roughness * roughness;
+		const float a2 = a * a;
+		const float denominator = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+		return a2 / (float(PI) * denominator * denominator);
+	}
+
+	inline float GeometrySchlickGGX(float NdotV, float roughness)
+	{
+		// k = roughness^2 / 2, the remapping for image based lighting.
+		const float k = roughness * roughness * 0.5f;
+		return NdotV / std::max(NdotV * (1.0f - k) + k, 0.000001f);
+	}
+
+	// The split sum over precomputed half vectors of one roughness.
+	void IntegrateHalfVectors(float NdotV, float roughness, const float* halfVectors, uint32_t sampleCount, float outScaleBias[2])
+	{
+		// N = +z, V in the xz plane.
+		const float V[3] = { std::sqrt(std::max(1.0f - NdotV * NdotV, 0.0f)), 0.0f, NdotV };
+		const float viewGeometry = GeometrySchlickGGX(NdotV, roughness);
+
+		float scale = 0.0f, bias = 0.0f;
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			const float* H = halfVectors + size_t(i) * 3;
+			const float VdotH = std::max(V[0] * H[0] + V[2] * H[2], 0.0f);
+			const float NdotL = 2.0f * VdotH * H[2] - V[2];
+			if (NdotL <= 0.0f)
+				continue;
+
+			const float visibility = viewGeometry * GeometrySchlickGGX(NdotL, roughness) * VdotH / (H[2] * NdotV);
+			const float oneMinusVdotH = 1.0f - VdotH;
+			const float squared = oneMinusVdotH * oneMinusVdotH;
+			const float fresnel = squared * squared * oneMinusVdotH;
+			scale += (1.0f - fresnel) * visibility;
+			bias += fresnel * visibility;
+		}
+		outScaleBias[0] = scale / sampleCount;
+		outScaleBias[1] = bias / sampleCount;
+	}
+
+	// A sample of the GGX lobe around +z with V = N: the light direction, its
+	// weight NdotL and the source mip it reads.
+	struct LobeSample
+	{
+		float direction[3];
+		float weight;
+		float mip;
+	};
+
+	std::vector<LobeSample> BuildLobe(float roughness, uint32_t sampleCount, uint32_t environmentSize, uint32_t environmentMips)
+	{
+		const float texelSolidAngle = float(4.0 * PI) / (6.0f * environmentSize * environmentSize);
+		std::vector<LobeSample> lobe;
+		lobe.reserve(sampleCount);
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			float H[3];
+			ImportanceSampleGGX(i, sampleCount, roughness, H);
+			// L = 2 (V.H) H - V with V = (0, 0, 1).
+			const float L[3] = { 2.0f * H[2] * H[0], 2.0f * H[2] * H[1], 2.0f * H[2] * H[2] - 1.0f };
+			if (L[2] <= 0.0f)
+				continue;
+
+			// pdf = D NdotH / (4 HdotV), NdotH = HdotV with V = N.
+			const float pdf = DistributionGGX(H[2], roughness) * 0.25f + 0.0001f;
+			const float sampleSolidAngle = 1.0f / (sampleCount * pdf + 0.0001f);
+			const float mip = std::clamp(0.5f * std::log2(sampleSolidAngle / texelSolidAngle), 0.0f, float(environmentMips - 1));
+			lobe.push_back({ { L[0], L[1], L[2] }, L[2], mip });
+		}
+		return lobe;
+	}
+}
+
+size_t OceanCubemap::GetOffset(uint32_t face, uint32_t mip) const
+{
+	size_t faceTexels = 0;
+	for (uint32_t m = 0; m < mipLevels; ++m)
+		faceTexels += size_t(GetMipSize(m)) * GetMipSize(m);
+
+	size_t offset = face * faceTexels;
+	for (uint32_t m = 0; m < mip; ++m)
+		offset += size_t(GetMipSize(m)) * GetMipSize(m);
+	return offset * 4;
+}
+
+OceanCubemap OceanIBLBaker::PanoramaToCubemap(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t size)
+{
+	assert(rgba && width > 0 && height > 0 && size > 0);
+	if (rowPitch == 0)
+		rowPitch = width * 4;
+
+	OceanCubemap cubemap;
+	cubemap.size = size;
+	cubemap.mipLevels = 1;
+	while ((size >> cubemap.mipLevels) > 0)
+		++cubemap.mipLevels;
+	cubemap.texels.resize(cubemap.GetOffset(6, 0));
+
+	ThreadPool::Get().ParallelFor(0, 6 * size, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t row = begin; row < end; ++row)
+			{
+				const uint32_t face = row / size, j = row % size;
+				float* out = cubemap.GetFace(face, 0) + size_t(j) * size * 4;
+				for (uint32_t i = 0; i < size; ++i)
+				{
+					// u = atan2(-x, -z) / 2pi, v = acos(y) / pi, bilinear, wrapping around in u.
+					float d[3];
+					TexelDirection(face, i, j, size, d);
+					float u = static_cast<float>(std::atan2(-d[0], -d[2]) / (2.0 * PI));
+					u -= std::floor(u);
+					const float v = static_cast<float>(std::acos(std::clamp(d[1], -1.0f, 1.0f)) / PI);
+
+					const float x = u * width - 0.5f;
+					const float y = std::clamp(v * height - 0.5f, 0.0f, float(height - 1));
+					const float x0f = std::floor(x);
+					const uint32_t x0 = static_cast<uint32_t>(x0f + width) % width, x1 = (x0 + 1) % width;
+					const uint32_t y0 = static_cast<uint32_t>(y), y1 = std::min(y0 + 1, height - 1);
+					const float fx = x - x0f, fy = y - y0;
+
+					const float* r0 = rgba + size_t(y0) * rowPitch;
+					const float* r1 = rgba + size_t(y1) * rowPitch;
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						const float top = r0[x0 * 4 + c] + (r0[x1 * 4 + c] - r0[x0 * 4 + c]) * fx;
+						const float bottom = r1[x0 * 4 + c] + (r1[x1 * 4 + c] - r1[x0 * 4 + c]) * fx;
+						out[i * 4 + c] = top + (bottom - top) * fy;
+					}
+				}
+			}
+		});
+
+	GenerateMips(cubemap);
+	return cubemap;
+}
+
+void OceanIBLBaker::GenerateMips(OceanCubemap& cubemap)
+{
+	for (uint32_t mip = 1; mip < cubemap.mipLevels; ++mip)
+	{
+		const uint32_t size = cubemap.GetMipSize(mip);
+		const uint32_t sourceSize = cubemap.GetMipSize(mip - 1);
+		ThreadPool::Get().ParallelFor(0, 6 * size, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t row = begin; row < end; ++row)
+				{
+					const uint32_t face = row / size, j = row % size;
+					const float* top = cubemap.GetFace(face, mip - 1) + size_t(std::min(2 * j, sourceSize - 1)) * sourceSize * 4;
+					const float* bottom = cubemap.GetFace(face, mip - 1) + size_t(std::min(2 * j + 1, sourceSize - 1)) * sourceSize * 4;
+					float* out = cubemap.GetFace(face, mip) + size_t(j) * size * 4;
+					for (uint32_t i = 0; i < size; ++i)
+					{
+						const uint32_t x0 = std::min(2 * i, sourceSize - 1) * 4, x1 = std::min(2 * i + 1, sourceSize - 1) * 4;
+						for (uint32_t c = 0; c < 4; ++c)
+							out[i * 4 + c] = 0.25f * (top[x0 + c] + top[x1 + c] + bottom[x0 + c] + bottom[x1 + c]);
+					}
+				}
+			});
+	}
+}
+
+void OceanIBLBaker::Sample(const OceanCubemap& cubemap, float x, float y, float z, float mip, float outRgb[3])
+{
+	float u, v;
+	const uint32_t face = DirectionToFace(x, y, z, u, v);
+
+	mip = std::clamp(mip, 0.0f, float(cubemap.mipLevels - 1));
+	const uint32_t mip0 = static_cast<uint32_t>(mip);
+	const uint32_t mip1 = std::min(mip0 + 1, cubemap.mipLevels - 1);
+	const float blend = mip - mip0;
+
+	outRgb[0] = outRgb[1] = outRgb[2] = 0.0f;
+	SampleFace(cubemap.GetFace(face, mip0), cubemap.GetMipSize(mip0), u, v, 1.0f - blend, outRgb);
+	if (blend > 0.0f)
+		SampleFace(cubemap.GetFace(face, mip1), cubemap.GetMipSize(mip1), u, v, blend, outRgb);
+}
+
+OceanCubemap OceanIBLBaker::PrefilterSpecular(const OceanCubemap& environment, uint32_t size, uint32_t mipLevels, uint32_t sampleCount)
+{
+	assert(environment.size > 0 && size > 0 && mipLevels > 0 && sampleCount > 0);
+
+	OceanCubemap specular;
+	specular.size = size;
+	specular.mipLevels = mipLevels;
+	specular.texels.resize(specular.GetOffset(6, 0));
+
+	for (uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		const uint32_t mipSize = specular.GetMipSize(mip);
+		const float roughness = mipLevels > 1 ? float(mip) / (mipLevels - 1) : 0.0f;
+
+		// A mirror reads the one environment mip whose texels match its own.
+		std::vector<LobeSample> lobe;
+		if (roughness > 0.0f)
+			lobe = BuildLobe(roughness, sampleCount, environment.size, environment.mipLevels);
+		else
+			lobe.push_back({ { 0.0f, 0.0f, 1.0f }, 1.0f, std::log2(float(environment.size) / mipSize) });
+
+		float totalWeight = 0.0f;
+		for (const LobeSample& sample : lobe)
+			totalWeight += sample.weight;
+		const float inverseWeight = 1.0f / std::max(totalWeight, 0.001f);
+
+		ThreadPool::Get().ParallelFor(0, 6 * mipSize, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t row = begin; row < end; ++row)
+				{
+					const uint32_t face = row / mipSize, j = row % mipSize;
+					float* out = specular.GetFace(face, mip) + size_t(j) * mipSize * 4;
+					for (uint32_t i = 0; i < mipSize; ++i)
+					{
+						float N[3];
+						TexelDirection(face, i, j, mipSize, N);
+
+						// The tangent frame of ImportanceSampleGGX.
+						const float up[3] = { std::abs(N[2]) < 0.999f ? 0.0f : 1.0f, 0.0f, std::abs(N[2]) < 0.999f ? 1.0f : 0.0f };
+						float T[3] = { up[1] * N[2] - up[2] * N[1], up[2] * N[0] - up[0] * N[2], up[0] * N[1] - up[1] * N[0] };
+						const float inverseLength = 1.0f / std::sqrt(T[0] * T[0] + T[1] * T[1] + T[2] * T[2]);
+						T[0] *= inverseLength, T[1] *= inverseLength, T[2] *= inverseLength;
+						const float B[3] = { N[1] * T[2] - N[2] * T[1], N[2] * T[0] - N[0] * T[2], N[0] * T[1] - N[1] * T[0] };
+
+						float color[3] = {};
+						for (const LobeSample& sample : lobe)
+						{
+							const float* l = sample.direction;
+							const float L[3] = {
+								T[0] * l[0] + B[0] * l[1] + N[0] * l[2],
+								T[1] * l[0] + B[1] * l[1] + N[1] * l[2],
+								T[2] * l[0] + B[2] * l[1] + N[2] * l[2],
+							};
+							float rgb[3];
+							Sample(environment, L[0], L[1], L[2], sample.mip, rgb);
+							for (uint32_t c = 0; c < 3; ++c)
+								color[c] += rgb[c] * sample.weight;
+						}
+
+						for (uint32_t c = 0; c < 3; ++c)
+							out[i * 4 + c] = color[c] * inverseWeight;
+						out[i * 4 + 3] = 1.0f;
+					}
+				}
+			});
+	}
+	return specular;
+}
+
+void OceanIBLBaker::IntegrateBrdf(float NdotV, float roughness, uint32_t sampleCount, float outScaleBias[2])
+{
+	std::vector<float> halfVectors(size_t(sampleCount) * 3);
+	for (uint32_t i = 0; i < sampleCount; ++i)
+		ImportanceSampleGGX(i, sampleCount, roughness, &halfVectors[size_t(i) * 3]);
+	IntegrateHalfVectors(NdotV, roughness, halfVectors.data(), sampleCount, outScaleBias);
+}
+
+std::vector<float> OceanIBLBaker::IntegrateBrdf(uint32_t size, uint32_t sampleCount)
+{
+	std::vector<float> lut(size_t(size) * size * 2);
+	ThreadPool::Get().ParallelFor(0, size, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			// The half vectors only depend on the roughness of the row.
+			std::vector<float> halfVectors(size_t(sampleCount) * 3);
+			for (uint32_t j = begin; j < end; ++j)
+			{
+				const float roughness = (j + 0.5f) / size;
+				for (uint32_t i = 0; i < sampleCount; ++i)
+					ImportanceSampleGGX(i, sampleCount, roughness, &halfVectors[size_t(i) * 3]);
+				for (uint32_t i = 0; i < size; ++i)
+					IntegrateHalfVectors((i + 0.5f) / size, roughness, halfVectors.data(), sampleCount, &lut[(size_t(j) * size + i) * 2]);
+			}
+		});
+	return lut;
+}
+
+OceanIBLBake OceanIBLBaker::Bake(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, const OceanIBLBakeSettings& settings)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	auto Milliseconds = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	OceanIBLBake bake;
+	auto start = Clock::now();
+	bake.environment = PanoramaToCubemap(rgba, width, height, rowPitch, settings.cubemapSize);
+	bake.times.cubemap = Milliseconds(start);
+
+	start = Clock::now();
+	bake.irradiance = OceanIrradiance::ProjectPanorama(rgba, width, height, rowPitch);
+	bake.times.irradiance = Milliseconds(start);
+
+	start = Clock::now();
+	bake.specular = PrefilterSpecular(bake.environment, settings.specularSize, settings.specularMipLevels, settings.specularSampleCount);
+	bake.times.specular = Milliseconds(start);
+	return bake;
+}
@@ -0,0 +1,263 @@
+#include "ocean_ibl_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "DX12/dx12_includes.h"
+
+#include "ocean_h0_cache.h"
+#include "ocean_half.h"
+#include "ocean_hash.h"
+
+// Bump whenever the IBL baker (resampling, prefilter, storage) changes its output.
+#define OCEAN_IBL_CACHE_VERSION 2
+
+using namespace EV;
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char* ENVIRONMENT_FILE = "environment";
+	const char* SPECULAR_FILE = "specular";
+	const char* IRRADIANCE_FILE = "irradiance";
+	// Written by version 1, the LUT moved to OceanBrdfLut. Only removed.
+	const char* BRDF_FILE = "brdf";
+	const char* const CACHE_FILES[] = { ENVIRONMENT_FILE, SPECULAR_FILE, IRRADIANCE_FILE };
+	const char* const STALE_FILES[] = { ENVIRONMENT_FILE, SPECULAR_FILE, IRRADIANCE_FILE, BRDF_FILE };
+
+	constexpr DXGI_FORMAT CUBEMAP_FORMAT = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	constexpr DXGI_FORMAT IRRADIANCE_FORMAT = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	// Largest finite half, the sun of an HDR panorama can go past it.
+	constexpr float HALF_MAX = 65504.0f;
+
+	uint32_t FullMipCount(uint32_t size)
+	{
+		uint32_t mipLevels = 1;
+		while ((size >> mipLevels) > 0)
+			++mipLevels;
+		return mipLevels;
+	}
+
+	// Packs rows of floats into the half float rows of an image.
+	void StoreHalfRows(const float* values, uint32_t width, uint32_t height, uint32_t channels, const Image& image)
+	{
+		std::vector<float> row(size_t(width) * channels);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const float* source = values + size_t(y) * width * channels;
+			std::transform(source, source + row.size(), row.begin(), [](float value) { return std::clamp(value, -HALF_MAX, HALF_MAX); });
+			OceanHalf::FromFloat(row.data(), reinterpret_cast<uint16_t*>(image.pixels + y * image.rowPitch), row.size());
+		}
+	}
+
+	bool StoreCubemap(const OceanCubemap& cubemap, ScratchImage& outImage)
+	{
+		if (FAILED(outImage.InitializeCube(CUBEMAP_FORMAT, cubemap.size, cubemap.size, 1, cubemap.mipLevels)))
+			return false;
+
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t mip = 0; mip < cubemap.mipLevels; ++mip)
+			{
+				const uint32_t size = cubemap.GetMipSize(mip);
+				StoreHalfRows(cubemap.GetFace(face, mip), size, size, 4, *outImage.GetImage(mip, face, 0));
+			}
+		}
+		return true;
+	}
+
+	bool IsCubemap(const TexMetadata& metadata, uint32_t size, uint32_t mipLevels)
+	{
+		return metadata.IsCubemap() && metadata.format == CUBEMAP_FORMAT && metadata.width == size && metadata.height == size &&
+			metadata.arraySize == 6 && metadata.mipLevels == mipLevels;
+	}
+
+	bool IsImage(const TexMetadata& metadata, DXGI_FORMAT format, uint32_t width, uint32_t height)
+	{
+		return metadata.dimension == TEX_DIMENSION_TEXTURE2D && !metadata.IsCubemap() && metadata.format == format &&
+			metadata.width == width && metadata.height == height && metadata.arraySize == 1 && metadata.mipLevels == 1;
+	}
+
+	// Writes a temporary file and renames it over the entry.
+	bool SaveFile(const ScratchImage& image, const fs::path& path)
+	{
+		fs::path temporaryPath = path;
+		temporaryPath += ".tmp";
+
+		std::error_code error;
+		if (FAILED(SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DDS_FLAGS_NONE, temporaryPath.c_str())))
+		{
+			fs::remove(temporaryPath, error);
+			return false;
+		}
+
+		fs::rename(temporaryPath, path, error);
+		if (error)
+		{
+			fs::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+}
+
+OceanIBLCache::OceanIBLCache(const fs::path& panorama, const OceanIBLBakeSettings& settings)
+	: m_panorama(panorama)
+	, m_settings(settings)
+{
+	OceanMappedFile file;
+	if (!file.Open(m_panorama))
+		return;
+
+	OceanHasher hasher;
+	hasher.Add(static_cast<uint32_t>(OCEAN_IBL_CACHE_VERSION));
+	hasher.Add(file.GetSize());
+	hasher.Add(file.GetData(), static_cast<size_t>(file.GetSize()));
+
+	hasher.Add(m_settings.cubemapSize);
+	hasher.Add(m_settings.specularSize);
+	hasher.Add(m_settings.specularMipLevels);
+	hasher.Add(m_settings.specularSampleCount);
+	m_key = hasher.Get();
+}
+
+fs::path OceanIBLCache::GetPath(const char* name) const
+{
+	char suffix[64];
+	std::snprintf(suffix, sizeof(suffix), ".%016llx.%s.dds", static_cast<unsigned long long>(m_key), name);
+
+	fs::path path = m_panorama;
+	path.replace_extension();
+	path += suffix;
+	return path;
+}
+
+bool OceanIBLCache::Load(OceanIBLCacheEntry& outEntry) const
+{
+	if (m_key == 0)
+		return false;
+
+	for (const char* name : CACHE_FILES)
+	{
+		std::error_code error;
+		if (!fs::exists(GetPath(name), error))
+			return false;
+	}
+
+	// Reject anything that doesn't look exactly like what Bake writes.
+	TexMetadata environment, specular, irradiance;
+	ScratchImage irradianceImage;
+	bool valid =
+		SUCCEEDED(LoadFromDDSFile(GetPath(ENVIRONMENT_FILE).c_str(), DDS_FLAGS_NONE, &environment, outEntry.environment)) &&
+		SUCCEEDED(LoadFromDDSFile(GetPath(SPECULAR_FILE).c_str(), DDS_FLAGS_NONE, &specular, outEntry.specular)) &&
+		SUCCEEDED(LoadFromDDSFile(GetPath(IRRADIANCE_FILE).c_str(), DDS_FLAGS_NONE, &irradiance, irradianceImage));
+	valid = valid &&
+		IsCubemap(environment, m_settings.cubemapSize, FullMipCount(m_settings.cubemapSize)) &&
+		IsCubemap(specular, m_settings.specularSize, m_settings.specularMipLevels) &&
+		IsImage(irradiance, IRRADIANCE_FORMAT, 9, 1);
+
+	if (!valid)
+	{
+		for (const char* name : CACHE_FILES)
+		{
+			std::error_code error;
+			fs::remove(GetPath(name), error);
+		}
+		return false;
+	}
+
+	const float* coefficients = reinterpret_cast<const float*>(irradianceImage.GetImage(0, 0, 0)->pixels);
+	for (uint32_t k = 0; k < 9; ++k)
+		for (uint32_t c = 0; c < 3; ++c)
+			outEntry.irradiance.rgb[k][c] = coefficients[k * 4 + c];
+	return true;
+}
+
+bool OceanIBLCache::Bake(OceanIBLCacheEntry& outEntry, OceanIBLBakeTimes* outTimes) const
+{
+	TexMetadata metadata;
+	ScratchImage panorama;
+	if (FAILED(LoadFromHDRFile(m_panorama.c_str(), &metadata, panorama)))
+		return false;
+
+	const Image* image = panorama.GetImage(0, 0, 0);
+	ScratchImage converted;
+	if (image->format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+	{
+		if (FAILED(Convert(*image, DXGI_FORMAT_R32G32B32A32_FLOAT, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, converted)))
+			return false;
+		image = converted.GetImage(0, 0, 0);
+	}
+
+	const OceanIBLBake bake = OceanIBLBaker::Bake(reinterpret_cast<const float*>(image->pixels), static_cast<uint32_t>(image->width),
+	                                              static_cast<uint32_t>(image->height), static_cast<uint32_t>(image->rowPitch / sizeof(float)), m_settings);
+	if (outTimes)
+		*outTimes = bake.times;
+
+	ScratchImage irradiance;
+	if (!StoreCubemap(bake.environment, outEntry.environment) || !StoreCubemap(bake.specular, outEntry.specular) ||
+		FAILED(irradiance.Initialize2D(IRRADIANCE_FORMAT, 9, 1, 1, 1)))
+		return false;
+
+	float* coefficients = reinterpret_cast<float*>(irradiance.GetImage(0, 0, 0)->pixels);
+	for (uint32_t k = 0; k < 9; ++k)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			coefficients[k * 4 + c] = static_cast<float>(bake.irradiance.rgb[k][c]);
+		coefficients[k * 4 + 3] = 0.0f;
+	}
+	outEntry.irradiance = bake.irradiance;
+
+	// The entry is usable either way, a failed store only means the next start bakes again.
+	if (m_key != 0 &&
+		SaveFile(outEntry.environment, GetPath(ENVIRONMENT_FILE)) && SaveFile(outEntry.specular, GetPath(SPECULAR_FILE)) &&
+		SaveFile(irradiance, GetPath(IRRADIANCE_FILE)))
+		RemoveStaleFiles();
+	return true;
+}
+
+bool OceanIBLCache::LoadOrBake(OceanIBLCacheEntry& outEntry, bool* outHit, OceanIBLBakeTimes* outTimes) const
+{
+	const bool hit = Load(outEntry);
+	if (outHit)
+		*outHit = hit;
+	return hit || Bake(outEntry, outTimes);
+}
+
+void OceanIBLCache::RemoveStaleFiles() const
+{
+	// <name>.<16 hex digits>.<file>.dds of any key but this one.
+	fs::path prefix = m_panorama.filename();
+	prefix.replace_extension();
+	prefix += ".";
+	const fs::path::string_type& prefixName = prefix.native();
+
+	std::error_code error;
+	const fs::path directory = m_panorama.has_parent_path() ? m_panorama.parent_path() : fs::path(".");
+	for (const fs::directory_entry& file : fs::directory_iterator(directory, error))
+	{
+		const fs::path::string_type name = file.path().filename().native();
+		if (name.size() <= prefixName.size() + 17 || name.compare(0, prefixName.size(), prefixName) != 0 || name[prefixName.size() + 16] != '.')
+			continue;
+
+		const bool hexKey = std::all_of(name.begin() + prefixName.size(), name.begin() + prefixName.size() + 16, [](auto c)
+			{
+				return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+			});
+		if (!hexKey)
+			continue;
+
+		for (const char* cacheFile : STALE_FILES)
+		{
+			fs::path suffix = ".";
+			suffix += cacheFile;
+			suffix += ".dds";
+			const fs::path::string_type& suffixName = suffix.native();
+			if (name.size() == prefixName.size() + 16 + suffixName.size() && name.compare(prefixName.size() + 16, suffixName.size(), suffixName) == 0 &&
+				file.path() != GetPath(cacheFile))
+				fs::remove(file.path(), error);
+		}
+	}
+}
@@ -0,0 +1,351 @@
+#include "ocean_irradiance.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "ocean_simd.h"
+#include "utility/thread_pool.h"
+
+using namespace EV;
+using namespace EV::simd;
+
+#define PI 3.14159265358979323846
+
+namespace
+{
+	constexpr uint32_t LANES = 4;
+	// Environment rows per thread pool job.
+	constexpr uint32_t ROWS_PER_JOB = 8;
+
+	// Normalization of the basis functions.
+	constexpr double K0 = 0.282094791773878; // 1 / (2 sqrt(pi))
+	constexpr double K1 = 0.488602511902920; // sqrt(3 / (4 pi))
+	constexpr double K2 = 1.092548430592079; // sqrt(15 / (4 pi))
+	constexpr double K3 = 0.315391565252520; // sqrt(5 / (16 pi))
+	constexpr double K4 = 0.546274215296040; // sqrt(15 / (16 pi))
+
+	// Rows of RotateUV in pano_to_cubemap_CS.hlsl, direction = R (u, v, 1).
+	constexpr float FACE_ROTATION[6][9] = {
+		{ 0, 0, 1, 0, -1, 0, -1, 0, 0 },  // +X
+		{ 0, 0, -1, 0, -1, 0, 1, 0, 0 },  // -X
+		{ 1, 0, 0, 0, 0, 1, 0, 1, 0 },    // +Y
+		{ 1, 0, 0, 0, 0, -1, 0, -1, 0 },  // -Y
+		{ 1, 0, 0, 0, -1, 0, 0, 0, 1 },   // +Z
+		{ -1, 0, 0, 0, -1, 0, 0, 0, -1 }, // -Z
+	};
+
+	// Loads 4 RGBA texels as one vector per channel.
+	inline void LoadRgb4(const float* rgba, Vec4* outR, Vec4* outG, Vec4* outB)
+	{
+		Vec4 t0 = Load(rgba);
+		Vec4 t1 = Load(rgba + 4);
+		Vec4 t2 = Load(rgba + 8);
+		Vec4 t3 = Load(rgba + 12);
+		_MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+		*outR = t0;
+		*outG = t1;
+		*outB = t2;
+	}
+
+	inline double Sum(Vec4 v)
+	{
+		alignas(16) float lanes[LANES];
+		_mm_store_ps(lanes, v);
+		return (double(lanes[0]) + double(lanes[1])) + (double(lanes[2]) + double(lanes[3]));
+	}
+
+	// Solid angle of the part of a cube face at distance 1 between the origin of the face and (x, y).
+	inline double AreaElement(double x, double y)
+	{
+		return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0));
+	}
+
+	// Sums the rows into one projection in row order, the result doesn't depend on how they were split.
+	OceanSH9 SumRows(const std::vector<double>& rowSums, uint32_t rowCount)
+	{
+		OceanSH9 result;
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			const double* sums = rowSums.data() + row * 27;
+			for (uint32_t k = 0; k < 9; ++k)
+				for (uint32_t c = 0; c < 3; ++c)
+					result.rgb[k][c] += sums[k * 3 + c];
+		}
+		return result;
+	}
+}
+
+OceanSH9 OceanIrradiance::ProjectPanorama(const float* rgba, uint32_t width, uint32_t height, uint32_t rowPitch)
+{
+	assert(rgba && width > 0 && height > 0);
+	if (rowPitch == 0)
+		rowPitch = width * 4;
+
+	// sin, cos, sin^2 and sin cos of the longitude of every column, shared by all rows.
+	std::vector<float> sinPhi(width), cosPhi(width), sinPhi2(width), sinCosPhi(width);
+	for (uint32_t i = 0; i < width; ++i)
+	{
+		const double phi = 2.0 * PI * (i + 0.5) / width;
+		const double s = std::sin(phi), c = std::cos(phi);
+		sinPhi[i] = float(s);
+		cosPhi[i] = float(c);
+		sinPhi2[i] = float(s * s);
+		sinCosPhi[i] = float(s * c);
+	}
+
+	std::vector<double> rowSums(size_t(height) * 27);
+	ThreadPool::Get().ParallelFor(0, height, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t j = begin; j < end; ++j)
+			{
+				const float* row = rgba + size_t(j) * rowPitch;
+
+				// Weighted sums of the row per channel: L, L sin, L cos, L sin^2, L sin cos.
+				Vec4 sum[3][5];
+				for (auto& channel : sum)
+					for (Vec4& s : channel)
+						s = _mm_setzero_ps();
+
+				uint32_t i = 0;
+				for (; i + LANES <= width; i += LANES)
+				{
+					Vec4 L[3];
+					LoadRgb4(row + i * 4, &L[0], &L[1], &L[2]);
+					const Vec4 s = Load(&sinPhi[i]);
+					const Vec4 c = Load(&cosPhi[i]);
+					const Vec4 s2 = Load(&sinPhi2[i]);
+					const Vec4 sc = Load(&sinCosPhi[i]);
+					for (uint32_t ch = 0; ch < 3; ++ch)
+					{
+						sum[ch][0] = _mm_add_ps(sum[ch][0], L[ch]);
+						sum[ch][1] = _mm_add_ps(sum[ch][1], _mm_mul_ps(L[ch], s));
+						sum[ch][2] = _mm_add_ps(sum[ch][2], _mm_mul_ps(L[ch], c));
+						sum[ch][3] = _mm_add_ps(sum[ch][3], _mm_mul_ps(L[ch], s2));
+						sum[ch][4] = _mm_add_ps(sum[ch][4], _mm_mul_ps(L[ch], sc));
+					}
+				}
+
+				double S[3][5];
+				for (uint32_t ch = 0; ch < 3; ++ch)
+					for (uint32_t k = 0; k < 5; ++k)
+						S[ch][k] = Sum(sum[ch][k]);
+				for (; i < width; ++i)
+				{
+					for (uint32_t ch = 0; ch < 3; ++ch)
+					{
+						const double L = row[i * 4 + ch];
+						S[ch][0] += L;
+						S[ch][1] += L * sinPhi[i];
+						S[ch][2] += L * cosPhi[i];
+						S[ch][3] += L * sinPhi2[i];
+						S[ch][4] += L * sinCosPhi[i];
+					}
+				}
+
+				// The row is a band of the sphere, x = -sin(theta) sin(phi), y = cos(theta),
+				// z = -sin(theta) cos(phi). Texels of a band span equal solid angles.
+				const double theta = PI * (j + 0.5) / height;
+				const double st = std::sin(theta), ct = std::cos(theta);
+				const double solidAngle = 2.0 * PI / width * (std::cos(PI * j / height) - std::cos(PI * (j + 1) / height));
+
+				double* out = rowSums.data() + size_t(j) * 27;
+				for (uint32_t ch = 0; ch < 3; ++ch)
+				{
+					const double L = S[ch][0], Ls = S[ch][1], Lc = S[ch][2], Lss = S[ch][3], Lsc = S[ch][4];
+					const double Lcc = L - Lss;
+					out[0 * 3 + ch] = solidAngle * K0 * L;
+					out[1 * 3 + ch] = solidAngle * K1 * ct * L;
+					out[2 * 3 + ch] = solidAngle * K1 * -st * Lc;
+					out[3 * 3 + ch] = solidAngle * K1 * -st * Ls;
+					out[4 * 3 + ch] = solidAngle * K2 * -st * ct * Ls;
+					out[5 * 3 + ch] = solidAngle * K2 * -st * ct * Lc;
+					out[6 * 3 + ch] = solidAngle * K3 * (3.0 * st * st * Lcc - L);
+					out[7 * 3 + ch] = solidAngle * K2 * st * st * Lsc;
+					out[8 * 3 + ch] = solidAngle * K4 * (st * st * Lss - ct * ct * L);
+				}
+			}
+		});
+
+	return SumRows(rowSums, height);
+}
+
+OceanSH9 OceanIrradiance::ProjectCubemap(const float* const faces[6], uint32_t size)
+{
+	assert(size > 0);
+
+	// A texel at (u, v) on the face has the direction (u, v, 1) / l in the space of the face. Along a row
+	// only u and l change, so the products of the direction up to second order are made of 6 sums per
+	// channel with the weights w, w u / l, w / l, w u / l^2, w / l^2, w u^2 / l^2, w the solid angle of
+	// the texel (the difference of the area element at its corners). Only w comes from a table, the
+	// rest is cheaper to compute than to read.
+	constexpr uint32_t MOMENTS = 6;
+	const double texel = 2.0 / size;
+	std::vector<double> corners(size_t(size + 1) * (size + 1));
+	std::vector<float> solidAngles(size_t(size) * size);
+	std::vector<float> columnU(size);
+	for (uint32_t i = 0; i < size; ++i)
+		columnU[i] = float((i + 0.5) * texel - 1.0);
+
+	// The area element is odd in both u and v, only a quarter of the corners needs the atan2.
+	const uint32_t half = size / 2;
+	ThreadPool::Get().ParallelFor(0, half + 1, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t j = begin; j < end; ++j)
+			{
+				double* row = &corners[j * (size + 1)];
+				double* mirroredRow = &corners[(size - j) * (size + 1)];
+				for (uint32_t i = 0; i <= half; ++i)
+				{
+					const double area = AreaElement(i * texel - 1.0, j * texel - 1.0);
+					row[i] = area;
+					row[size - i] = -area;
+					mirroredRow[i] = -area;
+					mirroredRow[size - i] = area;
+				}
+			}
+		});
+	ThreadPool::Get().ParallelFor(0, size, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t j = begin; j < end; ++j)
+			{
+				const double* top = &corners[j * (size + 1)];
+				const double* bottom = top + size + 1;
+				for (uint32_t i = 0; i < size; ++i)
+					solidAngles[j * size + i] = float(top[i] - top[i + 1] - bottom[i] + bottom[i + 1]);
+			}
+		});
+
+	const uint32_t rowCount = 6 * size;
+	std::vector<double> rowSums(size_t(rowCount) * 27);
+	ThreadPool::Get().ParallelFor(0, rowCount, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t row = begin; row < end; ++row)
+			{
+				const uint32_t face = row / size, j = row % size;
+				const float* texelsOfRow = faces[face] + size_t(j) * size * 4;
+				const float* rowSolidAngles = &solidAngles[size_t(j) * size];
+				const double v = (j + 0.5) * texel - 1.0;
+				const Vec4 v2 = Set(float(v * v + 1.0));
+
+				Vec4 sum[3][MOMENTS];
+				for (auto& channel : sum)
+					for (Vec4& s : channel)
+						s = _mm_setzero_ps();
+
+				uint32_t i = 0;
+				for (; i + LANES <= size; i += LANES)
+				{
+					Vec4 L[3];
+					LoadRgb4(texelsOfRow + i * 4, &L[0], &L[1], &L[2]);
+
+					const Vec4 u = Load(&columnU[i]);
+					const Vec4 w = Load(&rowSolidAngles[i]);
+					const Vec4 inverseLength2 = _mm_div_ps(Set(1.0f), _mm_add_ps(_mm_mul_ps(u, u), v2));
+					const Vec4 wl = _mm_mul_ps(w, Sqrt(inverseLength2));
+					const Vec4 wl2 = _mm_mul_ps(w, inverseLength2);
+					const Vec4 wul2 = _mm_mul_ps(wl2, u);
+					const Vec4 weight[MOMENTS] = { w, _mm_mul_ps(wl, u), wl, wul2, wl2, _mm_mul_ps(wul2, u) };
+					for (uint32_t k = 0; k < MOMENTS; ++k)
+						for (uint32_t ch = 0; ch < 3; ++ch)
+							sum[ch][k] = _mm_add_ps(sum[ch][k], _mm_mul_ps(L[ch], weight[k]));
+				}
+
+				double S[3][MOMENTS];
+				for (uint32_t ch = 0; ch < 3; ++ch)
+					for (uint32_t k = 0; k < MOMENTS; ++k)
+						S[ch][k] = Sum(sum[ch][k]);
+				for (; i < size; ++i)
+				{
+					const double u = columnU[i];
+					const double w = rowSolidAngles[i];
+					const double inverseLength2 = 1.0 / (u * u + v * v + 1.0);
+					const double wl = w * std::sqrt(inverseLength2);
+					const double wl2 = w * inverseLength2;
+					const double weight[MOMENTS] = { w, wl * u, wl, wl2 * u, wl2, wl2 * u * u };
+					for (uint32_t ch = 0; ch < 3; ++ch)
+						for (uint32_t k = 0; k < MOMENTS; ++k)
+							S[ch][k] += double(texelsOfRow[i * 4 + ch]) * weight[k];
+				}
+
+				// The first and second moments of the direction in the space of the face,
+				// rotated to world space: m' = R m, M' = R M R^T.
+				const float* R = FACE_ROTATION[face];
+				double* out = rowSums.data() + size_t(row) * 27;
+				for (uint32_t ch = 0; ch < 3; ++ch)
+				{
+					const double* Sc = S[ch];
+					const double m[3] = { Sc[1], v * Sc[2], Sc[2] };
+					const double M[3][3] = {
+						{ Sc[5], v * Sc[3], Sc[3] },
+						{ v * Sc[3], v * v * Sc[4], v * Sc[4] },
+						{ Sc[3], v * Sc[4], Sc[4] },
+					};
+					double world[3] = {}, worldM[3][3] = {};
+					for (uint32_t a = 0; a < 3; ++a)
+					{
+						for (uint32_t p = 0; p < 3; ++p)
+						{
+							world[a] += R[a * 3 + p] * m[p];
+							for (uint32_t b = 0; b < 3; ++b)
+								for (uint32_t q = 0; q < 3; ++q)
+									worldM[a][b] += R[a * 3 + p] * R[b * 3 + q] * M[p][q];
+						}
+					}
+
+					out[0 * 3 + ch] = K0 * Sc[0];
+					out[1 * 3 + ch] = K1 * world[1];
+					out[2 * 3 + ch] = K1 * world[2];
+					out[3 * 3 + ch] = K1 * world[0];
+					out[4 * 3 + ch] = K2 * worldM[0][1];
+					out[5 * 3 + ch] = K2 * worldM[1][2];
+					out[6 * 3 + ch] = K3 * (3.0 * worldM[2][2] - Sc[0]);
+					out[7 * 3 + ch] = K2 * worldM[0][2];
+					out[8 * 3 + ch] = K4 * (worldM[0][0] - worldM[1][1]);
+				}
+			}
+		});
+
+	return SumRows(rowSums, rowCount);
+}
+
+void OceanIrradiance::ToShaderConstants(const OceanSH9& radiance, float outConstants[9][4])
+{
+	// The clamped cosine per band over pi: 1, 2/3 and 1/4.
+	const double band[9] = { 1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+	const double normalization[9] = { K0, K1, K1, K1, K2, K2, K3, K2, K4 };
+
+	for (uint32_t k = 0; k < 9; ++k)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			outConstants[k][c] = float(radiance.rgb[k][c] * band[k] * normalization[k]);
+		outConstants[k][3] = 0.0f;
+	}
+}
+
+void OceanIrradiance::Evaluate(const float constants[9][4], float x, float y, float z, float outRgb[3])
+{
+	// Same as EvaluateIrradiance in pixel.hlsl and ocean_pixel.hlsl.
+	const float polynomial[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		float irradiance = 0.0f;
+		for (uint32_t k = 0; k < 9; ++k)
+			irradiance += constants[k][c] * polynomial[k];
+		outRgb[c] = std::max(irradiance, 0.0f);
+	}
+}
+
+void OceanIrradiance::EvaluateBasis(double x, double y, double z, double outBasis[9])
+{
+	outBasis[0] = K0;
+	outBasis[1] = K1 * y;
+	outBasis[2] = K1 * z;
+	outBasis[3] = K1 * x;
+	outBasis[4] = K2 * x * y;
+	outBasis[5] = K2 * y * z;
+	outBasis[6] = K3 * (3.0 * z * z - 1.0);
+	outBasis[7] = K2 * x * z;
+	outBasis[8] = K4 * (x * x - y * y);
+}
@@ -0,0 +1,161 @@
+#include "ocean_noise.h"
+
+#include <cmath>
+
+#include "ocean_simd.h"
+#include "utility/thread_pool.h"
+
+#define PI 3.14159265359f
+
+using namespace EV;
+
+// Philox4x32-10, Salmon et al. "Parallel random numbers: as easy as 1, 2, 3".
+namespace
+{
+	constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+	constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+	constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+	constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+	constexpr int PHILOX_ROUNDS = 10;
+
+	constexpr uint32_t ROWS_PER_JOB = 16;
+
+	// 24 random bits to a float in [0, 1).
+	constexpr float UINT24_TO_FLOAT = 1.0f / 16777216.0f;
+
+	// High and low 32 bits of a * b for all 4 lanes. SSE2 only has the
+	// unsigned 32x32->64 multiply on the even lanes, so do even and odd separately.
+	void MulHiLo(__m128i a, __m128i b, __m128i* hi, __m128i* lo)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+		*lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		*hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+	}
+
+	// Philox on 4 independent counters at once, one per lane. Only the first
+	// two output words are needed for a Box-Muller pair.
+	void Philox4x32x4(__m128i c0, __m128i c1, __m128i c2, __m128i c3, uint32_t k0, uint32_t k1, __m128i* out0, __m128i* out1)
+	{
+		const __m128i m0 = _mm_set1_epi32(static_cast<int>(PHILOX_M0));
+		const __m128i m1 = _mm_set1_epi32(static_cast<int>(PHILOX_M1));
+
+		for (int round = 0; round < PHILOX_ROUNDS; ++round)
+		{
+			__m128i hi0, lo0, hi1, lo1;
+			MulHiLo(c0, m0, &hi0, &lo0);
+			MulHiLo(c2, m1, &hi1, &lo1);
+
+			c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(static_cast<int>(k0)));
+			c1 = lo1;
+			c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(static_cast<int>(k1)));
+			c3 = lo0;
+
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		*out0 = c0;
+		*out1 = c1;
+	}
+}
+
+void OceanNoise::Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+{
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < PHILOX_ROUNDS; ++round)
+	{
+		uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0;
+		uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2;
+
+		uint32_t hi0 = static_cast<uint32_t>(p0 >> 32), lo0 = static_cast<uint32_t>(p0);
+		uint32_t hi1 = static_cast<uint32_t>(p1 >> 32), lo1 = static_cast<uint32_t>(p1);
+
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+std::complex<float> OceanNoise::GaussianPair(uint64_t seed, uint32_t cascade, uint32_t m, uint32_t n)
+{
+	const uint32_t counter[4] = { n, m, cascade, 0 };
+	const uint32_t key[2] = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+	uint32_t bits[4];
+	Philox4x32(counter, key, bits);
+
+	// u1 in (0, 1] so the log never sees 0.
+	float u1 = static_cast<float>((bits[0] >> 8) + 1) * UINT24_TO_FLOAT;
+	float u2 = static_cast<float>(bits[1] >> 8) * UINT24_TO_FLOAT;
+
+	float r = std::sqrt(-2.0f * std::log(u1));
+	float theta = 2.0f * PI * u2;
+	return std::complex<float>(r * std::cos(theta), r * std::sin(theta));
+}
+
+void OceanNoise::GenerateRows(uint64_t seed, uint32_t cascade, uint32_t resolution, uint32_t rowBegin, uint32_t rowEnd, std::complex<float>* outField)
+{
+	using namespace simd;
+
+	const uint32_t k0 = static_cast<uint32_t>(seed);
+	const uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+	const uint32_t vectorEnd = resolution & ~3u;
+
+	const __m128i laneOffset = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i cascadeCounter = _mm_set1_epi32(static_cast<int>(cascade));
+	const __m128i mantissaMask = _mm_set1_epi32(0x00ffffff);
+
+	for (uint32_t m = rowBegin; m < rowEnd; ++m)
+	{
+		const __m128i rowCounter = _mm_set1_epi32(static_cast<int>(m));
+		std::complex<float>* row = outField + static_cast<size_t>(m) * resolution;
+
+		uint32_t n = 0;
+		for (; n < vectorEnd; n += 4)
+		{
+			__m128i columnCounter = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(n)), laneOffset);
+
+			__m128i bits0, bits1;
+			Philox4x32x4(columnCounter, rowCounter, cascadeCounter, _mm_setzero_si128(), k0, k1, &bits0, &bits1);
+
+			// The 24 bit values fit in a signed int, so the signed conversion is exact.
+			__m128i top0 = _mm_and_si128(_mm_srli_epi32(bits0, 8), mantissaMask);
+			__m128i top1 = _mm_and_si128(_mm_srli_epi32(bits1, 8), mantissaMask);
+			Vec4 u1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(top0, _mm_set1_epi32(1))), Set(UINT24_TO_FLOAT));
+			Vec4 u2 = _mm_mul_ps(_mm_cvtepi32_ps(top1), Set(UINT24_TO_FLOAT));
+
+			Vec4 r = Sqrt(_mm_mul_ps(Set(-2.0f), Log(u1)));
+			Vec4 sinTheta, cosTheta;
+			SinCos(_mm_mul_ps(u2, Set(2.0f * PI)), &sinTheta, &cosTheta);
+
+			Vec4 re = _mm_mul_ps(r, cosTheta);
+			Vec4 im = _mm_mul_ps(r, sinTheta);
+
+			float* out = reinterpret_cast<float*>(row + n);
+			Store(out, _mm_unpacklo_ps(re, im));
+			Store(out + 4, _mm_unpackhi_ps(re, im));
+		}
+
+		for (; n < resolution; ++n)
+		{
+			row[n] = GaussianPair(seed, cascade, m, n);
+		}
+	}
+}
+
+void OceanNoise::Generate(uint64_t seed, uint32_t cascade, uint32_t resolution, std::complex<float>* outField)
+{
+	ThreadPool::Get().ParallelFor(0, resolution, ROWS_PER_JOB, [&](uint32_t rowBegin, uint32_t rowEnd)
+		{
+			GenerateRows(seed, cascade, resolution, rowBegin, rowEnd, outField);
+		});
+}
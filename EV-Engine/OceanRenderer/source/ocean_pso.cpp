@@ -1,6 +1,8 @@
 #include "ocean_pso.h"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <d3dcompiler.h>
 
 #include "core/application.h"
@@ -12,25 +14,29 @@
 #include "utility/helpers.h"
 #include "DX12/light.h"
 
-EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, const std::wstring& pixelPath, const UINT cascadeCount, const std::vector<float>& patchSizes)
+EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::vector<std::wstring>& vertexPaths, const std::wstring& pixelPath, const UINT cascadeCount, const std::vector<float>& patchSizes)
     : m_pPreviousCommandList(nullptr)
 	, m_cascadeCount(cascadeCount)
-	, m_cascadeSizes(patchSizes)
 	, m_camera(cam)
 {
     m_pAlignedMVP = (MVP*)_aligned_malloc(sizeof(MVP), 16);
     m_textures.resize(m_cascadeCount);
+    SetCascades(patchSizes, (1u << m_cascadeCount) - 1);
 
 
     // Get the folder of the running executable.
     std::wstring parentPath = GetModulePath();
-    std::wstring vertexShader = parentPath + vertexPath;
     std::wstring pixelShader = parentPath + pixelPath;
 
     // Setup the root signature
-    // Load the vertex shader.
-    Microsoft::WRL::ComPtr<ID3DBlob> vertexShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(vertexShader.c_str(), &vertexShaderBlob));
+    // Load the vertex shaders.
+    assert(!vertexPaths.empty() && vertexPaths.size() <= m_cascadeCount);
+    std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> vertexShaderBlobs(vertexPaths.size());
+    for (size_t i = 0; i < vertexPaths.size(); ++i)
+    {
+        std::wstring vertexShader = parentPath + vertexPaths[i];
+        ThrowIfFailed(D3DReadFileToBlob(vertexShader.c_str(), &vertexShaderBlobs[i]));
+    }
     Microsoft::WRL::ComPtr<ID3DBlob> pixelShaderBlob;
     ThrowIfFailed(D3DReadFileToBlob(pixelShader.c_str(), &pixelShaderBlob));
 
@@ -41,15 +47,16 @@ EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, co
         D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
-    // Descriptor range for the textures.
-    CD3DX12_DESCRIPTOR_RANGE1 descriptorRage(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 15, 3);
+    // Descriptor range for the textures, specular IBL and BRDF LUT at t4 and t5, the cascades from t6.
+    CD3DX12_DESCRIPTOR_RANGE1 descriptorRage(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 14, 4);
 
 
     // clang-format off
     CD3DX12_ROOT_PARAMETER1 rootParameters[RootParameters::NumRootParameters];
     rootParameters[RootParameters::MatricesCB].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParameters[RootParameters::Nodes].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
     rootParameters[RootParameters::MaterialCB].InitAsConstantBufferView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
-    rootParameters[RootParameters::Camera].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[RootParameters::Camera].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
     // rootParameters[RootParameters::LightPropertiesCB].InitAsConstants(sizeof(LightProperties) / 4, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParameters[RootParameters::PointLights].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
     // rootParameters[RootParameters::SpotLights].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
@@ -57,6 +64,7 @@ EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, co
     rootParameters[RootParameters::Textures].InitAsDescriptorTable(1, &descriptorRage, D3D12_SHADER_VISIBILITY_ALL);
     rootParameters[RootParameters::RenderParams].InitAsConstantBufferView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParameters[RootParameters::Constants].InitAsConstantBufferView(3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[RootParameters::IrradianceCB].InitAsConstantBufferView(4, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
 
     CD3DX12_STATIC_SAMPLER_DESC anisotropicSampler(0, D3D12_FILTER_ANISOTROPIC);
 
@@ -116,7 +124,6 @@ EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, co
 	rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
     pipelineStateStream.pRootSignature = m_rootSignature->GetRootSignature().Get();
-    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
     pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
     pipelineStateStream.RasterizerState = rasterizerState;
     pipelineStateStream.InputLayout = VertexPositionNormalTangentBitangentTexture::inputLayout;
@@ -125,7 +132,12 @@ EV::OceanPSO::OceanPSO(const EV::Camera& cam, const std::wstring& vertexPath, co
     pipelineStateStream.RTVFormats = rtvFormats;
     pipelineStateStream.SampleDesc = sampleDesc;
 
-    m_pipelineStateObject = Application::Get().CreatePipelineStateObject(pipelineStateStream);
+    for (const Microsoft::WRL::ComPtr<ID3DBlob>& vertexShaderBlob : vertexShaderBlobs)
+    {
+        pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
+        m_permutations.push_back(Application::Get().CreatePipelineStateObject(pipelineStateStream));
+    }
+    m_pipelineStateObject = m_permutations[0];
 
     // Create an SRV that can be used to pad unused texture slots.
     D3D12_SHADER_RESOURCE_VIEW_DESC defaultSRV;
@@ -180,14 +192,17 @@ void EV::OceanPSO::Apply(CommandList& commandList)
         commandList.SetGraphicsDynamicConstantBuffer(RootParameters::MatricesCB, m);
     }
 
-    // bind IBL textures
+    if (!m_nodes.empty())
+    {
+        commandList.SetGraphicsDynamicStructuredBuffer(RootParameters::Nodes, m_nodes);
+    }
+
+    // bind IBL
+    commandList.SetGraphicsDynamicConstantBuffer(RootParameters::IrradianceCB, m_irradiance);
     commandList.SetShaderResourceView(RootParameters::Textures, 0,
-        m_diffuseIBL ? m_diffuseIBL : m_defaultCubeSRV,
-        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    commandList.SetShaderResourceView(RootParameters::Textures, 1,
         m_specularIBL ? m_specularIBL : m_defaultCubeSRV,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    commandList.SetShaderResourceView(RootParameters::Textures, 2,
+    commandList.SetShaderResourceView(RootParameters::Textures, 1,
         m_lutIBL,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
@@ -209,9 +224,9 @@ void EV::OceanPSO::Apply(CommandList& commandList)
 
         for (UINT i = 0; i < m_cascadeCount; ++i)
         {
-            commandList.SetShaderResourceView(RootParameters::Textures, 3 + i * 3 + 0, m_textures[i].displacementTexture, shaderRead);
-            commandList.SetShaderResourceView(RootParameters::Textures, 3 + i * 3 + 1, m_textures[i].slopeTexture, shaderRead);
-            commandList.SetShaderResourceView(RootParameters::Textures, 3 + i * 3 + 2, m_textures[i].foamTexture, shaderRead);
+            commandList.SetShaderResourceView(RootParameters::Textures, 2 + i * 3 + 0, m_textures[i].displacementTexture, shaderRead);
+            commandList.SetShaderResourceView(RootParameters::Textures, 2 + i * 3 + 1, m_textures[i].slopeTexture, shaderRead);
+            commandList.SetShaderResourceView(RootParameters::Textures, 2 + i * 3 + 2, m_textures[i].foamTexture, shaderRead);
         }
 
     // if (m_dirtyFlags & DF_SpotLights)
@@ -227,11 +242,7 @@ void EV::OceanPSO::Apply(CommandList& commandList)
     commandList.SetGraphicsDynamicConstantBuffer(RootParameters::RenderParams, sizeof(OceanRenderParams), &m_oceanRenderParams);
 
     // Send OceanCascade params
-    {
-        UINT padAmount = 4 - m_cascadeCount; // 4 - cascadecount because we use floats and want 16byte alignment. Padding is hardcoded in the shader but taken care of here.
-        commandList.SetGraphicsDynamicConstantBuffer(RootParameters::Constants, (m_cascadeCount + padAmount) * sizeof(float), m_cascadeSizes.data());
-	    
-    }
+    commandList.SetGraphicsDynamicConstantBuffer(RootParameters::Constants, sizeof(CascadeConstants), &m_cascadeConstants);
     // if (m_dirtyFlags & (DF_PointLights | DF_SpotLights | DF_DirectionalLights))
     // {
     //     LightProperties lightProps;
@@ -246,9 +257,8 @@ void EV::OceanPSO::Apply(CommandList& commandList)
     m_dirtyFlags = DF_None;
 }
 
-void EV::OceanPSO::SetIBLTextures(std::shared_ptr<ShaderResourceView> diffuse, std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut)
+void EV::OceanPSO::SetIBLTextures(std::shared_ptr<ShaderResourceView> specular, std::shared_ptr<ShaderResourceView> lut)
 {
-    m_diffuseIBL = diffuse;
     m_specularIBL = specular;
     m_lutIBL = lut;
 }
@@ -259,3 +269,24 @@ void EV::OceanPSO::SetOceanTextures(std::shared_ptr<Texture> displacement, std::
    m_textures[cascade].slopeTexture = slope;
    m_textures[cascade].foamTexture = foam;
 }
+
+void EV::OceanPSO::SetCascades(const std::vector<float>& patchSizes, uint32_t activeMask)
+{
+    assert(m_cascadeCount <= _countof(m_cascadeConstants.patchSizes) && patchSizes.size() >= m_cascadeCount);
+
+    std::fill(std::begin(m_cascadeConstants.patchSizes), std::end(m_cascadeConstants.patchSizes), 0.0f);
+    std::copy_n(patchSizes.begin(), m_cascadeCount, m_cascadeConstants.patchSizes);
+    m_cascadeConstants.activeMask = activeMask;
+}
+
+void EV::OceanPSO::SetNodes(const std::vector<OceanQuadtreeNode>& nodes, uint32_t gridResolution)
+{
+    m_nodes = nodes;
+    m_cascadeConstants.gridResolution = static_cast<float>(gridResolution);
+}
+
+void EV::OceanPSO::SetSampledCascades(uint32_t count)
+{
+    assert(count <= m_cascadeCount && m_cascadeCount - count < m_permutations.size());
+    m_pipelineStateObject = m_permutations[m_cascadeCount - count];
+}
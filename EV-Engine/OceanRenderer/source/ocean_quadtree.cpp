@@ -0,0 +1,209 @@
+#include "ocean_quadtree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "ocean_simd.h"
+
+using namespace EV;
+using namespace EV::simd;
+
+// The six planes in two groups of four, one plane per lane. The last two lanes are never tested.
+struct OceanQuadtree::Frustum
+{
+	Vec4 a[2], b[2], c[2], d[2];
+	Vec4 absA[2], absB[2], absC[2];
+};
+
+namespace
+{
+	// Squared distance from the camera to the undisplaced square of a node.
+	float DistanceSquared(const float cameraPosition[3], float x, float z, float size)
+	{
+		const float dx = std::max({ x - cameraPosition[0], 0.0f, cameraPosition[0] - (x + size) });
+		const float dz = std::max({ z - cameraPosition[2], 0.0f, cameraPosition[2] - (z + size) });
+		return dx * dx + cameraPosition[1] * cameraPosition[1] + dz * dz;
+	}
+}
+
+OceanQuadtree::OceanQuadtree(const OceanQuadtreeSettings& settings)
+{
+	SetSettings(settings);
+}
+
+void OceanQuadtree::SetSettings(const OceanQuadtreeSettings& settings)
+{
+	assert(settings.lodCount > 0 && settings.lodCount <= 20);
+	assert(settings.gridResolution >= 2 && (settings.gridResolution & (settings.gridResolution - 1)) == 0);
+	assert(settings.minCascades >= 2 && settings.minCascades <= 4);
+
+	m_settings = settings;
+	m_ranges.resize(settings.lodCount);
+	for (uint32_t i = 0; i < settings.lodCount; ++i)
+		m_ranges[i] = settings.rangeFactor * settings.leafSize * static_cast<float>(1u << i);
+
+	// Every cascade until ClassifyCascades says otherwise.
+	m_cascadeCounts.assign(settings.lodCount, 4);
+}
+
+void OceanQuadtree::ClassifyCascades(const float* patchSizes, uint32_t cascadeCount, float focalLength)
+{
+	assert(cascadeCount >= m_settings.minCascades);
+
+	for (uint32_t lod = 0; lod < m_settings.lodCount; ++lod)
+	{
+		// A node of this level is no closer than the range of the level below.
+		// Both spacings double from level to level, so the counts only go down.
+		const float vertexSpacing = m_settings.leafSize * static_cast<float>(1u << lod) / m_settings.gridResolution;
+		const float pixelSize = lod > 0 ? m_ranges[lod - 1] / focalLength : 0.0f;
+		const float sampleSpacing = std::max(vertexSpacing, pixelSize);
+
+		uint32_t count = 0;
+		while (count < cascadeCount && patchSizes[count] >= m_settings.minSamplesPerPatch * sampleSpacing)
+			++count;
+		m_cascadeCounts[lod] = std::clamp(count, m_settings.minCascades, cascadeCount);
+	}
+}
+
+float OceanQuadtree::GetRootSize() const
+{
+	return m_settings.leafSize * static_cast<float>(1u << (m_settings.lodCount - 1));
+}
+
+void OceanQuadtree::Select(const float cameraPosition[3], const float (*frustumPlanes)[4], std::vector<OceanQuadtreeNode>& outNodes) const
+{
+	outNodes.clear();
+
+	// The root follows the camera in steps of half its size, which keeps it
+	// aligned to the grid of every level and the camera at least a quarter of
+	// its size away from its edges.
+	const float rootSize = GetRootSize();
+	const float step = 0.5f * rootSize;
+	const float rootX = std::round(cameraPosition[0] / step) * step - step;
+	const float rootZ = std::round(cameraPosition[2] / step) * step - step;
+
+	Frustum frustum = {};
+	if (frustumPlanes)
+	{
+		float lanes[4][8];
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			for (uint32_t j = 0; j < 4; ++j)
+				lanes[j][i] = i < 6 ? frustumPlanes[i][j] : 0.0f;
+		}
+		for (uint32_t group = 0; group < 2; ++group)
+		{
+			frustum.a[group] = Load(lanes[0] + group * 4);
+			frustum.b[group] = Load(lanes[1] + group * 4);
+			frustum.c[group] = Load(lanes[2] + group * 4);
+			frustum.d[group] = Load(lanes[3] + group * 4);
+			frustum.absA[group] = Abs(frustum.a[group]);
+			frustum.absB[group] = Abs(frustum.b[group]);
+			frustum.absC[group] = Abs(frustum.c[group]);
+		}
+	}
+
+	const uint32_t rootLod = m_settings.lodCount - 1;
+	const uint32_t activePlanes = frustumPlanes ? 0x3f : 0;
+	if (!SelectNode(rootX, rootZ, rootLod, cameraPosition, frustum, activePlanes, outNodes))
+		outNodes.push_back(MakeNode(rootX, rootZ, rootLod));
+}
+
+bool OceanQuadtree::SelectNode(float x, float z, uint32_t lod, const float cameraPosition[3], const Frustum& frustum,
+                               uint32_t activePlanes, std::vector<OceanQuadtreeNode>& outNodes) const
+{
+	const float size = m_settings.leafSize * static_cast<float>(1u << lod);
+
+	// The box the displaced node can reach, as centre and half extents. A box
+	// is outside of a plane when its centre is further behind it than the
+	// projected radius |a| ex + |b| ey + |c| ez, and inside when further in
+	// front. activePlanes holds the planes the parent straddles, one bit per plane.
+	if (activePlanes)
+	{
+		const float half = 0.5f * size;
+		const Vec4 centerX = Set(x + half), centerZ = Set(z + half);
+		const Vec4 extentXZ = Set(half + m_displacementBounds.horizontal), extentY = Set(m_displacementBounds.vertical);
+
+		uint32_t straddled = 0;
+		for (uint32_t group = 0; group < 2; ++group)
+		{
+			const uint32_t groupPlanes = (activePlanes >> (group * 4)) & 0xf;
+			if (!groupPlanes)
+				continue;
+
+			const Vec4 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(frustum.a[group], centerX), _mm_mul_ps(frustum.c[group], centerZ)), frustum.d[group]);
+			const Vec4 radius = _mm_add_ps(_mm_mul_ps(_mm_add_ps(frustum.absA[group], frustum.absC[group]), extentXZ), _mm_mul_ps(frustum.absB[group], extentY));
+
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) & groupPlanes)
+				return true;
+			straddled |= (_mm_movemask_ps(_mm_cmplt_ps(distance, radius)) & groupPlanes) << (group * 4);
+		}
+		activePlanes = straddled;
+	}
+
+	// Out of range, the parent draws this area at its own level.
+	const float distanceSquared = DistanceSquared(cameraPosition, x, z, size);
+	if (distanceSquared > m_ranges[lod] * m_ranges[lod])
+		return false;
+
+	if (lod == 0 || distanceSquared > m_ranges[lod - 1] * m_ranges[lod - 1])
+	{
+		outNodes.push_back(MakeNode(x, z, lod));
+		return true;
+	}
+
+	// Children out of their range are drawn as nodes of their level as well.
+	// They lie past the end of their morph, so their vertices already sit on
+	// the grid of this level.
+	const float half = 0.5f * size;
+	for (uint32_t child = 0; child < 4; ++child)
+	{
+		const float childX = x + (child & 1) * half;
+		const float childZ = z + (child >> 1) * half;
+		if (!SelectNode(childX, childZ, lod - 1, cameraPosition, frustum, activePlanes, outNodes))
+			outNodes.push_back(MakeNode(childX, childZ, lod - 1));
+	}
+	return true;
+}
+
+OceanQuadtreeNode OceanQuadtree::MakeNode(float x, float z, uint32_t lod) const
+{
+	const float previousRange = lod > 0 ? m_ranges[lod - 1] : 0.0f;
+
+	OceanQuadtreeNode node = {};
+	node.x = x;
+	node.z = z;
+	node.size = m_settings.leafSize * static_cast<float>(1u << lod);
+	node.lod = static_cast<float>(lod);
+	node.morphEnd = m_ranges[lod];
+	node.morphStart = previousRange + (m_ranges[lod] - previousRange) * m_settings.morphStartRatio;
+	node.cascadeCount = static_cast<float>(m_cascadeCounts[lod]);
+	node.fadeCascade = static_cast<float>(lod + 1 < m_settings.lodCount ? m_cascadeCounts[lod + 1] : m_cascadeCounts[lod]);
+	return node;
+}
+
+void OceanQuadtree::MorphVertex(const OceanQuadtreeNode& node, uint32_t gridX, uint32_t gridZ, const float cameraPosition[3],
+                                float& outX, float& outZ, float& outMorph) const
+{
+	const float gridSize = static_cast<float>(m_settings.gridResolution);
+	const float x = node.x + gridX / gridSize * node.size;
+	const float z = node.z + gridZ / gridSize * node.size;
+
+	const float dx = cameraPosition[0] - x;
+	const float dz = cameraPosition[2] - z;
+	const float distance = std::sqrt(dx * dx + cameraPosition[1] * cameraPosition[1] + dz * dz);
+	const float morph = std::clamp((distance - node.morphStart) / (node.morphEnd - node.morphStart), 0.0f, 1.0f);
+
+	// Odd vertices slide onto their even neighbour, halving the resolution at morph = 1.
+	outX = node.x + (gridX - (gridX & 1) * morph) / gridSize * node.size;
+	outZ = node.z + (gridZ - (gridZ & 1) * morph) / gridSize * node.size;
+	outMorph = morph;
+}
+
+float OceanQuadtree::CascadeWeight(const OceanQuadtreeNode& node, uint32_t cascade, float morph)
+{
+	if (cascade >= node.cascadeCount)
+		return 0.0f;
+	return cascade >= node.fadeCascade ? 1.0f - morph : 1.0f;
+}
@@ -1,16 +1,19 @@
 #include "ocean_scene.h"
 
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <iostream>
 #include <Shlwapi.h>
 
 #include "core/EV.h"
 
 #include <DirectXColors.h>
-#include <random>
 
 #include "compute_pso.h"
-#include "convolution_pso.h"
+#include "ocean_ibl_cache.h"
+#include "ocean_irradiance.h"
 #include "ocean_pso.h"
 #include "DX12/skybox_pso.h"
 #include "DX12/root_signature.h"
@@ -44,6 +47,26 @@ XMMATRIX XM_CALLCONV LookAtMatrix(FXMVECTOR position, FXMVECTOR direction, FXMVE
     return matrix;
 }
 
+// Appends the triangles of a node and its children, the node's moved by transform.
+void XM_CALLCONV GatherTriangles(SceneNode& node, FXMMATRIX transform, std::vector<float>& positions, std::vector<uint32_t>& indices)
+{
+    for (size_t i = 0; std::shared_ptr<Mesh> mesh = node.GetMesh(i); ++i)
+    {
+        const uint32_t first = static_cast<uint32_t>(positions.size() / 3);
+        for (const XMFLOAT3& position : mesh->GetPositions())
+        {
+            XMFLOAT3 moved;
+            XMStoreFloat3(&moved, XMVector3TransformCoord(XMLoadFloat3(&position), transform));
+            positions.insert(positions.end(), { moved.x, moved.y, moved.z });
+        }
+        for (uint32_t index : mesh->GetIndices())
+            indices.push_back(first + index);
+    }
+
+    for (const std::shared_ptr<SceneNode>& child : node.m_children)
+        GatherTriangles(*child, child->GetLocalTransform() * transform, positions, indices);
+}
+
 Ocean::Ocean(const std::wstring& name, uint32_t width, uint32_t height, bool bVSync)
     : super(name, width, height, bVSync)
     , m_scissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX))
@@ -104,7 +127,7 @@ void Ocean::OnResize(ResizeEventArgs& e)
     m_swapChain->Resize(m_width, m_height);
 
     float aspectRatio = m_width / (float)m_height;
-    m_camera.SetProjection(45.0f, aspectRatio, 0.1f, 1000.0f);
+    m_camera.SetProjection(45.0f, aspectRatio, 0.1f, 5000.0f);
 
     m_viewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(m_width), static_cast<float>(m_height));
 
@@ -208,41 +231,34 @@ bool Ocean::LoadContent()
     auto& commandQueue = app.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
     auto commandList = commandQueue.GetCommandList();
 
-    m_oceanPlane = commandList->CreatePlane(OCEAN_PLANE_SIZE, OCEAN_PLANE_SIZE, OCEAN_SUBRES, OCEAN_SUBRES, false);
+    m_oceanPatch = commandList->CreatePlane(1.0f, 1.0f, OCEAN_PATCH_RESOLUTION, OCEAN_PATCH_RESOLUTION, false);
+    m_oceanPatchStats = commandList->GetLastMeshStats();
 
     m_skybox = commandList->CreateCube(1.0f, true);
-    m_skyboxTexture = commandList->LoadTextureFromFile(L"assets/sky4k.hdr", true);
-
-    // Create a cubemap for the HDR panorama.
-    auto cubemapDesc = m_skyboxTexture->GetD3D12ResourceDesc();
-    cubemapDesc.Width = cubemapDesc.Height = 1024;
-    cubemapDesc.DepthOrArraySize = 6;
-    cubemapDesc.MipLevels = 0;
-
-    m_skyboxCubemap = app.CreateTexture(cubemapDesc);
-    m_skyboxCubemap->SetName(L"Cloud Cubemap");
-
-    // Convert the 2D panorama to a 3D cubemap.
-    commandList->PanoToCubemap(m_skyboxCubemap, m_skyboxTexture, 0); // tweak mip quality to blur HDR
+    LoadEnvironment(commandList, L"assets/sky4k.hdr");
+    LoadBrdfLut(commandList);
 
     // m_cubeMesh = commandList->CreateCube();
     m_helmet = commandList->LoadSceneFromFile(L"assets/damaged_helmet/DamagedHelmet.gltf");
     m_chessboard = commandList->LoadSceneFromFile(L"assets/chess/ABeautifulGame.gltf");
+    m_chessboard->UpdateBVH();
     m_boat = commandList->LoadSceneFromFile(L"assets/kenny/ship-large.obj");
+    BuildBoatHull();
 
     m_sphere = commandList->CreateSphere(0.1f);
 
     // m_defaultTexture = commandList->LoadTextureFromFile(L"assets/Mona_Lisa.jpg", true);
-    // Set the patch sizes for the cascades.
-    m_oceanPatchSizes.resize(m_oceanCascadesNumber);
-    m_oceanPatchSizes[0] = 500.0f;
-    m_oceanPatchSizes[1] = 250.0f;
-    m_oceanPatchSizes[2] = 17.0f;
-    m_oceanPatchSizes[3] = 5.0f;
     UpdateSpectrumParameters();
-    for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+    m_h0Cache = std::make_unique<OceanH0Cache>(fs::current_path() / "cache" / "ocean");
     {
-    	GenerateH0(commandList, i);
+        // The first spectrum is built and uploaded in place, later edits go through UpdateSpectrum.
+        std::vector<uint32_t> resolutions(m_oceanCascadesNumber);
+        for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+            resolutions[i] = m_oceanCascades[i].resolution;
+
+        std::unique_ptr<SpectrumBuild> build = BuildSpectrum(m_jonswapParams, m_noiseSeed, resolutions, m_plannerSettings, m_autoCascades, m_halfPrecision);
+        UploadSpectrum(commandList, *build);
+        SwapSpectrum(*build);
     }
 
     auto fence = commandQueue.ExecuteCommandList(commandList);
@@ -256,7 +272,7 @@ bool Ocean::LoadContent()
     CD3DX12_ROOT_PARAMETER1 H0RootParameters[OceanCompute::RootParameters::NumRootParameters];
     H0RootParameters[OceanCompute::RootParameters::ReadTextures].InitAsDescriptorTable(1, &h0DescriptorRangeSRV); // SRV t0
     H0RootParameters[OceanCompute::RootParameters::WriteTextures].InitAsDescriptorTable(1, &h0DescriptorRangeUAV); // UAV u0
-    H0RootParameters[OceanCompute::RootParameters::Constants].InitAsConstants(2, 0); // CBV b0
+    H0RootParameters[OceanCompute::RootParameters::Constants].InitAsConstants(4, 0); // CBV b0
 
     // FFT 
     CD3DX12_DESCRIPTOR_RANGE1 FFTDescriptorRangeUAV(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0,
@@ -272,98 +288,23 @@ bool Ocean::LoadContent()
     permuteRootParameters[0].InitAsDescriptorTable(1, &permuteDescriptorRangeUAV); // UAV
     permuteRootParameters[1].InitAsConstants(4, 0); // 4 floats, register b0
 
-    // Convolution
-    CD3DX12_DESCRIPTOR_RANGE1 convolutionSRVRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
-    CD3DX12_DESCRIPTOR_RANGE1 convolutionUAVRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
-
-    CD3DX12_ROOT_PARAMETER1 convolutionRootParameters[3];
-    convolutionRootParameters[0].InitAsConstants(4, 0);                    
-    convolutionRootParameters[1].InitAsDescriptorTable(1, &convolutionSRVRange);   
-    convolutionRootParameters[2].InitAsDescriptorTable(1, &convolutionUAVRange);   
-
-    // brdf 
-    CD3DX12_DESCRIPTOR_RANGE1 brdfUAVRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
-    CD3DX12_ROOT_PARAMETER1 brdfLutRootParameters[1];
-    brdfLutRootParameters[0].InitAsDescriptorTable(1, &brdfUAVRange);
-
     m_unlitPSO = std::make_shared<EffectPSO>(m_camera, L"/vertex.cso", L"/pixel.cso");
-    m_displacementPSO = std::make_shared<OceanPSO>(m_camera, L"/ocean_vertex.cso", L"/ocean_pixel.cso", m_oceanCascadesNumber, m_oceanPatchSizes);
+    m_displacementPSO = std::make_shared<OceanPSO>(m_camera, std::vector<std::wstring>{ L"/ocean_vertex.cso", L"/ocean_vertex_3.cso", L"/ocean_vertex_2.cso" },
+                                                   L"/ocean_pixel.cso", m_oceanCascadesNumber, m_oceanPatchSizes);
     m_oceanPSO = std::make_shared<OceanCompute>(L"/animate_waves.cso", H0RootParameters, _countof(H0RootParameters));
-    m_fftPSO = std::make_shared<OceanCompute>(L"/fft.cso", FFTRootParameters, _countof(FFTRootParameters));
+    for (UINT i = 0; i < m_fftPermutationsNumber; ++i)
+    {
+        std::wstring fftShader = L"/fft_" + std::to_wstring(OCEAN_MIN_SUBRES << i) + L".cso";
+        m_fftPSOs[i] = std::make_shared<OceanCompute>(fftShader, FFTRootParameters, _countof(FFTRootParameters));
+    }
     m_permutePSO = std::make_shared<OceanCompute>(L"/permute.cso", permuteRootParameters, _countof(permuteRootParameters));
-    m_convolutionPSO = std::make_shared<ConvolutionCompute>(L"/ibl_convolution.cso", convolutionRootParameters, _countof(convolutionRootParameters));
-    m_specularConvolutionPSO = std::make_shared<ConvolutionCompute>(L"/ibl_specular.cso", convolutionRootParameters, _countof(convolutionRootParameters));
-    m_brdfLutPSO = std::make_shared<ConvolutionCompute>(L"/brdf_lut.cso", brdfLutRootParameters, _countof(brdfLutRootParameters));
     m_skyboxPSO = std::make_shared<SkyboxPSO>(L"/skybox_VS.cso", L"/skybox_PS.cso");
     m_sdrPSO = std::make_shared<SDRPSO>(L"/HDR_to_SDR_VS.cso", L"/HDR_to_SDR_PS.cso");
     // m_permuteSlopePSO = std::make_shared<OceanCompute>(L"/permute_slopemap.cso", FFTRootParameters, _countof(FFTRootParameters));
 
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC cubeMapSRVDesc = {};
-    cubeMapSRVDesc.Format = cubemapDesc.Format;
-    cubeMapSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    cubeMapSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    cubeMapSRVDesc.TextureCube.MipLevels = (UINT)-1;  // Use all mips.
-
-    m_skyboxCubemapSRV = app.CreateShaderResourceView(m_skyboxCubemap, &cubeMapSRVDesc);
-
     commandQueue.WaitForFenceValue(fence);
 
-    auto& computeQueue = app.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
-    auto computeCommandList = computeQueue.GetCommandList();
-
-    DXGI_FORMAT irradianceFormat = DXGI_FORMAT_R16G16B16A16_FLOAT; // TODO: less precision might also be fine
-    DXGI_FORMAT brdfLutFormat = DXGI_FORMAT_R16G16_FLOAT; // TODO: less precision might also be fine
-    uint32_t specularMipLevels = 5;
-    uint32_t brdfTextureSize = 512;
-
-    auto irradianceDesc = CD3DX12_RESOURCE_DESC::Tex2D(irradianceFormat, m_convolutionPlaneSize, m_convolutionPlaneSize, 6);
-    irradianceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-    auto iblSpecularDesc = CD3DX12_RESOURCE_DESC::Tex2D(irradianceFormat, brdfTextureSize, brdfTextureSize, 6, specularMipLevels);
-    iblSpecularDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-    auto BRDFDesc = CD3DX12_RESOURCE_DESC::Tex2D(brdfLutFormat, brdfTextureSize, brdfTextureSize);
-    BRDFDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-
-	// diffuse irradiance texture
-    m_diffuseIrradianceMap = Application::Get().CreateTexture(irradianceDesc);
-    m_diffuseIrradianceMap->SetName(L"Diffuse Irradiance Texture");
-    // IBL specular texture
-    m_specularIrradianceMap = Application::Get().CreateTexture(iblSpecularDesc);
-    m_specularIrradianceMap->SetName(L"Specular Irradiance Texture");
-    // BRDF LUT
-    m_brdfLUT = Application::Get().CreateTexture(BRDFDesc);
-    m_brdfLUT->SetName(L"BRDF LUT ");
-
-    // Create cubemap SRVs for IBL
-    D3D12_SHADER_RESOURCE_VIEW_DESC cubeSRVDesc = {};
-    cubeSRVDesc.Format = irradianceFormat;
-    cubeSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    cubeSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    cubeSRVDesc.TextureCube.MostDetailedMip = 0;
-    cubeSRVDesc.TextureCube.MipLevels = 1;
-
-	m_diffuseCubemapSRV = Application::Get().CreateShaderResourceView(m_diffuseIrradianceMap, &cubeSRVDesc);
-
-    cubeSRVDesc.TextureCube.MipLevels = specularMipLevels;
-    m_specularCubemapSRV = Application::Get().CreateShaderResourceView(m_specularIrradianceMap, &cubeSRVDesc);
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC brdfSRVDesc = {};
-    brdfSRVDesc.Format = DXGI_FORMAT_R16G16_FLOAT;
-    brdfSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    brdfSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    brdfSRVDesc.Texture2D.MostDetailedMip = 0;
-    brdfSRVDesc.Texture2D.MipLevels = 1;
-
-    m_brdfLUTSRV = app.CreateShaderResourceView(m_brdfLUT, &brdfSRVDesc);
-
-    // Convolution IBL
-    m_convolutionPSO->Dispatch(computeCommandList, m_skyboxCubemapSRV, m_diffuseIrradianceMap, m_convolutionPlaneSize, m_convolutionSampleCount);
-    // specular
-    // computeCommandList->TransitionBarrier(m_specularIrradianceMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    m_specularConvolutionPSO->DispatchSpecular(computeCommandList, m_skyboxCubemapSRV, m_specularIrradianceMap, brdfTextureSize, 4096, specularMipLevels);
-    // LUT
-    m_brdfLutPSO->DispatchBRDFLUT(computeCommandList, m_brdfLUT, brdfTextureSize);
-
     // Update Render params for the ocean.
     m_displacementPSO->m_oceanRenderParams.scatterColor = XMFLOAT4(0.0f, 0.5f, 0.4f, 1.0f);
     m_displacementPSO->m_oceanRenderParams.oceanrColor = XMFLOAT4(0.0f, 0.15f, 0.3f, 1.0f);
@@ -428,12 +369,10 @@ bool Ocean::LoadContent()
     m_renderTarget.AttachTexture(AttachmentPoint::DepthStencil, depthTexture);
 
     // Set the skybox SRV before rendering
-    m_unlitPSO->SetIBLTextures(m_diffuseCubemapSRV, m_specularCubemapSRV, m_brdfLUTSRV);
-    m_displacementPSO->SetIBLTextures(m_diffuseCubemapSRV, m_specularCubemapSRV, m_brdfLUTSRV);
-
-
-    auto convolutionFence = computeQueue.ExecuteCommandList(computeCommandList);
-    computeQueue.WaitForFenceValue(convolutionFence);
+    m_unlitPSO->SetIBLTextures(m_specularCubemapSRV, m_brdfLUTSRV);
+    m_displacementPSO->SetIBLTextures(m_specularCubemapSRV, m_brdfLUTSRV);
+    m_unlitPSO->SetIrradiance(m_irradiance);
+    m_displacementPSO->SetIrradiance(m_irradiance);
 
     m_pWindow->RegisterCallbacks(shared_from_this());
     m_pWindow->Show();
@@ -470,6 +409,27 @@ void Ocean::OnUpdate(UpdateEventArgs& e)
 
     m_swapChain->WaitForSwapChain();
 
+    // The buoyancy steps of the last frame read the simulator, which is
+    // written from here on. Their poses are drawn this frame.
+    m_buoyancy.Wait();
+    m_buoyancyTime = m_buoyancy.GetUpdateTime();
+    m_buoyancySteps = m_buoyancy.GetLastSteps();
+    m_boatTransforms.clear();
+    if (m_floatBoats)
+    {
+        const XMMATRIX scale = XMMatrixScaling(m_boatScale, m_boatScale, m_boatScale);
+        const XMMATRIX centroid = XMMatrixTranslation(-m_boatHull.centroid[0], -m_boatHull.centroid[1], -m_boatHull.centroid[2]);
+        for (uint32_t i = 0; i < m_buoyancy.GetBodyCount(); ++i)
+        {
+            const OceanBuoyancyPose pose = m_buoyancy.GetPose(i);
+            const XMMATRIX rotation = XMMatrixRotationQuaternion(XMVectorSet(pose.rotation[0], pose.rotation[1], pose.rotation[2], pose.rotation[3]));
+            const XMMATRIX translation = XMMatrixTranslation(pose.position[0], pose.position[1], pose.position[2]);
+            m_boatTransforms.push_back(scale * centroid * rotation * translation);
+        }
+    }
+
+    UpdateSpectrum();
+
     // Update Camera
     float speedMultiplier = (m_shift ? 64.0f : 2.0f);
     XMVECTOR cameraTranslate = XMVectorSet(m_right - m_left, 0.0f, m_forward - m_backward, 1.0f) * speedMultiplier * static_cast<float>(e.deltaTime);
@@ -522,23 +482,72 @@ void Ocean::OnUpdate(UpdateEventArgs& e)
     m_skyboxPSO->SetViewMatrix(viewMatrix);
     m_skyboxPSO->SetProjectionMatrix(projMatrix);
 
-    uint32_t phaseDispatchSize = OCEAN_SUBRES / 16;
+    const bool floatBoats = m_floatBoats && m_buoyancy.GetBodyCount() > 0;
+    if (m_cpuSimulation || floatBoats)
+    {
+        OceanFoamParameters foamParameters;
+        foamParameters.decay = m_foamParameters[0];
+        foamParameters.bias = m_foamParameters[1];
+        foamParameters.add = m_foamParameters[2];
+        foamParameters.threshold = m_foamParameters[3];
+
+        HighResolutionClock cpuClock;
+        m_cpuSimulator.Simulate(static_cast<float>(oceanTime), foamParameters);
+        cpuClock.Tick();
+        m_cpuSimulationTime = cpuClock.GetDeltaMilliseconds();
+
+        // Water surface below the camera.
+        XMFLOAT3 cameraPosition;
+        XMStoreFloat3(&cameraPosition, m_camera.GetTranslation());
+
+        OceanSurfaceQuery query;
+        query.x = &cameraPosition.x;
+        query.z = &cameraPosition.z;
+        query.count = 1;
+        query.height = &m_cameraWaterHeight;
+        OceanSurface::Query(m_cpuSimulator, query);
+
+        if (floatBoats)
+            m_buoyancy.UpdateAsync(m_cpuSimulator, static_cast<float>(e.deltaTime));
+    }
+
+    if (m_clipPlayback)
+        UpdateClipPlayback(commandList, oceanTime);
+
+    // Nodes are culled with their bounds grown by how far the drawn cascades can move
+    // the surface, every frame and on every path, after the clip refreshed its bounds.
+    OceanDisplacementBounds cascadeBounds[m_oceanCascadesNumber];
     for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+        cascadeBounds[i] = m_clipPlayback ? m_oceanCascades[i].clipDisplacementBounds : m_oceanCascades[i].displacementBounds;
+    const uint32_t drawnMask = m_clipPlayback ? (1u << m_oceanCascadesNumber) - 1 : m_cascadePlan.activeMask;
+    m_oceanQuadtree.SetDisplacementBounds(OceanSpectrum::SumDisplacementBounds(cascadeBounds, m_oceanCascadesNumber, drawnMask));
+
+    // The compute passes only run without a clip, or when its playback failed.
+    for (UINT i = 0; i < m_oceanCascadesNumber && !m_clipPlayback; ++i)
     {
-        m_oceanPSO->Dispatch(commandList, m_oceanCascades[i].H0Texture, m_oceanCascades[i].slopeTexture, m_oceanCascades[i].displacementTexture, oceanTime, m_oceanPatchSizes[i], XMUINT3(phaseDispatchSize, phaseDispatchSize, 1));
+        // Cascades the planner found (next to) empty are neither simulated nor sampled.
+        if (!m_cascadePlan.IsActive(i))
+            continue;
+
+        const uint32_t resolution = m_cascadePlan.cascades[i].resolution;
+        const uint32_t phaseDispatchSize = resolution / 16;
+        const std::shared_ptr<OceanCompute> fftPSO = GetFFTPSO(resolution);
+
+        const OceanData& data = m_oceanCascades[i];
+        m_oceanPSO->Dispatch(commandList, data.H0Textures[data.front], data.slopeTexture, data.displacementTexture, oceanTime, m_oceanPatchSizes[i], resolution, 1.0f / data.H0Scales[data.front], XMUINT3(phaseDispatchSize, phaseDispatchSize, 1));
         commandList->UAVBarrier(m_oceanCascades[i].slopeTexture);
         commandList->UAVBarrier(m_oceanCascades[i].displacementTexture);
 
         // Displacement
-        m_fftPSO->Dispatch(commandList, m_oceanCascades[i].displacementTexture, XMUINT3(OCEAN_SUBRES, 1, 1), 0); // horizontal fft
+        fftPSO->Dispatch(commandList, m_oceanCascades[i].displacementTexture, XMUINT3(resolution, 1, 1), 0); // horizontal fft
         commandList->UAVBarrier(m_oceanCascades[i].displacementTexture);
-        m_fftPSO->Dispatch(commandList, m_oceanCascades[i].displacementTexture, XMUINT3(OCEAN_SUBRES, 1, 1), 1); // vertical fft
+        fftPSO->Dispatch(commandList, m_oceanCascades[i].displacementTexture, XMUINT3(resolution, 1, 1), 1); // vertical fft
         commandList->UAVBarrier(m_oceanCascades[i].displacementTexture);
 
         // Slope
-        m_fftPSO->Dispatch(commandList, m_oceanCascades[i].slopeTexture, XMUINT3(OCEAN_SUBRES, 1, 1), 0); // horizontal fft
+        fftPSO->Dispatch(commandList, m_oceanCascades[i].slopeTexture, XMUINT3(resolution, 1, 1), 0); // horizontal fft
         commandList->UAVBarrier(m_oceanCascades[i].slopeTexture);
-        m_fftPSO->Dispatch(commandList, m_oceanCascades[i].slopeTexture, XMUINT3(OCEAN_SUBRES, 1, 1), 1); // vertical fft
+        fftPSO->Dispatch(commandList, m_oceanCascades[i].slopeTexture, XMUINT3(resolution, 1, 1), 1); // vertical fft
 
         // Permutation
         commandList->UAVBarrier(m_oceanCascades[i].slopeTexture);
@@ -609,8 +618,9 @@ void Ocean::OnRender()
     else
     {
         SceneVisitor visitor(*commandList, m_camera, *m_unlitPSO, false);
-        SceneVisitor oceanVisitor(*commandList, m_camera, *m_displacementPSO, false);
-        SceneVisitor skyboxVisitor(*commandList, m_camera, *m_skyboxPSO, false);
+        SceneVisitor skyboxVisitor(*commandList, m_camera, *m_skyboxPSO, false, false);
+        visitor.SetSortDraws(m_sortDraws);
+        visitor.SetInstancing(m_instanceDraws);
 
 
          // Clear the render targets.
@@ -627,17 +637,32 @@ void Ocean::OnRender()
         commandList->SetRenderTarget(m_renderTarget);
 
         m_skybox->Accept(skyboxVisitor);
+        skyboxVisitor.Submit();
 
 
         // m_scene->Accept(visitor);
         XMMATRIX duckTranslation = XMMatrixTranslation(-4.0f, 0.0f, 0.0f);
         // m_boat->GetRootNode()->SetLocalTransform(XMMatrixIdentity() * XMMatrixIdentity() * duckTranslation);
-        // m_boat->Accept(visitor);
+        for (const XMMATRIX& transform : m_boatTransforms)
+        {
+            m_boat->GetRootNode()->SetLocalTransform(transform);
+            m_boat->Accept(visitor);
+        }
+        // Before the ocean, which is drawn over the hulls below the water.
+        visitor.Submit();
 
         // Set Ocean Textures
+        if (m_clipPlayback)
+            m_displacementPSO->SetCascades(m_clipPatchSizes, (1u << m_oceanCascadesNumber) - 1);
+        else
+            m_displacementPSO->SetCascades(m_oceanPatchSizes, m_cascadePlan.activeMask);
         for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
         {
-        	m_displacementPSO->SetOceanTextures(m_oceanCascades[i].displacementTexture, m_oceanCascades[i].slopeTexture, m_oceanCascades[i].foamTexture, i);
+            const OceanData& cascade = m_oceanCascades[i];
+            if (m_clipPlayback)
+                m_displacementPSO->SetOceanTextures(cascade.clipDisplacementTexture, cascade.clipSlopeTexture, cascade.clipFoamTexture, i);
+            else
+                m_displacementPSO->SetOceanTextures(cascade.displacementTexture, cascade.slopeTexture, cascade.foamTexture, i);
         }
         
         // m_displacementPSO->SetDirectionalLights(m_directionalLights);
@@ -654,7 +679,55 @@ void Ocean::OnRender()
         // m_scene->GetRootNode()->SetLocalTransform(scale * XMMatrixIdentity() * translation);
 
 
-        m_oceanPlane->Accept(oceanVisitor);
+        // Every node the quadtree keeps is an instance of the patch. Nodes are
+        // grouped by the cascades they sample, one draw per vertex shader permutation.
+        XMMATRIX viewMatrix = m_camera.GetViewMatrix();
+        XMMATRIX projectionMatrix = m_camera.GetProjectionMatrix();
+        float frustumPlanes[6][4];
+        m_camera.GetFrustumPlanes(frustumPlanes);
+
+        XMFLOAT3 cameraPosition;
+        XMStoreFloat3(&cameraPosition, m_camera.GetTranslation());
+
+        const float focalLength = m_height / (2.0f * std::tan(XMConvertToRadians(m_camera.GetFov()) * 0.5f));
+        const std::vector<float>& patchSizes = m_clipPlayback ? m_clipPatchSizes : m_oceanPatchSizes;
+
+        auto selectStart = std::chrono::high_resolution_clock::now();
+        m_oceanQuadtree.ClassifyCascades(patchSizes.data(), m_oceanCascadesNumber, focalLength);
+        m_oceanQuadtree.Select(&cameraPosition.x, frustumPlanes, m_oceanNodes);
+
+        for (std::vector<OceanQuadtreeNode>& group : m_oceanNodeGroups)
+            group.clear();
+        for (const OceanQuadtreeNode& node : m_oceanNodes)
+            m_oceanNodeGroups[m_oceanCascadesNumber - static_cast<UINT>(node.cascadeCount)].push_back(node);
+        m_oceanSelectTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - selectStart).count();
+
+        // Displacement fetches of the frame against sampling every simulated cascade everywhere.
+        const uint32_t activeMask = m_clipPlayback ? (1u << m_oceanCascadesNumber) - 1 : m_cascadePlan.activeMask;
+        const uint64_t patchVertices = (OCEAN_PATCH_RESOLUTION + 1) * (OCEAN_PATCH_RESOLUTION + 1);
+        m_oceanFetches = 0;
+        for (UINT i = 0; i < _countof(m_oceanNodeGroups); ++i)
+        {
+            const uint32_t sampledMask = activeMask & ((1u << (m_oceanCascadesNumber - i)) - 1);
+            m_oceanFetches += m_oceanNodeGroups[i].size() * patchVertices * std::popcount(sampledMask);
+        }
+        m_oceanFullFetches = m_oceanNodes.size() * patchVertices * std::popcount(activeMask);
+
+        std::shared_ptr<Mesh> patch = m_oceanPatch->GetRootNode()->GetMesh();
+        m_displacementPSO->SetViewMatrix(viewMatrix);
+        m_displacementPSO->SetProjectionMatrix(projectionMatrix);
+        m_displacementPSO->SetWorldMatrix(XMMatrixIdentity());
+        m_displacementPSO->SetMaterial(patch->GetMaterial());
+        for (UINT i = 0; i < _countof(m_oceanNodeGroups); ++i)
+        {
+            if (m_oceanNodeGroups[i].empty())
+                continue;
+
+            m_displacementPSO->SetNodes(m_oceanNodeGroups[i], OCEAN_PATCH_RESOLUTION);
+            m_displacementPSO->SetSampledCascades(m_oceanCascadesNumber - i);
+            m_displacementPSO->Apply(*commandList);
+            patch->Draw(*commandList, static_cast<uint32_t>(m_oceanNodeGroups[i].size()));
+        }
 
         XMMATRIX helmetTranslation = XMMatrixTranslation(0.0f, 2.0f, 0.0f);
         m_helmet->GetRootNode()->SetLocalTransform(XMMatrixIdentity() * rotation * helmetTranslation);
@@ -664,7 +737,7 @@ void Ocean::OnRender()
         //
         // m_chessboard->Accept(visitor);
 
-    	// Visualize the point light as a small sphere
+    	// Visualize the point light as a small sphere, Submit draws them all as instances.
         for (const auto& l : m_pointLights)
         {
             auto lightPos = XMLoadFloat4(&l.positionWS);
@@ -672,6 +745,10 @@ void Ocean::OnRender()
             m_sphere->GetRootNode()->SetLocalTransform(worldMatrix);
             m_sphere->Accept(visitor);
         }
+        visitor.Submit();
+        m_sceneCulling = visitor.GetCullingStats();
+        m_sceneStateStats = visitor.GetStateStats();
+        m_sceneInstancing = visitor.GetInstancingStats();
 
         // // Resolve the MSAA render target to the swapchain's backbuffer.
         // auto& swapChainRT = m_swapChain->GetRenderTarget();
@@ -772,10 +849,11 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
 
             auto Slider = [&](const char* label, float* v, float vmin, float vmax, const char* tooltip = nullptr) -> bool
                 {
+                    // Regeneration runs in the background and coalesces edits, so the ocean follows the drag.
                     bool changed = ImGui::SliderFloat(label, v, vmin, vmax);
                     if (tooltip && ImGui::IsItemHovered())
                         ImGui::SetTooltip("%s", tooltip);
-                    return ImGui::IsItemDeactivatedAfterEdit();
+                    return changed;
                 };
 
             auto SectionHeader = [](const char* label, ImVec4 color)
@@ -795,6 +873,83 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
                 ImGui::Unindent();
             }
 
+            // ── Cascades ──
+            if (ImGui::CollapsingHeader("  Cascades"))
+            {
+                ImGui::Indent();
+                static const char* resolutionNames[] = { "64", "128", "256", "512", "1024" };
+                static const uint32_t qualityTiers[][m_oceanCascadesNumber] =
+                {
+                    { 128, 128, 64, 64 },    // Low
+                    { 256, 256, 128, 128 },  // Medium
+                    { 512, 512, 256, 256 },  // High
+                    { 512, 512, 512, 512 },  // Ultra
+                };
+                static const char* qualityNames[] = { "Low", "Medium", "High", "Ultra" };
+
+                paramsChanged |= ImGui::Checkbox("Automatic", &m_autoCascades);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Plans the patch sizes from the spectrum and skips cascades without energy");
+                if (m_autoCascades)
+                {
+                    paramsChanged |= ImGui::SliderFloat("Skip Below", &m_plannerSettings.minEnergyFraction, 1e-5f, 1e-1f, "%.5f", ImGuiSliderFlags_Logarithmic);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Share of the height and slope energy a cascade needs to be simulated");
+                }
+
+                int quality = -1;
+                for (int tier = 0; tier < IM_ARRAYSIZE(qualityTiers); ++tier)
+                {
+                    if (std::equal(std::begin(qualityTiers[tier]), std::end(qualityTiers[tier]), m_oceanCascades,
+                        [](uint32_t resolution, const OceanData& cascade) { return resolution == cascade.resolution; }))
+                        quality = tier;
+                }
+                if (ImGui::Combo("Quality", &quality, qualityNames, IM_ARRAYSIZE(qualityNames)))
+                {
+                    for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+                        m_oceanCascades[i].resolution = qualityTiers[quality][i];
+                    paramsChanged = true;
+                }
+
+                paramsChanged |= ImGui::Checkbox("Half Precision", &m_halfPrecision);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Stores H0 and the simulation targets as 16 bit floats, --benchmark reports the height error");
+                double textureBytes = 0.0;
+                for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+                {
+                    // Both H0 textures and the slope and displacement targets with their mips.
+                    const size_t texels = static_cast<size_t>(m_cascadePlan.cascades[i].resolution) * m_cascadePlan.cascades[i].resolution;
+                    textureBytes += texels * (m_oceanCascades[i].outputFormat == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8.0 : 16.0) * (2.0 + 2.0 * 4.0 / 3.0);
+                }
+                ImGui::TextDisabled("  H0 and targets: %.1f MB", textureBytes / (1024.0 * 1024.0));
+
+                float totalHeight = 0.0f, totalSlope = 0.0f;
+                for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+                {
+                    totalHeight += m_cascadePlan.heightEnergy[i];
+                    totalSlope += m_cascadePlan.slopeEnergy[i];
+                }
+
+                for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+                {
+                    int permutation = 0;
+                    while ((OCEAN_MIN_SUBRES << permutation) < m_oceanCascades[i].resolution)
+                        ++permutation;
+
+                    char label[64];
+                    sprintf_s(label, _countof(label), "Cascade %u (%.1f m)", i, m_oceanPatchSizes[i]);
+                    if (ImGui::Combo(label, &permutation, resolutionNames, IM_ARRAYSIZE(resolutionNames)))
+                    {
+                        m_oceanCascades[i].resolution = OCEAN_MIN_SUBRES << permutation;
+                        paramsChanged = true;
+                    }
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("FFT resolution of the cascade");
+
+                    ImGui::TextDisabled("  height %5.1f%%, slope %5.1f%%%s",
+                        totalHeight > 0.0f ? 100.0f * m_cascadePlan.heightEnergy[i] / totalHeight : 0.0f,
+                        totalSlope > 0.0f ? 100.0f * m_cascadePlan.slopeEnergy[i] / totalSlope : 0.0f,
+                        m_cascadePlan.IsActive(i) ? "" : " (skipped)");
+                }
+                ImGui::Unindent();
+            }
+
             // ── Spectrum ──
             if (ImGui::CollapsingHeader("  Spectrum", ImGuiTreeNodeFlags_DefaultOpen))
             {
@@ -804,10 +959,27 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
                 paramsChanged |= Slider("Swell", &m_jonswapParams.swell, 0.0f, 1.0f, "Swell influence on wave choppiness");
                 paramsChanged |= Slider("Spread Blend", &m_jonswapParams.spreadBlend, 0.0f, 1.0f, "Blend between directional and isotropic spreading");
                 paramsChanged |= Slider("Short Wave Fade", &m_jonswapParams.shortWavesFade, 0.0f, 1.0f, "Fade out short high-frequency waves");
+                ImGui::InputScalar("Seed", ImGuiDataType_U32, &m_noiseSeed);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Seed of the wave phases, the same seed always gives the same ocean");
+                paramsChanged |= ImGui::IsItemDeactivatedAfterEdit();
 
                 ImGui::Spacing();
                 ImGui::TextDisabled("Alpha:      %.6f", m_jonswapParams.alpha);
                 ImGui::TextDisabled("Peak Omega: %.4f", m_jonswapParams.peakOmega);
+                ImGui::TextDisabled("H0 build:   %.2f ms%s", m_h0BuildTime,
+                    m_spectrumTask.valid() ? ", building" : m_spectrumUpload ? ", uploading" : "");
+                ImGui::TextDisabled("Rebuilt:    %s%s%s%s%s",
+                    (m_h0RebuildFlags & SDF_KTable) ? "k-table " : "",
+                    (m_h0RebuildFlags & SDF_Noise) ? "noise " : "",
+                    (m_h0RebuildFlags & SDF_Radial) ? "radial " : "",
+                    (m_h0RebuildFlags & SDF_Directional) ? "directional " : "",
+                    (m_h0RebuildFlags & SDF_Scale) ? "scale" : "");
+                ImGui::TextDisabled("H0 cache:   %u hits, %u misses", m_h0Cache->GetHits(), m_h0Cache->GetMisses());
+                ImGui::SameLine();
+                if (ImGui::SmallButton("Clear"))
+                    m_h0Cache->Clear();
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Removes the cached spectra from disk");
                 ImGui::Unindent();
             }
 
@@ -826,6 +998,24 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
                 Slider("Height Modifier", &m_displacementPSO->m_oceanRenderParams.heightMod, 0.0f, 5.0f, "Vertical scale of SSS wave height proxy");
                 Slider("Peak Scatter", &m_displacementPSO->m_oceanRenderParams.peakScatterIntensity, 0.0f, 1.0f, "Subsurface scatter intensity at wave crests");
                 Slider("IBL Intensity", &m_displacementPSO->m_oceanRenderParams.IBLIntensity, 0.0f, 1.0f, "Image-based lighting contribution");
+                if (m_iblCacheHit)
+                {
+                    ImGui::TextDisabled("IBL: cached bake loaded in %.1f ms", m_iblLoadTime);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Sky cubemap, prefiltered specular and SH irradiance read from the DDS files next to the panorama");
+                }
+                else
+                {
+                    ImGui::TextDisabled("IBL: baked in %.1f ms", m_iblLoadTime);
+                    if (ImGui::IsItemHovered())
+                        ImGui::SetTooltip("No bake of this panorama and these settings yet, baked on the CPU and stored next to it\n"
+                                          "Cubemap %.0f ms, irradiance %.1f ms, specular %.0f ms",
+                                          m_iblBakeTimes.cubemap, m_iblBakeTimes.irradiance, m_iblBakeTimes.specular);
+                }
+                ImGui::TextDisabled("BRDF LUT: %u^2 %s, %s in %.1f ms", m_brdfLutDesc.size, m_brdfLutDesc.format == OBF_Half ? "R16G16_FLOAT" : "R8G8_UNORM",
+                                    m_brdfLutGenerated ? "generated" : "loaded", m_brdfLutLoadTime);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip(m_brdfLutGenerated ? "brdf_lut.bin was missing or invalid, generated at startup and stored next to the executable"
+                                                         : "Built with the executable, %u samples per texel", m_brdfLutDesc.sampleCount);
                 ImGui::Unindent();
             }
 
@@ -844,16 +1034,155 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
                 ImGui::Unindent();
             }
 
+            // ── Surface ──
+            if (ImGui::CollapsingHeader("  Surface"))
+            {
+                ImGui::Indent();
+                OceanQuadtreeSettings quadtreeSettings = m_oceanQuadtree.GetSettings();
+                bool changed = false;
+                changed |= ImGui::SliderFloat("Leaf Size", &quadtreeSettings.leafSize, 4.0f, 128.0f, "%.0f m");
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Edge length of the finest nodes, the grid spacing near the camera is this over %d", OCEAN_PATCH_RESOLUTION);
+                int lodCount = static_cast<int>(quadtreeSettings.lodCount);
+                if (ImGui::SliderInt("Levels", &lodCount, 1, 14))
+                {
+                    quadtreeSettings.lodCount = static_cast<uint32_t>(lodCount);
+                    changed = true;
+                }
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Detail levels, every level doubles the size of the visible ocean");
+                changed |= ImGui::SliderFloat("Range Factor", &quadtreeSettings.rangeFactor, 4.5f, 16.0f);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Distance up to which a level is used, in node sizes of that level");
+                changed |= ImGui::SliderFloat("Samples per Patch", &quadtreeSettings.minSamplesPerPatch, 0.5f, 16.0f);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Cascades are skipped on levels where their patch spans fewer vertices or pixels");
+                if (changed)
+                    m_oceanQuadtree.SetSettings(quadtreeSettings);
+
+                const size_t patchVertices = (OCEAN_PATCH_RESOLUTION + 1) * (OCEAN_PATCH_RESOLUTION + 1);
+                ImGui::TextDisabled("Nodes:    %zu (%zu vertices)", m_oceanNodes.size(), m_oceanNodes.size() * patchVertices);
+                ImGui::TextDisabled("Patch:    %u vertices, %u %s indices, %.1f KB in %.3f ms", m_oceanPatchStats.numVertices,
+                                    m_oceanPatchStats.numIndices, m_oceanPatchStats.indexFormat == DXGI_FORMAT_R16_UINT ? "16-bit" : "32-bit",
+                                    m_oceanPatchStats.uploadBytes / 1024.0, m_oceanPatchStats.generateTime);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Generated straight into upload memory at load time");
+                ImGui::TextDisabled("Extent:   %.1f km", m_oceanQuadtree.GetRootSize() / 1000.0f);
+                const OceanDisplacementBounds& displacementBounds = m_oceanQuadtree.GetDisplacementBounds();
+                ImGui::TextDisabled("Bounds:   %.1f m sideways, %.1f m up and down", displacementBounds.horizontal, displacementBounds.vertical);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Largest displacement the spectrum allows, nodes are culled with this margin");
+                ImGui::TextDisabled("Select:   %.3f ms", m_oceanSelectTime);
+                ImGui::TextDisabled("Draws:    %zu / %zu / %zu nodes with 4 / 3 / 2 cascades",
+                                    m_oceanNodeGroups[0].size(), m_oceanNodeGroups[1].size(), m_oceanNodeGroups[2].size());
+                ImGui::TextDisabled("Fetches:  %.2fM of %.2fM, %.0f%% saved", m_oceanFetches / 1e6, m_oceanFullFetches / 1e6,
+                                    m_oceanFullFetches ? 100.0 * (m_oceanFullFetches - m_oceanFetches) / m_oceanFullFetches : 0.0);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Displacement texture fetches of the vertex shaders this frame");
+                ImGui::Unindent();
+            }
+
+            // ── CPU Simulation ──
+            if (ImGui::CollapsingHeader("  CPU Simulation"))
+            {
+                ImGui::Indent();
+                if (ImGui::Checkbox("Simulate on CPU", &m_cpuSimulation) && m_cpuSimulation)
+                    m_cpuSimulator.ResetFoam();
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Runs the animate, FFT and permute passes on the CPU as well");
+                if (m_cpuSimulation)
+                {
+                    ImGui::TextDisabled("Simulate:   %.2f ms", m_cpuSimulationTime);
+                    ImGui::TextDisabled("Water height below camera: %.2f m", m_cameraWaterHeight);
+                }
+                ImGui::Unindent();
+            }
+
+            // ── Buoyancy ──
+            if (ImGui::CollapsingHeader("  Buoyancy"))
+            {
+                ImGui::Indent();
+                if (ImGui::Checkbox("Float boats", &m_floatBoats) && m_floatBoats)
+                    SpawnBoats();
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Floats copies of the ship on the CPU simulation, which runs while they do");
+                ImGui::SliderInt("Boats", &m_boatCount, 1, 256);
+                if (ImGui::IsItemDeactivatedAfterEdit() && m_floatBoats)
+                    SpawnBoats();
+                ImGui::SliderFloat("Density", &m_boatDensity, 0.05f, 0.95f, "%.2f");
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Mass of a ship as a fraction of the water its hull can displace");
+                if (ImGui::IsItemDeactivatedAfterEdit() && m_floatBoats)
+                    SpawnBoats();
+                ImGui::SliderFloat("Scale", &m_boatScale, 0.5f, 10.0f, "%.1f");
+                if (ImGui::IsItemDeactivatedAfterEdit())
+                {
+                    BuildBoatHull();
+                    if (m_floatBoats)
+                        SpawnBoats();
+                }
+                if (ImGui::Button("Respawn"))
+                    SpawnBoats();
+                ImGui::TextDisabled("Hull:     %zu probes of %.2f m, %.1f m^3", m_boatHull.probeX.size(), m_boatHull.probeSize, m_boatHull.volume);
+                if (m_floatBoats)
+                {
+                    ImGui::TextDisabled("Step:     %.2f ms for %u steps of %u probes", m_buoyancyTime, m_buoyancySteps, m_buoyancy.GetProbeCount());
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Runs on a worker while the frame is rendered");
+                }
+                ImGui::Unindent();
+            }
+
+            // ── Playback ──
+            if (ImGui::CollapsingHeader("  Playback"))
+            {
+                ImGui::Indent();
+                ImGui::InputText("Clip", m_clipPath, IM_ARRAYSIZE(m_clipPath));
+                ImGui::SameLine();
+                if (ImGui::Button("Load"))
+                    LoadClip(m_clipPath);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Clips are baked with --bake <path>");
+
+                if (m_clip.IsOpen())
+                {
+                    const OceanClipDesc& clip = m_clip.GetDesc();
+                    ImGui::Checkbox("Play clip", &m_clipPlayback);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Streams the baked frames instead of running the compute passes");
+                    ImGui::TextDisabled("Clip:       %u frames at %.0f fps, %.1f s loop, %s",
+                        clip.frameCount, clip.frameRate, clip.GetDuration(), clip.format == OCF_Half ? "half" : "unorm16");
+                    ImGui::TextDisabled("Size:       %.1f MB", m_clip.GetSize() / (1024.0 * 1024.0));
+                    if (m_clipPlayback)
+                        ImGui::TextDisabled("Frame %u:  %.2f ms decode and upload", m_clipFrame, m_clipUploadTime);
+                }
+                ImGui::Unindent();
+            }
+
+            // ── Scene ──
+            if (ImGui::CollapsingHeader("  Scene"))
+            {
+                ImGui::Indent();
+                ImGui::TextDisabled("Culling: %u meshes tested, %u culled, %u drawn", m_sceneCulling.tested, m_sceneCulling.culled, m_sceneCulling.drawn);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Meshes of the ship, helmet and light spheres this frame, %u scene nodes skipped", m_sceneCulling.skippedNodes);
+                ImGui::Checkbox("Sort draws", &m_sortDraws);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Sorts the draws by material and mesh, off draws them in scene graph order");
+                ImGui::Checkbox("Instance draws", &m_instanceDraws);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Draws sorted meshes that share a mesh and material, like the ships and light spheres, as one instanced draw");
+                ImGui::TextDisabled("Instancing: %u meshes in %u instanced draws", m_sceneInstancing.instances, m_sceneInstancing.draws);
+                const CommandList::StateStats& state = m_sceneStateStats;
+                ImGui::TextDisabled("State:   %u draws, %u PSOs, %u root signatures", state.draws, state.pipelineStates, state.rootSignatures);
+                ImGui::TextDisabled("         %u SRVs, %u root buffers, %u VBs, %u IBs", state.shaderResourceViews, state.rootBuffers, state.vertexBuffers, state.indexBuffers);
+                const std::pair<const char*, const Scene*> scenes[] = { { "Helmet", m_helmet.get() }, { "Chess", m_chessboard.get() } };
+                for (const auto& [name, scene] : scenes)
+                {
+                    const BoundingVolumeHierarchy& bvh = scene->GetBVH();
+                    const Scene::BVHStats& stats = scene->GetBVHStats();
+                    ImGui::TextDisabled("%-7s %zu meshes, %zu nodes, depth %u", name, scene->GetBVHItems().size(), bvh.GetNodes().size(), bvh.GetDepth());
+                    ImGui::TextDisabled("        %u builds (%.3f ms), %u refits (%.3f ms), cost %.2fx",
+                        stats.builds, stats.buildTime, stats.refits, stats.refitTime, bvh.IsEmpty() ? 1.0f : bvh.GetCost() / bvh.GetBuildCost());
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Refits make the tree worse as meshes move, it is built again past 1.5x");
+                    const Scene::GeometryStats& geometry = scene->GetGeometryStats();
+                    ImGui::TextDisabled("        %u meshes in one VB and IB, %.1f + %.1f KB, %.1f KB padding", geometry.meshes,
+                        geometry.vertexBytes / 1024.0, geometry.indexBytes / 1024.0, geometry.paddingBytes / 1024.0);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Every mesh's section of the buffers starts on 256 bytes");
+                }
+                ImGui::Unindent();
+            }
+
             if (paramsChanged)
             {
                 m_jonswapParams.angle = m_jonswapParams.windDirection / 180.0f * PI;
-                m_jonswapParams.alpha = JonswapAlpha(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
-                m_jonswapParams.peakOmega = JonswapPeakFequency(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
-                auto& cq = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-                auto cl = cq.GetCommandList();
-                for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
-                    GenerateH0(cl, i);
-                cq.ExecuteCommandList(cl);
+                m_jonswapParams.alpha = OceanSpectrum::JonswapAlpha(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
+                m_jonswapParams.peakOmega = OceanSpectrum::JonswapPeakFequency(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
+                RequestSpectrum();
             }
         }
         ImGui::End();
@@ -886,12 +1215,19 @@ void Ocean::OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderT
 }
 void Ocean::UnloadContent()
 {
+    // The spectrum worker writes into the cascades, let it finish first.
+    if (m_spectrumTask.valid())
+        m_spectrumTask.wait();
+    m_spectrumTask = {};
+    m_spectrumUpload.reset();
+
     m_cubeMesh.reset();
     m_scene.reset();
     m_helmet.reset();
     m_chessboard.reset();
+    m_buoyancy.Clear();
     m_boat.reset();
-    m_oceanPlane.reset();
+    m_oceanPatch.reset();
     m_skybox.reset();
 
     m_defaultTexture.reset();
@@ -903,19 +1239,27 @@ void Ocean::UnloadContent()
     m_skyboxPSO.reset();
     m_sdrPSO.reset();
     m_oceanPSO.reset();
-    m_fftPSO.reset();
+    for (auto& fftPSO : m_fftPSOs)
+        fftPSO.reset();
     m_permutePSO.reset();
     for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
     {
-    	m_oceanCascades[i].H0Texture.reset();
+        m_oceanCascades[i].H0Textures[0].reset();
+        m_oceanCascades[i].H0Textures[1].reset();
         m_oceanCascades[i].slopeTexture.reset();
         m_oceanCascades[i].displacementTexture.reset();
         m_oceanCascades[i].foamTexture.reset();
+        m_oceanCascades[i].clipDisplacementTexture.reset();
+        m_oceanCascades[i].clipSlopeTexture.reset();
+        m_oceanCascades[i].clipFoamTexture.reset();
     }
-    m_skyboxTexture.reset();
     m_skyboxCubemap.reset();
+    m_specularIrradianceMap.reset();
+    m_brdfLUT.reset();
     m_HDRTexture.reset();
     m_skyboxCubemapSRV.reset();
+    m_specularCubemapSRV.reset();
+    m_brdfLUTSRV.reset();
     m_skyboxSignature.reset();
     m_HDRRootSignature.reset();
     m_SDRRootSignature.reset();
@@ -949,203 +1293,396 @@ float Ocean::InitPhillipsSpectrum(XMFLOAT2 k, XMFLOAT2 windDir, float windSpeed,
 
 }
 
-float DispersionRelation(float kMag)
+std::unique_ptr<Ocean::SpectrumBuild> Ocean::BuildSpectrum(JonswapParameters params, uint32_t seed, std::vector<uint32_t> resolutions,
+                                                          OceanCascadePlannerSettings settings, bool automatic, bool halfPrecision)
 {
-    return sqrt(9.81f * kMag * tanh(std::min(kMag * OCEAN_DEPTH, 20.0f)));
-}
+    HighResolutionClock clock;
+    auto build = std::make_unique<SpectrumBuild>();
+    build->plan = PlanCascades(params, resolutions, settings, automatic);
 
-float DispersionDerivative(float kMag)
-{
-    float th = tanh(std::min(kMag * OCEAN_DEPTH, 20.0f));
-    float ch = cosh(kMag * 20.0f);
-    return 9.81f * (OCEAN_DEPTH * kMag / ch / ch + th) / DispersionRelation(kMag) / 2.0f;
-}
+    for (UINT cascade = 0; cascade < m_oceanCascadesNumber; ++cascade)
+    {
+        const OceanCascadeDesc& cascadeDesc = build->plan.cascades[cascade];
+
+        // Without an up to date spectrum in memory (startup, resolution changes) a
+        // cached H0 is mapped straight from disk. Otherwise the cascade keeps its
+        // k-space table and spectrum terms around and only recomputes what the
+        // changed parameters touch, which beats reading the file back. The noise only
+        // depends on (seed, cascade, texel), so the wave phases stay put when the
+        // spectrum changes.
+        OceanCascadeSpectrum& spectrum = m_oceanCascades[cascade].spectrum;
+        const uint64_t cacheKey = OceanH0Cache::MakeKey(params, cascadeDesc, seed, cascade);
+
+        if (!spectrum.IsValid() && m_h0Cache->Load(cacheKey, cascadeDesc.resolution, build->cachedH0[cascade]))
+        {
+            build->packedH0[cascade] = build->cachedH0[cascade].packedH0;
+        }
+        else
+        {
+            uint32_t rebuildFlags = spectrum.Update(params, cascadeDesc, seed, cascade);
+            build->packedH0[cascade] = spectrum.GetPackedH0().data();
+            // Spectra that newer edits already replaced (the steps of a slider drag) aren't worth the disk space.
+            if (rebuildFlags != SDF_None && !m_spectrumDirty)
+                m_h0Cache->Store(cacheKey, cascadeDesc.resolution, build->packedH0[cascade]);
+            build->rebuildFlags |= rebuildFlags;
+        }
 
-float NormalizationFactor(float s)
-{
-    float s2 = s * s;
-    float s3 = s2 * s;
-    float s4 = s3 * s;
-    if (s < 5) return -0.000564f * s4 + 0.00776f * s3 - 0.044f * s2 + 0.192f * s + 0.163f;
-    else return -4.80e-08f * s4 + 1.07e-05f * s3 - 9.53e-04f * s2 + 5.90e-02f * s + 3.93e-01f;
-}
+        build->displacementBounds[cascade] = OceanSpectrum::DisplacementBounds(cascadeDesc, build->packedH0[cascade], OceanCpuSimulator::LAMBDA);
 
-float Cosine2s(float theta, float s)
-{
-    return NormalizationFactor(s) * pow(abs(cos(0.5f * theta)), 2.0f * s);
-}
+        // Scaled by a power of two, the H0 of the short wave cascades would
+        // otherwise end up in the subnormal halves.
+        build->H0Scales[cascade] = 1.0f;
+        if (halfPrecision)
+        {
+            const size_t valueCount = static_cast<size_t>(cascadeDesc.resolution) * cascadeDesc.resolution * 4;
+            build->H0Scales[cascade] = OceanHalf::RangeScale(build->packedH0[cascade], valueCount);
+            build->halfH0[cascade].resize(valueCount);
+            OceanHalf::FromFloat(build->packedH0[cascade], build->halfH0[cascade].data(), valueCount, build->H0Scales[cascade]);
+        }
+    }
+    build->halfPrecision = halfPrecision;
 
-float SpreadPower(float omega, float peakOmega)
-{
-    if (omega > peakOmega)
-        return 9.77f * pow(abs(omega / peakOmega), -2.5f);
-    else
-        return 6.97f * pow(abs(omega / peakOmega), 5.0f);
+    clock.Tick();
+    build->buildTime = clock.GetDeltaMilliseconds();
+    return build;
 }
 
-float Ocean::DirectionSpectrum(float theta, float omega)
+void Ocean::UploadSpectrum(std::shared_ptr<CommandList> commandList, const SpectrumBuild& build)
 {
-    float s = SpreadPower(omega, m_jonswapParams.peakOmega) + 16 * tanh(std::min(omega / m_jonswapParams.peakOmega, 20.0f)) * m_jonswapParams.swell * m_jonswapParams.swell;
+    for (UINT cascade = 0; cascade < m_oceanCascadesNumber; ++cascade)
+    {
+        OceanData& data = m_oceanCascades[cascade];
+        const uint32_t back = data.front ^ 1;
+        const uint32_t resolution = build.plan.cascades[cascade].resolution;
+
+        // The back texture is only replaced when the resolution or precision changed, every other edit rewrites it.
+        const DXGI_FORMAT format = build.halfPrecision ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT;
+        if (!data.H0Textures[back] || data.H0Resolutions[back] != resolution || data.H0Formats[back] != format)
+        {
+            auto H0Desc = CD3DX12_RESOURCE_DESC::Tex2D(format, resolution, resolution, 1, 1);
+            data.H0Textures[back] = Application::Get().CreateTexture(H0Desc);
+            data.H0Textures[back]->SetName(L"H0 Texture" + std::to_wstring(cascade) + L"_" + std::to_wstring(back));
+            data.H0Resolutions[back] = resolution;
+            data.H0Formats[back] = format;
+        }
+        data.H0Scales[back] = build.H0Scales[cascade];
 
-    return std::lerp(2.0f / 3.1415f * cos(theta) * cos(theta), Cosine2s(theta - m_jonswapParams.angle, s), m_jonswapParams.spreadBlend);
+        D3D12_SUBRESOURCE_DATA subData = {};
+        if (build.halfPrecision)
+        {
+            subData.pData = build.halfH0[cascade].data();
+            subData.RowPitch = resolution * 4 * sizeof(uint16_t);
+        }
+        else
+        {
+            subData.pData = build.packedH0[cascade];
+            subData.RowPitch = resolution * 4 * sizeof(float);
+        }
+        subData.SlicePitch = subData.RowPitch * resolution;
+        commandList->CopyTextureSubresource(data.H0Textures[back], 0, 1, &subData);
+    }
 }
 
-float Ocean::ShortWavesFade(float kLength)
+void Ocean::SwapSpectrum(const SpectrumBuild& build)
 {
-    return exp(-m_jonswapParams.shortWavesFade * m_jonswapParams.shortWavesFade * kLength * kLength);
-}
+    // The CPU simulation rounds like the textures, so the queries see the same surface.
+    m_cpuSimulator.SetHalfPrecision(build.halfPrecision);
+    for (UINT cascade = 0; cascade < m_oceanCascadesNumber; ++cascade)
+    {
+        OceanData& data = m_oceanCascades[cascade];
+        const OceanCascadeDesc& cascadeDesc = build.plan.cascades[cascade];
+
+        data.front ^= 1;
+        const DXGI_FORMAT outputFormat = build.halfPrecision ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT;
+        if (data.outputResolution != cascadeDesc.resolution || data.outputFormat != outputFormat)
+            CreateCascadeOutputs(cascade, cascadeDesc.resolution, outputFormat);
+        m_cpuSimulator.SetCascade(cascade, cascadeDesc, build.packedH0[cascade]);
+        data.displacementBounds = build.displacementBounds[cascade];
+    }
 
+    m_cascadePlan = build.plan;
+    m_oceanPatchSizes.resize(m_oceanCascadesNumber);
+    for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+        m_oceanPatchSizes[i] = m_cascadePlan.cascades[i].patchSize;
 
-void Ocean::GenerateH0(std::shared_ptr<CommandList> commandList, const UINT cascade) {
+    m_h0BuildTime = build.buildTime;
+    m_h0RebuildFlags = build.rebuildFlags;
+}
 
-    float patchSize = m_oceanPatchSizes[cascade];
-    float deltaK = 2.0f * PI / patchSize;
-    float highestK = (OCEAN_SUBRES / 2.0f) * deltaK; // nyquist limit
+void Ocean::CreateCascadeOutputs(const UINT cascade, uint32_t resolution, DXGI_FORMAT format)
+{
+    OceanData& data = m_oceanCascades[cascade];
 
-    // moved to heap to avoid stack overflow
-    std::vector<std::complex<float>> H0(OCEAN_SUBRES * OCEAN_SUBRES, { 0,0 });
-    std::vector<std::complex<float>> H0Conj(OCEAN_SUBRES * OCEAN_SUBRES, { 0,0 });
+    // The FFT passes work in place, in half precision the spectrum and the pass between the FFTs are stored in half as well.
+    auto phaseDesc = CD3DX12_RESOURCE_DESC::Tex2D(format, resolution, resolution);
+    phaseDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-    const float lowCutoff = cascade == 0 ? 0.001f : (OCEAN_SUBRES * PI / m_oceanPatchSizes[cascade - 1]); // nyquist limit of previous cascade;
-    const float highCutoff = highestK;
-    for (int m = 0; m < OCEAN_SUBRES; m++) {
-        for (int n = 0; n < OCEAN_SUBRES; n++) {
-            // Get wave vector for this frequency
-            float kx = (n - OCEAN_SUBRES / 2.0f) * deltaK;
-            float ky = (m - OCEAN_SUBRES / 2.0f) * deltaK;
-            float k(sqrtf(kx * kx + ky * ky));
+    auto foamDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, resolution, resolution);
+    foamDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-            if (k >= lowCutoff && k <= highCutoff)
-            {
-	            
-            float kAngle = atan2(ky, kx);
-            float omega = DispersionRelation(k);
-            float dOmegadk = DispersionDerivative(k);
-
-            float spectrum = JONSWAP(omega) * DirectionSpectrum(kAngle, omega) * ShortWavesFade(k);
-            
-            // Generate two independent gaussian random numbers
-            float xiR = GaussianRandom();
-            float xiI = GaussianRandom();
-            //
-            // XMFLOAT2 windDir(0.7f, 0.7f); // diagonal wind
-            // float windSpeed = 30.0f;
-
-            // float Ph = InitPhillipsSpectrum(k, windDir,windSpeed);
-
-            // Equation 42: h0(k) = (1/√2) * (gausRandom + i*gausRandomI) * sqrt(Ph(k))
-            // H0[m][n] = (1.0f / sqrtf(2.0f)) * std::complex<float>(xiR, xiI) * sqrtf(Ph);
-            float amplitude = sqrtf(2.0f * spectrum * fabsf(dOmegadk) / k * deltaK * deltaK);
-            H0[m * OCEAN_SUBRES + n] = std::complex<float>(xiR * amplitude, xiI * amplitude);
-            }
-        }
-    }
+    data.slopeTexture = Application::Get().CreateTexture(phaseDesc);
+    data.slopeTexture->SetName(L"Slope Output Texture" + std::to_wstring(cascade));
 
-    // Needs its own loop since the conjugate needs all data of H0 to be valid
-    for (int m = 0; m < OCEAN_SUBRES; m++) {
-        for (int n = 0; n < OCEAN_SUBRES; n++) {
-            int m_minus = (OCEAN_SUBRES - m) % OCEAN_SUBRES;
-            int n_minus = (OCEAN_SUBRES - n) % OCEAN_SUBRES;
-            H0Conj[m * OCEAN_SUBRES + n] = std::conj(H0[m_minus * OCEAN_SUBRES + n_minus]);
-        }
-    }
-	
-    // TODO: the tex formats can probably be 16bit rather than 32
-    // Input texture SRV
-	DXGI_FORMAT H0Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    auto H0Desc = CD3DX12_RESOURCE_DESC::Tex2D(H0Format, OCEAN_SUBRES, OCEAN_SUBRES);
-    
-    // output phase texture UAV
-    DXGI_FORMAT phaseFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    auto phaseDesc = CD3DX12_RESOURCE_DESC::Tex2D(phaseFormat, OCEAN_SUBRES, OCEAN_SUBRES);
-    phaseDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    data.displacementTexture = Application::Get().CreateTexture(phaseDesc);
+    data.displacementTexture->SetName(L"Displacement Output Texture" + std::to_wstring(cascade));
 
-    DXGI_FORMAT foamFormat = DXGI_FORMAT_R32_FLOAT;
-    auto foamDesc = CD3DX12_RESOURCE_DESC::Tex2D(foamFormat, OCEAN_SUBRES, OCEAN_SUBRES);
-    foamDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    data.foamTexture = Application::Get().CreateTexture(foamDesc);
+    data.foamTexture->SetName(L"Jacobian foam Texture" + std::to_wstring(cascade));
 
+    data.outputResolution = resolution;
+    data.outputFormat = format;
+}
 
-	// Copy H0 texture data
-    m_oceanCascades[cascade].H0Texture = Application::Get().CreateTexture(H0Desc);
-    m_oceanCascades[cascade].H0Texture->SetName(L"H0 Texture" + std::to_wstring(cascade));
+void Ocean::RequestSpectrum()
+{
+    m_spectrumDirty = true;
+}
 
-    std::vector<float> combinedData(OCEAN_SUBRES * OCEAN_SUBRES * 4);
+void Ocean::UpdateSpectrum()
+{
+    // The H0 textures are kept between builds and last read by the FFT passes, so they
+    // are uploaded on the compute queue: it can move them to COPY_DEST, a copy list
+    // can't take them out of NON_PIXEL_SHADER_RESOURCE. Queue order also keeps the
+    // copy behind the passes that still read the back textures.
+    auto& computeQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
 
-    for (int m = 0; m < OCEAN_SUBRES; m++) {
-        for (int n = 0; n < OCEAN_SUBRES; n++) {
-            int index = (m * OCEAN_SUBRES + n) * 4;
-            combinedData[index + 0] = H0[m * OCEAN_SUBRES + n].real();        // R: H0 real
-            combinedData[index + 1] = H0[m * OCEAN_SUBRES + n].imag();        // G: H0 imaginary
-            combinedData[index + 2] = H0Conj[m * OCEAN_SUBRES + n].real();    // B: H0_conj real
-            combinedData[index + 3] = H0Conj[m * OCEAN_SUBRES + n].imag();    // A: H0_conj imaginary
+    if (m_spectrumUpload)
+    {
+        // Swap on the first frame after the copy landed, the compute passes of this frame already read the new H0.
+        if (computeQueue.IsFenceComplete(m_spectrumUploadFence))
+        {
+            SwapSpectrum(*m_spectrumUpload);
+            m_spectrumUpload.reset();
         }
     }
+    else if (m_spectrumTask.valid() && m_spectrumTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        m_spectrumUpload = m_spectrumTask.get();
 
-    D3D12_SUBRESOURCE_DATA subData = {};
-    subData.pData = combinedData.data();
-    subData.RowPitch = OCEAN_SUBRES * 4 * sizeof(float);
-    subData.SlicePitch = subData.RowPitch * OCEAN_SUBRES;
+        auto commandList = computeQueue.GetCommandList();
+        UploadSpectrum(commandList, *m_spectrumUpload);
+        m_spectrumUploadFence = computeQueue.ExecuteCommandList(commandList);
+    }
 
-    // TODO clean this up... separate the jobs properly
-    // TODO also use one application get rather than keep calling it
+    // Only one build is in flight, every edit made in the meantime is folded into the next one.
+    if (m_spectrumDirty && !m_spectrumTask.valid() && !m_spectrumUpload)
+    {
+        std::vector<uint32_t> resolutions(m_oceanCascadesNumber);
+        for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+            resolutions[i] = m_oceanCascades[i].resolution;
 
-    // Create slope output texture
-    m_oceanCascades[cascade].slopeTexture = Application::Get().CreateTexture(phaseDesc);
-    m_oceanCascades[cascade].slopeTexture->SetName(L"Slope Output Texture" + std::to_wstring(cascade));
+        m_spectrumTask = std::async(std::launch::async, &Ocean::BuildSpectrum, this,
+            m_jonswapParams, m_noiseSeed, std::move(resolutions), m_plannerSettings, m_autoCascades, m_halfPrecision);
+        m_spectrumDirty = false;
+    }
+}
 
-    // Create phase output texture
-    m_oceanCascades[cascade].displacementTexture = Application::Get().CreateTexture(phaseDesc);
-    m_oceanCascades[cascade].displacementTexture->SetName(L"Displacement Output Texture" + std::to_wstring(cascade));
+void Ocean::BuildBoatHull()
+{
+    // In the space of the root node, scaled. The root's own transform is the pose.
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    if (m_boat)
+        GatherTriangles(*m_boat->GetRootNode(), XMMatrixScaling(m_boatScale, m_boatScale, m_boatScale), positions, indices);
+
+    m_boatHull = OceanBuoyancy::VoxelizeHull(positions.data(), static_cast<uint32_t>(positions.size() / 3),
+                                             indices.data(), static_cast<uint32_t>(indices.size()));
+}
 
-    // foam texture
-    m_oceanCascades[cascade].foamTexture = Application::Get().CreateTexture(foamDesc);
-    m_oceanCascades[cascade].foamTexture->SetName(L"Jacobian foam Texture" + std::to_wstring(cascade));
+void Ocean::LoadEnvironment(std::shared_ptr<CommandList> commandList, const fs::path& panoramaFile)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    OceanIBLCache cache(panoramaFile, m_iblSettings);
+    OceanIBLCacheEntry entry;
+    if (!cache.LoadOrBake(entry, &m_iblCacheHit, &m_iblBakeTimes))
+        throw std::exception("Failed to load or bake the image based lighting of the sky panorama.");
+
+    // Every image of the entry in one copy, the subresources of a cube are ordered like the images.
+    auto upload = [&](const ScratchImage& image, const wchar_t* name)
+    {
+        const TexMetadata& metadata = image.GetMetadata();
+        auto desc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, metadata.width, static_cast<UINT>(metadata.height),
+                                                 static_cast<UINT16>(metadata.arraySize), static_cast<UINT16>(metadata.mipLevels));
+        std::shared_ptr<Texture> texture = Application::Get().CreateTexture(desc);
+        texture->SetName(name);
+
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources(image.GetImageCount());
+        const Image* images = image.GetImages();
+        for (size_t i = 0; i < subresources.size(); ++i)
+        {
+            subresources[i].pData = images[i].pixels;
+            subresources[i].RowPitch = images[i].rowPitch;
+            subresources[i].SlicePitch = images[i].slicePitch;
+        }
+        commandList->CopyTextureSubresource(texture, 0, static_cast<uint32_t>(subresources.size()), subresources.data());
+        return texture;
+    };
+    m_skyboxCubemap = upload(entry.environment, L"Sky Cubemap");
+    m_specularIrradianceMap = upload(entry.specular, L"Specular Irradiance Texture");
 
+    D3D12_SHADER_RESOURCE_VIEW_DESC cubeSRVDesc = {};
+    cubeSRVDesc.Format = entry.environment.GetMetadata().format;
+    cubeSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    cubeSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+    cubeSRVDesc.TextureCube.MipLevels = (UINT)-1;  // Use all mips.
+    m_skyboxCubemapSRV = Application::Get().CreateShaderResourceView(m_skyboxCubemap, &cubeSRVDesc);
 
+    cubeSRVDesc.Format = entry.specular.GetMetadata().format;
+    m_specularCubemapSRV = Application::Get().CreateShaderResourceView(m_specularIrradianceMap, &cubeSRVDesc);
 
-    commandList->CopyTextureSubresource(m_oceanCascades[cascade].H0Texture, 0, 1, &subData);
+    static_assert(sizeof(m_irradiance.coefficients) == sizeof(float[9][4]), "IrradianceSH must match the layout of ToShaderConstants");
+    OceanIrradiance::ToShaderConstants(entry.irradiance, reinterpret_cast<float(*)[4]>(m_irradiance.coefficients));
+    m_iblLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
-float Ocean::GaussianRandom() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::normal_distribution<float> dist(0.0f, 1.0f); // mean=0, std=1
+void Ocean::LoadBrdfLut(std::shared_ptr<CommandList> commandList)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    const fs::path path = GetModulePath() + L"/brdf_lut.bin";
+
+    // The mapped file is the upload source, a generated LUT only exists in memory.
+    OceanBrdfLutBlob blob;
+    std::vector<uint8_t> generated;
+    m_brdfLutGenerated = !OceanBrdfLut::Load(path, blob);
+    if (m_brdfLutGenerated)
+    {
+        blob.desc = OceanBrdfLutDesc();
+        generated = OceanBrdfLut::Generate(blob.desc);
+        blob.texels = generated.data();
+        OceanBrdfLut::Store(path, blob.desc, blob.texels);
+    }
+    m_brdfLutDesc = blob.desc;
+
+    const DXGI_FORMAT format = m_brdfLutDesc.format == OBF_Half ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R8G8_UNORM;
+    auto desc = CD3DX12_RESOURCE_DESC::Tex2D(format, m_brdfLutDesc.size, m_brdfLutDesc.size, 1, 1);
+    m_brdfLUT = Application::Get().CreateTexture(desc);
+    m_brdfLUT->SetName(L"BRDF LUT");
+
+    D3D12_SUBRESOURCE_DATA subresource = {};
+    subresource.pData = blob.texels;
+    subresource.RowPitch = static_cast<LONG_PTR>(m_brdfLutDesc.size) * m_brdfLutDesc.GetTexelSize();
+    subresource.SlicePitch = static_cast<LONG_PTR>(m_brdfLutDesc.GetPayloadSize());
+    commandList->CopyTextureSubresource(m_brdfLUT, 0, 1, &subresource);
 
-    return dist(gen);
+    D3D12_SHADER_RESOURCE_VIEW_DESC brdfSRVDesc = {};
+    brdfSRVDesc.Format = format;
+    brdfSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    brdfSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    brdfSRVDesc.Texture2D.MipLevels = 1;
+    m_brdfLUTSRV = Application::Get().CreateShaderResourceView(m_brdfLUT, &brdfSRVDesc);
+    m_brdfLutLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
-float TMACorrection(float omega)
+void Ocean::SpawnBoats()
 {
-    // Acerola uses 20 for depth
-    float omegaH = omega * sqrt(OCEAN_DEPTH / 9.81f);
-    if (omegaH <= 1.0f)
-        return 0.5f * omegaH * omegaH;
-    if (omegaH < 2.0f)
-        return 1.0f - 0.5f * (2.0f - omegaH) * (2.0f - omegaH);
-
-    return 1.0f;
+    m_buoyancy.Clear();
+    if (m_boatHull.probeX.empty())
+        return;
+
+    // Rows along x, far enough apart that the hulls don't overlap.
+    float extent = 0.0f;
+    for (size_t i = 0; i < m_boatHull.probeX.size(); ++i)
+        extent = std::max({ extent, std::abs(m_boatHull.probeX[i]), std::abs(m_boatHull.probeZ[i]) });
+    const float spacing = 3.0f * extent + 2.0f * m_boatHull.probeSize;
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(m_boatCount))));
+
+    OceanBuoyancyBodyDesc desc;
+    desc.hull = &m_boatHull;
+    desc.mass = m_boatDensity * m_buoyancy.GetSettings().waterDensity * m_boatHull.volume;
+    for (int i = 0; i < m_boatCount; ++i)
+    {
+        desc.position[0] = (i % columns - 0.5f * (columns - 1)) * spacing;
+        desc.position[1] = 0.0f;
+        desc.position[2] = (i / columns - 0.5f * (columns - 1)) * spacing;
+        m_buoyancy.AddBody(desc);
+    }
 }
 
-float Ocean::JONSWAP(float omega)
+bool Ocean::LoadClip(const fs::path& path)
 {
-    float sigma = (omega <= m_jonswapParams.peakOmega) ? 0.07f : 0.09f;
-    float r = exp(-(omega - m_jonswapParams.peakOmega) * (omega - m_jonswapParams.peakOmega) / 2.0f / sigma / sigma / m_jonswapParams.peakOmega / m_jonswapParams.peakOmega);
-    float g = 9.81f;
+    m_clipPlayback = false;
+    m_clipFrame = UINT32_MAX;
 
-    float oneOverOmega = 1.0f / (omega + 1e-6f);
-    float peakOmegaOverOmega = m_jonswapParams.peakOmega / omega;
+    // The clip brings its own patch sizes, only the number of cascades has to match the shaders.
+    if (!m_clip.Open(path) || m_clip.GetDesc().cascades.size() != m_oceanCascadesNumber)
+    {
+        m_clip.Close();
+        return false;
+    }
+    m_clipPatchSizes.clear();
+    for (const OceanClipCascade& cascade : m_clip.GetDesc().cascades)
+        m_clipPatchSizes.push_back(cascade.patchSize);
 
-    return m_jonswapParams.scale * TMACorrection(omega) * m_jonswapParams.alpha * g * g * oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega 
-			* exp(-1.25f * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega) * pow(abs(m_jonswapParams.gamma), r);
+    for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+    {
+        const uint32_t resolution = m_clip.GetDesc().cascades[i].resolution;
+        OceanData& cascade = m_oceanCascades[i];
+
+        // Only ever written by uploads, a single mip is enough.
+        auto displacementDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16B16A16_FLOAT, resolution, resolution, 1, 1);
+        auto slopeDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16_FLOAT, resolution, resolution, 1, 1);
+        auto foamDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16_FLOAT, resolution, resolution, 1, 1);
+
+        cascade.clipDisplacementTexture = Application::Get().CreateTexture(displacementDesc);
+        cascade.clipDisplacementTexture->SetName(L"Clip Displacement Texture" + std::to_wstring(i));
+        cascade.clipSlopeTexture = Application::Get().CreateTexture(slopeDesc);
+        cascade.clipSlopeTexture->SetName(L"Clip Slope Texture" + std::to_wstring(i));
+        cascade.clipFoamTexture = Application::Get().CreateTexture(foamDesc);
+        cascade.clipFoamTexture->SetName(L"Clip Foam Texture" + std::to_wstring(i));
+    }
+    return true;
 }
-float Ocean::JonswapAlpha(float fetch, float windSpeed)
+
+void Ocean::UpdateClipPlayback(std::shared_ptr<CommandList> commandList, const double time)
 {
-    return 0.076f * pow(9.81f * fetch / windSpeed / windSpeed, - 0.22f);
+    // Nearest frame, the clip is only uploaded when the frame changes.
+    const uint32_t frame = m_clip.GetFrame(time);
+    if (frame == m_clipFrame)
+        return;
+
+    HighResolutionClock uploadClock;
+    if (!m_clip.Decode(frame, m_clipFrames))
+    {
+        m_clipPlayback = false;
+        return;
+    }
+
+    for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+    {
+        const OceanClipFrame& clipFrame = m_clipFrames[i];
+        const uint32_t resolution = clipFrame.resolution;
+        const size_t texelCount = static_cast<size_t>(resolution) * resolution;
+        m_clipTexels[0].resize(texelCount * 4);
+        m_clipTexels[1].resize(texelCount * 2);
+        m_clipTexels[2].resize(texelCount);
+        clipFrame.ToHalfTexels(m_clipTexels[0].data(), m_clipTexels[1].data(), m_clipTexels[2].data());
+        m_oceanCascades[i].clipDisplacementBounds = clipFrame.GetDisplacementBounds();
+
+        const std::shared_ptr<Texture> textures[] = { m_oceanCascades[i].clipDisplacementTexture, m_oceanCascades[i].clipSlopeTexture, m_oceanCascades[i].clipFoamTexture };
+        const UINT texelSizes[] = { 4 * sizeof(uint16_t), 2 * sizeof(uint16_t), sizeof(uint16_t) };
+        for (UINT texture = 0; texture < _countof(textures); ++texture)
+        {
+            D3D12_SUBRESOURCE_DATA subData = {};
+            subData.pData = m_clipTexels[texture].data();
+            subData.RowPitch = resolution * texelSizes[texture];
+            subData.SlicePitch = subData.RowPitch * resolution;
+            commandList->CopyTextureSubresource(textures[texture], 0, 1, &subData);
+        }
+    }
+
+    uploadClock.Tick();
+    m_clipUploadTime = uploadClock.GetDeltaMilliseconds();
+    m_clipFrame = frame;
 }
 
-float Ocean::JonswapPeakFequency(float fetch, float windSpeed)
+std::shared_ptr<OceanCompute> Ocean::GetFFTPSO(uint32_t resolution) const
 {
-    return 22.0f * pow(windSpeed * fetch / 9.81f / 9.81f, -0.33f);
+    assert(resolution >= OCEAN_MIN_SUBRES && resolution <= OCEAN_MAX_SUBRES && (resolution & (resolution - 1)) == 0);
+
+    UINT permutation = 0;
+    while ((OCEAN_MIN_SUBRES << permutation) < resolution)
+        ++permutation;
+    return m_fftPSOs[permutation];
 }
 
 void Ocean::UpdateSpectrumParameters()
@@ -1162,8 +1699,30 @@ void Ocean::UpdateSpectrumParameters()
     m_jonswapParams.windSpeed = 0.5f; // [0.0f, 100.0f]
 
     m_jonswapParams.angle = m_jonswapParams.windDirection / 180.0f * PI;
-    m_jonswapParams.alpha = JonswapAlpha(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
-    m_jonswapParams.peakOmega = JonswapPeakFequency(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
+    m_jonswapParams.alpha = OceanSpectrum::JonswapAlpha(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
+    m_jonswapParams.peakOmega = OceanSpectrum::JonswapPeakFequency(m_jonswapParams.fetch, m_jonswapParams.windSpeed);
+}
+
+OceanCascadePlan Ocean::PlanCascades(const JonswapParameters& params, const std::vector<uint32_t>& resolutions,
+                                     const OceanCascadePlannerSettings& settings, bool automatic)
+{
+    OceanCascadePlan plan = OceanCascadePlanner::Plan(params, resolutions, settings);
+    if (!automatic)
+    {
+        // The original hand tuned setup, every cascade starts at the Nyquist limit of the previous one.
+        static const float patchSizes[m_oceanCascadesNumber] = { 500.0f, 250.0f, 17.0f, 5.0f };
+        for (UINT i = 0; i < m_oceanCascadesNumber; ++i)
+        {
+            OceanCascadeDesc& desc = plan.cascades[i];
+            desc.patchSize = patchSizes[i];
+            desc.highCutoff = resolutions[i] * PI / patchSizes[i];
+            desc.lowCutoff = i == 0 ? 0.001f : plan.cascades[i - 1].highCutoff;
+            OceanCascadePlanner::IntegrateEnergy(params, desc.lowCutoff, desc.highCutoff, desc.depth,
+                plan.heightEnergy[i], plan.slopeEnergy[i]);
+        }
+        plan.activeMask = (1u << m_oceanCascadesNumber) - 1;
+    }
+    return plan;
 }
 
 void Ocean::OnKeyPress(KeyEventArgs& e)
@@ -0,0 +1,507 @@
+#include "ocean_spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ocean_noise.h"
+#include "ocean_simd.h"
+#include "utility/thread_pool.h"
+
+#define PI 3.14159265359f
+#define GRAVITY 9.81f
+
+using namespace EV;
+
+namespace
+{
+	// Rows handed to a worker at once. A 512 wide row is ~25us of work.
+	constexpr uint32_t ROWS_PER_JOB = 8;
+
+	float NormalizationFactor(float s)
+	{
+		float s2 = s * s;
+		float s3 = s2 * s;
+		float s4 = s3 * s;
+		if (s < 5) return -0.000564f * s4 + 0.00776f * s3 - 0.044f * s2 + 0.192f * s + 0.163f;
+		else return -4.80e-08f * s4 + 1.07e-05f * s3 - 9.53e-04f * s2 + 5.90e-02f * s + 3.93e-01f;
+	}
+
+	float Cosine2s(float theta, float s)
+	{
+		return NormalizationFactor(s) * std::pow(std::abs(std::cos(0.5f * theta)), 2.0f * s);
+	}
+
+	float SpreadPower(float omega, float peakOmega)
+	{
+		if (omega > peakOmega)
+			return 9.77f * std::pow(std::abs(omega / peakOmega), -2.5f);
+		else
+			return 6.97f * std::pow(std::abs(omega / peakOmega), 5.0f);
+	}
+
+	float TMACorrection(float omega, float depth)
+	{
+		// Acerola uses 20 for depth
+		float omegaH = omega * sqrt(depth / GRAVITY);
+		if (omegaH <= 1.0f)
+			return 0.5f * omegaH * omegaH;
+		if (omegaH < 2.0f)
+			return 1.0f - 0.5f * (2.0f - omegaH) * (2.0f - omegaH);
+
+		return 1.0f;
+	}
+
+	// Polynomial evaluation of both NormalizationFactor branches, selected per lane.
+	simd::Vec4 NormalizationFactor(simd::Vec4 s)
+	{
+		using namespace simd;
+		Vec4 low = Set(-0.000564f);
+		low = _mm_add_ps(_mm_mul_ps(low, s), Set(0.00776f));
+		low = _mm_add_ps(_mm_mul_ps(low, s), Set(-0.044f));
+		low = _mm_add_ps(_mm_mul_ps(low, s), Set(0.192f));
+		low = _mm_add_ps(_mm_mul_ps(low, s), Set(0.163f));
+
+		Vec4 high = Set(-4.80e-08f);
+		high = _mm_add_ps(_mm_mul_ps(high, s), Set(1.07e-05f));
+		high = _mm_add_ps(_mm_mul_ps(high, s), Set(-9.53e-04f));
+		high = _mm_add_ps(_mm_mul_ps(high, s), Set(5.90e-02f));
+		high = _mm_add_ps(_mm_mul_ps(high, s), Set(3.93e-01f));
+
+		return Select(_mm_cmplt_ps(s, Set(5.0f)), low, high);
+	}
+
+	// Runs func(begin, end) over texel ranges of whole rows on the thread pool.
+	template<typename Func>
+	void ParallelForTexels(uint32_t resolution, const Func& func)
+	{
+		ThreadPool::Get().ParallelFor(0, resolution, ROWS_PER_JOB, [&](uint32_t rowBegin, uint32_t rowEnd)
+		{
+			func(rowBegin * resolution, rowEnd * resolution);
+		});
+	}
+}
+
+float OceanSpectrum::DispersionRelation(float kMag, float depth)
+{
+	return sqrt(GRAVITY * kMag * tanh(std::min(kMag * depth, 20.0f)));
+}
+
+float OceanSpectrum::DispersionDerivative(float kMag, float depth)
+{
+	float th = tanh(std::min(kMag * depth, 20.0f));
+	float ch = cosh(kMag * depth);
+	return GRAVITY * (depth * kMag / ch / ch + th) / DispersionRelation(kMag, depth) / 2.0f;
+}
+
+float OceanSpectrum::DirectionSpectrum(const JonswapParameters& params, float theta, float omega)
+{
+	float s = SpreadPower(omega, params.peakOmega) + 16 * tanh(std::min(omega / params.peakOmega, 20.0f)) * params.swell * params.swell;
+
+	return std::lerp(2.0f / 3.1415f * cos(theta) * cos(theta), Cosine2s(theta - params.angle, s), params.spreadBlend);
+}
+
+float OceanSpectrum::ShortWavesFade(const JonswapParameters& params, float kLength)
+{
+	return exp(-params.shortWavesFade * params.shortWavesFade * kLength * kLength);
+}
+
+float OceanSpectrum::JONSWAP(const JonswapParameters& params, float omega, float depth)
+{
+	float sigma = (omega <= params.peakOmega) ? 0.07f : 0.09f;
+	float r = exp(-(omega - params.peakOmega) * (omega - params.peakOmega) / 2.0f / sigma / sigma / params.peakOmega / params.peakOmega);
+	float g = GRAVITY;
+
+	float oneOverOmega = 1.0f / (omega + 1e-6f);
+	float peakOmegaOverOmega = params.peakOmega / omega;
+
+	return params.scale * TMACorrection(omega, depth) * params.alpha * g * g * oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega
+		* exp(-1.25f * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega) * std::pow(std::abs(params.gamma), r);
+}
+
+float OceanSpectrum::JonswapAlpha(float fetch, float windSpeed)
+{
+	return 0.076f * pow(GRAVITY * fetch / windSpeed / windSpeed, -0.22f);
+}
+
+float OceanSpectrum::JonswapPeakFequency(float fetch, float windSpeed)
+{
+	return 22.0f * pow(windSpeed * fetch / GRAVITY / GRAVITY, -0.33f);
+}
+
+uint32_t OceanSpectrum::PlanRebuild(const JonswapParameters& previous, const JonswapParameters& next)
+{
+	uint32_t flags = SDF_None;
+
+	// fetch and wind speed only reach the spectrum through alpha and the peak frequency.
+	// The peak also drives the spread power, so moving it touches both terms.
+	if (previous.alpha != next.alpha || previous.peakOmega != next.peakOmega)
+		flags |= SDF_Radial | SDF_Directional;
+	if (previous.gamma != next.gamma || previous.shortWavesFade != next.shortWavesFade)
+		flags |= SDF_Radial;
+	if (previous.angle != next.angle || previous.spreadBlend != next.spreadBlend || previous.swell != next.swell)
+		flags |= SDF_Directional;
+	if (previous.scale != next.scale)
+		flags |= SDF_Scale;
+
+	return flags;
+}
+
+void OceanSpectrum::BuildKTable(OceanKTable& table, uint32_t begin, uint32_t end)
+{
+	using namespace simd;
+
+	const OceanCascadeDesc& desc = table.desc;
+	const uint32_t N = desc.resolution;
+	const float deltaK = 2.0f * PI / desc.patchSize;
+	const float halfN = N / 2.0f;
+
+	const Vec4 one = Set(1.0f);
+	const Vec4 depth = Set(desc.depth);
+	const Vec4 laneOffset = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		const uint32_t m = i / N;
+		const uint32_t n = i % N;
+
+		Vec4 kx = _mm_mul_ps(_mm_add_ps(Set(n - halfN), laneOffset), Set(deltaK));
+		Vec4 ky = Set((m - halfN) * deltaK);
+
+		Vec4 k = Sqrt(_mm_add_ps(_mm_mul_ps(kx, kx), _mm_mul_ps(ky, ky)));
+		Vec4 valid = _mm_and_ps(_mm_cmpge_ps(k, Set(desc.lowCutoff)), _mm_cmple_ps(k, Set(desc.highCutoff)));
+		Vec4 rcpK = _mm_div_ps(one, Max(k, Set(1e-6f)));
+
+		// Dispersion relation and its derivative (finite depth).
+		Vec4 th = TanhPositive(Min(_mm_mul_ps(k, depth), Set(20.0f)));
+		Vec4 omega = Sqrt(_mm_mul_ps(_mm_mul_ps(Set(GRAVITY), k), th));
+		Vec4 sech2 = SechSquaredPositive(_mm_mul_ps(k, depth));
+		Vec4 dOmegadk = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(depth, k), sech2), th);
+		dOmegadk = _mm_div_ps(_mm_mul_ps(Set(GRAVITY * 0.5f), dOmegadk), omega);
+
+		// TMA correction
+		Vec4 omegaH = _mm_mul_ps(omega, Set(sqrtf(desc.depth / GRAVITY)));
+		Vec4 twoMinusH = _mm_sub_ps(Set(2.0f), omegaH);
+		Vec4 tma = Select(_mm_cmple_ps(omegaH, one), _mm_mul_ps(Set(0.5f), _mm_mul_ps(omegaH, omegaH)),
+		           Select(_mm_cmplt_ps(omegaH, Set(2.0f)), _mm_sub_ps(one, _mm_mul_ps(Set(0.5f), _mm_mul_ps(twoMinusH, twoMinusH))), one));
+
+		Vec4 factor = _mm_mul_ps(_mm_mul_ps(Set(2.0f * deltaK * deltaK), Abs(dOmegadk)), rcpK);
+		factor = _mm_and_ps(valid, Sqrt(Max(factor, _mm_setzero_ps())));
+
+		Store(&table.k[i], k);
+		Store(&table.dirX[i], _mm_mul_ps(kx, rcpK));
+		Store(&table.dirY[i], _mm_mul_ps(ky, rcpK));
+		Store(&table.omega[i], omega);
+		Store(&table.tma[i], tma);
+		Store(&table.factor[i], factor);
+	}
+}
+
+void OceanSpectrum::BuildRadial(const JonswapParameters& params, const OceanKTable& table, float* outRadial, uint32_t begin, uint32_t end)
+{
+	using namespace simd;
+
+	const Vec4 one = Set(1.0f);
+	const Vec4 peakOmega = Set(params.peakOmega);
+	const Vec4 gamma = Set(params.gamma);
+	const Vec4 fadeScale = Set(-params.shortWavesFade * params.shortWavesFade);
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		Vec4 k = Load(&table.k[i]);
+		Vec4 omega = Load(&table.omega[i]);
+
+		// JONSWAP, without the scale which is applied last.
+		Vec4 sigma = Select(_mm_cmple_ps(omega, peakOmega), Set(0.07f), Set(0.09f));
+		Vec4 d = _mm_sub_ps(omega, peakOmega);
+		Vec4 sigmaPeak = _mm_mul_ps(sigma, peakOmega);
+		Vec4 r = Exp(_mm_div_ps(_mm_mul_ps(Set(-0.5f), _mm_mul_ps(d, d)), _mm_mul_ps(sigmaPeak, sigmaPeak)));
+
+		Vec4 oneOverOmega = _mm_div_ps(one, _mm_add_ps(omega, Set(1e-6f)));
+		Vec4 oneOverOmega2 = _mm_mul_ps(oneOverOmega, oneOverOmega);
+		Vec4 oneOverOmega5 = _mm_mul_ps(_mm_mul_ps(oneOverOmega2, oneOverOmega2), oneOverOmega);
+		Vec4 peakOverOmega = _mm_div_ps(peakOmega, omega);
+		Vec4 peakOverOmega2 = _mm_mul_ps(peakOverOmega, peakOverOmega);
+
+		Vec4 jonswap = _mm_mul_ps(Set(params.alpha * GRAVITY * GRAVITY), Load(&table.tma[i]));
+		jonswap = _mm_mul_ps(jonswap, oneOverOmega5);
+		jonswap = _mm_mul_ps(jonswap, Exp(_mm_mul_ps(Set(-1.25f), _mm_mul_ps(peakOverOmega2, peakOverOmega2))));
+		jonswap = _mm_mul_ps(jonswap, Pow(gamma, r));
+
+		Vec4 fade = Exp(_mm_mul_ps(fadeScale, _mm_mul_ps(k, k)));
+
+		Store(outRadial + i, _mm_mul_ps(jonswap, fade));
+	}
+}
+
+void OceanSpectrum::BuildDirectional(const JonswapParameters& params, const OceanKTable& table, float* outDirectional, uint32_t begin, uint32_t end)
+{
+	using namespace simd;
+
+	const Vec4 peakOmega = Set(params.peakOmega);
+	const Vec4 swell = Set(16.0f * params.swell * params.swell);
+	const Vec4 windX = Set(cosf(params.angle));
+	const Vec4 windY = Set(sinf(params.angle));
+	const Vec4 spreadBlend = Set(params.spreadBlend);
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		Vec4 omega = Load(&table.omega[i]);
+		Vec4 cosTheta = Load(&table.dirX[i]);
+		Vec4 sinTheta = Load(&table.dirY[i]);
+
+		// Both SpreadPower branches are a power of the same ratio, pick the
+		// coefficients per lane and evaluate a single pow.
+		Vec4 omegaRatio = _mm_div_ps(omega, peakOmega);
+		Vec4 abovePeak = _mm_cmpgt_ps(omega, peakOmega);
+		Vec4 spread = _mm_mul_ps(Select(abovePeak, Set(9.77f), Set(6.97f)),
+			Pow(omegaRatio, Select(abovePeak, Set(-2.5f), Set(5.0f))));
+		Vec4 s = _mm_add_ps(spread, _mm_mul_ps(swell, TanhPositive(Min(omegaRatio, Set(20.0f)))));
+
+		// cos(theta) and the half angle cosine of phi = (theta - windAngle)
+		// follow from k directly, no atan2/cos needed:
+		// |cos(phi / 2)|^(2s) == ((1 + cos(phi)) / 2)^s == (|k / |k| + windDir|^2 / 4)^s
+		// The last form keeps its precision for waves running against the wind.
+		Vec4 halfX = _mm_add_ps(cosTheta, windX);
+		Vec4 halfY = _mm_add_ps(sinTheta, windY);
+		Vec4 halfCos2 = _mm_mul_ps(Set(0.25f), _mm_add_ps(_mm_mul_ps(halfX, halfX), _mm_mul_ps(halfY, halfY)));
+		Vec4 cosine2s = _mm_mul_ps(NormalizationFactor(s), Pow(halfCos2, s));
+		Vec4 isotropic = _mm_mul_ps(Set(2.0f / 3.1415f), _mm_mul_ps(cosTheta, cosTheta));
+
+		Store(outDirectional + i, Lerp(isotropic, cosine2s, spreadBlend));
+	}
+}
+
+void OceanSpectrum::BuildAmplitude(const OceanKTable& table, const float* radial, const float* directional, float* outAmplitude, uint32_t begin, uint32_t end)
+{
+	using namespace simd;
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		Vec4 factor = Load(&table.factor[i]);
+		Vec4 spectrum = _mm_mul_ps(Load(radial + i), Load(directional + i));
+		Vec4 amplitude = _mm_mul_ps(factor, Sqrt(Max(spectrum, _mm_setzero_ps())));
+
+		// The terms are not finite at k = 0, the mask clears whatever ended up there.
+		Store(outAmplitude + i, _mm_and_ps(_mm_cmpgt_ps(factor, _mm_setzero_ps()), amplitude));
+	}
+}
+
+void OceanSpectrum::ApplyNoise(float scale, const float* amplitude, const std::complex<float>* noise, std::complex<float>* outH0, uint32_t begin, uint32_t end)
+{
+	using namespace simd;
+
+	const Vec4 scaleRoot = Set(sqrtf(std::max(scale, 0.0f)));
+	const float* noiseFloats = reinterpret_cast<const float*>(noise);
+	float* H0Floats = reinterpret_cast<float*>(outH0);
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		Vec4 a = _mm_mul_ps(Load(amplitude + i), scaleRoot);
+
+		// noise is interleaved (re, im), duplicate each amplitude for both parts.
+		Store(H0Floats + i * 2 + 0, _mm_mul_ps(Load(noiseFloats + i * 2 + 0), _mm_unpacklo_ps(a, a)));
+		Store(H0Floats + i * 2 + 4, _mm_mul_ps(Load(noiseFloats + i * 2 + 4), _mm_unpackhi_ps(a, a)));
+	}
+}
+
+void OceanSpectrum::BuildH0(const JonswapParameters& params, const OceanCascadeDesc& cascade, const std::complex<float>* noise, float* outRGBA)
+{
+	const uint32_t N = cascade.resolution;
+	const size_t count = static_cast<size_t>(N) * N;
+
+	OceanKTable table;
+	table.desc = cascade;
+	for (auto* term : { &table.k, &table.dirX, &table.dirY, &table.omega, &table.tma, &table.factor })
+		term->resize(count);
+
+	std::vector<float> radial(count);
+	std::vector<float> directional(count);
+	std::vector<float> amplitude(count);
+	std::vector<std::complex<float>> H0(count);
+
+	ParallelForTexels(N, [&](uint32_t begin, uint32_t end)
+	{
+		BuildKTable(table, begin, end);
+		BuildRadial(params, table, radial.data(), begin, end);
+		BuildDirectional(params, table, directional.data(), begin, end);
+		BuildAmplitude(table, radial.data(), directional.data(), amplitude.data(), begin, end);
+		ApplyNoise(params.scale, amplitude.data(), noise, H0.data(), begin, end);
+	});
+
+	PackH0(H0, N, outRGBA, true);
+}
+
+void OceanSpectrum::BuildH0Reference(const JonswapParameters& params, const OceanCascadeDesc& cascade, const std::complex<float>* noise, float* outRGBA)
+{
+	const uint32_t N = cascade.resolution;
+	const float deltaK = 2.0f * PI / cascade.patchSize;
+
+	std::vector<std::complex<float>> H0(N * N, { 0,0 });
+
+	for (int m = 0; m < (int)N; m++) {
+		for (int n = 0; n < (int)N; n++) {
+			// Get wave vector for this frequency
+			float kx = (n - N / 2.0f) * deltaK;
+			float ky = (m - N / 2.0f) * deltaK;
+			float k(sqrtf(kx * kx + ky * ky));
+
+			if (k >= cascade.lowCutoff && k <= cascade.highCutoff)
+			{
+				float kAngle = atan2(ky, kx);
+				float omega = DispersionRelation(k, cascade.depth);
+				float dOmegadk = DispersionDerivative(k, cascade.depth);
+
+				float spectrum = JONSWAP(params, omega, cascade.depth) * DirectionSpectrum(params, kAngle, omega) * ShortWavesFade(params, k);
+
+				float amplitude = sqrtf(2.0f * spectrum * fabsf(dOmegadk) / k * deltaK * deltaK);
+				H0[m * N + n] = noise[m * N + n] * amplitude;
+			}
+		}
+	}
+
+	PackH0(H0, N, outRGBA, false);
+}
+
+void OceanSpectrum::PackH0(const std::vector<std::complex<float>>& H0, uint32_t resolution, float* outRGBA, bool parallel)
+{
+	const uint32_t N = resolution;
+
+	// The conjugate needs all data of H0 to be valid, so this runs after the spectrum pass.
+	auto packRows = [&](uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t m = rowBegin; m < rowEnd; m++) {
+			const uint32_t mMinus = (N - m) % N;
+			for (uint32_t n = 0; n < N; n++) {
+				const uint32_t nMinus = (N - n) % N;
+				const std::complex<float> h0 = H0[m * N + n];
+				const std::complex<float> h0Conj = std::conj(H0[mMinus * N + nMinus]);
+
+				float* texel = outRGBA + (m * N + n) * 4;
+				texel[0] = h0.real();       // R: H0 real
+				texel[1] = h0.imag();       // G: H0 imaginary
+				texel[2] = h0Conj.real();   // B: H0_conj real
+				texel[3] = h0Conj.imag();   // A: H0_conj imaginary
+			}
+		}
+	};
+
+	if (parallel)
+		ThreadPool::Get().ParallelFor(0, N, ROWS_PER_JOB * 4, packRows);
+	else
+		packRows(0, N);
+}
+
+OceanDisplacementBounds OceanSpectrum::DisplacementBounds(const OceanCascadeDesc& cascade, const float* packedH0, float choppiness)
+{
+	const uint32_t N = cascade.resolution;
+
+	// Per row sums of |h|, |h| |k.x| / |k| and |h| |k.y| / |k|, added up in order so the result doesn't depend on the split.
+	std::vector<double> rowSums(static_cast<size_t>(N) * 3);
+	ThreadPool::Get().ParallelFor(0, N, ROWS_PER_JOB * 4, [&](uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t m = rowBegin; m < rowEnd; ++m)
+		{
+			const float ky = m - N / 2.0f;
+			double height = 0.0, x = 0.0, z = 0.0;
+			for (uint32_t n = 0; n < N; ++n)
+			{
+				const float kx = n - N / 2.0f;
+				const float* texel = packedH0 + (static_cast<size_t>(m) * N + n) * 4;
+				const float amplitude = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1]) + std::sqrt(texel[2] * texel[2] + texel[3] * texel[3]);
+
+				// Only the direction of k matters, texel units will do. The origin moves nothing sideways.
+				const float k = std::sqrt(kx * kx + ky * ky);
+				const float kRcp = k > 0.0f ? 1.0f / k : 0.0f;
+				height += amplitude;
+				x += amplitude * std::abs(kx) * kRcp;
+				z += amplitude * std::abs(ky) * kRcp;
+			}
+			rowSums[m * 3 + 0] = height;
+			rowSums[m * 3 + 1] = x;
+			rowSums[m * 3 + 2] = z;
+		}
+	});
+
+	double height = 0.0, x = 0.0, z = 0.0;
+	for (uint32_t m = 0; m < N; ++m)
+	{
+		height += rowSums[m * 3 + 0];
+		x += rowSums[m * 3 + 1];
+		z += rowSums[m * 3 + 2];
+	}
+
+	OceanDisplacementBounds bounds;
+	bounds.vertical = static_cast<float>(height);
+	bounds.horizontal = choppiness * static_cast<float>(std::max(x, z));
+	return bounds;
+}
+
+OceanDisplacementBounds OceanSpectrum::SumDisplacementBounds(const OceanDisplacementBounds* bounds, uint32_t count, uint32_t mask)
+{
+	OceanDisplacementBounds sum;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!(mask & (1u << i)))
+			continue;
+		sum.horizontal += bounds[i].horizontal;
+		sum.vertical += bounds[i].vertical;
+	}
+	return sum;
+}
+
+uint32_t OceanCascadeSpectrum::Update(const JonswapParameters& params, const OceanCascadeDesc& cascade, uint64_t seed, uint32_t cascadeIndex)
+{
+	const uint32_t N = cascade.resolution;
+	const size_t count = static_cast<size_t>(N) * N;
+
+	uint32_t flags = SDF_All;
+	if (m_valid)
+	{
+		flags = OceanSpectrum::PlanRebuild(m_params, params);
+		if (!(m_table.desc == cascade))
+			flags |= SDF_KTable | SDF_Radial | SDF_Directional;
+		if (m_table.desc.resolution != N || m_seed != seed || m_cascadeIndex != cascadeIndex)
+			flags |= SDF_Noise;
+	}
+
+	if (flags == SDF_None)
+		return flags;
+
+	if (flags & SDF_KTable)
+	{
+		m_table.desc = cascade;
+		for (auto* term : { &m_table.k, &m_table.dirX, &m_table.dirY, &m_table.omega, &m_table.tma, &m_table.factor,
+		                    &m_radial, &m_directional, &m_amplitude })
+			term->resize(count);
+		m_noise.resize(count);
+		m_H0.resize(count);
+		m_packedH0.resize(count * 4);
+	}
+
+	if (flags & SDF_Noise)
+		OceanNoise::Generate(seed, cascadeIndex, N, m_noise.data());
+
+	ParallelForTexels(N, [&](uint32_t begin, uint32_t end)
+	{
+		if (flags & SDF_KTable)
+			OceanSpectrum::BuildKTable(m_table, begin, end);
+		if (flags & SDF_Radial)
+			OceanSpectrum::BuildRadial(params, m_table, m_radial.data(), begin, end);
+		if (flags & SDF_Directional)
+			OceanSpectrum::BuildDirectional(params, m_table, m_directional.data(), begin, end);
+		if (flags & (SDF_Radial | SDF_Directional))
+			OceanSpectrum::BuildAmplitude(m_table, m_radial.data(), m_directional.data(), m_amplitude.data(), begin, end);
+
+		// Everything, the scale included, ends up in this multiply.
+		OceanSpectrum::ApplyNoise(params.scale, m_amplitude.data(), m_noise.data(), m_H0.data(), begin, end);
+	});
+
+	OceanSpectrum::PackH0(m_H0, N, m_packedH0.data(), true);
+
+	m_valid = true;
+	m_params = params;
+	m_seed = seed;
+	m_cascadeIndex = cascadeIndex;
+
+	return flags;
+}
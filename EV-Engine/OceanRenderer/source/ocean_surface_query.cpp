@@ -0,0 +1,314 @@
+#include "ocean_surface_query.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ocean_simd.h"
+#include "utility/thread_pool.h"
+
+using namespace EV;
+using namespace EV::simd;
+
+namespace
+{
+	constexpr uint32_t LANES = 4;
+	// 4 point groups per thread pool job, 256 points.
+	constexpr uint32_t QUERY_GROUPS_PER_JOB = 64;
+
+	// Texels and weights of a bilinear sample for 4 points, shared by every
+	// field of a cascade. Indices are already wrapped and point at the
+	// interleaved surface texels.
+	struct Footprint
+	{
+		alignas(16) int32_t index[LANES][4]; // [lane] (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+		Vec4 weights[LANES];                 // [lane] in the same order
+	};
+
+	uint32_t Log2(uint32_t N)
+	{
+		uint32_t log2N = 0;
+		while ((1u << log2N) < N)
+			++log2N;
+		return log2N;
+	}
+
+	void ComputeFootprint(const OceanCascadeDesc& desc, Vec4 x, Vec4 z, Footprint& footprint)
+	{
+		const uint32_t N = desc.resolution;
+		const Vec4 rcpPatch = Set(1.0f / desc.patchSize);
+		const __m128i mask = _mm_set1_epi32(static_cast<int>(N - 1));
+
+		// Wrap to [0, 1) first so far away queries keep their precision.
+		Vec4 u = _mm_mul_ps(x, rcpPatch);
+		Vec4 v = _mm_mul_ps(z, rcpPatch);
+		u = _mm_sub_ps(u, Floor(u));
+		v = _mm_sub_ps(v, Floor(v));
+
+		// Texel centers sit at (i + 0.5) / N.
+		Vec4 tu = _mm_sub_ps(_mm_mul_ps(u, Set(static_cast<float>(N))), Set(0.5f));
+		Vec4 tv = _mm_sub_ps(_mm_mul_ps(v, Set(static_cast<float>(N))), Set(0.5f));
+		Vec4 fu = Floor(tu);
+		Vec4 fv = Floor(tv);
+		Vec4 fractionX = _mm_sub_ps(tu, fu);
+		Vec4 fractionY = _mm_sub_ps(tv, fv);
+
+		__m128i x0 = _mm_and_si128(_mm_cvttps_epi32(fu), mask);
+		__m128i y0 = _mm_and_si128(_mm_cvttps_epi32(fv), mask);
+		__m128i x1 = _mm_and_si128(_mm_add_epi32(x0, _mm_set1_epi32(1)), mask);
+		__m128i y1 = _mm_and_si128(_mm_add_epi32(y0, _mm_set1_epi32(1)), mask);
+
+		const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(Log2(N)));
+		y0 = _mm_sll_epi32(y0, shift);
+		y1 = _mm_sll_epi32(y1, shift);
+
+		// Lane major, so each point reads its own 4 taps.
+		Vec4 i00 = _mm_castsi128_ps(_mm_add_epi32(y0, x0));
+		Vec4 i10 = _mm_castsi128_ps(_mm_add_epi32(y0, x1));
+		Vec4 i01 = _mm_castsi128_ps(_mm_add_epi32(y1, x0));
+		Vec4 i11 = _mm_castsi128_ps(_mm_add_epi32(y1, x1));
+		_MM_TRANSPOSE4_PS(i00, i10, i01, i11);
+		_mm_store_ps(reinterpret_cast<float*>(footprint.index[0]), i00);
+		_mm_store_ps(reinterpret_cast<float*>(footprint.index[1]), i10);
+		_mm_store_ps(reinterpret_cast<float*>(footprint.index[2]), i01);
+		_mm_store_ps(reinterpret_cast<float*>(footprint.index[3]), i11);
+
+		const Vec4 one = Set(1.0f);
+		Vec4 w00 = _mm_mul_ps(_mm_sub_ps(one, fractionX), _mm_sub_ps(one, fractionY));
+		Vec4 w10 = _mm_mul_ps(fractionX, _mm_sub_ps(one, fractionY));
+		Vec4 w01 = _mm_mul_ps(_mm_sub_ps(one, fractionX), fractionY);
+		Vec4 w11 = _mm_mul_ps(fractionX, fractionY);
+		_MM_TRANSPOSE4_PS(w00, w10, w01, w11);
+		footprint.weights[0] = w00;
+		footprint.weights[1] = w10;
+		footprint.weights[2] = w01;
+		footprint.weights[3] = w11;
+	}
+
+	template<int Tap>
+	inline Vec4 Broadcast(Vec4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(Tap, Tap, Tap, Tap));
+	}
+
+	// Filters 4 consecutive floats of the texels of one lane, offset 0 gives
+	// (displacementX, displacementY, displacementZ, foam), 4 gives (slopeX, slopeZ, 0, 0).
+	inline Vec4 Sample(const float* surface, const int32_t* index, Vec4 weights, uint32_t offset)
+	{
+		const uint32_t stride = OceanCpuSimulator::SURFACE_STRIDE;
+		Vec4 result = _mm_mul_ps(Load(surface + index[0] * stride + offset), Broadcast<0>(weights));
+		result = _mm_add_ps(result, _mm_mul_ps(Load(surface + index[1] * stride + offset), Broadcast<1>(weights)));
+		result = _mm_add_ps(result, _mm_mul_ps(Load(surface + index[2] * stride + offset), Broadcast<2>(weights)));
+		result = _mm_add_ps(result, _mm_mul_ps(Load(surface + index[3] * stride + offset), Broadcast<3>(weights)));
+		return result;
+	}
+
+	// Sums the fields of every cascade at (x, z), transposed back to one field
+	// per vector: (displacementX, displacementY, displacementZ, foam) and, if
+	// outSlopes is set, (slopeX, slopeZ, 0, 0).
+	void SampleCascades(const OceanCpuSimulator& simulator, Vec4 x, Vec4 z, Vec4 outFields[4], Vec4 outSlopes[4])
+	{
+		Vec4 fields[LANES] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		Vec4 slopes[LANES] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		Footprint footprint;
+
+		for (uint32_t c = 0; c < simulator.GetCascadeCount(); ++c)
+		{
+			const OceanCpuSimulator::Cascade& cascade = simulator.GetCascade(c);
+			if (cascade.desc.resolution == 0)
+				continue;
+
+			ComputeFootprint(cascade.desc, x, z, footprint);
+			const float* surface = cascade.surface.data();
+			for (uint32_t lane = 0; lane < LANES; ++lane)
+			{
+				fields[lane] = _mm_add_ps(fields[lane], Sample(surface, footprint.index[lane], footprint.weights[lane], 0));
+				if (outSlopes)
+					slopes[lane] = _mm_add_ps(slopes[lane], Sample(surface, footprint.index[lane], footprint.weights[lane], 4));
+			}
+		}
+
+		_MM_TRANSPOSE4_PS(fields[0], fields[1], fields[2], fields[3]);
+		for (uint32_t i = 0; i < 4; ++i)
+			outFields[i] = fields[i];
+
+		if (outSlopes)
+		{
+			_MM_TRANSPOSE4_PS(slopes[0], slopes[1], slopes[2], slopes[3]);
+			for (uint32_t i = 0; i < 4; ++i)
+				outSlopes[i] = slopes[i];
+		}
+	}
+
+	void Query4(const OceanCpuSimulator& simulator, uint32_t iterations, Vec4 targetX, Vec4 targetZ,
+	            Vec4* outHeight, Vec4* outNormalX, Vec4* outNormalY, Vec4* outNormalZ, Vec4* outFoam)
+	{
+		Vec4 displacement[4];
+
+		Vec4 x = targetX;
+		Vec4 z = targetZ;
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			SampleCascades(simulator, x, z, displacement, nullptr);
+			x = _mm_sub_ps(targetX, displacement[0]);
+			z = _mm_sub_ps(targetZ, displacement[2]);
+		}
+
+		// The slopes sit in the same cache line as the displacement.
+		Vec4 slopes[4];
+		SampleCascades(simulator, x, z, displacement, slopes);
+
+		// normalize(-slope.x, 1, -slope.y)
+		const Vec4 slopeX = slopes[0];
+		const Vec4 slopeZ = slopes[1];
+		Vec4 rcpLength = _mm_div_ps(Set(1.0f), Sqrt(_mm_add_ps(_mm_add_ps(_mm_mul_ps(slopeX, slopeX), _mm_mul_ps(slopeZ, slopeZ)), Set(1.0f))));
+		const Vec4 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+
+		*outHeight = displacement[1];
+		*outNormalX = _mm_xor_ps(_mm_mul_ps(slopeX, rcpLength), signMask);
+		*outNormalY = rcpLength;
+		*outNormalZ = _mm_xor_ps(_mm_mul_ps(slopeZ, rcpLength), signMask);
+		*outFoam = Min(Max(displacement[3], _mm_setzero_ps()), Set(1.0f));
+	}
+
+	inline void StoreOutput(float* output, uint32_t offset, uint32_t count, Vec4 value)
+	{
+		if (!output)
+			return;
+
+		if (count == LANES)
+		{
+			Store(output + offset, value);
+			return;
+		}
+
+		alignas(16) float lanes[LANES];
+		_mm_store_ps(lanes, value);
+		std::copy(lanes, lanes + count, output + offset);
+	}
+
+	float SampleReference(const OceanCascadeDesc& desc, const std::vector<float>& plane, float x, float z)
+	{
+		const uint32_t N = desc.resolution;
+		const float rcpPatch = 1.0f / desc.patchSize;
+
+		float u = x * rcpPatch;
+		float v = z * rcpPatch;
+		u -= std::floor(u);
+		v -= std::floor(v);
+
+		float tu = u * N - 0.5f;
+		float tv = v * N - 0.5f;
+		float fu = std::floor(tu);
+		float fv = std::floor(tv);
+		float fractionX = tu - fu;
+		float fractionY = tv - fv;
+
+		uint32_t x0 = static_cast<uint32_t>(static_cast<int32_t>(fu)) & (N - 1);
+		uint32_t y0 = static_cast<uint32_t>(static_cast<int32_t>(fv)) & (N - 1);
+		uint32_t x1 = (x0 + 1) & (N - 1);
+		uint32_t y1 = (y0 + 1) & (N - 1);
+
+		float result = plane[y0 * N + x0] * ((1.0f - fractionX) * (1.0f - fractionY));
+		result += plane[y0 * N + x1] * (fractionX * (1.0f - fractionY));
+		result += plane[y1 * N + x0] * ((1.0f - fractionX) * fractionY);
+		result += plane[y1 * N + x1] * (fractionX * fractionY);
+		return result;
+	}
+}
+
+void OceanSurface::Query(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query)
+{
+	// Large batches are split over the thread pool, small ones stay on the caller.
+	const uint32_t groups = (query.count + LANES - 1) / LANES;
+	ThreadPool::Get().ParallelFor(0, groups, QUERY_GROUPS_PER_JOB, [&](uint32_t groupBegin, uint32_t groupEnd)
+	{
+		QueryRange(simulator, query, groupBegin * LANES, std::min(query.count, groupEnd * LANES));
+	});
+}
+
+void OceanSurface::QueryRange(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; i += LANES)
+	{
+		const uint32_t count = std::min(LANES, end - i);
+
+		Vec4 x, z;
+		if (count == LANES)
+		{
+			x = Load(query.x + i);
+			z = Load(query.z + i);
+		}
+		else
+		{
+			// Pad the tail with its last point.
+			alignas(16) float paddedX[LANES];
+			alignas(16) float paddedZ[LANES];
+			for (uint32_t lane = 0; lane < LANES; ++lane)
+			{
+				paddedX[lane] = query.x[i + std::min(lane, count - 1)];
+				paddedZ[lane] = query.z[i + std::min(lane, count - 1)];
+			}
+			x = _mm_load_ps(paddedX);
+			z = _mm_load_ps(paddedZ);
+		}
+
+		Vec4 height, normalX, normalY, normalZ, foam;
+		Query4(simulator, query.iterations, x, z, &height, &normalX, &normalY, &normalZ, &foam);
+
+		StoreOutput(query.height, i, count, height);
+		StoreOutput(query.normalX, i, count, normalX);
+		StoreOutput(query.normalY, i, count, normalY);
+		StoreOutput(query.normalZ, i, count, normalZ);
+		StoreOutput(query.foam, i, count, foam);
+	}
+}
+
+void OceanSurface::QueryReference(const OceanCpuSimulator& simulator, const OceanSurfaceQuery& query)
+{
+	const uint32_t numCascades = simulator.GetCascadeCount();
+
+	for (uint32_t i = 0; i < query.count; ++i)
+	{
+		float x = query.x[i];
+		float z = query.z[i];
+		for (uint32_t iteration = 0; iteration < query.iterations; ++iteration)
+		{
+			float dx = 0.0f;
+			float dz = 0.0f;
+			for (uint32_t c = 0; c < numCascades; ++c)
+			{
+				const OceanCpuSimulator::Cascade& cascade = simulator.GetCascade(c);
+				if (cascade.desc.resolution == 0)
+					continue;
+
+				dx += SampleReference(cascade.desc, cascade.displacementX, x, z);
+				dz += SampleReference(cascade.desc, cascade.displacementZ, x, z);
+			}
+			x = query.x[i] - dx;
+			z = query.z[i] - dz;
+		}
+
+		float height = 0.0f;
+		float slopeX = 0.0f;
+		float slopeZ = 0.0f;
+		float foam = 0.0f;
+		for (uint32_t c = 0; c < numCascades; ++c)
+		{
+			const OceanCpuSimulator::Cascade& cascade = simulator.GetCascade(c);
+			if (cascade.desc.resolution == 0)
+				continue;
+
+			height += SampleReference(cascade.desc, cascade.displacementY, x, z);
+			slopeX += SampleReference(cascade.desc, cascade.slopeX, x, z);
+			slopeZ += SampleReference(cascade.desc, cascade.slopeZ, x, z);
+			foam += SampleReference(cascade.desc, cascade.foam, x, z);
+		}
+
+		float rcpLength = 1.0f / std::sqrt(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+		if (query.height) query.height[i] = height;
+		if (query.normalX) query.normalX[i] = -slopeX * rcpLength;
+		if (query.normalY) query.normalY[i] = rcpLength;
+		if (query.normalZ) query.normalZ[i] = -slopeZ * rcpLength;
+		if (query.foam) query.foam[i] = std::clamp(foam, 0.0f, 1.0f);
+	}
+}